@@ -65,13 +65,14 @@ Batch::lastJob()
 }
 
 void
-Batch::startPrepare(Job& job, pid_t p)
+Batch::startPrepare(Job& job, pid_t p, bool child)
 {
     fxAssert(pid == 0, "PID not empty for Batch::startPrepare()");
     fxAssert(prepareJob == NULL, "prepareJob not NULL for Batch::startPrepare()");
     prepareJob = &job;
     pid = p;
-    Dispatcher::instance().startChild(pid, this);
+    if (child)				// else a PreparePool worker reports
+	Dispatcher::instance().startChild(pid, this);
 }
 
 void
@@ -41,7 +41,7 @@ class Batch
 
 	void childStatus(pid_t, int);
 
-	void startPrepare(Job& job, pid_t);
+	void startPrepare(Job& job, pid_t, bool child = true);
 	void startSend(pid_t);
 
 	Job& firstJob();
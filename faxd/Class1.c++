@@ -1068,6 +1068,32 @@ Class1Modem::recvECMFrame(HDLCFrame& frame)
 	    protoTrace("Timeout receiving HDLC frame");
 	    return (false);
 	}
+	/*
+	 * Take a whole byte from the modem at a time by table lookup
+	 * unless it holds a flag or it completes the frame, the RCP
+	 * frame or the block; those are handled bit-by-bit below.
+	 */
+	u_int count;
+	int c = peekModemBits(count, 60000);
+	if (c != EOF && count == 8 && !didBlockEnd()) {
+	    const HDLCStuffer::Unstuffed& u = ecmStuffer.unstuff(ones, c);
+	    u_int len = frame.getLength() + (u.len >= bitpos);
+	    if (!u.flag && len != 5 && len < frameSize+6) {
+		skipModemBits(8);
+		bit = (c >> 7) & 1;	// getModemBit ends on 0x80
+		ones = u.ones;
+		if (u.len >= bitpos) {		// fully populated byte
+		    u_short rem = u.len - bitpos;
+		    frame.put(byte | (u.bits >> rem));
+		    bitpos = 8 - rem;
+		    byte = (u.bits << bitpos) & 0xff;
+		} else {
+		    bitpos -= u.len;
+		    byte |= (u.bits << bitpos);
+		}
+		continue;
+	    }
+	}
 	bit = getModemBit(60000);
 	if (bit == 1) {
 	    ones++;
@@ -30,6 +30,7 @@
  */
 #include "FaxModem.h"
 #include "FaxParams.h"
+#include "HDLCStuffer.h"
 
 class HDLCFrame;
 
@@ -82,9 +83,7 @@ protected:
     u_int	lastPPM;		// last PPM during receive
     bool	sendCFR;		// received TCF was not confirmed
     u_int	ecmPage;		// page number for ECM frame
-    u_short	ecmBitPos;		// bit position to populate on ecmByte
-    u_int	ecmByte;		// pending byte to add to ecmBlock
-    u_short	ecmOnes;		// count of consecutive ones for adding zero bits
+    HDLCStuffer	ecmStuffer;		// adds transparent zero bits to ecmStuffedBlock
     u_char*	ecmFrame;		// to hold outgoing frames as they are read from the file
     u_int	ecmFramePos;		// fill pointer for ecmFrame
     u_char*	ecmBlock;		// to hold 256 raw ecmFrames to send before MCF
@@ -196,7 +195,8 @@ protected:
     bool	syncECMFrame();
     void	abortPageECMRecv(TIFF* tif, const Class2Params& params, u_char* block, u_int fcount, u_short seq, bool pagedataseen);
     bool	recvPageECMData(TIFF* tif, const Class2Params& params, Status& eresult);
-    void	blockData(u_int byte, bool flag);
+    void	blockData(const u_char* data, u_int cc);
+    void	blockFlags(u_int count);
     bool	blockFrame(const u_char* bitrev, bool lastframe, u_int ppmcmd, Status& eresult);
     bool	endECMBlock();
     void	abortReceive();
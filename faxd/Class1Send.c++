@@ -34,6 +34,7 @@
 #include "Class1.h"
 #include "ModemConfig.h"
 #include "HDLCFrame.h"
+#include "PageReader.h"
 #include "t.30.h"
 
 /*
@@ -961,40 +962,31 @@ Class1Modem::raiseToNextBR(Class2Params& params)
     /*NOTREACHED*/
 }
 
+/*
+ * Add frame data to ecmStuffedBlock with transparent zero bits.
+ */
 void
-Class1Modem::blockData(u_int byte, bool flag)
+Class1Modem::blockData(const u_char* data, u_int cc)
 {
     if (useV34) {
 	// With V.34-fax the DTE makes the stuffing
-	byte =  (((byte>>0)&1)<<7)|(((byte>>1)&1)<<6)|
-		(((byte>>2)&1)<<5)|(((byte>>3)&1)<<4)|
-		(((byte>>4)&1)<<3)|(((byte>>5)&1)<<2)|
-		(((byte>>6)&1)<<1)|(((byte>>7)&1)<<0);
-	ecmStuffedBlock[ecmStuffedBlockPos++] = byte;
+	const u_char* bitrev = TIFFGetBitRevTable(true);
+	u_char* cp = ecmStuffedBlock + ecmStuffedBlockPos;
+	for (u_int i = 0; i < cc; i++)
+	    cp[i] = bitrev[data[i]];
+	ecmStuffedBlockPos += cc;
 	return;
     }
-    for (u_int j = 8; j > 0; j--) {
-	u_short bit = (byte & (1 << (j - 1))) != 0 ? 1 : 0;
-	ecmByte |= (bit << ecmBitPos);
-	ecmBitPos++;
-	if (ecmBitPos == 8) {
-	    ecmStuffedBlock[ecmStuffedBlockPos++] = ecmByte;
-	    ecmBitPos = 0;
-	    ecmByte = 0;
-	}
-	// add transparent zero bits if needed
-	if (bit == 1 && !flag) ecmOnes++;
-	else ecmOnes = 0;
-	if (ecmOnes == 5) {
-	    ecmBitPos++;
-	    if (ecmBitPos == 8) {
-		ecmStuffedBlock[ecmStuffedBlockPos++] = ecmByte;
-		ecmBitPos = 0;
-		ecmByte = 0;
-	    }
-	    ecmOnes = 0;
-	}
-    }
+    ecmStuffedBlockPos += ecmStuffer.putData(ecmStuffedBlock + ecmStuffedBlockPos, data, cc);
+}
+
+/*
+ * Add count 0x7e flags to ecmStuffedBlock; not used with V.34-fax.
+ */
+void
+Class1Modem::blockFlags(u_int count)
+{
+    ecmStuffedBlockPos += ecmStuffer.putFlags(ecmStuffedBlock + ecmStuffedBlockPos, count);
 }
 
 /*
@@ -1032,8 +1024,7 @@ Class1Modem::blockFrame(const u_char* bitrev, bool lastframe, u_int ppmcmd, Stat
 
 	    if (!useV34) {
 		// synchronize with 200 ms of 0x7e flags
-		for (u_int i = 0; i < params.transferSize(200); i++)
-		    blockData(0x7e, true);
+		blockFlags(params.transferSize(200));
 	    }
 
 	    u_char* firstframe = (u_char*) malloc(frameSize + 6);
@@ -1046,22 +1037,19 @@ Class1Modem::blockFrame(const u_char* bitrev, bool lastframe, u_int ppmcmd, Stat
 		    HDLCFrame ecmframe(5);
 		    // frame bit marked for transmission
 		    fcount++;
-		    for (u_int i = fnum * (frameSize + 4);
-			i < (fnum + 1) * (frameSize + 4); i++) {
-			ecmframe.put(ecmBlock[i]);
-			blockData(ecmBlock[i], false);
-		    }
+		    const u_char* fp = ecmBlock + fnum * (frameSize + 4);
+		    for (u_int i = 0; i < frameSize + 4; i++)
+			ecmframe.put(fp[i]);
 		    int fcs1 = ecmframe.getCRC() >> 8;		// 1st byte FCS
 		    int fcs2 = ecmframe.getCRC() & 0xff;	// 2nd byte FCS
 		    ecmframe.put(fcs1); ecmframe.put(fcs2);
-		    blockData(fcs1, false);
-		    blockData(fcs2, false);
+		    blockData((const u_char*) ecmframe, frameSize + 6);
 		    traceHDLCFrame("<--", ecmframe, true);
 		    protoTrace("SEND send frame number %u", fnum);
 
 		    if (!useV34) {
 			// separate frames with a 0x7e flag
-			blockData(0x7e, true);
+			blockFlags(1);
 		    }
 
 		    if (firstframe[0] == 0x1) {
@@ -1084,13 +1072,11 @@ Class1Modem::blockFrame(const u_char* bitrev, bool lastframe, u_int ppmcmd, Stat
 		if (duplicate) {
 		    HDLCFrame ecmframe(5);
 		    fcount++;
-		    for (u_int i = 0; i < (frameSize + 6); i++) {
-			blockData(firstframe[i], false);
-		    }
+		    blockData(firstframe, frameSize + 6);
 		    ecmframe.put(firstframe, (frameSize + 6));
 		    traceHDLCFrame("<--", ecmframe, true);
 		    protoTrace("SEND send frame number %u", frameRev[firstframe[3]]);
-		    if (!useV34) blockData(0x7e, true);
+		    if (!useV34) blockFlags(1);
 		} else {
 		    duplicate = true;
 		}
@@ -1099,15 +1085,14 @@ Class1Modem::blockFrame(const u_char* bitrev, bool lastframe, u_int ppmcmd, Stat
 	    HDLCFrame rcpframe(5);
 	    rcpframe.put(0xff); rcpframe.put(0xc0); rcpframe.put(0x61); rcpframe.put(0x96); rcpframe.put(0xd3);
 	    for (u_short k = 0; k < 3; k++) {		// three RCP frames
-		for (u_short j = 0; j < 5; j++)
-		    blockData(rcpframe[j], false);
+		blockData((const u_char*) rcpframe, 5);
 		traceHDLCFrame("<--", rcpframe, true);
 
 		// separate frames with a 0x7e flag
-		if (!useV34) blockData(0x7e, true);
+		if (!useV34) blockFlags(1);
 	    }
 	    // add one more flag to ensure one full flag gets transmitted before DLE+ETX
-	    if (!useV34) blockData(0x7e, true);
+	    if (!useV34) blockFlags(1);
 
 	    // start up the high-speed carrier...
 	    if (flowControl == FLOW_XONXOFF)   
@@ -1707,6 +1692,8 @@ EOLcode(u_long& w)
 }
 #undef EOLcheck
 
+#define	PAGE_CHUNK	(16*1024)	// page data read at a time
+
 /*
  * Send a page of data.
  */
@@ -1735,7 +1722,8 @@ Class1Modem::sendPage(TIFF* tif, Class2Params& params, u_int pageChop, u_int ppm
     }
 
     bool rc = true;
-    blockNumber = frameNumber = ecmBlockPos = ecmFramePos = ecmBitPos = ecmOnes = ecmByte = 0;
+    blockNumber = frameNumber = ecmBlockPos = ecmFramePos = 0;
+    ecmStuffer.reset();
     ecmPage += 1;
     protoTrace("SEND begin page");
 
@@ -1772,188 +1760,221 @@ Class1Modem::sendPage(TIFF* tif, Class2Params& params, u_int pageChop, u_int ppm
 	 */
 	bool doTagLine = setupTagLineSlop(params);
 	u_int ts = getTagLineSlop();
-	/*
-	 * Calculate total amount of space needed to read
-	 * the image into memory (in its encoded format).
-	 */
-	tiff_bytecount_t* stripbytecount;
-	(void) TIFFGetField(tif, TIFFTAG_STRIPBYTECOUNTS, &stripbytecount);
-	tstrip_t strip;
-	u_long totdata = 0;
-	for (strip = 0; strip < nstrips; strip++)
-	    totdata += stripbytecount[strip];
-	/*
-	 * Read the image into memory.
-	 */
-	u_char* data = new u_char[totdata+ts];
-	u_int off = ts;			// skip tag line slop area
-	for (strip = 0; strip < nstrips; strip++) {
-	    uint32 sbc = stripbytecount[strip];
-	    if (sbc > 0 && TIFFReadRawStrip(tif, strip, data+off, sbc) >= 0)
-		off += (u_int) sbc;
-	}
-	totdata -= pageChop;		// deduct trailing white space not sent
 	TIFFGetFieldDefaulted(tif, TIFFTAG_ROWSPERSTRIP, &rowsperstrip);
 	if (rowsperstrip == (uint32) -1)
 	    TIFFGetField(tif, TIFFTAG_IMAGELENGTH, &rowsperstrip);
-
+	bool convert = (conf.softRTFCC && params.df != newparams.df);
+	u_int minLen = newparams.minScanlineSize();	// only in non-ECM
 	/*
-	 * Image the tag line, if intended.
+	 * The page is read and sent in pieces so that transmission
+	 * starts without the whole page in memory.  The tag line is
+	 * imaged into the first piece, which is usually large enough
+	 * to hold the rows that it replaces; when it is not (e.g. the
+	 * rows are poorly compressed) the whole page is read instead.
+	 * Converting the data format and imaging the tag line into
+	 * MMR data both process the entire image, so then the page
+	 * is read in one piece.  Each piece has room in front of it
+	 * for the tag line or for the part of a scanline carried over
+	 * from the previous piece.
 	 */
-	u_char* dp;
-	if (doTagLine) {
-	    u_long totbytes = totdata;
-	    dp = imageTagLine(data+ts, fillorder, params, totbytes, cover);
-	    // Because the whole image is processed with MMR, 
-	    // totdata is then determined during encoding.
-	    totdata = (params.df == DF_2DMMR) ? totbytes : totdata+ts - (dp-data);
-	} else
-	    dp = data;
+	PageReader page(tif, pageChop, fxmax(ts, minLen*rowsperstrip));
+	u_long want = PAGE_CHUNK;
+	if (convert || (doTagLine && params.df == DF_2DMMR))
+	    want = page.getTotal();
+	else if (doTagLine)
+	    want = fxmax(want, (u_long) 4*ts);
 
-	/*
-	 * After a page chop rowsperstrip is no longer valid, as the strip will
-	 * be shorter.  Therefore, convertPhaseCData (for the benefit of supporting
-	 * the sending of JBIG NEWLEN markers) and correctPhaseCData (only in the 
-	 * case of MMR data) deliberately update rowsperstrip.  Page-chopped and
-	 * un-converted MH and MR data will not have updated rowsperstrip.
-	 * However, this only amounts to a allocating more memory than is needed,
-	 * and this is not consequential.
-	 */
+	/* For debugging purposes we may want to write the image-data to file. */
+	if (conf.saverawimage) imagefd = Sys::open("/tmp/out.fax", O_RDWR|O_CREAT|O_EXCL);
 
-	if (conf.softRTFCC && params.df != newparams.df) {
-	    switch (params.df) {
-		case DF_1DMH:
-		    protoTrace("Reading MH-compressed image file");
-		    break;
-		case DF_2DMR:
-		    protoTrace("Reading MR-compressed image file");
-		    break;
-		case DF_2DMMR:
-		    protoTrace("Reading MMR-compressed image file");
-		    break;
-	    }
-	    dp = convertPhaseCData(dp, totdata, fillorder, params, newparams, rowsperstrip);
-	    params = newparams;		// revert back
-	}
+	u_char* fill = NULL;			// zero-fill buffer
+	u_char* eoFill = NULL;
+	u_char* fp = NULL;
+	u_long w = 0xffffff;			// EOL search window
+	u_char* carry = NULL;			// scanline split between pieces
+	u_int carryLen = 0;
+	bool first = true;
+	u_long totdata;
+	u_char* dp;
+	while (rc && (dp = page.read(want, totdata)) != NULL) {
+	    bool last = page.isEOF();
+	    if (first) {
+		/*
+		 * Image the tag line, if intended.
+		 */
+		if (doTagLine) {
+		    if (!last && !tagLineFits(dp, fillorder, params, totdata)) {
+			page.restart();
+			dp = page.read(page.getTotal(), totdata);
+			last = true;
+		    }
+		    u_long totbytes = totdata;
+		    u_char* tp = imageTagLine(dp, fillorder, params, totbytes, cover);
+		    // Because the whole image is processed with MMR, 
+		    // totdata is then determined during encoding.
+		    totdata = (params.df == DF_2DMMR) ? totbytes : totdata + (dp-tp);
+		    dp = tp;
+		}
 
-        /*
-         * correct broken Phase C (T.4) data if neccessary
-         */
-	if (params.df < DF_2DMMR)
-	    correctPhaseCData(dp, totdata, fillorder, params, rowsperstrip);
+		/*
+		 * After a page chop rowsperstrip is no longer valid, as the strip will
+		 * be shorter.  Therefore, convertPhaseCData (for the benefit of supporting
+		 * the sending of JBIG NEWLEN markers) and correctPhaseCData (only in the 
+		 * case of MMR data) deliberately update rowsperstrip.  Page-chopped and
+		 * un-converted MH and MR data will not have updated rowsperstrip.
+		 * However, this only amounts to a allocating more memory than is needed,
+		 * and this is not consequential.
+		 */
 
-	/*
-	 * Send the page of data.  This is slightly complicated
-	 * by the fact that we may have to add zero-fill before the
-	 * EOL codes to bring the transmit time for each scanline
-	 * up to the negotiated min-scanline time.
-	 *
-	 * Note that we blindly force the data to be in LSB2MSB bit
-	 * order so that the EOL locating code works (if needed).
-	 * This may result in two extraneous bit reversals if the
-	 * modem wants the data in MSB2LSB order, but for now we'll
-	 * avoid the temptation to optimize.
-	 */
-	if (params.df <= DF_2DMMR && fillorder != FILLORDER_LSB2MSB) {
-	    TIFFReverseBits(dp, totdata);
-	}
+		if (convert) {
+		    switch (params.df) {
+			case DF_1DMH:
+			    protoTrace("Reading MH-compressed image file");
+			    break;
+			case DF_2DMR:
+			    protoTrace("Reading MR-compressed image file");
+			    break;
+			case DF_2DMMR:
+			    protoTrace("Reading MMR-compressed image file");
+			    break;
+		    }
+		    dp = convertPhaseCData(dp, totdata, fillorder, params, newparams, rowsperstrip);
+		    params = newparams;		// revert back
+		}
 
-	/* For debugging purposes we may want to write the image-data to file. */
-	if (conf.saverawimage) imagefd = Sys::open("/tmp/out.fax", O_RDWR|O_CREAT|O_EXCL);
+		/*
+		 * correct broken Phase C (T.4) data if neccessary
+		 */
+		if (params.df < DF_2DMMR)
+		    fixFirstEOL(dp, totdata, fillorder, params);
+	    }
+	    if (last && params.df < DF_2DMMR)
+		cutExtraRTC(dp, totdata, fillorder, params);
 
-	u_int minLen = params.minScanlineSize();
-	if (minLen > 0) {			// only in non-ECM
 	    /*
-	     * Client requires a non-zero min-scanline time.  We
-	     * comply by zero-padding scanlines that have <minLen
-	     * bytes of data to send.  To minimize underrun we
-	     * do this padding in a strip-sized buffer.
+	     * Send the page of data.  This is slightly complicated
+	     * by the fact that we may have to add zero-fill before the
+	     * EOL codes to bring the transmit time for each scanline
+	     * up to the negotiated min-scanline time.
+	     *
+	     * Note that we blindly force the data to be in LSB2MSB bit
+	     * order so that the EOL locating code works (if needed).
+	     * This may result in two extraneous bit reversals if the
+	     * modem wants the data in MSB2LSB order, but for now we'll
+	     * avoid the temptation to optimize.
 	     */
-	    u_char* fill = new u_char[minLen*rowsperstrip];
-	    u_char* eoFill = fill + minLen*rowsperstrip;
-	    u_char* fp = fill;
-
-	    u_char* bp = dp;
-	    u_char* ep = dp+totdata;
-	    u_long w = 0xffffff;
-
-            /*
-             * Immediately copy leading EOL into the fill buffer,
-             * because it has not to be padded. Note that leading
-             * EOL is not byte-aligned, and so we also copy 4 bits
-             * if image data. But that's OK, and may only lead to
-             * adding one extra zero-fill byte to the first image
-             * row.
-             */
-            *fp++ = *bp++;
-            *fp++ = *bp++;
-	    do {
-		u_char* bol = bp;
-                bool foundEOL;
-		do {
-		    w = (w<<8) | *bp++;
-                    foundEOL = EOLcode(w);
-                } while (!foundEOL && bp < ep);
+	    if (params.df <= DF_2DMMR && fillorder != FILLORDER_LSB2MSB) {
+		TIFFReverseBits(dp, totdata);
+	    }
+
+	    if (minLen > 0) {			// only in non-ECM
 		/*
-                 * We're either after an EOL code or at the end of data.
-		 * If necessary, insert zero-fill before the last byte
-		 * in the EOL code so that we comply with the
-		 * negotiated min-scanline time.
+		 * Client requires a non-zero min-scanline time.  We
+		 * comply by zero-padding scanlines that have <minLen
+		 * bytes of data to send.  To minimize underrun we
+		 * do this padding in a strip-sized buffer.  A scanline
+		 * that is split between pieces is moved to the front
+		 * of the next piece.
 		 */
-		u_int lineLen = bp - bol;
-		if ((fp + fxmax(lineLen, minLen) >= eoFill) && (fp-fill != 0)) {
+		if (!fill) {
+		    fill = new u_char[minLen*rowsperstrip];
+		    eoFill = fill + minLen*rowsperstrip;
+		    fp = fill;
+		}
+		u_char* bp = dp;
+		u_char* ep = dp+totdata;
+		if (carryLen) {
+		    memcpy(dp - carryLen, carry, carryLen);
+		    carry = dp - carryLen;
+		}
+
+		if (first) {
 		    /*
-		     * Not enough space for this scanline, flush
-		     * the current data and reset the pointer into
-		     * the zero fill buffer.
+		     * Immediately copy leading EOL into the fill buffer,
+		     * because it has not to be padded. Note that leading
+		     * EOL is not byte-aligned, and so we also copy 4 bits
+		     * if image data. But that's OK, and may only lead to
+		     * adding one extra zero-fill byte to the first image
+		     * row.
 		     */
-		    rc = sendPageData(fill, fp-fill, bitrev, (params.ec != EC_DISABLE), eresult);
-		    fp = fill;
-		    if (!rc)			// error writing data
-			break;
+		    *fp++ = *bp++;
+		    *fp++ = *bp++;
 		}
-		if (lineLen >= minLen*rowsperstrip) {
+		while (bp < ep) {
+		    u_char* bol = (carryLen ? carry : bp);
+		    bool foundEOL;
+		    carryLen = 0;
+		    do {
+			w = (w<<8) | *bp++;
+			foundEOL = EOLcode(w);
+		    } while (!foundEOL && bp < ep);
 		    /*
-		     * The fill buffer is smaller than this
-		     * scanline alone.  Flush this scanline
-		     * also.  lineLen is greater than minLen.
+		     * We're either after an EOL code or at the end of data.
+		     * If necessary, insert zero-fill before the last byte
+		     * in the EOL code so that we comply with the
+		     * negotiated min-scanline time.
 		     */
-		    rc = sendPageData(bol, lineLen, bitrev, (params.ec != EC_DISABLE), eresult);
-		    if (!rc)			// error writing
+		    u_int lineLen = bp - bol;
+		    if (!foundEOL && !last && lineLen < minLen*rowsperstrip) {
+			carry = bol;		// finish with the next piece
+			carryLen = lineLen;
 			break;
-		} else {
-		    memcpy(fp, bol, lineLen);	// first part of line
-		    fp += lineLen;
-		    if (lineLen < minLen) {		// must zero-fill
-			u_int zeroLen = minLen - lineLen;
-                	if ( foundEOL ) {
-                	    memset(fp-1, 0, zeroLen);	// zero padding
-			    fp += zeroLen;
-			    fp[-1] = bp[-1];		// last byte in EOL
-			} else {
-			    /*
-			     * Last line does not contain EOL
-			     */
-			    memset(fp, 0, zeroLen);	// zero padding
-			    fp += zeroLen;
+		    }
+		    if ((fp + fxmax(lineLen, minLen) >= eoFill) && (fp-fill != 0)) {
+			/*
+			 * Not enough space for this scanline, flush
+			 * the current data and reset the pointer into
+			 * the zero fill buffer.
+			 */
+			rc = sendPageData(fill, fp-fill, bitrev, (params.ec != EC_DISABLE), eresult);
+			fp = fill;
+			if (!rc)			// error writing data
+			    break;
+		    }
+		    if (lineLen >= minLen*rowsperstrip) {
+			/*
+			 * The fill buffer is smaller than this
+			 * scanline alone.  Flush this scanline
+			 * also.  lineLen is greater than minLen.
+			 */
+			rc = sendPageData(bol, lineLen, bitrev, (params.ec != EC_DISABLE), eresult);
+			if (!rc)			// error writing
+			    break;
+		    } else {
+			memcpy(fp, bol, lineLen);	// first part of line
+			fp += lineLen;
+			if (lineLen < minLen) {		// must zero-fill
+			    u_int zeroLen = minLen - lineLen;
+			    if ( foundEOL ) {
+				memset(fp-1, 0, zeroLen);	// zero padding
+				fp += zeroLen;
+				fp[-1] = bp[-1];		// last byte in EOL
+			    } else {
+				/*
+				 * Last line does not contain EOL
+				 */
+				memset(fp, 0, zeroLen);	// zero padding
+				fp += zeroLen;
+			    }
 			}
 		    }
 		}
-	    } while (bp < ep);
-	    /*
-	     * Flush anything that was not sent above.
-	     */
-	    if (fp > fill && rc) {
-		rc = sendPageData(fill, fp-fill, bitrev, (params.ec != EC_DISABLE), eresult);
+	    } else {
+		/*
+		 * No EOL-padding needed, just jam the bytes.
+		 */
+		rc = sendPageData(dp, (u_int) totdata, bitrev, (params.ec != EC_DISABLE), eresult);
 	    }
-	    delete fill;
-	} else {
-	    /*
-	     * No EOL-padding needed, just jam the bytes.
-	     */
-	    rc = sendPageData(dp, (u_int) totdata, bitrev, (params.ec != EC_DISABLE), eresult);
+	    first = false;
+	    want = PAGE_CHUNK;
+	}
+	/*
+	 * Flush anything that was not sent above.
+	 */
+	if (fp > fill && rc) {
+	    rc = sendPageData(fill, fp-fill, bitrev, (params.ec != EC_DISABLE), eresult);
 	}
-	delete data;
+	delete [] fill;
 	if (imagefd > 0) {
 	    Sys::close(imagefd);
 	    imagefd = 0;
@@ -25,10 +25,13 @@
  */
 #include <ctype.h>
 #include <stdlib.h>
+#include <string.h>
+#include <sys/uio.h>
 
 #include "ModemServer.h"
 #include "FaxTrace.h"
 #include "Sys.h"
+#include "tiffio.h"
 
 /*
  * Call status description strings.
@@ -476,31 +479,87 @@ ClassModem::getModemLine(char buf[], u_int bufSize, long ms)
 	trimModemLine(buf, n);
     return (n);
 }
+int ClassModem::getModemDLEData(u_char* buf, u_int size, long ms, bool& fin)
+    { return server.getModemDLEData(buf, size, ms, fin); }
 int ClassModem::getModemBit(long ms)  { return server.getModemBit(ms); }
+int ClassModem::peekModemBits(u_int& count, long ms) { return server.peekModemBits(count, ms); }
+void ClassModem::skipModemBits(u_int count) { server.skipModemBits(count); }
 int ClassModem::getModemChar(long ms, bool doquery) { return server.getModemChar(ms, doquery); }
 int ClassModem::getModemDataChar()    { return server.getModemChar(dataTimeout); }
 int ClassModem::getLastByte()         { return server.getLastByte(); }
 bool ClassModem::didBlockEnd()        { return server.didBlockEnd(); }
 void ClassModem::resetBlock()         { server.resetBlock(); }
 
+/*
+ * Reverse the bits in each byte of a buffer, a word
+ * at a time (each step swaps adjacent bits, pairs of
+ * bits and then nibbles within every byte of the word).
+ */
+static void
+reverseBits(u_char* dst, const u_char* src, u_int cc, const u_char* bitrev)
+{
+    const u_long m1 = ~0UL/3;		// 0x55...
+    const u_long m2 = ~0UL/5;		// 0x33...
+    const u_long m4 = ~0UL/17;		// 0x0f...
+    u_int i = 0;
+    for (; i + sizeof (u_long) <= cc; i += sizeof (u_long)) {
+	u_long w;
+	memcpy(&w, src+i, sizeof (w));
+	w = ((w >> 1) & m1) | ((w & m1) << 1);
+	w = ((w >> 2) & m2) | ((w & m2) << 2);
+	w = ((w >> 4) & m4) | ((w & m4) << 4);
+	memcpy(dst+i, &w, sizeof (w));
+    }
+    for (; i < cc; i++)
+	dst[i] = bitrev[src[i]];
+}
+
 bool
 ClassModem::putModemDLEData(const u_char* data, u_int cc, const u_char* bitrev, long ms, bool doquery)
 {
-    u_char dlebuf[2*1024];
+    u_char revbuf[8*1024];
+    struct iovec iov[64];
+    const u_char* noRev = TIFFGetBitRevTable(false);
+    const u_char* bitRev = TIFFGetBitRevTable(true);
     while (cc > 0) {
 	if (wasTimeout() || abortRequested())
 	    return (false);
+	u_int n = fxmin((size_t) cc, sizeof (revbuf));
+	const u_char* cp;
+	if (bitrev == noRev)
+	    cp = data;
+	else {
+	    if (bitrev == bitRev)
+		reverseBits(revbuf, data, n, bitrev);
+	    else {
+		for (u_int i = 0; i < n; i++)
+		    revbuf[i] = bitrev[data[i]];
+	    }
+	    cp = revbuf;
+	}
 	/*
-	 * Copy to temp buffer, doubling DLE's.
+	 * Write the data with DLE's doubled.  Each segment
+	 * ends with a DLE and the next one starts with it,
+	 * so the DLE is sent twice without copying.
 	 */
-	u_int i, j;
-	u_int n = fxmin((size_t) cc, sizeof (dlebuf)/2);
-	for (i = 0, j = 0; i < n; i++, j++) {
-	    dlebuf[j] = bitrev[data[i]];
-	    if (dlebuf[j] == DLE)
-		dlebuf[++j] = DLE;
+	const u_char* ep = cp + n;
+	const u_char* sp = cp;		// where to look for the next DLE
+	const u_char* dp;
+	u_int iovcnt = 0;
+	while ((dp = (const u_char*) memchr(sp, DLE, ep - sp)) != NULL) {
+	    iov[iovcnt].iov_base = (char*) cp;
+	    iov[iovcnt].iov_len = dp+1 - cp;
+	    cp = dp;
+	    sp = dp+1;
+	    if (++iovcnt == sizeof (iov) / sizeof (iov[0])) {
+		if (!putModem(iov, iovcnt, ms))
+		    return (false);
+		iovcnt = 0;
+	    }
 	}
-	if (!putModem(dlebuf, j, ms))
+	iov[iovcnt].iov_base = (char*) cp;
+	iov[iovcnt].iov_len = ep - cp;
+	if (!putModem(iov, iovcnt+1, ms))
 	    return (false);
 	data += n;
 	cc -= n;
@@ -538,6 +597,8 @@ void ClassModem::flushModemInput()
     { server.modemFlushInput(); }
 bool ClassModem::putModem(void* d, int n, long ms)
     { return server.putModem(d, n, ms); }
+bool ClassModem::putModem(const struct iovec* iov, int iovcnt, long ms)
+    { return server.putModem(iov, iovcnt, ms); }
 bool ClassModem::putModemData(void* d, int n)
     { return server.putModem(d, n, dataTimeout); }
 
@@ -37,6 +37,7 @@ class ModemServer;
 class ModemConfig;
 class FaxRequest;
 class Class2Params;
+struct iovec;
 
 // NB: these would be enums in the ClassModem class
 //     if there were a portable way to refer to them!
@@ -266,11 +267,15 @@ public:
     void	setTimeout(bool);
     void	flushModemInput();
     bool	putModem(void* data, int n, long ms = 0);
+    bool	putModem(const struct iovec* iov, int iovcnt, long ms = 0);
     bool	putModemData(void* data, int n);
     bool	putModemDLEData(const u_char* data, u_int,
 		    const u_char* brev, long ms, bool doquery = false);
     bool	putModemLine(const char* cp, long ms = 0);
+    int		getModemDLEData(u_char* buf, u_int size, long ms, bool& fin);
     int		getModemBit(long ms = 0);
+    int		peekModemBits(u_int& count, long ms = 0);
+    void	skipModemBits(u_int count);
     int		getModemChar(long ms = 0, bool doquery = false);
     int		getModemDataChar();
     int		getLastByte();
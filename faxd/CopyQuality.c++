@@ -365,47 +365,20 @@ FaxModem::recvPageDLEData(TIFF* tif, bool checkQuality,
 	    parserCount[1] = 0;
 	    parserCount[2] = 0;
 	    memset(parserBuf, 0, 16);
-	    int cc = 0, c;
+	    int cc = 0;
 	    bool fin = false;
 	    if (params.df == DF_JBIG) {
-		for (; cc < 20; cc++) {
-		    c = getModemChar(30000);
-		    if (c == EOF || wasTimeout()) {
-			fin = true;
-			break;
-		    }
-		    if (c == DLE) {
-			c = getModemChar(30000);
-			if (c == EOF || c == ETX || wasTimeout()) {
-			    fin = true;
-			    break;
-			}
-		    }
-		    buf[cc] = c;
-		}
+		cc = getModemDLEData(buf, 20, 30000, fin);
 		parseJBIGBIH(buf);
 		flushRawData(tif, 0, (const u_char*) buf, cc);
 	    }
 	    if (!fin) {
 		do {
-		    cc = 0;
-		    do {
-			c = getModemChar(30000);
-			if (c == EOF || wasTimeout()) {
-			    fin = true;
-			    break;
-			}
-			if (c == DLE) {
-			    c = getModemChar(30000);
-			    if (c == EOF || c == ETX || wasTimeout()) {
-				fin = true;
-				break;
-			    }
-			}
-			if (params.df == DF_JBIG) parseJBIGStream(c);
-			else parseJPEGStream(c);
-			buf[cc++] = c;
-		    } while (cc < RCVBUFSIZ && !fin);
+		    cc = getModemDLEData(buf, RCVBUFSIZ, 30000, fin);
+		    for (int i = 0; i < cc; i++) {
+			if (params.df == DF_JBIG) parseJBIGStream(buf[i]);
+			else parseJPEGStream(buf[i]);
+		    }
 		    if (params.df == DF_JBIG) {
 			flushRawData(tif, 0, (const u_char*) buf, cc);
 		    } else {
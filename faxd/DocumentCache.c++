@@ -0,0 +1,404 @@
+/*	$Id$ */
+/*
+ * Copyright (c) 2026 iFAX Solutions, Inc.
+ * HylaFAX is a trademark of Silicon Graphics
+ *
+ * Permission to use, copy, modify, distribute, and sell this software and
+ * its documentation for any purpose is hereby granted without fee, provided
+ * that (i) the above copyright notices and this permission notice appear in
+ * all copies of the software and related documentation, and (ii) the names of
+ * Sam Leffler and Silicon Graphics may not be used in any advertising or
+ * publicity relating to the software without the specific, prior written
+ * permission of Sam Leffler and Silicon Graphics.
+ *
+ * THE SOFTWARE IS PROVIDED "AS-IS" AND WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS, IMPLIED OR OTHERWISE, INCLUDING WITHOUT LIMITATION, ANY
+ * WARRANTY OF MERCHANTABILITY OR FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * IN NO EVENT SHALL SAM LEFFLER OR SILICON GRAPHICS BE LIABLE FOR
+ * ANY SPECIAL, INCIDENTAL, INDIRECT OR CONSEQUENTIAL DAMAGES OF ANY KIND,
+ * OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS,
+ * WHETHER OR NOT ADVISED OF THE POSSIBILITY OF DAMAGE, AND ON ANY THEORY OF
+ * LIABILITY, ARISING OUT OF OR IN CONNECTION WITH THE USE OR PERFORMANCE
+ * OF THIS SOFTWARE.
+ */
+#include "Sys.h"
+#include "DocumentCache.h"
+#include "Class2Params.h"
+#include "config.h"
+
+#include <dirent.h>
+#include <utime.h>
+#ifdef HAVE_STDINT_H
+#include <stdint.h>
+#endif
+
+/*
+ * SHA-256 (FIPS 180-2) for hashing document contents.
+ */
+struct SHA256 {
+    uint32_t	h[8];
+    u_long	bytes;			// total bytes hashed
+    u_char	buf[64];		// partial block
+
+    SHA256();
+    void	block(const u_char*);
+    void	update(const u_char*, u_int);
+    fxStr	digest();
+};
+
+static const uint32_t sha256K[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5,
+    0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3,
+    0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc,
+    0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7,
+    0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13,
+    0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3,
+    0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5,
+    0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208,
+    0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2,
+};
+
+#define	ROTR(x,n)	(((x) >> (n)) | ((x) << (32-(n))))
+
+SHA256::SHA256()
+{
+    h[0] = 0x6a09e667; h[1] = 0xbb67ae85; h[2] = 0x3c6ef372; h[3] = 0xa54ff53a;
+    h[4] = 0x510e527f; h[5] = 0x9b05688c; h[6] = 0x1f83d9ab; h[7] = 0x5be0cd19;
+    bytes = 0;
+}
+
+void
+SHA256::block(const u_char* p)
+{
+    uint32_t w[64];
+    u_int i;
+    for (i = 0; i < 16; i++, p += 4)
+	w[i] = (p[0]<<24) | (p[1]<<16) | (p[2]<<8) | p[3];
+    for (; i < 64; i++) {
+	uint32_t s0 = ROTR(w[i-15],7) ^ ROTR(w[i-15],18) ^ (w[i-15]>>3);
+	uint32_t s1 = ROTR(w[i-2],17) ^ ROTR(w[i-2],19) ^ (w[i-2]>>10);
+	w[i] = w[i-16] + s0 + w[i-7] + s1;
+    }
+    uint32_t a = h[0], b = h[1], c = h[2], d = h[3];
+    uint32_t e = h[4], f = h[5], g = h[6], hh = h[7];
+    for (i = 0; i < 64; i++) {
+	uint32_t t1 = hh + (ROTR(e,6) ^ ROTR(e,11) ^ ROTR(e,25))
+	    + ((e & f) ^ (~e & g)) + sha256K[i] + w[i];
+	uint32_t t2 = (ROTR(a,2) ^ ROTR(a,13) ^ ROTR(a,22))
+	    + ((a & b) ^ (a & c) ^ (b & c));
+	hh = g; g = f; f = e; e = d + t1;
+	d = c; c = b; b = a; a = t1 + t2;
+    }
+    h[0] += a; h[1] += b; h[2] += c; h[3] += d;
+    h[4] += e; h[5] += f; h[6] += g; h[7] += hh;
+}
+
+void
+SHA256::update(const u_char* p, u_int n)
+{
+    u_int used = bytes & 63;
+    bytes += n;
+    if (used) {
+	u_int cc = fxmin(64 - used, n);
+	memcpy(buf + used, p, cc);
+	p += cc, n -= cc;
+	if (used + cc < 64)
+	    return;
+	block(buf);
+    }
+    for (; n >= 64; p += 64, n -= 64)
+	block(p);
+    memcpy(buf, p, n);
+}
+
+fxStr
+SHA256::digest()
+{
+    u_long nbits = bytes << 3;
+    u_int used = bytes & 63;
+    buf[used++] = 0x80;
+    if (used > 56) {
+	memset(buf + used, 0, 64 - used);
+	block(buf);
+	used = 0;
+    }
+    memset(buf + used, 0, 56 - used);
+    for (u_int i = 0; i < 8; i++)
+	buf[63-i] = (u_char) (nbits >> (8*i));
+    block(buf);
+    fxStr s;
+    for (u_int i = 0; i < 8; i++)
+	s.append(fxStr::format("%08x", h[i]));
+    return (s);
+}
+
+class DocumentCacheEntry : public QLink {
+public:
+    fxStr	key;			// cache key (file name suffix)
+    u_long	size;			// file size in bytes
+
+    DocumentCacheEntry(const fxStr& k, u_long s) : key(k), size(s) {}
+    ~DocumentCacheEntry() {}
+};
+
+fxIMPLEMENT_StrKeyPtrValueDictionary(DocumentCacheDict, DocumentCacheEntry*)
+
+#define	CACHEPREF	"cache."
+
+DocumentCache::DocumentCache()
+{
+    maxBytes = totalBytes = 0;
+    hits = misses = evictions = 0;
+    bytesSaved = 0;
+}
+
+DocumentCache::~DocumentCache()
+{
+    while (!lru.isEmpty()) {
+	DocumentCacheEntry* e = (DocumentCacheEntry*) lru.next;
+	e->remove();
+	delete e;
+    }
+}
+
+void
+DocumentCache::setMaxSize(u_long kbytes)
+{
+    maxBytes = kbytes * 1024;
+    trim();
+}
+
+/*
+ * Discard a cached file.  Jobs that are using the
+ * imaged document hold their own link to the file.
+ */
+void
+DocumentCache::remove(DocumentCacheEntry* e)
+{
+    (void) Sys::unlink(fileName(e->key));
+    totalBytes -= e->size;
+    entries.remove(e->key);
+    e->remove();
+    delete e;
+}
+
+void
+DocumentCache::trim()
+{
+    while (totalBytes > maxBytes && !lru.isEmpty()) {
+	remove((DocumentCacheEntry*) lru.prev);
+	evictions++;
+    }
+}
+
+void
+DocumentCache::enter(const fxStr& key, u_long size)
+{
+    DocumentCacheEntry** ep = (DocumentCacheEntry**) entries.find(key);
+    DocumentCacheEntry* e;
+    if (ep) {
+	e = *ep;
+	totalBytes -= e->size;
+	e->size = size;
+	e->remove();
+    } else {
+	e = new DocumentCacheEntry(key, size);
+	entries[key] = e;
+    }
+    totalBytes += size;
+    e->insert(*lru.next);
+    trim();
+}
+
+struct DocumentCacheFile {
+    fxStr	key;
+    u_long	size;
+    time_t	mtime;
+};
+
+static int
+compareMtime(const void* a, const void* b)
+{
+    time_t ta = ((const DocumentCacheFile*) a)->mtime;
+    time_t tb = ((const DocumentCacheFile*) b)->mtime;
+    return (ta < tb ? -1 : ta > tb ? 1 : 0);
+}
+
+/*
+ * Rebuild the index from the files in the docq.  Files
+ * are entered oldest first so that the most recently
+ * used files are kept when the cache is over its limit.
+ * Files left behind by an interrupted store are removed.
+ */
+void
+DocumentCache::scan()
+{
+    DIR* dir = Sys::opendir(FAX_DOCDIR);
+    if (!dir)
+	return;
+    u_int n = 0, max = 0;
+    DocumentCacheFile* files = NULL;
+    for (dirent* dp = readdir(dir); dp; dp = readdir(dir)) {
+	if (strncmp(dp->d_name, CACHEPREF, sizeof (CACHEPREF)-1) != 0)
+	    continue;
+	fxStr file(fxStr(FAX_DOCDIR "/") | dp->d_name);
+	if (strchr(dp->d_name, '#')) {
+	    (void) Sys::unlink(file);
+	    continue;
+	}
+	struct stat sb;
+	if (Sys::stat(file, sb) < 0 || !S_ISREG(sb.st_mode))
+	    continue;
+	if (n == max) {
+	    max = max ? 2*max : 64;
+	    DocumentCacheFile* nf = new DocumentCacheFile[max];
+	    for (u_int i = 0; i < n; i++)
+		nf[i] = files[i];
+	    delete [] files;
+	    files = nf;
+	}
+	files[n].key = &dp->d_name[sizeof (CACHEPREF)-1];
+	files[n].size = sb.st_size;
+	files[n].mtime = sb.st_mtime;
+	n++;
+    }
+    closedir(dir);
+    if (n > 0) {
+	qsort(files, n, sizeof (files[0]), compareMtime);
+	for (u_int i = 0; i < n; i++)
+	    enter(files[i].key, files[i].size);
+	delete [] files;
+    }
+}
+
+/*
+ * Record that a preparation subprocess reused a
+ * cached file instead of converting a document.
+ */
+void
+DocumentCache::noteHit(const fxStr& key, u_long size)
+{
+    hits++;
+    bytesSaved += size;
+    enter(key, size);
+}
+
+/*
+ * Record that a preparation subprocess converted a
+ * document; a non-zero size means the result was
+ * added to the cache.
+ */
+void
+DocumentCache::noteMiss(const fxStr& key, u_long size)
+{
+    misses++;
+    if (size > 0)
+	enter(key, size);
+}
+
+/*
+ * Add the contents of a file to a hash.
+ */
+static bool
+hashFile(SHA256& sha, const char* file)
+{
+    int fd = Sys::open(file, O_RDONLY);
+    if (fd < 0)
+	return (false);
+    u_char buf[64*1024];
+    ssize_t cc;
+    while ((cc = Sys::read(fd, (char*) buf, sizeof (buf))) > 0)
+	sha.update(buf, (u_int) cc);
+    Sys::close(fd);
+    return (cc == 0);
+}
+
+/*
+ * Construct the cache key for converting a document with
+ * the specified converter, operation and imaging parameters.
+ * Besides the document the hash covers the converter command,
+ * its contents (normally a script) and the configuration the
+ * converter scripts read, so that changing any of them does
+ * not return documents imaged the old way.  An empty string
+ * is returned if the document cannot be read.
+ */
+fxStr
+DocumentCache::makeKey(const fxStr& doc, const fxStr& converter, u_int op,
+    const Class2Params& params, u_int maxPages, bool unlimited)
+{
+    SHA256 sha;
+    if (!hashFile(sha, doc))
+	return (fxStr::null);
+    sha.update((const u_char*) (const char*) converter, converter.length()+1);
+    (void) hashFile(sha, converter);
+    sha.update((const u_char*) "", 1);
+    (void) hashFile(sha, FAX_ETCDIR "/setup.cache");
+    return (sha.digest() | fxStr::format(".%u.%u.%u.%d.%u.%u%s",
+	op, params.verticalRes(), params.pageWidth(), params.pageLength(),
+	params.df, maxPages, unlimited ? "u" : ""));
+}
+
+fxStr
+DocumentCache::fileName(const fxStr& key)
+{
+    return (FAX_DOCDIR "/" CACHEPREF | key);
+}
+
+/*
+ * Replace outFile with a link to the cached file for key.
+ * The link is made under a temporary name and renamed
+ * so that outFile never appears empty or partial.
+ */
+bool
+DocumentCache::fetch(const fxStr& key, const fxStr& outFile, u_long& size)
+{
+    fxStr file(fileName(key));
+    struct stat sb;
+    if (Sys::stat(file, sb) < 0)
+	return (false);
+    fxStr tmp(outFile | fxStr::format("#%u", (u_int) getpid()));
+    (void) Sys::unlink(tmp);
+    if (Sys::link(file, tmp) < 0)
+	return (false);
+    if (Sys::rename(tmp, outFile) < 0) {
+	(void) Sys::unlink(tmp);
+	return (false);
+    }
+    (void) utime(file, NULL);		// for LRU order across restarts
+    size = sb.st_size;
+    return (true);
+}
+
+/*
+ * Add a newly imaged document to the cache.  Files that
+ * are linked elsewhere (e.g. a converter that linked the
+ * source document because no conversion was needed) are
+ * not cached since that would upset the link counts used
+ * to track references to source documents.
+ */
+bool
+DocumentCache::store(const fxStr& key, const fxStr& outFile, u_long& size)
+{
+    struct stat sb;
+    if (Sys::stat(outFile, sb) < 0 || !S_ISREG(sb.st_mode) || sb.st_nlink != 1)
+	return (false);
+    fxStr file(fileName(key));
+    fxStr tmp(file | fxStr::format("#%u", (u_int) getpid()));
+    (void) Sys::unlink(tmp);
+    if (Sys::link(outFile, tmp) < 0)
+	return (false);
+    if (Sys::rename(tmp, file) < 0) {
+	(void) Sys::unlink(tmp);
+	return (false);
+    }
+    size = sb.st_size;
+    return (true);
+}
@@ -0,0 +1,101 @@
+/*	$Id$ */
+/*
+ * Copyright (c) 2026 iFAX Solutions, Inc.
+ * HylaFAX is a trademark of Silicon Graphics
+ *
+ * Permission to use, copy, modify, distribute, and sell this software and
+ * its documentation for any purpose is hereby granted without fee, provided
+ * that (i) the above copyright notices and this permission notice appear in
+ * all copies of the software and related documentation, and (ii) the names of
+ * Sam Leffler and Silicon Graphics may not be used in any advertising or
+ * publicity relating to the software without the specific, prior written
+ * permission of Sam Leffler and Silicon Graphics.
+ *
+ * THE SOFTWARE IS PROVIDED "AS-IS" AND WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS, IMPLIED OR OTHERWISE, INCLUDING WITHOUT LIMITATION, ANY
+ * WARRANTY OF MERCHANTABILITY OR FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * IN NO EVENT SHALL SAM LEFFLER OR SILICON GRAPHICS BE LIABLE FOR
+ * ANY SPECIAL, INCIDENTAL, INDIRECT OR CONSEQUENTIAL DAMAGES OF ANY KIND,
+ * OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS,
+ * WHETHER OR NOT ADVISED OF THE POSSIBILITY OF DAMAGE, AND ON ANY THEORY OF
+ * LIABILITY, ARISING OUT OF OR IN CONNECTION WITH THE USE OR PERFORMANCE
+ * OF THIS SOFTWARE.
+ */
+#ifndef _DocumentCache_
+#define	_DocumentCache_
+/*
+ * Content-addressed cache of imaged (converted) documents.
+ */
+#include "QLink.h"
+#include "Dictionary.h"
+
+class Class2Params;
+class DocumentCacheEntry;
+
+fxDECLARE_StrKeyDictionary(DocumentCacheDict, DocumentCacheEntry*)
+
+/*
+ * Imaged documents are normally named after the source document
+ * they were converted from (see the ``Document Use Database''
+ * notes in faxQueueApp.c++) and so are only reused by jobs that
+ * reference the same submitted file.  This cache keeps a copy of
+ * imaged documents in the docq keyed by a hash of the source
+ * document's contents and the converter (see makeKey) and by
+ * the imaging parameters, so that the same document submitted
+ * by many jobs or users is converted only once.
+ *
+ * The cached files are named:
+ *
+ *	cache.<sha256>.<op>.<vres>.<width>.<length>.<df>.<maxpages>[u]
+ *
+ * and are hard linked to the imaged document name on a hit, so
+ * a cached file may be discarded at any time without affecting
+ * jobs that are using it.  Lookups and stores are done by the
+ * job preparation subprocess with the static methods; the
+ * scheduler is told the outcome and maintains the index used
+ * to bound the total size of the cache, discarding the least
+ * recently used files first.
+ */
+class DocumentCache {
+private:
+    DocumentCacheDict entries;		// entries by cache key
+    QLink	lru;			// entries, most recently used first
+    u_long	maxBytes;		// max bytes to hold, 0 to disable
+    u_long	totalBytes;		// bytes currently held
+
+    void	remove(DocumentCacheEntry*);
+    void	trim();
+    void	enter(const fxStr& key, u_long size);
+public:
+					// statistics
+    u_int	hits;			// # conversions satisfied from the cache
+    u_int	misses;			// # conversions done
+    u_int	evictions;		// # files discarded as least used
+    u_long	bytesSaved;		// imaged bytes not regenerated
+
+    DocumentCache();
+    ~DocumentCache();
+
+    void	setMaxSize(u_long kbytes);
+    u_long	getMaxSize() const;
+    u_long	getTotalBytes() const;
+    u_int	size() const;
+
+    void	scan();			// rebuild index from docq
+
+					// called in the scheduler
+    void	noteHit(const fxStr& key, u_long size);
+    void	noteMiss(const fxStr& key, u_long size);
+
+					// called in the prepare subprocess
+    static fxStr makeKey(const fxStr& doc, const fxStr& converter, u_int op,
+		    const Class2Params& params, u_int maxPages, bool unlimited);
+    static fxStr fileName(const fxStr& key);
+    static bool	fetch(const fxStr& key, const fxStr& outFile, u_long& size);
+    static bool	store(const fxStr& key, const fxStr& outFile, u_long& size);
+};
+inline u_long DocumentCache::getMaxSize() const	{ return maxBytes; }
+inline u_long DocumentCache::getTotalBytes() const { return totalBytes; }
+inline u_int DocumentCache::size() const	{ return entries.size(); }
+#endif /* _DocumentCache_ */
@@ -783,17 +783,33 @@ void
 FaxModem::correctPhaseCData(u_char* buf, u_long& pBufSize,
                             u_int fillorder, const Class2Params& params, uint32& rows)
 {
-    u_char* endOfData;
-    MemoryDecoder dec1(buf, params.pageWidth(), pBufSize, fillorder, params.is2D(), false);
-    dec1.fixFirstEOL();
+    fixFirstEOL(buf, pBufSize, fillorder, params);
+    cutExtraRTC(buf, pBufSize, fillorder, params);
+    // we don't update rows because we don't decode the entire image
+}
+
+/*
+ * The two halves of correctPhaseCData for data that are
+ * sent in pieces: fixFirstEOL looks only at the first row
+ * and cutExtraRTC only at the last few bytes of the data.
+ */
+void
+FaxModem::fixFirstEOL(u_char* buf, u_long cc, u_int fillorder, const Class2Params& params)
+{
+    MemoryDecoder dec(buf, params.pageWidth(), cc, fillorder, params.is2D(), false);
+    dec.fixFirstEOL();
+}
+
+void
+FaxModem::cutExtraRTC(u_char* buf, u_long& cc, u_int fillorder, const Class2Params& params)
+{
     /*
-     * We have to construct new decoder. See comments to cutExtraRTC().
+     * The decoder must be new. See comments to MemoryDecoder::cutExtraRTC().
      */
-    MemoryDecoder dec2(buf, params.pageWidth(), pBufSize, fillorder, params.is2D(), false);
-    endOfData = dec2.cutExtraRTC();
-    // we don't update rows because we don't decode the entire image
+    MemoryDecoder dec(buf, params.pageWidth(), cc, fillorder, params.is2D(), false);
+    u_char* endOfData = dec.cutExtraRTC();
     if( endOfData )
-        pBufSize = endOfData - buf;
+        cc = endOfData - buf;
 }
 
 u_char*
@@ -169,11 +169,16 @@ protected:
     bool	setupTagLineSlop(const Class2Params&);
     u_int	getTagLineSlop() const;
     u_char*	imageTagLine(u_char* buf, u_int fillorder, const Class2Params&, u_long& totdata, PageType p);
+    bool	tagLineFits(u_char* buf, u_int fillorder, const Class2Params&, u_long totdata);
 /*
  * Correct if neccessary Phase C (T.4/T.6) data (remove extra RTC/EOFB etc.)
  */
     void	correctPhaseCData(u_char* buf, u_long& pBufSize,
                                   u_int fillorder, const Class2Params& params, uint32& rows);
+    void	fixFirstEOL(u_char* buf, u_long cc,
+		    u_int fillorder, const Class2Params& params);
+    void	cutExtraRTC(u_char* buf, u_long& cc,
+		    u_int fillorder, const Class2Params& params);
 /*
  * Convert Phase C data...
  */
@@ -76,6 +76,7 @@ FaxRequest::reset(void)
     nsf = fxStr::null;
     notify = no_notice;
     jobtype = "facsimile";		// for compatibility w/ old clients
+    binary = false;
 }
 
 FaxRequest::~FaxRequest()
@@ -233,13 +234,81 @@ FaxRequest::readQFile(bool& rejectJob)
      */
     status = send_nobatch;
 
+    if (isBinaryQFile(bp, (u_int) sb.st_size)) {
+	binary = true;
+	if (!decodeQFile((const u_char*) bp, (u_int) sb.st_size,
+	  statusstring, statuscode, rejectJob)) {
+	    error("Corrupted file (bad binary encoding)");
+	    if (buf != stackbuf)
+		delete [] buf;
+	    return (false);
+	}
+    } else {
+	binary = false;
+	parseQFile(bp, (u_int) sb.st_size, statusstring, statuscode, rejectJob);
+    }
+    if (pri == (u_short) -1)
+	pri = usrpri;
+    if (tts == 0)	// distinguish ``now'' from unset
+	tts = Sys::now();
+    /*
+     * Validate certain items that are assumed to have
+     * ``suitable values'' by higher-level code (i.e.
+     * the scheduler).
+     */
+    if (state < state_suspended || state > state_failed) {
+	error("Invalid scheduler state %u in job request", state);
+	rejectJob = true;
+    }
+#define	isNull(s)	((s).length() == 0)
+    if (isNull(number) || isNull(mailaddr) || isNull(sender) || isNull(jobid)
+     || isNull(modem)  || isNull(client)   || isNull(owner)) {
+	rejectJob = true;
+	error("Null or missing %s in job request",
+	    isNull(number)   ? "number" :
+	    isNull(mailaddr) ? "mailaddr" :
+	    isNull(sender)   ? "sender" :
+	    isNull(jobid)    ? "jobid" :
+	    isNull(modem)    ? "modem" :
+	    isNull(client)   ? "client" :
+			       "owner"
+	);
+    }
+
+    /*
+     * We try to default it to something sane if it wasn't in
+     * the qfile already
+     */
+    if (statuscode == 999 && statusstring.length() == 0)
+	    statuscode = 0;
+
+    result = Status(statuscode, "%s", (const char*)statusstring);
+    if (minbr > BR_33600)	minbr = BR_33600;
+    if (desiredbr > BR_33600)	desiredbr = BR_33600;
+    if (desiredst > ST_40MS)	desiredst = ST_40MS;
+    if (desiredec > EC_ECLFULL)	desiredec = EC_ECLFULL;
+    if (desireddf > DF_2DMMR)	desireddf = DF_2DMMR;
+    if (buf != stackbuf)			// dynamically allocated buffer
+	delete [] buf;
+    return (true);
+}
+
+/*
+ * Parse the contents of a text job description file.
+ * The buffer must have room for one byte past the end
+ * of the file contents.
+ */
+void
+FaxRequest::parseQFile(char* bp, u_int cc,
+    fxStr& statusstring, u_int& statuscode, bool& rejectJob)
+{
     /*
      * Force \n-termination of the last line in the
      * file.  This simplifies the logic below by always
      * being able to look for \n-termination and not
      * worry about running off the end of the buffer.
      */
-    char* ep = bp+sb.st_size;
+    char* ep = bp+cc;
     if (ep[-1] != '\n')
 	ep[0] = '\n';
     do {
@@ -407,50 +476,6 @@ FaxRequest::readQFile(bool& rejectJob)
 	    error("Unknown field %s[%u]: %s", cmd, hash, tag);
 	}
     } while (bp < ep);
-    if (pri == (u_short) -1)
-	pri = usrpri;
-    if (tts == 0)	// distinguish ``now'' from unset
-	tts = Sys::now();
-    /*
-     * Validate certain items that are assumed to have
-     * ``suitable values'' by higher-level code (i.e.
-     * the scheduler).
-     */
-    if (state < state_suspended || state > state_failed) {
-	error("Invalid scheduler state %u in job request", state);
-	rejectJob = true;
-    }
-#define	isNull(s)	((s).length() == 0)
-    if (isNull(number) || isNull(mailaddr) || isNull(sender) || isNull(jobid)
-     || isNull(modem)  || isNull(client)   || isNull(owner)) {
-	rejectJob = true;
-	error("Null or missing %s in job request",
-	    isNull(number)   ? "number" :
-	    isNull(mailaddr) ? "mailaddr" :
-	    isNull(sender)   ? "sender" :
-	    isNull(jobid)    ? "jobid" :
-	    isNull(modem)    ? "modem" :
-	    isNull(client)   ? "client" :
-			       "owner"
-	);
-    }
-
-    /*
-     * We try to default it to something sane if it wasn't in
-     * the qfile already
-     */
-    if (statuscode == 999 && statusstring.length() == 0)
-	    statuscode = 0;
-
-    result = Status(statuscode, "%s", (const char*)statusstring);
-    if (minbr > BR_33600)	minbr = BR_33600;
-    if (desiredbr > BR_33600)	desiredbr = BR_33600;
-    if (desiredst > ST_40MS)	desiredst = ST_40MS;
-    if (desiredec > EC_ECLFULL)	desiredec = EC_ECLFULL;
-    if (desireddf > DF_2DMMR)	desireddf = DF_2DMMR;
-    if (buf != stackbuf)			// dynamically allocated buffer
-	delete [] buf;
-    return (true);
 }
 
 /*
@@ -497,6 +522,23 @@ void
 FaxRequest::writeQFile()
 {
     fxStackBuffer sb;
+    if (binary)
+	encodeQFile(sb);
+    else
+	writeTextQFile(sb);
+    lseek(fd, 0L, SEEK_SET);
+    Sys::write(fd, sb, sb.getLength());
+    (void) ftruncate(fd, sb.getLength());
+    // XXX maybe should fsync, but not especially portable
+}
+
+/*
+ * Format the job description in the traditional
+ * line-oriented ``tag:value'' text form.
+ */
+void
+FaxRequest::writeTextQFile(fxStackBuffer& sb)
+{
     sb.fput("tts:%u\n", tts);
     sb.fput("killtime:%u\n", killtime);
     sb.fput("retrytime:%u\n", retrytime);
@@ -532,10 +574,210 @@ FaxRequest::writeQFile()
 	    , (const char*) fitem.item
 	);
     }
-    lseek(fd, 0L, SEEK_SET);
-    Sys::write(fd, sb, sb.getLength());
-    (void) ftruncate(fd, sb.getLength());
-    // XXX maybe should fsync, but not especially portable
+}
+
+/*
+ * Binary queue file support.
+ *
+ * A binary queue file holds the same information as the
+ * text form but in a layout that can be decoded without
+ * any tokenizing or hashing.  All integers are stored
+ * big-endian.  The file is laid out as:
+ *
+ *    0	magic "\0HFQ"
+ *    4	format version (16 bits)
+ *    6	# shortvals entries
+ *    8	# strvals entries
+ *   10	# document/polling items
+ *   12	string table size (32 bits)
+ *   16	tts, killtime, retrytime, statuscode, returned (32 bits each)
+ *   36	notify, pagechop (16 bits each)
+ *   40	chopthreshold (IEEE float bits)
+ *   44	string table offset of the status string
+ *   48	shortvals values (16 bits each, in shortvals[] order)
+ *	strvals string table offsets (32 bits each, in strvals[] order)
+ *	items (op and dirnum 16 bits, addr and item offsets 32 bits)
+ *	string table (null-terminated strings; offset 0 is "")
+ *
+ * New fields must only be appended to the shortvals[] and
+ * strvals[] tables so that files written by older software
+ * (with fewer entries) remain readable.
+ */
+#define	QF_VERSION	1
+#define	QF_HDRSIZE	48
+#define	QF_ITEMSIZE	12
+
+static const char qfMagic[4] = { '\0', 'H', 'F', 'Q' };
+
+static void
+put16(fxStackBuffer& sb, u_int v)
+{
+    sb.put((char)(v>>8));
+    sb.put((char) v);
+}
+
+static void
+put32(fxStackBuffer& sb, u_long v)
+{
+    sb.put((char)(v>>24));
+    sb.put((char)(v>>16));
+    sb.put((char)(v>>8));
+    sb.put((char) v);
+}
+
+static u_int
+get16(const u_char* cp)
+{
+    return ((cp[0]<<8) | cp[1]);
+}
+
+static u_long
+get32(const u_char* cp)
+{
+    return (((u_long) cp[0]<<24) | ((u_long) cp[1]<<16) | (cp[2]<<8) | cp[3]);
+}
+
+/*
+ * Add a string to the string table and return its offset.
+ */
+static u_long
+addString(fxStackBuffer& strtab, const char* s)
+{
+    if (s[0] == '\0')
+	return (0);
+    u_long off = strtab.getLength();
+    strtab.put(s, strlen(s)+1);
+    return (off);
+}
+
+bool
+FaxRequest::isBinaryQFile(const char* buf, u_int cc)
+{
+    return (cc >= sizeof (qfMagic) && memcmp(buf, qfMagic, sizeof (qfMagic)) == 0);
+}
+
+void
+FaxRequest::encodeQFile(fxStackBuffer& sb)
+{
+    fxStackBuffer strtab;
+    strtab.put('\0');				// offset 0 is ""
+    u_long stroff[N(strvals)];
+    for (u_int i = 0; i < N(strvals); i++)
+	stroff[i] = addString(strtab, (*this).*strvals[i].p);
+    u_long statusoff = addString(strtab, result.string());
+    u_int nitems = items.length();
+    u_long* itemoff = new u_long[2*nitems+1];
+    for (u_int i = 0; i < nitems; i++) {
+	itemoff[2*i+0] = addString(strtab, items[i].addr);
+	itemoff[2*i+1] = addString(strtab, items[i].item);
+    }
+
+    sb.put(qfMagic, sizeof (qfMagic));
+    put16(sb, QF_VERSION);
+    put16(sb, N(shortvals));
+    put16(sb, N(strvals));
+    put16(sb, nitems);
+    put32(sb, strtab.getLength());
+    put32(sb, tts);
+    put32(sb, killtime);
+    put32(sb, retrytime);
+    put32(sb, result.value());
+    put32(sb, status);
+    put16(sb, notify&3);
+    put16(sb, pagechop&3);
+    u_int bits;
+    memcpy(&bits, &chopthreshold, sizeof (bits));
+    put32(sb, bits);
+    put32(sb, statusoff);
+    for (u_int i = 0; i < N(shortvals); i++)
+	put16(sb, (*this).*shortvals[i].p);
+    for (u_int i = 0; i < N(strvals); i++)
+	put32(sb, stroff[i]);
+    for (u_int i = 0; i < nitems; i++) {
+	put16(sb, items[i].op);
+	put16(sb, items[i].dirnum);
+	put32(sb, itemoff[2*i+0]);
+	put32(sb, itemoff[2*i+1]);
+    }
+    delete [] itemoff;
+    sb.put(strtab, strtab.getLength());
+}
+
+bool
+FaxRequest::decodeQFile(const u_char* bp, u_int cc,
+    fxStr& statusstring, u_int& statuscode, bool& rejectJob)
+{
+    if (cc < QF_HDRSIZE || get16(bp+4) != QF_VERSION)
+	return (false);
+    u_int nshort = get16(bp+6);
+    u_int nstr = get16(bp+8);
+    u_int nitems = get16(bp+10);
+    u_long strsize = get32(bp+12);
+    if (nshort > N(shortvals) || nstr > N(strvals))
+	return (false);
+    u_long off = QF_HDRSIZE + 2*nshort + 4*nstr + QF_ITEMSIZE*nitems;
+    if (strsize == 0 || off + strsize != cc)
+	return (false);
+    const char* strtab = (const char*) bp + off;
+    if (strtab[strsize-1] != '\0')		// guarantee termination
+	return (false);
+#define	STR(o)	((o) < strsize ? strtab+(o) : (valid = false, ""))
+    bool valid = true;
+
+    tts = get32(bp+16);
+    killtime = get32(bp+20);
+    retrytime = get32(bp+24);
+    statuscode = get32(bp+28);
+    status = (FaxSendStatus) get32(bp+32);
+    notify = get16(bp+36);
+    if (notify > 3) {
+	error("Invalid notify value %u", notify);
+	notify = no_notice;
+    }
+    pagechop = get16(bp+38);
+    if (pagechop > 3) {
+	error("Invalid pagechop value %u", pagechop);
+	pagechop = chop_default;
+    }
+    u_int bits = get32(bp+40);
+    memcpy(&chopthreshold, &bits, sizeof (bits));
+    statusstring = STR(get32(bp+44));
+
+    const u_char* cp = bp + QF_HDRSIZE;
+    for (u_int i = 0; i < nshort; i++, cp += 2)
+	(*this).*shortvals[i].p = get16(cp);
+    for (u_int i = 0; i < nstr; i++, cp += 4)
+	(*this).*strvals[i].p = STR(get32(cp));
+    for (u_int i = 0; i < nitems; i++, cp += QF_ITEMSIZE) {
+	u_int op = get16(cp);
+	const char* addr = STR(get32(cp+4));
+	const char* item = STR(get32(cp+8));
+	switch (op) {
+	case send_tiff:
+	case send_pdf:
+	case send_postscript:
+	case send_pcl:
+	case send_data:
+	    if (!checkDocument(item)) {
+		error("Rejected document in corrupt job request");
+		rejectJob = true;
+		continue;
+	    }
+	    break;
+	case send_unknown:
+	    error("Unknown document operation %u", op);
+	    continue;
+	default:
+	    if (op > send_unknown) {
+		error("Unknown document operation %u", op);
+		continue;
+	    }
+	    break;
+	}
+	items.append(FaxItem((FaxSendOp) op, get16(cp+2), addr, item));
+    }
+#undef STR
+    return (valid);
 }
 
 /*
@@ -36,6 +36,7 @@
 #include "Status.h"
 
 class Class2Params;
+class fxStackBuffer;
 
 
 /*
@@ -50,6 +51,13 @@ protected:
     void reset(void);
     virtual bool checkDocument(const char* pathname);
     virtual void error(const char* fmt, ...);
+
+    void parseQFile(char* bp, u_int cc,
+	fxStr& statusstring, u_int& statuscode, bool& rejectJob);
+    bool decodeQFile(const u_char* bp, u_int cc,
+	fxStr& statusstring, u_int& statuscode, bool& rejectJob);
+    void encodeQFile(fxStackBuffer&);
+    void writeTextQFile(fxStackBuffer&);
 public:
     enum {
 	send_fax	= 0,	// send prepared file via fax
@@ -173,6 +181,7 @@ public:
     fxStr	nsf;		// NSF string from receiving equipment (ASCII representation)
     fxStr	pagerange;	// Range of pages to send (if set)
     pid_t	writeQFilePid;	// pid of last writeQFile operation
+    bool	binary;		// queue file uses binary encoding
     FaxItemArray items;	// set of requests
 
     static stringval strvals[];
@@ -188,6 +197,7 @@ public:
     void writeQFile();
     u_int findItem(FaxSendOp, u_int start = 0) const;
 
+    static bool isBinaryQFile(const char* buf, u_int cc);
     static bool isStrCmd(const char* cmd, u_int& ix);
     static bool isShortCmd(const char* cmd, u_int& ix);
 
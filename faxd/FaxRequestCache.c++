@@ -0,0 +1,174 @@
+/*	$Id$ */
+/*
+ * Copyright (c) 2026 iFAX Solutions, Inc.
+ * HylaFAX is a trademark of Silicon Graphics
+ *
+ * Permission to use, copy, modify, distribute, and sell this software and
+ * its documentation for any purpose is hereby granted without fee, provided
+ * that (i) the above copyright notices and this permission notice appear in
+ * all copies of the software and related documentation, and (ii) the names of
+ * Sam Leffler and Silicon Graphics may not be used in any advertising or
+ * publicity relating to the software without the specific, prior written
+ * permission of Sam Leffler and Silicon Graphics.
+ *
+ * THE SOFTWARE IS PROVIDED "AS-IS" AND WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS, IMPLIED OR OTHERWISE, INCLUDING WITHOUT LIMITATION, ANY
+ * WARRANTY OF MERCHANTABILITY OR FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * IN NO EVENT SHALL SAM LEFFLER OR SILICON GRAPHICS BE LIABLE FOR
+ * ANY SPECIAL, INCIDENTAL, INDIRECT OR CONSEQUENTIAL DAMAGES OF ANY KIND,
+ * OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS,
+ * WHETHER OR NOT ADVISED OF THE POSSIBILITY OF DAMAGE, AND ON ANY THEORY OF
+ * LIABILITY, ARISING OUT OF OR IN CONNECTION WITH THE USE OR PERFORMANCE
+ * OF THIS SOFTWARE.
+ */
+#include "Sys.h"
+#include "FaxRequestCache.h"
+#include "FaxRequest.h"
+
+class FaxRequestCacheEntry : public QLink {
+public:
+    FaxRequest	req;		// parsed request contents
+    dev_t	dev;		// qfile identity and state when cached
+    ino_t	ino;
+    off_t	size;
+    time_t	mtime;
+
+    FaxRequestCacheEntry(const FaxRequest& r);
+    ~FaxRequestCacheEntry();
+
+    void set(const FaxRequest& r, const struct stat& sb);
+    bool isValid(const struct stat& sb) const;
+};
+
+FaxRequestCacheEntry::FaxRequestCacheEntry(const FaxRequest& r) : req(r)
+{
+    req.fd = -1;
+}
+FaxRequestCacheEntry::~FaxRequestCacheEntry() {}
+
+void
+FaxRequestCacheEntry::set(const FaxRequest& r, const struct stat& sb)
+{
+    req = r;
+    req.fd = -1;			// never close the caller's file
+    dev = sb.st_dev;
+    ino = sb.st_ino;
+    size = sb.st_size;
+    mtime = sb.st_mtime;
+}
+
+bool
+FaxRequestCacheEntry::isValid(const struct stat& sb) const
+{
+    return (sb.st_dev == dev && sb.st_ino == ino &&
+	sb.st_size == size && sb.st_mtime == mtime);
+}
+
+fxIMPLEMENT_StrKeyPtrValueDictionary(FaxRequestCacheDict, FaxRequestCacheEntry*)
+
+FaxRequestCache::FaxRequestCache()
+{
+    maxEntries = 0;
+    hits = misses = evictions = invalidations = 0;
+}
+
+FaxRequestCache::~FaxRequestCache()
+{
+    flush();
+}
+
+void
+FaxRequestCache::setMaxEntries(u_int n)
+{
+    maxEntries = n;
+    while (entries.size() > maxEntries) {
+	remove((FaxRequestCacheEntry*) lru.prev);
+	evictions++;
+    }
+}
+
+void
+FaxRequestCache::remove(FaxRequestCacheEntry* e)
+{
+    entries.remove(e->req.qfile);
+    e->remove();
+    delete e;
+}
+
+/*
+ * Fill in a request from the cache.  The request must
+ * have its queue file open (and locked) so that the file
+ * can be checked against the cached state; the caller's
+ * file descriptor is preserved.
+ */
+bool
+FaxRequestCache::lookup(FaxRequest& req)
+{
+    FaxRequestCacheEntry** ep = (FaxRequestCacheEntry**) entries.find(req.qfile);
+    if (ep) {
+	FaxRequestCacheEntry* e = *ep;
+	struct stat sb;
+	if (Sys::fstat(req.fd, sb) >= 0 && e->isValid(sb)) {
+	    int fd = req.fd;
+	    req = e->req;
+	    req.fd = fd;
+	    e->remove();			// move to head of lru list
+	    e->insert(*lru.next);
+	    hits++;
+	    return (true);
+	}
+	remove(e);
+    }
+    misses++;
+    return (false);
+}
+
+/*
+ * Record the contents of a request that was just read
+ * from, or written to, its open queue file.
+ */
+void
+FaxRequestCache::update(const FaxRequest& req, bool written)
+{
+    if (maxEntries == 0)
+	return;
+    struct stat sb;
+    if (Sys::fstat(req.fd, sb) < 0 ||
+      (!written && sb.st_mtime >= Sys::now())) {
+	invalidate(req.qfile);
+	return;
+    }
+    FaxRequestCacheEntry* e;
+    FaxRequestCacheEntry** ep = (FaxRequestCacheEntry**) entries.find(req.qfile);
+    if (ep) {
+	e = *ep;
+	e->remove();
+    } else {
+	if (entries.size() >= maxEntries) {
+	    remove((FaxRequestCacheEntry*) lru.prev);
+	    evictions++;
+	}
+	e = new FaxRequestCacheEntry(req);
+	entries[req.qfile] = e;
+    }
+    e->set(req, sb);
+    e->insert(*lru.next);
+}
+
+void
+FaxRequestCache::invalidate(const fxStr& qfile)
+{
+    FaxRequestCacheEntry** ep = (FaxRequestCacheEntry**) entries.find(qfile);
+    if (ep) {
+	remove(*ep);
+	invalidations++;
+    }
+}
+
+void
+FaxRequestCache::flush()
+{
+    while (!lru.isEmpty())
+	remove((FaxRequestCacheEntry*) lru.next);
+}
@@ -0,0 +1,80 @@
+/*	$Id$ */
+/*
+ * Copyright (c) 2026 iFAX Solutions, Inc.
+ * HylaFAX is a trademark of Silicon Graphics
+ *
+ * Permission to use, copy, modify, distribute, and sell this software and
+ * its documentation for any purpose is hereby granted without fee, provided
+ * that (i) the above copyright notices and this permission notice appear in
+ * all copies of the software and related documentation, and (ii) the names of
+ * Sam Leffler and Silicon Graphics may not be used in any advertising or
+ * publicity relating to the software without the specific, prior written
+ * permission of Sam Leffler and Silicon Graphics.
+ *
+ * THE SOFTWARE IS PROVIDED "AS-IS" AND WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS, IMPLIED OR OTHERWISE, INCLUDING WITHOUT LIMITATION, ANY
+ * WARRANTY OF MERCHANTABILITY OR FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * IN NO EVENT SHALL SAM LEFFLER OR SILICON GRAPHICS BE LIABLE FOR
+ * ANY SPECIAL, INCIDENTAL, INDIRECT OR CONSEQUENTIAL DAMAGES OF ANY KIND,
+ * OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS,
+ * WHETHER OR NOT ADVISED OF THE POSSIBILITY OF DAMAGE, AND ON ANY THEORY OF
+ * LIABILITY, ARISING OUT OF OR IN CONNECTION WITH THE USE OR PERFORMANCE
+ * OF THIS SOFTWARE.
+ */
+#ifndef _FaxRequestCache_
+#define	_FaxRequestCache_
+/*
+ * Cache of parsed job request (qfile) state for the scheduler.
+ */
+#include "QLink.h"
+#include "Dictionary.h"
+
+class FaxRequest;
+class FaxRequestCacheEntry;
+
+fxDECLARE_StrKeyDictionary(FaxRequestCacheDict, FaxRequestCacheEntry*)
+
+/*
+ * The scheduler reads a job's queue file each time it
+ * considers the job.  This cache holds a copy of the parsed
+ * contents of recently used queue files so that a read can
+ * be satisfied without parsing the file when it is known to
+ * be unchanged.  Entries are validated against the file's
+ * device, inode, size and modification time.  A file read
+ * in the same second it was last modified is not cached,
+ * since a later change in that second would go unnoticed;
+ * contents we wrote ourselves are trusted until another
+ * process is known to have changed the file and the entry
+ * is invalidated.  The cache is bounded and the least
+ * recently used entries are discarded first.
+ */
+class FaxRequestCache {
+private:
+    FaxRequestCacheDict entries;	// entries by qfile name
+    QLink	lru;			// entries, most recently used first
+    u_int	maxEntries;		// max entries to hold, 0 to disable
+
+    void	remove(FaxRequestCacheEntry*);
+public:
+					// statistics
+    u_int	hits;			// # lookups satisfied from the cache
+    u_int	misses;			// # lookups that required a parse
+    u_int	evictions;		// # entries discarded as least used
+    u_int	invalidations;		// # entries explicitly discarded
+
+    FaxRequestCache();
+    ~FaxRequestCache();
+
+    void	setMaxEntries(u_int);
+    u_int	getMaxEntries() const;
+    u_int	size() const;
+
+    bool	lookup(FaxRequest& req);
+    void	update(const FaxRequest& req, bool written = false);
+    void	invalidate(const fxStr& qfile);
+    void	flush();
+};
+inline u_int FaxRequestCache::getMaxEntries() const	{ return maxEntries; }
+inline u_int FaxRequestCache::size() const	{ return entries.size(); }
+#endif /* _FaxRequestCache_ */
@@ -34,7 +34,7 @@
  * the state expected by Frank Cringle's decoder.
  */
 #define	DECLARE_STATE_EOL()						\
-    uint32 BitAcc;			/* bit accumulator */		\
+    g3bits_t BitAcc;			/* bit accumulator */		\
     int BitsAvail;			/* # valid bits in BitAcc */	\
     int EOLcnt				/* # EOL codes recognized */
 #define	DECLARE_STATE()							\
@@ -67,29 +67,44 @@
 
 /*
  * Override default definitions for the TIFF library.
- * We redirect the logic to call nextByte for each
- * input byte we need.  Note that we don't need to check
- * for EOF because the input decoder does a longjmp.
+ * Data in memory (see setInput) is loaded into the
+ * accumulator a word at a time; otherwise we redirect
+ * the logic to call nextByte for each input byte we need.
+ * Note that we don't need to check for EOF because the
+ * input decoder does a longjmp.
  */
 #define NeedBits8(n,eoflab) do {					\
     if (BitsAvail < (n)) {						\
-	BitAcc |= nextByte()<<BitsAvail;				\
-	BitsAvail += 8;							\
+	if (inp)							\
+	    fillBits(BitAcc, BitsAvail, n);				\
+	else {								\
+	    BitAcc |= (g3bits_t) nextByte()<<BitsAvail;			\
+	    BitsAvail += 8;						\
+	}								\
     }									\
 } while (0)
 #define NeedBits16(n,eoflab) do {					\
     if (BitsAvail < (n)) {						\
-	BitAcc |= nextByte()<<BitsAvail;				\
-	if ((BitsAvail += 8) < (n)) {					\
-	    BitAcc |= nextByte()<<BitsAvail;				\
-	    BitsAvail += 8;						\
+	if (inp)							\
+	    fillBits(BitAcc, BitsAvail, n);				\
+	else {								\
+	    BitAcc |= (g3bits_t) nextByte()<<BitsAvail;			\
+	    if ((BitsAvail += 8) < (n)) {				\
+		BitAcc |= (g3bits_t) nextByte()<<BitsAvail;		\
+		BitsAvail += 8;						\
+	    }								\
 	}								\
     }									\
 } while (0)
 
 #include "tif_fax3.h"
 
-G3Decoder::G3Decoder() {}
+G3Decoder::G3Decoder()
+{
+    data = 0;
+    bit = 0;
+    inp = inEnd = NULL;
+}
 G3Decoder::~G3Decoder() {}
 
 void
@@ -104,6 +119,9 @@ G3Decoder::setupDecoder(u_int recvFillOrder, bool is2d, bool isg4)
     is2D = is2d;
     isG4 = isg4;
     bitmap = TIFFGetBitRevTable(recvFillOrder != FILLORDER_LSB2MSB);
+    reverseBits = (recvFillOrder != FILLORDER_LSB2MSB);
+    if (inp)
+	inp = getInput();			// back up over unused data
     data = 0;					// not needed
     bit = 0;					// force initial read
     EOLcnt = 0;					// no initial EOL
@@ -123,6 +141,61 @@ G3Decoder::setRuns(tiff_runlen_t* cr, tiff_runlen_t* rr, int w)
     }
 }
 
+/*
+ * Decode data from memory instead of calling nextByte
+ * for each byte.  nextByte is called only when the data
+ * is exhausted and is expected to raise EOF or RTC.
+ */
+void
+G3Decoder::setInput(u_char* bp, u_long cc)
+{
+    inp = bp;
+    inEnd = bp + cc;
+    data = 0;
+    bit = 0;
+}
+
+#define	ACCBITS	(8*(int) sizeof (g3bits_t))
+
+/*
+ * Load as many whole bytes of in-memory input as fit
+ * in the bit accumulator.  When a full word remains
+ * it is loaded at once and bit-reversed in place;
+ * any bits beyond the bytes accounted for are input
+ * that will be loaded again, so OR'ing it in now is
+ * harmless.
+ */
+inline void
+G3Decoder::fillBits(g3bits_t& acc, int& avail, int n)
+{
+    if (inEnd - inp >= (int) sizeof (g3bits_t)) {
+	g3bits_t w = 0;
+	for (u_int i = 0; i < sizeof (g3bits_t); i++)
+	    w |= (g3bits_t) inp[i] << (8*i);
+	if (reverseBits) {
+	    const g3bits_t m1 = (g3bits_t) 0x5555555555555555ULL;
+	    const g3bits_t m2 = (g3bits_t) 0x3333333333333333ULL;
+	    const g3bits_t m4 = (g3bits_t) 0x0f0f0f0f0f0f0f0fULL;
+	    w = ((w >> 1) & m1) | ((w & m1) << 1);
+	    w = ((w >> 2) & m2) | ((w & m2) << 2);
+	    w = ((w >> 4) & m4) | ((w & m4) << 4);
+	}
+	acc |= w << avail;
+	int nb = (ACCBITS-1 - avail) >> 3;	// leave room to push back a bit
+	inp += nb;
+	avail += nb<<3;
+    } else {
+	while (avail <= ACCBITS-1-8 && inp < inEnd) {
+	    acc |= (g3bits_t) bitmap[*inp++] << avail;
+	    avail += 8;
+	}
+	while (avail < n) {			// out of data
+	    acc |= (g3bits_t) nextByte() << avail;
+	    avail += 8;
+	}
+    }
+}
+
 void G3Decoder::raiseEOF()	{ siglongjmp(jmpEOF, 1); }
 void G3Decoder::raiseRTC()	{ siglongjmp(jmpRTC, 1); }
 
@@ -174,6 +247,52 @@ G3Decoder::isNextRow1D()
     return (is1D);
 }
 
+/*
+ * Set the black runs in a scanline.  The row is
+ * cleared and whole bytes of each black span are
+ * set with memset.  As with the TIFF library fill
+ * routine runs that overflow the row are clipped
+ * in place and an odd run count is padded with a
+ * zero run, so the result is the same reference
+ * line for the next row.
+ */
+static void
+fillruns(u_char* buf, tiff_runlen_t* runs, tiff_runlen_t* erun,
+    tiff_runlen_t lastx)
+{
+    memset(buf, 0, howmany(lastx, 8));
+    if ((erun-runs)&1)
+	*erun++ = 0;
+    tiff_runlen_t x = 0;
+    for (; runs < erun; runs += 2) {
+	if (x+runs[0] > lastx || runs[0] > lastx)
+	    runs[0] = lastx - x;
+	x += runs[0];				// white
+	if (x+runs[1] > lastx || runs[1] > lastx)
+	    runs[1] = lastx - x;
+	tiff_runlen_t run = runs[1];		// black
+	if (run == 0)
+	    continue;
+	u_char* cp = buf + (x>>3);
+	u_int bx = x & 7;
+	x += run;
+	if (bx) {				// partial byte on lhs
+	    if (bx+run < 8) {
+		*cp |= (0xff >> bx) & ~(0xff >> (bx+run));
+		continue;
+	    }
+	    *cp++ |= 0xff >> bx;
+	    run -= 8-bx;
+	}
+	if (run >= 8) {
+	    memset(cp, 0xff, run>>3);
+	    cp += run>>3;
+	}
+	if (run &= 7)				// partial byte on rhs
+	    *cp |= 0xff << (8-run);
+    }
+}
+
 #define	unexpected(table, a0) do {		\
     invalidCode(table, a0);			\
     rowgood = false;				\
@@ -239,7 +358,7 @@ G3Decoder::decodeRow(void* scanline, u_int lastx)
     if (!nullrow)
 	RTCrun = 0;
     if (scanline)
-	_TIFFFax3fillruns((u_char*) scanline, thisrun, pa, lastx);
+	fillruns((u_char*) scanline, thisrun, pa, lastx);
     if (is2D) {
 	SETVAL(0);			// imaginary change for reference
 	SWAP(tiff_runlen_t*, curruns, refruns);
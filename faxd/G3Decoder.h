@@ -33,13 +33,19 @@ extern "C" {
 #include <setjmp.h>
 }
 #include "tiffio.h"
+#ifdef HAVE_STDINT_H
+#include <stdint.h>
+typedef uint64_t g3bits_t;	// decoder bit accumulator
+#else
+typedef u_long g3bits_t;
+#endif
 
 class G3Decoder {
 private:
     bool	is2D;		// whether or not data is 2d-encoded
     bool	isG4;		// whether or not data is MMR
-    uint32	data;		// current input/output byte
-    int		bit;		// current bit in input/output byte
+    g3bits_t	data;		// bit accumulator
+    int		bit;		// # valid bits in accumulator
     int		EOLcnt;		// EOL code recognized during decoding (1/0)
     int		RTCrun;		// count of consecutive zero-length rows
     int		rowref;		// reference count of rows decoded
@@ -49,9 +55,17 @@ private:
     tiff_runlen_t*	refruns;	// runs for reference line
     tiff_runlen_t*	curruns;	// runs for current line
     const u_char* bitmap;	// bit reversal table
+    bool	reverseBits;	// whether input bit order is reversed
+    u_char*	inp;		// next byte of in-memory input
+    u_char*	inEnd;		// end of in-memory input
+
+    void	fillBits(g3bits_t& acc, int& avail, int n);
 protected:
     G3Decoder();
 
+    void	setInput(u_char* bp, u_long cc);
+    u_char*	getInput() const;
+
     void	raiseEOF();
     void	raiseRTC();
 
@@ -102,7 +116,9 @@ public:
 
 inline tiff_runlen_t* G3Decoder::lastRuns()	{ return is2D ? refruns : curruns; }
 inline const u_char* G3Decoder::getBitmap()	{ return bitmap; }
-inline int G3Decoder::getPendingBits() const	{ return bit; }
+inline int G3Decoder::getPendingBits() const
+    { return (inp ? bit&7 : bit); }
+inline u_char* G3Decoder::getInput() const	{ return inp - (bit>>3); }
 inline bool G3Decoder::seenRTC() const		{ return (RTCrow != -1); }
 inline int G3Decoder::getRTCRow() const		{ return RTCrow; }
 inline int G3Decoder::getReferenceRow() const	{ return rowref; }
@@ -33,6 +33,12 @@
 #include "StackBuffer.h"
 #include "tiffio.h"
 #include "t4.h"
+#ifdef HAVE_STDINT_H
+#include <stdint.h>
+typedef uint64_t spanword_t;
+#else
+typedef u_long spanword_t;
+#endif
 
 G3Encoder::G3Encoder(fxStackBuffer& b) : buf(b) {}
 G3Encoder::~G3Encoder() {}
@@ -51,21 +57,10 @@ G3Encoder::setupEncoder(u_int fillOrder, bool is2d, bool isg4)
      */
     bitmap = TIFFGetBitRevTable(fillOrder != FILLORDER_MSB2LSB);
     data = 0;
-    bit = 8;
+    nbits = 0;
     firstEOL = true;
 }
 
-/*
- * Flush 8-bits of encoded data to the output buffer.
- */
-inline void
-G3Encoder::flushBits()
-{
-    buf.put(bitmap[data]);
-    data = 0;
-    bit = 8;
-}
-
 static const tableentry horizcode =
     { 3, 0x1 };		/* 001 */
 static const tableentry passcode =
@@ -80,182 +75,80 @@ static const tableentry vcodes[7] = {
     { 7, 0x02 }		/* 0000 010 */  
 };
 
-#define isAligned(p,t)  ((((u_long)(p)) & (sizeof (t)-1)) == 0)
+#define	WORDBITS	(8*(int) sizeof (spanword_t))
 
 /*
- * Find a span of ones or zeros using the supplied
- * table.  The byte-aligned start of the bit string
- * is supplied along with the start+end bit indices.
- * The table gives the number of consecutive ones or
- * zeros starting from the msb and is indexed by byte
- * value.
+ * Load the word of pixels that starts at p, most
+ * significant bit first.  Bytes at or beyond the end
+ * of the row, ep, are returned as zero.
  */
-int
-G3Encoder::findspan(const u_char** bpp, int bs, int be, const u_char* tab)
+static inline spanword_t
+loadWord(const u_char* p, const u_char* ep)
 {
-    const u_char *bp = *bpp;
-    int bits = be - bs;
-    int n, span;
-
-    /*
-     * Check partial byte on lhs.
-     */
-    if (bits > 0 && (n = (bs & 7))) {
-	span = tab[(*bp << n) & 0xff];
-	if (span > 8-n)        /* table value too generous */
-	    span = 8-n;
-	if (span > bits)	/* constrain span to bit range */
-	    span = bits;
-	if (n+span < 8)        /* doesn't extend to edge of byte */
-	    goto done;
-	bits -= span;
-	bp++;
-    } else
-	span = 0;
-    /*
-     * Scan full bytes for all 1's or all 0's.
-     */
-    while (bits >= 8) {
-	n = tab[*bp];
-	span += n;
-	bits -= n;
-	if (n < 8)        /* end of run */
-	    goto done;
-	bp++;
+    spanword_t w = 0;
+    u_int i;
+    if (ep - p >= (int) sizeof (spanword_t)) {
+	for (i = 0; i < sizeof (spanword_t); i++)
+	    w = (w << 8) | p[i];
+    } else {
+	for (i = 0; p+i < ep; i++)
+	    w = (w << 8) | p[i];
+	w <<= 8*(sizeof (spanword_t) - i);
     }
-    /*
-     * Check partial byte on rhs.
-     */
-    if (bits > 0) {
-	n = tab[*bp];
-	span += (n > bits ? bits : n);
-    }
-done:
-    *bpp = bp;
-    return (span);
+    return (w);
 }
 
 /*
- * Find a span of ones or zeros using the supplied
- * table.  The ``base'' of the bit string is supplied
- * along with the start+end bit indices.
+ * Count the leading zero bits in a non-zero word.
  */
-int
-G3Encoder::find0span(const u_char* bp, int bs, int be)
+static inline int
+countZeros(spanword_t w)
 {
-	int32 bits = be - bs;
-	int32 n, span;
-
-	bp += bs>>3;
-	/*
-	 * Check partial byte on lhs.
-	 */
-	if (bits > 0 && (n = (bs & 7))) {
-		span = zeroruns[(*bp << n) & 0xff];
-		if (span > 8-n)		/* table value too generous */
-			span = 8-n;
-		if (span > bits)	/* constrain span to bit range */
-			span = bits;
-		if (n+span < 8)		/* doesn't extend to edge of byte */
-			return (span);
-		bits -= span;
-		bp++;
-	} else
-		span = 0;
-	if ((uint32) bits >= 2*8*sizeof (long)) {
-		long* lp;
-		/*
-		 * Align to longword boundary and check longwords.
-		 */
-		while (!isAligned(bp, long)) {
-			if (*bp != 0x00)
-				return (span + zeroruns[*bp]);
-			span += 8, bits -= 8;
-			bp++;
-		}
-		lp = (long*) bp;
-		while ((uint32) bits >= 8*sizeof (long) && *lp == 0) {
-			span += 8*sizeof (long), bits -= 8*sizeof (long);
-			lp++;
-		}
-		bp = (u_char*) lp;
-	}
-	/*
-	 * Scan full bytes for all 0's.
-	 */
-	while (bits >= 8) {
-		if (*bp != 0x00)	/* end of run */
-			return (span + zeroruns[*bp]);
-		span += 8, bits -= 8;
-		bp++;
-	}
-	/*
-	 * Check partial byte on rhs.
-	 */
-	if (bits > 0) {
-		n = zeroruns[*bp];
-		span += (n > bits ? bits : n);
-	}
-	return (span);
+#if defined(__GNUC__)
+    return (__builtin_clzll((unsigned long long) w)
+	- (8*(int) sizeof (unsigned long long) - WORDBITS));
+#else
+    int n = 0;
+    while ((w >> (WORDBITS-8)) == 0)
+	w <<= 8, n += 8;
+    while ((w >> (WORDBITS-1)) == 0)
+	w <<= 1, n++;
+    return (n);
+#endif
 }
 
-int
-G3Encoder::find1span(const u_char* bp, int bs, int be)
+/*
+ * Find a span of ones or zeros.  The ``base'' of the
+ * bit string is supplied along with the start+end bit
+ * indices.  The bit string is scanned a word at a time
+ * and the end of the span is found by counting the
+ * leading zeros of the word (inverted for a span of ones).
+ */
+inline int
+G3Encoder::findspan(const u_char* bp, int bs, int be, int color)
 {
-	int32 bits = be - bs;
-	int32 n, span;
-
-	bp += bs>>3;
-	/*
-	 * Check partial byte on lhs.
-	 */
-	if (bits > 0 && (n = (bs & 7))) {
-		span = oneruns[(*bp << n) & 0xff];
-		if (span > 8-n)		/* table value too generous */
-			span = 8-n;
-		if (span > bits)	/* constrain span to bit range */
-			span = bits;
-		if (n+span < 8)		/* doesn't extend to edge of byte */
-			return (span);
-		bits -= span;
-		bp++;
-	} else
-		span = 0;
-	if ((uint32) bits >= 2*8*sizeof (long)) {
-		long* lp;
-		/*
-		 * Align to longword boundary and check longwords.
-		 */
-		while (!isAligned(bp, long)) {
-			if (*bp != 0xff)
-				return (span + oneruns[*bp]);
-			span += 8, bits -= 8;
-			bp++;
-		}
-		lp = (long*) bp;
-		while ((uint32) bits >= 8*sizeof (long) && *lp == ~0) {
-			span += 8*sizeof (long), bits -= 8*sizeof (long);
-			lp++;
-		}
-		bp = (u_char*) lp;
-	}
-	/*
-	 * Scan full bytes for all 1's.
-	 */
-	while (bits >= 8) {
-		if (*bp != 0xff)	/* end of run */
-			return (span + oneruns[*bp]);
-		span += 8, bits -= 8;
-		bp++;
+    if (bs >= be)
+	return (0);
+    const u_char* ep = bp + howmany(be, 8);
+    const u_char* p = bp + (bs>>3);
+    int off = bs & 7;
+    int span = 0;
+    for (;;) {
+	spanword_t w = loadWord(p, ep);
+	if (color)
+	    w = ~w;
+	w <<= off;				// discard bits before bs
+	if (w != 0) {
+	    span += countZeros(w);
+	    break;
 	}
-	/*
-	 * Check partial byte on rhs.
-	 */
-	if (bits > 0) {
-		n = oneruns[*bp];
-		span += (n > bits ? bits : n);
-	}
-	return (span);
+	span += WORDBITS - off;
+	p += sizeof (spanword_t);
+	if (p >= ep)
+	    break;
+	off = 0;
+    }
+    return (span < be-bs ? span : be-bs);	// constrain span to bit range
 }
 
 /*
@@ -274,7 +167,7 @@ G3Encoder::putcode(const tableentry& te)
  * exists.
  */
 #define finddiff(_cp, _bs, _be, _color) \
-	(_bs + (_color ? find1span(_cp,_bs,_be) : find0span(_cp,_bs,_be)))
+	(_bs + findspan(_cp,_bs,_be,_color))
 
 /*
  * Like finddiff, but also check the starting bit
@@ -300,8 +193,8 @@ G3Encoder::encode(const void* vp, u_int w, u_int h, u_char* rp)
 	if (!isG4) {						// put the EOL
 	    if( firstEOL )					// according to T.4 first EOL 
 		firstEOL = false;				// should not be aligned
-	    else if (bit != 4)
-		putBits(0, (bit < 4) ? bit+4 : bit-4);		// byte-align other EOLs
+	    else if (nbits != 4)
+		putBits(0, (nbits > 4) ? 12-nbits : 4-nbits);	// byte-align other EOLs
 	    if (is2D)
 		if (rp)
 		    putBits((EOL<<1)|0, 12+1);			// T.4 4.2.2
@@ -349,17 +242,18 @@ G3Encoder::encode(const void* vp, u_int w, u_int h, u_char* rp)
 	} else {						// 1-D line
 	    int bs = 0, span;
 	    for (;;) {
-		span = findspan(&bp, bs, w, zeroruns);		// white span
+		span = findspan(bp, bs, w, 0);			// white span
 		putspan(span, TIFFFaxWhiteCodes);
 		bs += span;
 		if ((u_int) bs >= w)
 		    break;
-		span = findspan(&bp, bs, w, oneruns);		// black span
+		span = findspan(bp, bs, w, 1);			// black span
 		putspan(span, TIFFFaxBlackCodes);
 		bs += span;
 		if ((u_int) bs >= w)
 		    break;
 	    }
+	    bp += rowbytes;					// advance raster row
 	}
     }
 #undef PIXEL
@@ -372,8 +266,10 @@ G3Encoder::encoderCleanup()
 	putBits(EOL, 12);
 	putBits(EOL, 12);
     }
-    if (bit != 8)					// flush partial byte
-	flushBits();
+    if (nbits > 0) {					// flush partial byte
+	buf.put(bitmap[(data << (8-nbits)) & 0xff]);
+	nbits = 0;
+    }
 }
 
 /*
@@ -401,57 +297,16 @@ G3Encoder::putspan(int span, const tableentry* tab)
 /*
  * Write a variable-length bit-value to the output
  * stream. Values are assumed to be at most 16 bits.
+ * Bits are collected in data and written out a whole
+ * byte at a time.
  */
 void
 G3Encoder::putBits(u_int bits, u_int length)
 {
-    static const u_int mask[9] =
-	{ 0x00, 0x01, 0x03, 0x07, 0x0f, 0x1f, 0x3f, 0x7f, 0xff };
-
-    while (length > (u_short) bit) {
-	data |= bits >> (length - bit);
-	length -= bit;
-	flushBits();
+    data = (data << length) | (bits & ((1<<length)-1));
+    nbits += length;
+    while (nbits >= 8) {
+	nbits -= 8;
+	buf.put(bitmap[(data >> nbits) & 0xff]);
     }
-    data |= (bits & mask[length]) << (bit - length);
-    bit -= length;
-    if (bit == 0)
-	flushBits();
 }
-
-const u_char G3Encoder::zeroruns[256] = {
-    8, 7, 6, 6, 5, 5, 5, 5, 4, 4, 4, 4, 4, 4, 4, 4,    /* 0x00 - 0x0f */
-    3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3,    /* 0x10 - 0x1f */
-    2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2,    /* 0x20 - 0x2f */
-    2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2,    /* 0x30 - 0x3f */
-    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,    /* 0x40 - 0x4f */
-    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,    /* 0x50 - 0x5f */
-    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,    /* 0x60 - 0x6f */
-    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,    /* 0x70 - 0x7f */
-    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,    /* 0x80 - 0x8f */
-    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,    /* 0x90 - 0x9f */
-    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,    /* 0xa0 - 0xaf */
-    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,    /* 0xb0 - 0xbf */
-    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,    /* 0xc0 - 0xcf */
-    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,    /* 0xd0 - 0xdf */
-    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,    /* 0xe0 - 0xef */
-    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,    /* 0xf0 - 0xff */
-};
-const u_char G3Encoder::oneruns[256] = {
-    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,    /* 0x00 - 0x0f */
-    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,    /* 0x10 - 0x1f */
-    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,    /* 0x20 - 0x2f */
-    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,    /* 0x30 - 0x3f */
-    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,    /* 0x40 - 0x4f */
-    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,    /* 0x50 - 0x5f */
-    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,    /* 0x60 - 0x6f */
-    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,    /* 0x70 - 0x7f */
-    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,    /* 0x80 - 0x8f */
-    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,    /* 0x90 - 0x9f */
-    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,    /* 0xa0 - 0xaf */
-    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,    /* 0xb0 - 0xbf */
-    2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2,    /* 0xc0 - 0xcf */
-    2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2,    /* 0xd0 - 0xdf */
-    3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3,    /* 0xe0 - 0xef */
-    4, 4, 4, 4, 4, 4, 4, 4, 5, 5, 5, 5, 6, 6, 7, 8,    /* 0xf0 - 0xff */
-};
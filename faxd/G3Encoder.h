@@ -39,22 +39,15 @@ private:
     bool	isG4;		// data is to be G4-encoded
     bool	firstEOL;	// first EOL is not byte-aligned
     const u_char* bitmap;	// bit reversal table
-    short	data;		// current input/output byte
-    short	bit;		// current bit in input/output byte
+    u_int	data;		// pending output bits
+    u_int	nbits;		// # bits pending in data
     fxStackBuffer& buf;
 
-    static const u_char zeroruns[256];
-    static const u_char oneruns[256];
-
-    static int findspan(const u_char**, int, int, const u_char*);
-    static int find0span(const u_char*, int, int);
-    static int find1span(const u_char*, int, int);
-    static int finddiff(const u_char*, int, int, int);
+    static int findspan(const u_char*, int, int, int);
 
     void	putBits(u_int bits, u_int length);
     void	putcode(const tableentry& te);
     void	putspan(int span, const tableentry* tab);
-    void	flushBits();
 public:
     G3Encoder(fxStackBuffer&);
     virtual ~G3Encoder();
@@ -71,8 +71,12 @@ protected:
     void addc(u_char c);		// make room & add a char to the buffer
     void grow(u_int amount);		// make more room in the buffer
     void buildCRC(u_char c);		// calculate the CRC for the frame
+
+    static const u_short crcTab[256];	// CRC16-CCITT by byte value
 };
 
+inline void HDLCFrame::buildCRC(u_char c)
+    { crc = ((crc << 8) ^ crcTab[(crc >> 8) ^ c]) & 0xffff; }
 inline void HDLCFrame::put(u_char c)
     { if (next < end) *next++ = c; else addc(c); buildCRC(c); }
 inline void HDLCFrame::reset()			    { next = base; ok = false; crc = 0xffff; }
@@ -0,0 +1,159 @@
+/*	$Id$ */
+/*
+ * Copyright (c) 2026 iFAX Solutions, Inc.
+ * HylaFAX is a trademark of Silicon Graphics
+ *
+ * Permission to use, copy, modify, distribute, and sell this software and
+ * its documentation for any purpose is hereby granted without fee, provided
+ * that (i) the above copyright notices and this permission notice appear in
+ * all copies of the software and related documentation, and (ii) the names of
+ * Sam Leffler and Silicon Graphics may not be used in any advertising or
+ * publicity relating to the software without the specific, prior written
+ * permission of Sam Leffler and Silicon Graphics.
+ *
+ * THE SOFTWARE IS PROVIDED "AS-IS" AND WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS, IMPLIED OR OTHERWISE, INCLUDING WITHOUT LIMITATION, ANY
+ * WARRANTY OF MERCHANTABILITY OR FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * IN NO EVENT SHALL SAM LEFFLER OR SILICON GRAPHICS BE LIABLE FOR
+ * ANY SPECIAL, INCIDENTAL, INDIRECT OR CONSEQUENTIAL DAMAGES OF ANY KIND,
+ * OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS,
+ * WHETHER OR NOT ADVISED OF THE POSSIBILITY OF DAMAGE, AND ON ANY THEORY OF
+ * LIABILITY, ARISING OUT OF OR IN CONNECTION WITH THE USE OR PERFORMANCE
+ * OF THIS SOFTWARE.
+ */
+
+/*
+ * Transparent Zero-Bit Insertion for ECM HDLC Frames.
+ */
+#include "HDLCStuffer.h"
+#include <string.h>
+
+HDLCStuffer::Stuffed HDLCStuffer::stuffTab[5][256];
+HDLCStuffer::Unstuffed HDLCStuffer::unstuffTab[6][256];
+bool HDLCStuffer::tablesSetup = false;
+
+/*
+ * Build the tables by running each byte value through
+ * the bit-serial procedure from every possible state.
+ */
+void
+HDLCStuffer::setupTables()
+{
+    for (u_int n = 0; n < 5; n++) {
+	for (u_int c = 0; c < 256; c++) {
+	    Stuffed& s = stuffTab[n][c];
+	    u_int bits = 0, len = 0, ones = n;
+	    for (int i = 7; i >= 0; i--) {
+		u_int bit = (c >> i) & 1;
+		bits |= bit << len++;
+		ones = bit ? ones+1 : 0;
+		if (ones == 5) {		// insert a zero bit
+		    len++;
+		    ones = 0;
+		}
+	    }
+	    s.bits = bits;
+	    s.len = len;
+	    s.ones = ones;
+	}
+    }
+    for (u_int n = 0; n < 6; n++) {
+	for (u_int c = 0; c < 256; c++) {
+	    Unstuffed& u = unstuffTab[n][c];
+	    u_int bits = 0, len = 0, ones = n;
+	    u.flag = false;
+	    for (u_int i = 0; i < 8; i++) {
+		u_int bit = (c >> i) & 1;
+		if (bit)
+		    ones++;
+		else if (ones == 5) {		// drop a stuffed zero bit
+		    ones = 0;
+		    continue;
+		} else
+		    ones = 0;
+		bits = (bits << 1) | bit;
+		len++;
+		if (ones == 6) {
+		    u.flag = true;
+		    break;
+		}
+	    }
+	    u.bits = bits;
+	    u.len = len;
+	    u.ones = ones;
+	}
+    }
+    tablesSetup = true;
+}
+
+HDLCStuffer::HDLCStuffer()
+{
+    if (!tablesSetup)
+	setupTables();
+    reset();
+}
+
+/*
+ * Reset to the start of a bit stream.
+ */
+void
+HDLCStuffer::reset()
+{
+    data = 0;
+    nbits = 0;
+    ones = 0;
+}
+
+/*
+ * Stuff cc bytes of frame data into dst and return the
+ * number of bytes written.  Bits that do not fill a byte
+ * are held until the next call.
+ */
+u_int
+HDLCStuffer::putData(u_char* dst, const u_char* src, u_int cc)
+{
+    u_char* cp = dst;
+    u_int d = data, nb = nbits, n = ones;
+    while (cc-- > 0) {
+	const Stuffed& s = stuffTab[n][*src++];
+	d |= (u_int) s.bits << nb;
+	nb += s.len;
+	n = s.ones;
+	if (nb >= 8) {
+	    *cp++ = d;
+	    d >>= 8;
+	    nb -= 8;
+	    if (nb >= 8) {
+		*cp++ = d;
+		d >>= 8;
+		nb -= 8;
+	    }
+	}
+    }
+    data = d;
+    nbits = nb;
+    ones = n;
+    return (cp - dst);
+}
+
+/*
+ * Write count flag sequences into dst and return the
+ * number of bytes written.  A flag reads the same in
+ * either bit order, so byte-aligned flags are copied.
+ */
+u_int
+HDLCStuffer::putFlags(u_char* dst, u_int count)
+{
+    ones = 0;
+    if (nbits == 0) {
+	memset(dst, 0x7e, count);
+	return (count);
+    }
+    for (u_int i = 0; i < count; i++) {
+	data |= 0x7e << nbits;
+	dst[i] = data;
+	data >>= 8;
+    }
+    return (count);
+}
@@ -0,0 +1,74 @@
+/*	$Id$ */
+/*
+ * Copyright (c) 2026 iFAX Solutions, Inc.
+ * HylaFAX is a trademark of Silicon Graphics
+ *
+ * Permission to use, copy, modify, distribute, and sell this software and
+ * its documentation for any purpose is hereby granted without fee, provided
+ * that (i) the above copyright notices and this permission notice appear in
+ * all copies of the software and related documentation, and (ii) the names of
+ * Sam Leffler and Silicon Graphics may not be used in any advertising or
+ * publicity relating to the software without the specific, prior written
+ * permission of Sam Leffler and Silicon Graphics.
+ *
+ * THE SOFTWARE IS PROVIDED "AS-IS" AND WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS, IMPLIED OR OTHERWISE, INCLUDING WITHOUT LIMITATION, ANY
+ * WARRANTY OF MERCHANTABILITY OR FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * IN NO EVENT SHALL SAM LEFFLER OR SILICON GRAPHICS BE LIABLE FOR
+ * ANY SPECIAL, INCIDENTAL, INDIRECT OR CONSEQUENTIAL DAMAGES OF ANY KIND,
+ * OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS,
+ * WHETHER OR NOT ADVISED OF THE POSSIBILITY OF DAMAGE, AND ON ANY THEORY OF
+ * LIABILITY, ARISING OUT OF OR IN CONNECTION WITH THE USE OR PERFORMANCE
+ * OF THIS SOFTWARE.
+ */
+#ifndef _HDLCStuffer_
+#define _HDLCStuffer_
+/*
+ * Transparent Zero-Bit Insertion for ECM HDLC Frames.
+ *
+ * Frame bytes are taken MSB first, as they are kept in an HDLCFrame,
+ * and the stuffed bit stream is packed LSB first, the order in which
+ * a Class 1 modem sends it and in which getModemBit returns received
+ * bits (T.4 A.3.1).  A zero bit follows any five consecutive one bits
+ * of frame data; flags are sent as is.  Both directions work a byte
+ * at a time from tables indexed by the number of ones in the
+ * preceding bits.
+ */
+#include "Types.h"
+
+class HDLCStuffer {
+public:
+    struct Unstuffed {
+	u_char	bits;		// frame data bits, MSB first, right-justified
+	u_char	len;		// # frame data bits
+	u_char	ones;		// consecutive one bits after the byte
+	u_char	flag;		// six ones (flag or abort) seen in the byte
+    };
+private:
+    struct Stuffed {
+	u_short	bits;		// output bits, LSB first
+	u_char	len;		// # output bits
+	u_char	ones;		// consecutive one bits after the byte
+    };
+    u_int	data;		// pending output bits
+    u_int	nbits;		// # bits pending in data
+    u_int	ones;		// consecutive one bits sent
+
+    static Stuffed stuffTab[5][256];
+    static Unstuffed unstuffTab[6][256];
+    static bool tablesSetup;
+
+    static void setupTables();
+public:
+    HDLCStuffer();
+
+    void	reset();
+    u_int	putData(u_char* dst, const u_char* src, u_int cc);
+    u_int	putFlags(u_char* dst, u_int count);
+
+    const Unstuffed& unstuff(u_int ones, u_int c) const;
+};
+inline const HDLCStuffer::Unstuffed& HDLCStuffer::unstuff(u_int n, u_int c) const
+    { return unstuffTab[n][c]; }
+#endif /* _HDLCStuffer_ */
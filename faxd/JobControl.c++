@@ -49,6 +49,7 @@ JobControlInfo::JobControlInfo(const JobControlInfo& other)
     , modem(other.modem)
     , tod(other.tod)
     , args(other.args)
+    , text(other.text)
 {
     defined = other.defined;
     maxConcurrentCalls = other.maxConcurrentCalls;
@@ -61,6 +62,7 @@ JobControlInfo::JobControlInfo(const JobControlInfo& other)
 }
 
 JobControlInfo::JobControlInfo (const fxStr& buffer)
+    : text(buffer)
 {
     defined = 0;
     u_int pos = 0;
@@ -229,6 +231,11 @@ const fxStr& JobControlInfo::getArgs() const
     return args;
 }
 
+const fxStr& JobControlInfo::getText() const
+{
+    return text;
+}
+
 int
 JobControlInfo::getDesiredDF() const
 {
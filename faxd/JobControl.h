@@ -54,6 +54,7 @@ private:
     int		usexvres;		// use extended resolution
     u_int	vres;			// use extended resolution
     fxStr	args;			// arguments for subprocesses
+    fxStr	text;			// job control output parsed
     int		desireddf;		// if set, desireddf value
 
     // default returned on no match
@@ -82,6 +83,7 @@ public:
     u_int getVRes() const;
     int getDesiredDF() const;
     const fxStr& getArgs() const;
+    const fxStr& getText() const;
 
     virtual bool setConfigItem(const char*, const char*);
     virtual void configError(const char*, ...);
@@ -0,0 +1,612 @@
+/*	$Id$ */
+/*
+ * Copyright (c) 2026 iFAX Solutions, Inc.
+ * HylaFAX is a trademark of Silicon Graphics
+ *
+ * Permission to use, copy, modify, distribute, and sell this software and
+ * its documentation for any purpose is hereby granted without fee, provided
+ * that (i) the above copyright notices and this permission notice appear in
+ * all copies of the software and related documentation, and (ii) the names of
+ * Sam Leffler and Silicon Graphics may not be used in any advertising or
+ * publicity relating to the software without the specific, prior written
+ * permission of Sam Leffler and Silicon Graphics.
+ *
+ * THE SOFTWARE IS PROVIDED "AS-IS" AND WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS, IMPLIED OR OTHERWISE, INCLUDING WITHOUT LIMITATION, ANY
+ * WARRANTY OF MERCHANTABILITY OR FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * IN NO EVENT SHALL SAM LEFFLER OR SILICON GRAPHICS BE LIABLE FOR
+ * ANY SPECIAL, INCIDENTAL, INDIRECT OR CONSEQUENTIAL DAMAGES OF ANY KIND,
+ * OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS,
+ * WHETHER OR NOT ADVISED OF THE POSSIBILITY OF DAMAGE, AND ON ANY THEORY OF
+ * LIABILITY, ARISING OUT OF OR IN CONNECTION WITH THE USE OR PERFORMANCE
+ * OF THIS SOFTWARE.
+ */
+#include "Sys.h"
+#include "JobStatusIndex.h"
+#include "FaxRequest.h"
+#include "config.h"
+
+#include <stddef.h>
+#if HAS_MMAP
+#include <sys/mman.h>
+#endif
+
+#if defined(__GNUC__)
+#define	MEMBAR()	__sync_synchronize()
+#else
+#define	MEMBAR()
+#endif
+
+#define	JSI_MAGIC	"HFJOBIDX"
+#define	JSI_VERSION	2
+#define	JSI_MAXSHORTS	32		// max # u_short values in a record
+#define	JSI_STRSPACE	768		// space for string values in a record
+
+struct JobStatusIndexHeader {
+    char	magic[8];		// JSI_MAGIC
+    u_int	version;		// JSI_VERSION
+    u_int	recsize;		// sizeof (JobStatusRecord)
+    u_int	nslots;			// # record slots
+    u_int	nused;			// # slots holding a record
+    u_int	ndead;			// # slots holding a removed record
+    volatile u_int gen;		// index generation, advanced on change
+    u_int	basegen;		// generation when this file was made
+    u_int	pad[7];
+};
+
+struct JobStatusRecord {
+    volatile u_int seq;		// odd while record is being changed
+    u_int	gen;			// generation of last change, 0 if unused
+    u_int	removed;		// non-zero if job was removed
+    char	jobid[16];		// job identifier
+    char	queue[8];		// queue directory holding the qfile
+    char	leftqueue[8];		// queue the job last moved out of
+    u_int	leftgen;		// generation of that move
+    dev_t	dev;			// identity and state of the qfile
+    ino_t	ino;
+    off_t	size;
+    time_t	mtime;
+    time_t	tts;			// values from the qfile
+    time_t	killtime;
+    time_t	retrytime;
+    float	chopthreshold;
+    int		statuscode;
+    u_short	shorts[JSI_MAXSHORTS];
+    u_short	strused;		// # bytes used in strings
+    char	strings[JSI_STRSPACE];	// NUL-terminated string values
+};
+
+/*
+ * The job state that is recorded.  This is everything
+ * that hfaxd can include in a job status listing.
+ */
+static u_short FaxRequest::* const jobShorts[] = {
+    &FaxRequest::state,		&FaxRequest::npages,
+    &FaxRequest::totpages,	&FaxRequest::ntries,
+    &FaxRequest::ndials,	&FaxRequest::totdials,
+    &FaxRequest::maxdials,	&FaxRequest::tottries,
+    &FaxRequest::maxtries,	&FaxRequest::pagewidth,
+    &FaxRequest::pagelength,	&FaxRequest::resolution,
+    &FaxRequest::usrpri,	&FaxRequest::pri,
+    &FaxRequest::minbr,		&FaxRequest::desiredbr,
+    &FaxRequest::desiredst,	&FaxRequest::desiredec,
+    &FaxRequest::desireddf,	&FaxRequest::desiredtl,
+    &FaxRequest::useccover,	&FaxRequest::usexvres,
+    &FaxRequest::pagechop,	&FaxRequest::notify,
+};
+static fxStr FaxRequest::* const jobStrings[] = {
+    &FaxRequest::groupid,	&FaxRequest::owner,
+    &FaxRequest::commid,	&FaxRequest::sender,
+    &FaxRequest::mailaddr,	&FaxRequest::jobtag,
+    &FaxRequest::number,	&FaxRequest::subaddr,
+    &FaxRequest::passwd,	&FaxRequest::external,
+    &FaxRequest::modem,		&FaxRequest::receiver,
+    &FaxRequest::company,	&FaxRequest::location,
+    &FaxRequest::client,	&FaxRequest::jobtype,
+    &FaxRequest::tagline,	&FaxRequest::doneop,
+};
+#define	N(a)	(sizeof (a) / sizeof (a[0]))
+
+static u_int
+hash(const char* jobid)
+{
+    u_int h = 0;
+    while (*jobid)
+	h = 31*h + (u_char) *jobid++;
+    return (h);
+}
+
+static bool
+sameFile(const JobStatusRecord& r, const struct stat& sb)
+{
+    return (r.dev == sb.st_dev && r.ino == sb.st_ino &&
+	r.size == sb.st_size && r.mtime == sb.st_mtime);
+}
+
+/*
+ * Fill in a record from a request; false is returned
+ * if the request's strings do not fit.
+ */
+static bool
+pack(JobStatusRecord& r, const FaxRequest& req, const struct stat& sb)
+{
+    memset(&r, 0, sizeof (r));
+    if (req.jobid.length() >= sizeof (r.jobid))
+	return (false);
+    strcpy(r.jobid, req.jobid);
+    u_int l = req.qfile.next(0, '/');
+    if (l >= sizeof (r.queue))
+	return (false);
+    memcpy(r.queue, (const char*) req.qfile, l);
+    r.dev = sb.st_dev;
+    r.ino = sb.st_ino;
+    r.size = sb.st_size;
+    r.mtime = sb.st_mtime;
+    r.tts = req.tts;
+    r.killtime = req.killtime;
+    r.retrytime = req.retrytime;
+    r.chopthreshold = req.chopthreshold;
+    r.statuscode = req.result.value();
+    u_int i;
+    for (i = 0; i < N(jobShorts); i++)
+	r.shorts[i] = req.*jobShorts[i];
+    u_int off = 0;
+    for (i = 0; i <= N(jobStrings); i++) {
+	const char* s = (i < N(jobStrings) ? (const char*) (req.*jobStrings[i]) :
+	    req.result.string());
+	u_int len = strlen(s)+1;
+	if (off + len > sizeof (r.strings))
+	    return (false);
+	memcpy(r.strings + off, s, len);
+	off += len;
+    }
+    r.strused = off;
+    return (true);
+}
+
+/*
+ * Fill in a request from a (private copy of a) record.
+ */
+static bool
+unpack(const JobStatusRecord& r, FaxRequest& req)
+{
+    if (r.strused > sizeof (r.strings) || r.strused == 0 ||
+      r.strings[r.strused-1] != '\0')
+	return (false);
+    const char* cp = r.strings;
+    const char* ep = r.strings + r.strused;
+    const char* vals[N(jobStrings)+1];
+    u_int i;
+    for (i = 0; i <= N(jobStrings); i++) {
+	if (cp >= ep)
+	    return (false);
+	vals[i] = cp;
+	cp += strlen(cp)+1;
+    }
+    req.jobid = r.jobid;
+    for (i = 0; i < N(jobStrings); i++)
+	req.*jobStrings[i] = vals[i];
+    for (i = 0; i < N(jobShorts); i++)
+	req.*jobShorts[i] = r.shorts[i];
+    req.tts = r.tts;
+    req.killtime = r.killtime;
+    req.retrytime = r.retrytime;
+    req.chopthreshold = r.chopthreshold;
+    req.result = Status(r.statuscode, "%s", vals[N(jobStrings)]);
+    return (true);
+}
+
+JobStatusIndex::JobStatusIndex()
+{
+    hdr = NULL;
+    mapsize = 0;
+    writable = false;
+    dev = 0;
+    ino = 0;
+}
+
+JobStatusIndex::~JobStatusIndex()
+{
+    close();
+}
+
+inline JobStatusRecord*
+JobStatusIndex::record(u_int slot) const
+{
+    return ((JobStatusRecord*) (hdr+1) + slot);
+}
+
+/*
+ * Locate the record for a job.
+ */
+JobStatusRecord*
+JobStatusIndex::find(const char* jobid) const
+{
+    u_int n = hdr->nslots;
+    u_int slot = hash(jobid) % n;
+    for (u_int i = 0; i < n; i++) {
+	JobStatusRecord* r = record(slot);
+	if (r->gen == 0)
+	    break;
+	if (strncmp(r->jobid, jobid, sizeof (r->jobid)) == 0)
+	    return (r);
+	if (++slot == n)
+	    slot = 0;
+    }
+    return (NULL);
+}
+
+/*
+ * Map an index file and check that it
+ * was created by a compatible writer.
+ */
+bool
+JobStatusIndex::map(int fd, bool rw)
+{
+#if HAS_MMAP
+    struct stat sb;
+    if (Sys::fstat(fd, sb) < 0 || (size_t) sb.st_size < sizeof (*hdr))
+	return (false);
+    void* addr = mmap(NULL, (size_t) sb.st_size,
+	rw ? PROT_READ|PROT_WRITE : PROT_READ, MAP_SHARED, fd, 0);
+    if (addr == (void*) MAP_FAILED)
+	return (false);
+    JobStatusIndexHeader* h = (JobStatusIndexHeader*) addr;
+    if (memcmp(h->magic, JSI_MAGIC, sizeof (h->magic)) != 0 ||
+      h->version != JSI_VERSION || h->recsize != sizeof (JobStatusRecord) ||
+      h->nslots == 0 || (size_t) sb.st_size !=
+	sizeof (*h) + h->nslots * sizeof (JobStatusRecord)) {
+	munmap((char*) addr, (size_t) sb.st_size);
+	return (false);
+    }
+    hdr = h;
+    mapsize = (size_t) sb.st_size;
+    writable = rw;
+    dev = sb.st_dev;
+    ino = sb.st_ino;
+    return (true);
+#else
+    return (false);
+#endif
+}
+
+void
+JobStatusIndex::unmap()
+{
+#if HAS_MMAP
+    if (hdr)
+	munmap((char*) hdr, mapsize);
+#endif
+    hdr = NULL;
+    mapsize = 0;
+    writable = false;
+}
+
+/*
+ * Discard our mapping of the index; the index file
+ * is left for other processes.
+ */
+void
+JobStatusIndex::close()
+{
+    unmap();
+}
+
+/*
+ * Return true if a record still describes a job
+ * description file in the send or done queue.
+ */
+bool
+JobStatusIndex::isCurrent(const JobStatusRecord& r) const
+{
+    struct stat sb;
+    return ((Sys::stat(fxStr::format(FAX_SENDDIR "/" FAX_QFILEPREF "%s",
+	    r.jobid), sb) >= 0 && sameFile(r, sb)) ||
+	(Sys::stat(fxStr::format(FAX_DONEDIR "/" FAX_QFILEPREF "%s",
+	    r.jobid), sb) >= 0 && sameFile(r, sb)));
+}
+
+/*
+ * Write a new index file with the specified number of
+ * slots holding the current records of the existing index
+ * (if any) and replace the existing index with it.  Records
+ * of removed jobs are dropped, so changes made before the
+ * rebuild can no longer be enumerated; the base generation
+ * tells readers this.
+ */
+bool
+JobStatusIndex::rebuild(u_int nslots, u_int gen)
+{
+    fxStr tmp(filename | ".new");
+    int fd = Sys::open(tmp, O_RDWR|O_CREAT|O_TRUNC, 0600);
+    if (fd < 0)
+	return (false);
+    JobStatusIndexHeader h;
+    memset(&h, 0, sizeof (h));
+    memcpy(h.magic, JSI_MAGIC, sizeof (h.magic));
+    h.version = JSI_VERSION;
+    h.recsize = sizeof (JobStatusRecord);
+    h.nslots = nslots;
+    h.gen = h.basegen = (hdr ? hdr->gen : gen) + 1;
+    off_t size = sizeof (h) + (off_t) nslots * sizeof (JobStatusRecord);
+    if (Sys::write(fd, (const char*) &h, sizeof (h)) != sizeof (h) ||
+      ftruncate(fd, size) < 0) {
+	Sys::close(fd);
+	Sys::unlink(tmp);
+	return (false);
+    }
+    JobStatusIndex nindex;
+    bool ok = nindex.map(fd, true);
+    Sys::close(fd);
+    if (!ok) {
+	Sys::unlink(tmp);
+	return (false);
+    }
+    if (hdr) {
+	for (u_int i = 0; i < hdr->nslots; i++) {
+	    const JobStatusRecord& r = *record(i);
+	    if (r.gen == 0 || r.removed || !isCurrent(r))
+		continue;
+	    u_int slot = hash(r.jobid) % nslots;
+	    while (nindex.record(slot)->gen != 0)
+		if (++slot == nslots)
+		    slot = 0;
+	    *nindex.record(slot) = r;
+	    nindex.record(slot)->seq = 0;
+	    nindex.hdr->nused++;
+	}
+    }
+    if (Sys::rename(tmp, filename) < 0) {
+	Sys::unlink(tmp);
+	return (false);
+    }
+    unmap();
+    hdr = nindex.hdr, nindex.hdr = NULL;
+    mapsize = nindex.mapsize;
+    writable = true;
+    dev = nindex.dev;
+    ino = nindex.ino;
+    return (true);
+}
+
+/*
+ * Create a new, empty, index for the writer.  The generation
+ * of any existing index is carried forward so generations
+ * handed out to clients never go backwards.
+ */
+bool
+JobStatusIndex::create(const char* file, u_int nslots)
+{
+    JobStatusIndex old;
+    u_int gen = (old.open(file) ? old.generation() : 0);
+    old.close();
+    close();
+    filename = file;
+    return (rebuild(nslots < 16 ? 16 : nslots, gen));
+}
+
+/*
+ * Record the state of a request that was just read
+ * from, or written to, its open (and locked) queue file.
+ * As with the request cache, a file that was modified
+ * by someone else during the current second is not
+ * recorded since a later change in the same second
+ * would go unnoticed.
+ */
+void
+JobStatusIndex::update(const FaxRequest& req, bool written)
+{
+    struct stat sb;
+    if (!hdr || !writable)
+	return;
+    if (req.fd < 0 || Sys::fstat(req.fd, sb) < 0 ||
+      (!written && sb.st_mtime >= Sys::now())) {
+	remove(req.jobid);
+	return;
+    }
+    JobStatusRecord* r = find(req.jobid);
+    if (r && !r->removed && sameFile(*r, sb))
+	return;					// already up to date
+    JobStatusRecord tmp;
+    if (!pack(tmp, req, sb)) {
+	remove(req.jobid);
+	return;
+    }
+    if (++hdr->gen == 0)
+	hdr->gen = 1;
+    if (r) {
+	if (r->removed) {			// job is back
+	    hdr->ndead--;
+	    hdr->nused++;
+	}
+	if (strcmp(r->queue, tmp.queue) != 0) {	// e.g. sendq -> doneq
+	    memcpy(tmp.leftqueue, r->queue, sizeof (tmp.leftqueue));
+	    tmp.leftgen = hdr->gen;
+	} else {
+	    memcpy(tmp.leftqueue, r->leftqueue, sizeof (tmp.leftqueue));
+	    tmp.leftgen = r->leftgen;
+	}
+    } else {
+	/*
+	 * Keep the table at most 3/4 full so probe
+	 * sequences stay short; when a rebuild would not
+	 * leave room for growth double the table size.
+	 */
+	if (4*(hdr->nused + hdr->ndead + 1) > 3*hdr->nslots) {
+	    u_int n = hdr->nslots;
+	    if (4*(hdr->nused + 1) > n)
+		n *= 2;
+	    if (!rebuild(n))
+		return;
+	}
+	/*
+	 * Removed records are not reused; they are kept
+	 * until the next rebuild so that readers can find
+	 * out which jobs were removed.
+	 */
+	u_int slot = hash(tmp.jobid) % hdr->nslots;
+	while ((r = record(slot))->gen != 0)
+	    if (++slot == hdr->nslots)
+		slot = 0;
+	hdr->nused++;
+    }
+    tmp.gen = hdr->gen;
+    r->seq++;					// odd, record is changing
+    MEMBAR();
+    memcpy((char*) r + offsetof(JobStatusRecord, gen),
+	(const char*) &tmp + offsetof(JobStatusRecord, gen),
+	sizeof (tmp) - offsetof(JobStatusRecord, gen));
+    MEMBAR();
+    r->seq++;
+}
+
+/*
+ * Remove the record for a job.  The record is marked as
+ * removed, rather than freed, so probe sequences that
+ * pass through it are not broken and readers can see
+ * when the job was removed.
+ */
+void
+JobStatusIndex::remove(const fxStr& jobid)
+{
+    if (!hdr || !writable)
+	return;
+    JobStatusRecord* r = find(jobid);
+    if (!r || r->removed)
+	return;
+    if (++hdr->gen == 0)
+	hdr->gen = 1;
+    r->seq++;
+    MEMBAR();
+    r->removed = 1;
+    r->gen = hdr->gen;
+    MEMBAR();
+    r->seq++;
+    hdr->nused--;
+    hdr->ndead++;
+}
+
+/*
+ * Map the index for reading.  If the index is already
+ * mapped it is remapped only if the file was replaced.
+ */
+bool
+JobStatusIndex::open(const char* file)
+{
+    struct stat sb;
+    if (Sys::stat(file, sb) < 0) {
+	close();
+	return (false);
+    }
+    if (hdr && sb.st_dev == dev && sb.st_ino == ino)
+	return (true);
+    close();
+    int fd = Sys::open(file, O_RDONLY);
+    if (fd < 0)
+	return (false);
+    bool ok = map(fd, false);
+    Sys::close(fd);
+    if (ok)
+	filename = file;
+    return (ok);
+}
+
+/*
+ * Fill in a request from the index.  This succeeds
+ * only if the record for the job was made from the
+ * file described by sb.
+ */
+bool
+JobStatusIndex::lookup(const char* jobid, const struct stat& sb,
+    FaxRequest& req) const
+{
+    if (!hdr)
+	return (false);
+    const JobStatusRecord* r = find(jobid);
+    if (!r)
+	return (false);
+    JobStatusRecord copy;
+    u_int seq = r->seq;
+    if (seq & 1)
+	return (false);
+    MEMBAR();
+    memcpy(&copy, (const char*) r, sizeof (copy));
+    MEMBAR();
+    if (r->seq != seq)
+	return (false);
+    if (copy.removed || strncmp(copy.jobid, jobid, sizeof (copy.jobid)) != 0 ||
+      !sameFile(copy, sb))
+	return (false);
+    return (unpack(copy, req));
+}
+
+/*
+ * Return the identifiers of jobs in queue whose records
+ * changed, or were removed, after generation since, together
+ * with the current generation.  Jobs that moved out of queue
+ * after since (e.g. from sendq to doneq) are included so the
+ * caller can report them as removed.  False is returned if the
+ * changes cannot be enumerated: because there is no index,
+ * since is zero, since predates the current index file, or a
+ * record was being changed for too long to be read.
+ */
+bool
+JobStatusIndex::changedSince(const char* queue, u_int since, u_int& gen,
+    fxStrArray& jobids) const
+{
+    if (!hdr || since == 0 || since < hdr->basegen || since > hdr->gen)
+	return (false);
+    gen = hdr->gen;
+    MEMBAR();
+    for (u_int i = 0, n = hdr->nslots; i < n; i++) {
+	const JobStatusRecord* r = record(i);
+	u_int tries;
+	for (tries = 0; tries < 1000; tries++) {
+	    u_int seq = r->seq;
+	    if (seq & 1)
+		continue;
+	    MEMBAR();
+	    u_int rgen = r->gen;
+	    u_int leftgen = r->leftgen;
+	    char jobid[sizeof (r->jobid)];
+	    char rqueue[sizeof (r->queue)];
+	    char leftqueue[sizeof (r->leftqueue)];
+	    memcpy(jobid, (const char*) r->jobid, sizeof (jobid));
+	    memcpy(rqueue, (const char*) r->queue, sizeof (rqueue));
+	    memcpy(leftqueue, (const char*) r->leftqueue, sizeof (leftqueue));
+	    MEMBAR();
+	    if (r->seq != seq)
+		continue;
+	    rqueue[sizeof (rqueue)-1] = '\0';
+	    leftqueue[sizeof (leftqueue)-1] = '\0';
+	    if (rgen > since && (strcmp(rqueue, queue) == 0 ||
+	      (leftgen > since && strcmp(leftqueue, queue) == 0))) {
+		jobid[sizeof (jobid)-1] = '\0';
+		jobids.append(jobid);
+	    }
+	    break;
+	}
+	if (tries == 1000)			// writer stuck or died
+	    return (false);
+    }
+    return (true);
+}
+
+u_int
+JobStatusIndex::generation() const
+{
+    return (hdr ? hdr->gen : 0);
+}
+
+u_int
+JobStatusIndex::size() const
+{
+    return (hdr ? hdr->nused : 0);
+}
+
+u_int
+JobStatusIndex::slots() const
+{
+    return (hdr ? hdr->nslots : 0);
+}
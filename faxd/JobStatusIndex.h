@@ -0,0 +1,97 @@
+/*	$Id$ */
+/*
+ * Copyright (c) 2026 iFAX Solutions, Inc.
+ * HylaFAX is a trademark of Silicon Graphics
+ *
+ * Permission to use, copy, modify, distribute, and sell this software and
+ * its documentation for any purpose is hereby granted without fee, provided
+ * that (i) the above copyright notices and this permission notice appear in
+ * all copies of the software and related documentation, and (ii) the names of
+ * Sam Leffler and Silicon Graphics may not be used in any advertising or
+ * publicity relating to the software without the specific, prior written
+ * permission of Sam Leffler and Silicon Graphics.
+ *
+ * THE SOFTWARE IS PROVIDED "AS-IS" AND WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS, IMPLIED OR OTHERWISE, INCLUDING WITHOUT LIMITATION, ANY
+ * WARRANTY OF MERCHANTABILITY OR FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * IN NO EVENT SHALL SAM LEFFLER OR SILICON GRAPHICS BE LIABLE FOR
+ * ANY SPECIAL, INCIDENTAL, INDIRECT OR CONSEQUENTIAL DAMAGES OF ANY KIND,
+ * OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS,
+ * WHETHER OR NOT ADVISED OF THE POSSIBILITY OF DAMAGE, AND ON ANY THEORY OF
+ * LIABILITY, ARISING OUT OF OR IN CONNECTION WITH THE USE OR PERFORMANCE
+ * OF THIS SOFTWARE.
+ */
+#ifndef _JobStatusIndex_
+#define	_JobStatusIndex_
+/*
+ * Shared index of job status for queue listings.
+ */
+#include "Str.h"
+#include "StrArray.h"
+#include <sys/stat.h>
+
+class FaxRequest;
+struct JobStatusRecord;
+struct JobStatusIndexHeader;
+
+/*
+ * Each hfaxd process reads and parses every job description
+ * file to list the send or done queue.  The scheduler already
+ * reads and writes these files, so it keeps a copy of the
+ * fields that can appear in a listing in a file that is mapped
+ * into memory by hfaxd.  Records are kept in an open-addressed
+ * hash table keyed by job identifier.  Each record holds the
+ * device, inode, size and modification time of the qfile it
+ * was made from; a reader uses a record only if these match
+ * the file it is listing and otherwise reads the file as before.
+ *
+ * There is a single writer, the scheduler.  A record's sequence
+ * number is odd while the record is being changed so readers
+ * can detect, and skip, a torn copy.  Every change advances the
+ * index generation; the generation of its last change is kept
+ * in each record, with the queue holding the job (and the queue
+ * it last moved out of), so readers can ask for just the jobs in
+ * a queue that have changed since a generation they have already
+ * seen.  Removed
+ * jobs keep their record, marked as removed.  When the table
+ * fills it is rebuilt in a new file that replaces the old one;
+ * readers notice the change of file and map the new one.
+ */
+class JobStatusIndex {
+private:
+    fxStr	filename;		// index file pathname
+    JobStatusIndexHeader* hdr;		// mapped index, NULL if none
+    size_t	mapsize;		// size of mapping
+    bool	writable;		// true if we maintain the index
+    dev_t	dev;			// identity of the mapped file
+    ino_t	ino;
+
+    JobStatusRecord* record(u_int slot) const;
+    JobStatusRecord* find(const char* jobid) const;
+    bool	map(int fd, bool rw);
+    void	unmap();
+    bool	rebuild(u_int nslots, u_int gen = 0);
+    bool	isCurrent(const JobStatusRecord&) const;
+public:
+    JobStatusIndex();
+    ~JobStatusIndex();
+
+    bool	create(const char* filename, u_int nslots);	// writer
+    void	update(const FaxRequest& req, bool written = false);
+    void	remove(const fxStr& jobid);
+
+    bool	open(const char* filename);			// reader
+    bool	lookup(const char* jobid, const struct stat& sb,
+		    FaxRequest& req) const;
+    bool	changedSince(const char* queue, u_int since, u_int& gen,
+		    fxStrArray& jobids) const;
+
+    void	close();
+    bool	isOpen() const;
+    u_int	generation() const;
+    u_int	size() const;
+    u_int	slots() const;
+};
+inline bool JobStatusIndex::isOpen() const		{ return hdr != NULL; }
+#endif /* _JobStatusIndex_ */
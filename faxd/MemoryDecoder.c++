@@ -41,6 +41,7 @@ MemoryDecoder::MemoryDecoder(u_char* data, u_long n)
     runs = NULL;
     rowBuf = NULL;
     rows = 0;
+    setInput(bp, cc);
 }
 
 MemoryDecoder::MemoryDecoder(u_char* data, u_int wid, u_long n,
@@ -60,6 +61,7 @@ MemoryDecoder::MemoryDecoder(u_char* data, u_int wid, u_long n,
     rowBuf    = new u_char[byteWidth];
     setupDecoder(fillorder, is2D, isG4);
     setRuns(runs, runs+width, width);
+    setInput(bp, cc);
 }
 
 MemoryDecoder::~MemoryDecoder()
@@ -70,13 +72,15 @@ MemoryDecoder::~MemoryDecoder()
 	delete runs;
 }
 
+/*
+ * Called by the decoder only when all the data in
+ * memory has been consumed.
+ */
 int
 MemoryDecoder::decodeNextByte()
 {
-    if (cc == 0)
-        raiseRTC();                     // XXX don't need to recognize EOF
-    cc--;
-    return (*bp++);
+    raiseRTC();                         // XXX don't need to recognize EOF
+    return (0);
 }
 
 void
@@ -154,7 +158,7 @@ MemoryDecoder::scanPageForBlanks(u_int fillorder, const Class2Params& params)
 	for (;;) {
 	    (void) decodeRow(NULL, rowpixels);
 	    if (isBlank(lastRuns(), rowpixels)) {
-		endOfData = bp;			// include one blank row
+		endOfData = current();		// include one blank row
 		nblanks = 0;
 		do {
 		    nblanks++;
@@ -242,6 +246,7 @@ u_char* MemoryDecoder::cutExtraRTC()
     if( cc > CheckArea ){
         bp += (cc-CheckArea);
         cc = CheckArea;
+        setInput(bp, cc);
     }
         
     endOfData = NULL;
@@ -313,6 +318,24 @@ u_char* MemoryDecoder::cutExtraEOFB()
     return endOfData;
 }
 
+/*
+ * Decode up to max rows and return the number decoded;
+ * fewer are returned if the data end first.
+ */
+u_int MemoryDecoder::decodeRows(u_int max)
+{
+    rows = 0;
+    if (!RTCraised()) {
+	while (rows < max) {
+	    (void) decodeRow(NULL, width);
+	    if (seenRTC())
+		break;
+	    rows++;
+	}
+    }
+    return rows;
+}
+
 u_char* MemoryDecoder::encodeTagLine(u_long* raster, u_int th, u_int slop)
 {
     /*
@@ -32,7 +32,7 @@
 
 class MemoryDecoder : public G3Decoder {
 private:
-    u_char*	bp;
+    u_char*	bp;		// start of data
     u_int	width;
     u_int	byteWidth;
     u_long	cc;
@@ -53,10 +53,11 @@ public:
     MemoryDecoder(u_char* data, u_int wid, u_long n,
                   u_int fillorder, bool twoDim, bool mmr);
     ~MemoryDecoder();
-    u_char* current() { return bp; }
+    u_char* current() { return getInput(); }
     void fixFirstEOL();
     u_char* cutExtraRTC();
     u_char* cutExtraEOFB();
+    u_int decodeRows(u_int max);
     u_char* encodeTagLine (u_long* raster, u_int th, u_int slop);
     u_char* convertDataFormat(const Class2Params& params);
 
@@ -222,6 +222,30 @@ Modem::findModem(const Job& job)
     return (NULL);
 }
 
+/*
+ * Check whether any modem that findModem would consider
+ * for the job is currently ready.  Unlike findModem this
+ * does not reorder the modem list, so the scheduler can use
+ * it to skip jobs before reading their on-disk state.
+ */
+bool
+Modem::isReadyFor(const Job& job)
+{
+    if (modemsReady == 0)
+	return (false);
+    RE* c = ModemGroup::find(job.device);
+    for (ModemIter iter(list); iter.notDone(); iter++) {
+	Modem& modem = iter;
+	if (modem.getState() != Modem::READY)
+	    continue;
+	if (c ? !c->Find(modem.devID) : job.device != modem.devID)
+	    continue;
+	if (modem.isCapable(job))
+	    return (true);
+    }
+    return (false);
+}
+
 /*
  * Assign a modem for use by a job.
  */
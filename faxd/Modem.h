@@ -112,6 +112,7 @@ public:
     static Modem& getModemByID(const fxStr& id);
     static Modem* modemExists(const fxStr& id);
     static Modem* findModem(const Job& job);
+    static bool isReadyFor(const Job& job);
     bool isInGroup(const fxStr& mgroup);
 
     bool assign();			// assign modem
@@ -0,0 +1,236 @@
+/*	$Id$ */
+/*
+ * Copyright (c) 2026 iFAX Solutions, Inc.
+ * HylaFAX is a trademark of Silicon Graphics
+ *
+ * Permission to use, copy, modify, distribute, and sell this software and
+ * its documentation for any purpose is hereby granted without fee, provided
+ * that (i) the above copyright notices and this permission notice appear in
+ * all copies of the software and related documentation, and (ii) the names of
+ * Sam Leffler and Silicon Graphics may not be used in any advertising or
+ * publicity relating to the software without the specific, prior written
+ * permission of Sam Leffler and Silicon Graphics.
+ *
+ * THE SOFTWARE IS PROVIDED "AS-IS" AND WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS, IMPLIED OR OTHERWISE, INCLUDING WITHOUT LIMITATION, ANY
+ * WARRANTY OF MERCHANTABILITY OR FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * IN NO EVENT SHALL SAM LEFFLER OR SILICON GRAPHICS BE LIABLE FOR
+ * ANY SPECIAL, INCIDENTAL, INDIRECT OR CONSEQUENTIAL DAMAGES OF ANY KIND,
+ * OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS,
+ * WHETHER OR NOT ADVISED OF THE POSSIBILITY OF DAMAGE, AND ON ANY THEORY OF
+ * LIABILITY, ARISING OUT OF OR IN CONNECTION WITH THE USE OR PERFORMANCE
+ * OF THIS SOFTWARE.
+ */
+#include "ModemIOTrace.h"
+#include "Sys.h"
+
+#include <string.h>
+#include <errno.h>
+#include <sys/time.h>
+#if HAS_MMAP
+#include <sys/mman.h>
+#endif
+
+#define	IOTRACE_MAGIC	"HFIO"
+#define	IOTRACE_VERSION	1
+#define	IOTRACE_HDRSIZE	64		// header is padded to this
+#define	IOTRACE_MINSIZE	(4*1024)
+
+ModemIOTrace::ModemIOTrace(int f, Header* h, bool m)
+{
+    fd = f;
+    hdr = h;
+    mapped = m;
+    ring = (u_char*) hdr + IOTRACE_HDRSIZE;
+    mask = hdr->size-1;
+    maxData = fxmin((u_int) 0xffff, hdr->size/4);
+}
+
+ModemIOTrace::~ModemIOTrace()
+{
+    u_int len = IOTRACE_HDRSIZE + hdr->size;
+#if HAS_MMAP
+    if (mapped) {
+	munmap((char*) hdr, len);
+	hdr = NULL;
+    }
+#endif
+    if (hdr) {
+	if (fd >= 0)			// write back the unmapped copy
+	    (void) Sys::write(fd, (const char*) hdr, len);
+	free(hdr);
+    }
+    if (fd >= 0)
+	Sys::close(fd);
+}
+
+/*
+ * Create a trace file with a ring of at least size
+ * bytes (rounded up to a power of 2).  The trace is
+ * mapped shared so that it survives the process.
+ */
+ModemIOTrace*
+ModemIOTrace::create(const fxStr& file, u_int size, mode_t mode,
+    const fxStr& commid, fxStr& emsg)
+{
+    u_int ringSize = IOTRACE_MINSIZE;
+    while (ringSize < size && ringSize < 0x40000000)
+	ringSize <<= 1;
+    u_int len = IOTRACE_HDRSIZE + ringSize;
+    int fd = Sys::open(file, O_RDWR|O_CREAT|O_TRUNC, mode);
+    if (fd < 0) {
+	emsg = fxStr::format("%s: %s", (const char*) file, strerror(errno));
+	return (NULL);
+    }
+    Header* hdr = NULL;
+    bool mapped = false;
+#if HAS_MMAP
+    if (ftruncate(fd, len) == 0) {
+	void* addr = mmap(NULL, len, PROT_READ|PROT_WRITE, MAP_SHARED, fd, 0);
+	if (addr != (void*) MAP_FAILED) {
+	    hdr = (Header*) addr;
+	    mapped = true;
+	}
+    }
+#endif
+    if (!hdr && (hdr = (Header*) malloc(len)) == NULL) {
+	emsg = fxStr::format("%s: No space for trace buffer", (const char*) file);
+	Sys::close(fd);
+	return (NULL);
+    }
+    memset(hdr, 0, IOTRACE_HDRSIZE);
+    memcpy(hdr->magic, IOTRACE_MAGIC, sizeof (hdr->magic));
+    hdr->version = IOTRACE_VERSION;
+    hdr->size = ringSize;
+    hdr->pid = (u_int) getpid();
+    strncpy(hdr->commid, commid, sizeof (hdr->commid)-1);
+    return new ModemIOTrace(fd, hdr, mapped);
+}
+
+/*
+ * Open a trace file for reading.
+ */
+ModemIOTrace*
+ModemIOTrace::open(const fxStr& file, fxStr& emsg)
+{
+    int fd = Sys::open(file, O_RDONLY);
+    if (fd < 0) {
+	emsg = fxStr::format("%s: %s", (const char*) file, strerror(errno));
+	return (NULL);
+    }
+    struct stat sb;
+    Header h;
+    if (Sys::fstat(fd, sb) < 0 || Sys::read(fd, (char*) &h, sizeof (h)) != sizeof (h) ||
+      memcmp(h.magic, IOTRACE_MAGIC, sizeof (h.magic)) != 0) {
+	emsg = fxStr::format("%s: Not a modem I/O trace file", (const char*) file);
+	Sys::close(fd);
+	return (NULL);
+    }
+    if (h.version != IOTRACE_VERSION) {
+	emsg = fxStr::format("%s: Unsupported trace file version %u",
+	    (const char*) file, h.version);
+	Sys::close(fd);
+	return (NULL);
+    }
+    u_int len = IOTRACE_HDRSIZE + h.size;
+    if (h.size < IOTRACE_MINSIZE || (h.size & (h.size-1)) != 0 ||
+      (off_t) len > sb.st_size || h.head - h.tail > h.size) {
+	emsg = fxStr::format("%s: Corrupted trace file", (const char*) file);
+	Sys::close(fd);
+	return (NULL);
+    }
+    Header* hdr = (Header*) malloc(len);
+    if (!hdr) {
+	emsg = fxStr::format("%s: No space for trace buffer", (const char*) file);
+	Sys::close(fd);
+	return (NULL);
+    }
+    if (lseek(fd, 0, SEEK_SET) != 0 || Sys::read(fd, (char*) hdr, len) != (ssize_t) len) {
+	emsg = fxStr::format("%s: Read error: %s", (const char*) file, strerror(errno));
+	free(hdr);
+	Sys::close(fd);
+	return (NULL);
+    }
+    Sys::close(fd);
+    return new ModemIOTrace(-1, hdr, false);
+}
+
+/*
+ * Copy data in/out of the ring at a stream
+ * position, wrapping at the end of the buffer.
+ */
+void
+ModemIOTrace::put(u_int pos, const void* data, u_int cc)
+{
+    u_int off = pos & mask;
+    u_int n = fxmin(cc, mask+1 - off);
+    memcpy(ring + off, data, n);
+    if (n < cc)
+	memcpy(ring, (const u_char*) data + n, cc - n);
+}
+
+void
+ModemIOTrace::get(u_int pos, void* data, u_int cc) const
+{
+    u_int off = pos & mask;
+    u_int n = fxmin(cc, mask+1 - off);
+    memcpy(data, ring + off, n);
+    if (n < cc)
+	memcpy((u_char*) data + n, ring, cc - n);
+}
+
+/*
+ * Append a record of modem I/O to the ring, dropping
+ * the oldest records to make room.  The head is moved
+ * last so a reader of the file never sees a partial
+ * record.  Large transfers are split over several
+ * records so that no one record can fill the ring.
+ */
+void
+ModemIOTrace::record(u_int dir, const u_char* data, u_int cc)
+{
+    Record r;
+    timeval tv;
+    gettimeofday(&tv, 0);
+    r.sec = (u_int) tv.tv_sec;
+    r.usec = (u_int) tv.tv_usec;
+    r.dir = dir;
+    r.pad = 0;
+    do {
+	u_int n = fxmin(cc, maxData);
+	u_int need = sizeof (r) + n;
+	u_int head = hdr->head;
+	u_int tail = hdr->tail;
+	while (head + need - tail > mask+1) {
+	    Record old;
+	    get(tail, &old, sizeof (old));
+	    tail += sizeof (old) + old.len;
+	}
+	hdr->tail = tail;
+	r.len = n;
+	put(head, &r, sizeof (r));
+	put(head + sizeof (r), data, n);
+	hdr->head = head + need;
+	data += n;
+	cc -= n;
+    } while (cc > 0);
+}
+
+/*
+ * Return the record at pos and advance pos to the
+ * next one; data must hold at least 64KB.  Start
+ * with pos set to getTail().
+ */
+bool
+ModemIOTrace::next(u_int& pos, Record& r, u_char* data) const
+{
+    if (hdr->head - pos < sizeof (r))
+	return (false);
+    get(pos, &r, sizeof (r));
+    if (hdr->head - pos - sizeof (r) < r.len)
+	return (false);
+    get(pos + sizeof (r), data, r.len);
+    pos += sizeof (r) + r.len;
+    return (true);
+}
@@ -0,0 +1,93 @@
+/*	$Id$ */
+/*
+ * Copyright (c) 2026 iFAX Solutions, Inc.
+ * HylaFAX is a trademark of Silicon Graphics
+ *
+ * Permission to use, copy, modify, distribute, and sell this software and
+ * its documentation for any purpose is hereby granted without fee, provided
+ * that (i) the above copyright notices and this permission notice appear in
+ * all copies of the software and related documentation, and (ii) the names of
+ * Sam Leffler and Silicon Graphics may not be used in any advertising or
+ * publicity relating to the software without the specific, prior written
+ * permission of Sam Leffler and Silicon Graphics.
+ *
+ * THE SOFTWARE IS PROVIDED "AS-IS" AND WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS, IMPLIED OR OTHERWISE, INCLUDING WITHOUT LIMITATION, ANY
+ * WARRANTY OF MERCHANTABILITY OR FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * IN NO EVENT SHALL SAM LEFFLER OR SILICON GRAPHICS BE LIABLE FOR
+ * ANY SPECIAL, INCIDENTAL, INDIRECT OR CONSEQUENTIAL DAMAGES OF ANY KIND,
+ * OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS,
+ * WHETHER OR NOT ADVISED OF THE POSSIBILITY OF DAMAGE, AND ON ANY THEORY OF
+ * LIABILITY, ARISING OUT OF OR IN CONNECTION WITH THE USE OR PERFORMANCE
+ * OF THIS SOFTWARE.
+ */
+#ifndef _ModemIOTrace_
+#define	_ModemIOTrace_
+/*
+ * Binary Modem I/O Trace Support.
+ *
+ * When SessionIOTraceSize is set, modem I/O traced during a session
+ * is kept as raw, timestamped records in a ring buffer mapped from
+ * a file next to the session log instead of being formatted into the
+ * log.  Positions in the ring count bytes written since the session
+ * began; the ring size is a power of 2 so they wrap with the counters.
+ * The oldest records are dropped as space is needed.  The file is in
+ * host byte order and is read back by faxiotrace.
+ */
+#include "Str.h"
+
+class ModemIOTrace {
+public:
+    enum {
+	DIR_SEND = 0,		// host to modem, "<--"
+	DIR_RECV = 1		// modem to host, "-->"
+    };
+    struct Header {
+	char	magic[4];	// "HFIO"
+	u_int	version;	// format version
+	u_int	size;		// # bytes in ring
+	u_int	head;		// position of next record
+	u_int	tail;		// position of oldest record
+	u_int	pid;		// process that wrote the trace
+	char	commid[16];	// session communication identifier
+    };
+    struct Record {
+	u_int	sec;		// time of i/o
+	u_int	usec;
+	u_short	len;		// # data bytes following
+	u_char	dir;		// DIR_SEND or DIR_RECV
+	u_char	pad;
+    };
+private:
+    int		fd;		// trace file
+    Header*	hdr;		// header at the front of the file
+    u_char*	ring;		// ring buffer following the header
+    u_int	mask;		// ring size - 1
+    u_int	maxData;	// largest data length in one record
+    bool	mapped;		// hdr is mmap'd from fd
+
+    ModemIOTrace(int fd, Header* hdr, bool mapped);
+
+    void	put(u_int pos, const void* data, u_int cc);
+    void	get(u_int pos, void* data, u_int cc) const;
+public:
+    ~ModemIOTrace();
+
+    static ModemIOTrace* create(const fxStr& file, u_int size, mode_t mode,
+		    const fxStr& commid, fxStr& emsg);
+    static ModemIOTrace* open(const fxStr& file, fxStr& emsg);
+
+    void	record(u_int dir, const u_char* data, u_int cc);
+    bool	next(u_int& pos, Record& r, u_char* data) const;
+
+    u_int	getPid() const;
+    const char*	getCommID() const;
+    u_int	getHead() const;
+    u_int	getTail() const;
+};
+inline u_int ModemIOTrace::getPid() const		{ return hdr->pid; }
+inline const char* ModemIOTrace::getCommID() const	{ return hdr->commid; }
+inline u_int ModemIOTrace::getHead() const		{ return hdr->head; }
+inline u_int ModemIOTrace::getTail() const		{ return hdr->tail; }
+#endif /* _ModemIOTrace_ */
@@ -30,6 +30,7 @@
 #include <errno.h>
 #include <sys/param.h>
 #include <sys/time.h>
+#include <sys/uio.h>
 #if HAS_MODEM_H
 #include <sys/modem.h>
 #else
@@ -43,6 +44,7 @@
 #include "Dispatcher.h"
 #include "FaxTrace.h"
 #include "FaxMachineLog.h"
+#include "ModemIOTrace.h"
 #include "ModemServer.h"
 #include "UUCPLock.h"
 #include "Class0.h"
@@ -98,6 +100,7 @@ ModemServer::ModemServer(const fxStr& devName, const fxStr& devID)
     sawBlockEnd = false;
     timeout = false;
     log = NULL;
+    ioTrace = NULL;
 }
 
 ModemServer::~ModemServer()
@@ -688,6 +691,20 @@ ModemServer::beginSession(const fxStr& number)
     {
 	log =
 	    new FaxMachineLog(ftmp, canonicalizePhoneNumber(number), commid);
+	/*
+	 * With a binary trace modem i/o goes to a ring
+	 * buffer beside the session log; faxiotrace
+	 * renders it for reading.
+	 */
+	if (sessionIOTraceSize && (logTracingLevel & FAXTRACE_MODEMIO)) {
+	    file.append(".io");
+	    ioTrace = ModemIOTrace::create(file, sessionIOTraceSize,
+		logMode, commid, emsg);
+	    if (ioTrace)
+		log->log("Modem I/O traced to %s", (const char*) file);
+	    else
+		logError("Can not create modem I/O trace: %s", (const char*) emsg);
+	}
     }
 }
 
@@ -697,6 +714,7 @@ ModemServer::beginSession(const fxStr& number)
 void
 ModemServer::endSession()
 {
+    delete ioTrace, ioTrace = NULL;
     delete log, log = NULL;
 }
 
@@ -970,6 +988,11 @@ ModemServer::traceModemIO(const char* dir, const u_char* data, u_int cc)
 	    return;
     } else if ((tracingLevel & FAXTRACE_MODEMIO) == 0)
 	return;
+    if (ioTrace) {
+	ioTrace->record(dir[0] == '<' ? ModemIOTrace::DIR_SEND :
+	    ModemIOTrace::DIR_RECV, data, cc);
+	return;
+    }
 
     const char* hexdigits = "0123456789ABCDEF";
     fxStackBuffer buf;
@@ -1504,6 +1527,47 @@ ModemServer::getModemChar(long ms, bool isquery)
     return (rcvBuf[rcvNext++]);
 }
 
+/*
+ * Read up to size bytes of DLE-escaped data into buf and return
+ * the number of bytes read.  Whole runs of data between DLE's are
+ * copied from the receive buffer at once.  <DLE><DLE> gives a DLE
+ * and <DLE> with any other character gives that character, except
+ * that <DLE><ETX>, EOF or a timeout ends the data and sets fin.
+ */
+int
+ModemServer::getModemDLEData(u_char* buf, u_int size, long ms, bool& fin)
+{
+    u_int cc = 0;
+    fin = false;
+    while (cc < size) {
+	if (rcvNext >= rcvCC) {
+	    if (getModemChar(ms) == EOF || timeout) {
+		fin = true;
+		break;
+	    }
+	    rcvNext--;				// NB: refilled rcvBuf
+	}
+	const u_char* cp = rcvBuf + rcvNext;
+	u_int n = fxmin((u_int)(rcvCC - rcvNext), size - cc);
+	const u_char* dp = (const u_char*) memchr(cp, DLE, n);
+	if (dp)
+	    n = dp - cp;
+	memcpy(buf + cc, cp, n);
+	cc += n;
+	rcvNext += n;
+	if (dp) {
+	    rcvNext++;
+	    int c = getModemChar(ms);
+	    if (c == EOF || c == ETX || timeout) {
+		fin = true;
+		break;
+	    }
+	    buf[cc++] = c;
+	}
+    }
+    return (cc);
+}
+
 int
 ModemServer::getModemBit(long ms)
 {
@@ -1511,6 +1575,24 @@ ModemServer::getModemBit(long ms)
      * Return bytes bit-by-bit in MSB2LSB order.
      * getModemChar() returns them in LSB2MSB.
      */
+    u_int count;
+    (void) peekModemBits(count, ms);
+    // enable this to simulate a VERY noisy connection
+    // if (((int) Sys::now() & 1) && ((random() % 10000)/10000.0) > 0.95) return (1);
+    if (gotByte == EOF) return (EOF);
+    else if (gotByte & (0x80 >> --rcvBit)) return (1);
+    else return (0);
+}
+
+/*
+ * Return the byte that getModemBit is taking bits from,
+ * reading another if needed, with the number of its bits
+ * not yet returned in count (the high-order bits).  This
+ * lets the caller consume whole bytes with skipModemBits.
+ */
+int
+ModemServer::peekModemBits(u_int& count, long ms)
+{
     if (rcvBit < 1) {
 	rcvBit = 8;
 	gotByte = getModemChar(ms);
@@ -1519,11 +1601,14 @@ ModemServer::getModemBit(long ms)
 	    if (gotByte == 0x03) sawBlockEnd = true;	// DLE+ETX
 	}
     }
-    // enable this to simulate a VERY noisy connection
-    // if (((int) Sys::now() & 1) && ((random() % 10000)/10000.0) > 0.95) return (1);
-    if (gotByte == EOF) return (EOF);
-    else if (gotByte & (0x80 >> --rcvBit)) return (1);
-    else return (0);
+    count = rcvBit;
+    return (gotByte);
+}
+
+void
+ModemServer::skipModemBits(u_int count)
+{
+    rcvBit -= count;
 }
 
 int
@@ -1577,6 +1662,41 @@ ModemServer::putModem(const void* data, int n, long ms)
     return (putModem1(data, n, ms));
 }
 
+/*
+ * Write several pieces of data to the modem at once.
+ */
+bool
+ModemServer::putModem(const struct iovec* iov, int iovcnt, long ms)
+{
+    int n = 0;
+    for (int i = 0; i < iovcnt; i++)
+	n += iov[i].iov_len;
+    traceStatus(FAXTRACE_MODEMCOM, "<-- data [%d]", n);
+    if (ms)
+	startTimeout(ms);
+    else
+	timeout = false;
+    int cc = writev(modemFd, iov, iovcnt);
+    if (ms)
+	stopTimeout("writing to modem");
+    if (cc > 0) {
+	for (int i = 0, left = cc; i < iovcnt && left > 0; i++) {
+	    u_int len = fxmin((u_int) left, (u_int) iov[i].iov_len);
+	    traceModemIO("<--", (const u_char*) iov[i].iov_base, len);
+	    left -= len;
+	}
+	n -= cc;
+    }
+    if (cc == -1) {
+	if (errno != EINTR)
+	    traceStatus(FAXTRACE_MODEMCOM, "MODEM WRITE ERROR: errno %u",
+		errno);
+    } else if (n != 0)
+	traceStatus(FAXTRACE_MODEMCOM, "MODEM WRITE SHORT: sent %u, wrote %u",
+	    cc+n, cc);
+    return (!timeout && n == 0);
+}
+
 bool
 ModemServer::putModem1(const void* data, int n, long ms)
 {
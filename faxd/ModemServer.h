@@ -47,6 +47,8 @@
 
 class FaxMachineInfo;
 class FaxMachineLog;
+class ModemIOTrace;
+struct iovec;
 
 /*
  * This class defines the ``server process'' that manages
@@ -124,6 +126,7 @@ protected:
     Status	abortCallReason;	// reason for abort
 // logging and tracing
     FaxMachineLog* log;			// current log device
+    ModemIOTrace* ioTrace;		// binary modem i/o trace for session
 
     ModemServer(const fxStr& deviceName, const fxStr& devID);
 
@@ -141,13 +144,17 @@ protected:
     void	sendDLEETX();
     int		getModemLine(char buf[], u_int bufSize, long ms = 0);
     int		getModemChar(long ms = 0, bool isquery = false);
+    int		getModemDLEData(u_char* buf, u_int size, long ms, bool& fin);
     int		getModemBit(long ms = 0);
+    int		peekModemBits(u_int& count, long ms = 0);
+    void	skipModemBits(u_int count);
     int		getLastByte();
     bool	didBlockEnd();
     void	resetBlock();
     bool	isModemInput() const;
     void	flushModemInput();
     bool	putModem(const void* data, int n, long ms = 0);
+    bool	putModem(const struct iovec* iov, int iovcnt, long ms = 0);
     bool	putModem1(const void* data, int n, long ms = 0);
     void	startTimeout(long ms);
     void	stopTimeout(const char* whichdir);
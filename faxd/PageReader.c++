@@ -0,0 +1,137 @@
+/*	$Id$ */
+/*
+ * Copyright (c) 2026 iFAX Solutions, Inc.
+ * HylaFAX is a trademark of Silicon Graphics
+ *
+ * Permission to use, copy, modify, distribute, and sell this software and
+ * its documentation for any purpose is hereby granted without fee, provided
+ * that (i) the above copyright notices and this permission notice appear in
+ * all copies of the software and related documentation, and (ii) the names of
+ * Sam Leffler and Silicon Graphics may not be used in any advertising or
+ * publicity relating to the software without the specific, prior written
+ * permission of Sam Leffler and Silicon Graphics.
+ *
+ * THE SOFTWARE IS PROVIDED "AS-IS" AND WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS, IMPLIED OR OTHERWISE, INCLUDING WITHOUT LIMITATION, ANY
+ * WARRANTY OF MERCHANTABILITY OR FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * IN NO EVENT SHALL SAM LEFFLER OR SILICON GRAPHICS BE LIABLE FOR
+ * ANY SPECIAL, INCIDENTAL, INDIRECT OR CONSEQUENTIAL DAMAGES OF ANY KIND,
+ * OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS,
+ * WHETHER OR NOT ADVISED OF THE POSSIBILITY OF DAMAGE, AND ON ANY THEORY OF
+ * LIABILITY, ARISING OUT OF OR IN CONNECTION WITH THE USE OR PERFORMANCE
+ * OF THIS SOFTWARE.
+ */
+#include "PageReader.h"
+#include "Sys.h"
+
+/*
+ * The last piece of a page holds at least this much
+ * data so that the end of the page data (e.g. an
+ * RTC to be removed) can be examined in one piece.
+ */
+#define	PAGE_TAIL	64
+
+PageReader::PageReader(TIFF* tif, u_long pageChop, u_int l)
+{
+    fd = TIFFFileno(tif);
+    nstrips = TIFFNumberOfStrips(tif);
+    stripoff = NULL;
+    stripsize = NULL;
+    if (!TIFFGetField(tif, TIFFTAG_STRIPOFFSETS, &stripoff) ||
+      !TIFFGetField(tif, TIFFTAG_STRIPBYTECOUNTS, &stripsize))
+	nstrips = 0;
+    total = 0;
+    for (tstrip_t s = 0; s < nstrips; s++)
+	total += (u_long) stripsize[s];
+    total = (total > pageChop ? total - pageChop : 0);
+    left = total;
+    strip = 0;
+    stripdone = 0;
+    lead = l;
+    buf[0] = buf[1] = NULL;
+    size[0] = size[1] = 0;
+    cur = 0;
+}
+
+PageReader::~PageReader()
+{
+    delete [] buf[0];
+    delete [] buf[1];
+}
+
+/*
+ * Hint that data in the file will be wanted soon.
+ */
+void
+PageReader::prefetch(off_t off, u_long cc)
+{
+#ifdef POSIX_FADV_WILLNEED
+    if (cc > 0)
+	(void) posix_fadvise(fd, off, (off_t) cc, POSIX_FADV_WILLNEED);
+#endif
+}
+
+/*
+ * Start again at the beginning of the page data; the
+ * piece last returned remains valid until the next read.
+ */
+void
+PageReader::restart()
+{
+    strip = 0;
+    stripdone = 0;
+    left = total;
+}
+
+/*
+ * Return the next piece of page data, about want bytes,
+ * or NULL at the end of the page.  A strip that can not
+ * be read is skipped.
+ */
+u_char*
+PageReader::read(u_long want, u_long& cc)
+{
+    cc = 0;
+    if (left == 0)
+	return (NULL);
+    u_long n = fxmin(want, left);
+    if (left - n < PAGE_TAIL)
+	n = left;
+    cur ^= 1;
+    if (size[cur] < lead + n) {
+	delete [] buf[cur];
+	size[cur] = lead + n;
+	buf[cur] = new u_char[size[cur]];
+    }
+    u_char* dp = buf[cur] + lead;
+    while (cc < n && strip < nstrips) {
+	u_long sc = (u_long) stripsize[strip];
+	if (stripdone >= sc) {
+	    strip++, stripdone = 0;
+	    continue;
+	}
+	off_t off = (off_t) stripoff[strip] + stripdone;
+	ssize_t r;
+	if (lseek(fd, off, SEEK_SET) != off ||
+	  (r = Sys::read(fd, (char*) dp+cc, (u_int) fxmin(n-cc, sc-stripdone))) <= 0) {
+	    stripdone = sc;		// skip unreadable data
+	    continue;
+	}
+	cc += r;
+	stripdone += r;
+    }
+    while (strip < nstrips && stripdone >= (u_long) stripsize[strip])
+	strip++, stripdone = 0;
+    left = (cc < n ? 0 : left - n);
+    /*
+     * Prefetch the next piece or, at the end of
+     * the page, what follows it in the file.
+     */
+    if (left > 0 && strip < nstrips)
+	prefetch((off_t) stripoff[strip] + stripdone,
+	    fxmin(fxmin(want, left), (u_long) stripsize[strip] - stripdone));
+    else if (nstrips > 0)
+	prefetch((off_t) (stripoff[nstrips-1] + stripsize[nstrips-1]), total);
+    return (cc > 0 ? dp : NULL);
+}
@@ -0,0 +1,72 @@
+/*	$Id$ */
+/*
+ * Copyright (c) 2026 iFAX Solutions, Inc.
+ * HylaFAX is a trademark of Silicon Graphics
+ *
+ * Permission to use, copy, modify, distribute, and sell this software and
+ * its documentation for any purpose is hereby granted without fee, provided
+ * that (i) the above copyright notices and this permission notice appear in
+ * all copies of the software and related documentation, and (ii) the names of
+ * Sam Leffler and Silicon Graphics may not be used in any advertising or
+ * publicity relating to the software without the specific, prior written
+ * permission of Sam Leffler and Silicon Graphics.
+ *
+ * THE SOFTWARE IS PROVIDED "AS-IS" AND WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS, IMPLIED OR OTHERWISE, INCLUDING WITHOUT LIMITATION, ANY
+ * WARRANTY OF MERCHANTABILITY OR FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * IN NO EVENT SHALL SAM LEFFLER OR SILICON GRAPHICS BE LIABLE FOR
+ * ANY SPECIAL, INCIDENTAL, INDIRECT OR CONSEQUENTIAL DAMAGES OF ANY KIND,
+ * OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS,
+ * WHETHER OR NOT ADVISED OF THE POSSIBILITY OF DAMAGE, AND ON ANY THEORY OF
+ * LIABILITY, ARISING OUT OF OR IN CONNECTION WITH THE USE OR PERFORMANCE
+ * OF THIS SOFTWARE.
+ */
+#ifndef _PageReader_
+#define _PageReader_
+/*
+ * Streaming Reader for Encoded Page Data.
+ *
+ * The raw (encoded) data of the strips of the current directory
+ * are returned in pieces of about the size asked for rather than
+ * all at once.  Each piece has lead bytes of writable space before
+ * it for the caller to prepend data (e.g. an imaged tag line), and
+ * remains valid until the next piece after it has been read, as the
+ * pieces are read into a ring of two buffers.  The final piece is
+ * never so short that the end of the page data is split over two
+ * pieces.  The data that follow each piece, and after the last the
+ * data that follow the page in the file (usually the next page),
+ * are prefetched so that reading overlaps with transmission.
+ */
+#include "Types.h"
+#include "tiffio.h"
+
+class PageReader {
+private:
+    int		fd;		// TIFF file descriptor
+    tiff_offset_t* stripoff;	// strip offsets
+    tiff_bytecount_t* stripsize;// strip byte counts
+    tstrip_t	nstrips;	// # strips in page
+    tstrip_t	strip;		// current strip
+    u_long	stripdone;	// bytes of current strip read
+    u_long	total;		// bytes of page data to return
+    u_long	left;		// bytes of page data not yet returned
+    u_int	lead;		// space before each piece
+    u_char*	buf[2];		// ring of buffers
+    u_long	size[2];	// size of each buffer
+    u_int	cur;		// buffer holding current piece
+
+    void	prefetch(off_t off, u_long cc);
+public:
+    PageReader(TIFF*, u_long pageChop, u_int lead);
+    ~PageReader();
+
+    u_char*	read(u_long want, u_long& cc);
+    void	restart();
+
+    u_long	getTotal() const;
+    bool	isEOF() const;
+};
+inline u_long PageReader::getTotal() const	{ return total; }
+inline bool PageReader::isEOF() const		{ return left == 0; }
+#endif /* _PageReader_ */
@@ -0,0 +1,388 @@
+/*	$Id$ */
+/*
+ * Copyright (c) 2026 iFAX Solutions, Inc.
+ * HylaFAX is a trademark of Silicon Graphics
+ *
+ * Permission to use, copy, modify, distribute, and sell this software and
+ * its documentation for any purpose is hereby granted without fee, provided
+ * that (i) the above copyright notices and this permission notice appear in
+ * all copies of the software and related documentation, and (ii) the names of
+ * Sam Leffler and Silicon Graphics may not be used in any advertising or
+ * publicity relating to the software without the specific, prior written
+ * permission of Sam Leffler and Silicon Graphics.
+ *
+ * THE SOFTWARE IS PROVIDED "AS-IS" AND WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS, IMPLIED OR OTHERWISE, INCLUDING WITHOUT LIMITATION, ANY
+ * WARRANTY OF MERCHANTABILITY OR FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * IN NO EVENT SHALL SAM LEFFLER OR SILICON GRAPHICS BE LIABLE FOR
+ * ANY SPECIAL, INCIDENTAL, INDIRECT OR CONSEQUENTIAL DAMAGES OF ANY KIND,
+ * OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS,
+ * WHETHER OR NOT ADVISED OF THE POSSIBILITY OF DAMAGE, AND ON ANY THEORY OF
+ * LIABILITY, ARISING OUT OF OR IN CONNECTION WITH THE USE OR PERFORMANCE
+ * OF THIS SOFTWARE.
+ */
+#include "Sys.h"
+#include "PreparePool.h"
+#include "faxQueueApp.h"
+#include "Modem.h"
+#include "Trigger.h"
+#include "Dispatcher.h"
+
+#include <errno.h>
+#include <sys/socket.h>
+
+PrepareWorker::PrepareWorker(PreparePool& p, pid_t pi, int f)
+    : pool(p)
+{
+    pid = pi;
+    fd = f;
+    batch = NULL;
+    stale = false;
+}
+PrepareWorker::~PrepareWorker() {}
+
+/*
+ * The worker returned the status of a job, or
+ * closed its socket because it is going away.
+ */
+int
+PrepareWorker::inputReady(int)
+{
+    int status;
+    ssize_t n;
+    do
+	n = Sys::read(fd, (char*) &status, sizeof (status));
+    while (n < 0 && errno == EINTR);
+    if (n == sizeof (status) && batch)
+	pool.done(*this, status<<8);		// NB: as if from _exit
+    else {
+	/*
+	 * The worker is exiting (or confused); stop using
+	 * it.  Any job it had is finished off when the
+	 * process is reaped.
+	 */
+	pool.retire(*this, true);
+    }
+    return (0);
+}
+
+/*
+ * The worker process exited.  If it was in the middle
+ * of a job then pass its exit status on to the batch as
+ * if a prepare subprocess had died.
+ */
+void
+PrepareWorker::childStatus(pid_t, int status)
+{
+    pool.retire(*this);
+    if (batch) {
+	logError("PREPARE: worker %d exited with status %#x while busy",
+	    (int) pid, status);
+	pool.done(*this, (status & 0xff) ? status : (Job::failed<<8));
+    }
+    pid = 0;
+    pool.reap(*this);
+}
+
+PreparePool::PreparePool()
+{
+    maxWorkers = 0;
+    nworkers = 0;
+    jobs = spawned = 0;
+}
+
+PreparePool::~PreparePool()
+{
+    while (!queue.isEmpty()) {
+	PrepareRequest* r = (PrepareRequest*) queue.next;
+	r->remove();
+	delete r;
+    }
+}
+
+void
+PreparePool::setMaxWorkers(u_int n)
+{
+    maxWorkers = n;
+}
+
+u_int
+PreparePool::queueLength() const
+{
+    u_int n = 0;
+    for (const QLink* ql = queue.next; ql != &queue; ql = ql->next)
+	n++;
+    return (n);
+}
+
+/*
+ * Pre-fork the configured number of workers.  This is done
+ * at startup, while the scheduler's image is still small.
+ */
+void
+PreparePool::start()
+{
+    while (nworkers < maxWorkers && spawn())
+	;
+}
+
+/*
+ * Create a worker process.  The worker gets its end of a
+ * socket pair and runs the worker loop in faxQueueApp; it
+ * must not hold the scheduler's end of other workers'
+ * sockets or they would not see EOF when retired.
+ */
+PrepareWorker*
+PreparePool::spawn()
+{
+    int sv[2];
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, sv) < 0) {
+	logError("PREPARE: socketpair: %m");
+	return (NULL);
+    }
+    pid_t pid = fork();
+    switch (pid) {
+    case -1:
+	logError("PREPARE: Could not fork worker: %m");
+	Sys::close(sv[0]);
+	Sys::close(sv[1]);
+	return (NULL);
+    case 0:
+	Sys::close(sv[0]);
+	for (QLink* ql = workers.next; ql != &workers; ql = ql->next) {
+	    PrepareWorker* w = (PrepareWorker*) ql;
+	    if (w->fd >= 0)
+		Sys::close(w->fd);
+	}
+	faxQueueApp::instance().runPrepareWorker(sv[1]);
+	_exit(0);
+	/*NOTREACHED*/
+    }
+    Sys::close(sv[1]);
+    (void) fcntl(sv[0], F_SETFD, FD_CLOEXEC);
+    PrepareWorker* w = new PrepareWorker(*this, pid, sv[0]);
+    w->insert(workers);
+    nworkers++;
+    spawned++;
+    Dispatcher::instance().link(sv[0], Dispatcher::ReadMask, w);
+    Dispatcher::instance().startChild(pid, w);
+    return (w);
+}
+
+/*
+ * Stop giving work to a worker.  Closing the socket
+ * tells an idle worker to exit; a busy worker is
+ * closed when it finishes the current job unless
+ * the socket is already dead.
+ */
+void
+PreparePool::retire(PrepareWorker& w, bool force)
+{
+    if (w.fd >= 0 && !w.stale)
+	nworkers--;
+    w.stale = true;
+    if (w.fd >= 0 && (w.batch == NULL || force)) {
+	Dispatcher::instance().unlink(w.fd);
+	Sys::close(w.fd);
+	w.fd = -1;
+    }
+}
+
+/*
+ * Discard a worker once its process has been
+ * reaped and its socket closed.
+ */
+void
+PreparePool::reap(PrepareWorker& w)
+{
+    if (w.pid == 0 && w.fd < 0) {
+	w.remove();
+	delete &w;
+    }
+}
+
+/*
+ * Replace the workers after a configuration change.
+ */
+void
+PreparePool::configChanged()
+{
+    QLink* next;
+    for (QLink* ql = workers.next; ql != &workers; ql = next) {
+	next = ql->next;
+	retire(*(PrepareWorker*) ql);
+    }
+}
+
+/*
+ * Queue a batch for preparation and hand it to a
+ * worker if one is available.
+ */
+void
+PreparePool::submit(Batch& batch, Job& job)
+{
+    (new PrepareRequest(batch, job))->insert(queue);
+    dispatch();
+}
+
+void
+PreparePool::dispatch()
+{
+    while (!queue.isEmpty()) {
+	PrepareWorker* w = NULL;
+	for (QLink* ql = workers.next; ql != &workers; ql = ql->next) {
+	    PrepareWorker* t = (PrepareWorker*) ql;
+	    if (t->fd >= 0 && !t->stale && t->batch == NULL) {
+		w = t;
+		break;
+	    }
+	}
+	if (!w && nworkers < maxWorkers)
+	    w = spawn();
+	PrepareRequest* r = (PrepareRequest*) queue.next;
+	if (w && start(*w, *r)) {
+	    r->remove();
+	    delete r;
+	    continue;
+	}
+	if (w)
+	    retire(*w);
+	else if (nworkers > 0)
+	    break;				// wait for a busy worker
+	/*
+	 * There is no worker to give the job to; have it
+	 * retried later, as is done when a fork fails.
+	 */
+	Batch& batch = r->batch;
+	r->remove();
+	delete r;
+	faxQueueApp::instance().prepareDone(batch, Job::requeued<<8);
+    }
+}
+
+/*
+ * Pass a job to a worker.  The worker is told what the
+ * scheduler knows that is not in the queue file: the
+ * destination, the modem's capabilities, and the job
+ * control settings.
+ */
+bool
+PreparePool::start(PrepareWorker& w, PrepareRequest& r)
+{
+    Job& job = r.job;
+    fxStr msg(job.jobid);
+    msg.append('\0');
+    msg.append(r.batch.dest);
+    msg.append('\0');
+    if (job.modem) {
+	msg.append(job.modem->getDeviceID());
+	msg.append('\0');
+	msg.append(fxStr::format("%c%x", job.modem->supportsPolling() ? 'P' : 'p',
+	    job.modem->getCapabilities().encodeCaps()));
+    } else
+	msg.append('\0');
+    msg.append('\0');
+    msg.append(job.getJCI().getText());
+    if (!writeMessage(w.fd, msg)) {
+	logError("PREPARE: Could not pass job %s to worker %d: %m",
+	    (const char*) job.jobid, (int) w.pid);
+	return (false);
+    }
+    w.batch = &r.batch;
+    r.batch.startPrepare(job, w.pid, false);
+    job.pid = w.pid;
+    jobs++;
+    Trigger::post(Trigger::JOB_PREP_BEGIN, job);
+    return (true);
+}
+
+/*
+ * A worker finished (or abandoned) a job.
+ */
+void
+PreparePool::done(PrepareWorker& w, int status)
+{
+    Batch& batch = *w.batch;
+    pid_t pid = w.pid;
+    w.batch = NULL;
+    if (w.stale)
+	retire(w);
+    batch.childStatus(pid, status);
+    dispatch();
+}
+
+bool
+PreparePool::isQueued(const Job& job) const
+{
+    for (const QLink* ql = queue.next; ql != &queue; ql = ql->next)
+	if (&((const PrepareRequest*) ql)->job == &job)
+	    return (true);
+    return (false);
+}
+
+/*
+ * Remove a job that has not yet been given to a worker.
+ * The batch is completed as if preparation was aborted.
+ */
+bool
+PreparePool::cancel(Job& job)
+{
+    for (QLink* ql = queue.next; ql != &queue; ql = ql->next) {
+	PrepareRequest* r = (PrepareRequest*) ql;
+	if (&r->job == &job) {
+	    Batch& batch = r->batch;
+	    r->remove();
+	    delete r;
+	    faxQueueApp::instance().prepareDone(batch, Job::requeued<<8);
+	    return (true);
+	}
+    }
+    return (false);
+}
+
+static bool
+readFully(int fd, char* buf, u_int cc)
+{
+    while (cc > 0) {
+	ssize_t n = Sys::read(fd, buf, cc);
+	if (n < 0 && errno == EINTR)
+	    continue;
+	if (n <= 0)
+	    return (false);
+	buf += n, cc -= n;
+    }
+    return (true);
+}
+
+/*
+ * Messages are a length followed by that many bytes.
+ */
+bool
+PreparePool::readMessage(int fd, fxStr& msg)
+{
+    u_int len;
+    if (!readFully(fd, (char*) &len, sizeof (len)) || len > 64*1024)
+	return (false);
+    msg.resize(len);
+    return (len == 0 || readFully(fd, (char*) &msg[0], len));
+}
+
+bool
+PreparePool::writeMessage(int fd, const fxStr& msg)
+{
+    u_int len = msg.length();
+    fxStr buf((const char*) &len, sizeof (len));
+    buf.append(msg);
+    const char* cp = buf;
+    u_int cc = buf.length();
+    while (cc > 0) {
+	ssize_t n = Sys::write(fd, cp, cc);
+	if (n < 0 && errno == EINTR)
+	    continue;
+	if (n <= 0)
+	    return (false);
+	cp += n, cc -= n;
+    }
+    return (true);
+}
@@ -0,0 +1,127 @@
+/*	$Id$ */
+/*
+ * Copyright (c) 2026 iFAX Solutions, Inc.
+ * HylaFAX is a trademark of Silicon Graphics
+ *
+ * Permission to use, copy, modify, distribute, and sell this software and
+ * its documentation for any purpose is hereby granted without fee, provided
+ * that (i) the above copyright notices and this permission notice appear in
+ * all copies of the software and related documentation, and (ii) the names of
+ * Sam Leffler and Silicon Graphics may not be used in any advertising or
+ * publicity relating to the software without the specific, prior written
+ * permission of Sam Leffler and Silicon Graphics.
+ *
+ * THE SOFTWARE IS PROVIDED "AS-IS" AND WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS, IMPLIED OR OTHERWISE, INCLUDING WITHOUT LIMITATION, ANY
+ * WARRANTY OF MERCHANTABILITY OR FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * IN NO EVENT SHALL SAM LEFFLER OR SILICON GRAPHICS BE LIABLE FOR
+ * ANY SPECIAL, INCIDENTAL, INDIRECT OR CONSEQUENTIAL DAMAGES OF ANY KIND,
+ * OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS,
+ * WHETHER OR NOT ADVISED OF THE POSSIBILITY OF DAMAGE, AND ON ANY THEORY OF
+ * LIABILITY, ARISING OUT OF OR IN CONNECTION WITH THE USE OR PERFORMANCE
+ * OF THIS SOFTWARE.
+ */
+#ifndef _PreparePool_
+#define	_PreparePool_
+/*
+ * Pool of pre-forked job preparation worker processes.
+ */
+#include "IOHandler.h"
+#include "QLink.h"
+#include "Str.h"
+
+class Batch;
+class Job;
+class PreparePool;
+
+/*
+ * A worker process and the scheduler's end of the
+ * socket used to pass it work.
+ */
+class PrepareWorker : public IOHandler, public QLink {
+private:
+    PreparePool& pool;
+    pid_t	pid;		// worker process, 0 when reaped
+    int		fd;		// socket to worker, -1 when closed
+    Batch*	batch;		// batch being prepared, if any
+    bool	stale;		// retire when current work is done
+
+    friend class PreparePool;
+public:
+    PrepareWorker(PreparePool&, pid_t, int);
+    ~PrepareWorker();
+
+    int inputReady(int);
+    void childStatus(pid_t, int);
+};
+
+/*
+ * A batch waiting for a worker to become available.
+ */
+struct PrepareRequest : public QLink {
+    Batch&	batch;
+    Job&	job;
+
+    PrepareRequest(Batch& b, Job& j) : batch(b), job(j) {}
+};
+
+/*
+ * Job preparation (document conversion, cover pages, and
+ * page handling) is normally done in a fork of the scheduler
+ * for each batch.  When a pool size is configured, a fixed
+ * number of long-lived workers are forked instead and fed
+ * jobs over a socket; batches wait in a queue when all the
+ * workers are busy.  A worker is told everything about the
+ * job that is held only in the scheduler (the destination,
+ * assigned modem's capabilities, and job control settings)
+ * and rereads the queue file itself.  The result comes back
+ * to the batch as if a prepare subprocess had exited with
+ * the job status.
+ *
+ * Workers are retired and replaced when the configuration
+ * changes since they hold a copy of it from when they were
+ * forked.
+ */
+class PreparePool {
+private:
+    QLink	workers;		// live workers
+    QLink	queue;			// batches waiting for a worker
+    u_int	maxWorkers;		// pool size, 0 to fork per batch
+    u_int	nworkers;		// # live workers
+
+    PrepareWorker* spawn();
+    void	dispatch();
+    bool	start(PrepareWorker&, PrepareRequest&);
+    void	retire(PrepareWorker&, bool force = false);
+    void	done(PrepareWorker&, int status);
+    void	reap(PrepareWorker&);
+
+    friend class PrepareWorker;
+public:
+    u_int	jobs;			// # jobs handed to workers
+    u_int	spawned;		// # workers started
+
+    PreparePool();
+    ~PreparePool();
+
+    void	setMaxWorkers(u_int);
+    u_int	getMaxWorkers() const;
+    bool	isEnabled() const;
+    u_int	workerCount() const;
+    u_int	queueLength() const;
+
+    void	start();		// pre-fork the workers
+    void	configChanged();	// replace workers with fresh ones
+    void	submit(Batch&, Job&);
+    bool	isQueued(const Job&) const;
+    bool	cancel(Job&);
+
+					// used by the worker process
+    static bool	readMessage(int fd, fxStr& msg);
+    static bool	writeMessage(int fd, const fxStr& msg);
+};
+inline u_int PreparePool::getMaxWorkers() const	{ return maxWorkers; }
+inline bool PreparePool::isEnabled() const	{ return maxWorkers > 0; }
+inline u_int PreparePool::workerCount() const	{ return nworkers; }
+#endif /* _PreparePool_ */
@@ -99,6 +99,7 @@ ServerConfig::S_numbertag ServerConfig::numbers[] = {
    FAXTRACE_MODEMIO|FAXTRACE_TIMEOUTS },
 { "sessiontracing",	&ServerConfig::logTracingLevel,	FAXTRACE_SERVER },
 { "servertracing",	&ServerConfig::tracingLevel,	FAXTRACE_SERVER },
+{ "sessioniotracesize",	&ServerConfig::sessionIOTraceSize, 0 },
 { "uucplocktimeout",	&ServerConfig::uucpLockTimeout,	0 },
 { "jobreqproto",	&ServerConfig::requeueProto,	FAX_REQPROTO },
 { "jobreqother",	&ServerConfig::requeueOther,	FAX_REQUEUE },
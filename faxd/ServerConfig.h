@@ -110,6 +110,7 @@ public:
     u_int	tracingLevel;		// tracing level w/o session
     u_int	logTracingLevel;	// tracing level during session
     u_int	tracingMask;		// tracing level control mask
+    u_int	sessionIOTraceSize;	// size of binary modem i/o trace
     bool	clocalAsRoot;		// set CLOCAL as root
     bool	priorityScheduling;	// change process priority
     u_int	requeueTTS[9];		// requeue intervals[CallStatus code]
@@ -145,6 +145,44 @@ FaxModem::setupTagLineSlop(const Class2Params& params)
 
 #include "MemoryDecoder.h"
 
+/*
+ * Return the number of rows the tag line occupies
+ * at the given vertical resolution.
+ */
+static u_int
+tagLineHeight(u_int fontHeight, u_int vr)
+{
+    switch (vr) {
+    case VR_NORMAL:
+    case VR_200X100:
+	return ((fontHeight/2)+MARGIN_TOP+MARGIN_BOT);	// half VR_FINE
+    case VR_FINE:
+    case VR_200X200:
+	return (fontHeight+MARGIN_TOP+MARGIN_BOT);	// reference resolution
+    case VR_R8:
+    case VR_R16:
+    case VR_200X400:
+    case VR_300X300:	// not proportionate but legible
+	return ((fontHeight*2)+MARGIN_TOP+MARGIN_BOT);	// double VR_FINE
+    }
+    return (0);
+}
+
+/*
+ * Return whether the (partial) page data in buf hold
+ * enough rows for imageTagLine to replace.  This is the
+ * tag line plus the (up to 4) rows skipped to reach a
+ * 1D-encoded row and one more for the decoder's look
+ * ahead to the following EOL.
+ */
+bool
+FaxModem::tagLineFits(u_char* buf, u_int fillorder, const Class2Params& params, u_long totdata)
+{
+    u_int h = tagLineHeight(tagLineFont->fontHeight(), params.vr) + 4 + 1;
+    MemoryDecoder dec(buf, params.pageWidth(), totdata, fillorder, params.is2D(), (params.df == DF_2DMMR));
+    return (dec.decodeRows(h) == h);
+}
+
 /*
  * Image the tag line in place of the top few lines of the page
  * data and return the encoded tag line at the front of the
@@ -208,23 +246,7 @@ FaxModem::imageTagLine(u_char* buf, u_int fillorder, const Class2Params& params,
      */
     u_int w = params.pageWidth();
     u_int h = (tagLineFont->fontHeight()*2)+MARGIN_TOP+MARGIN_BOT;	// max height - double VR_FINE
-    u_int th = 0;							// actual tagline height
-    switch(params.vr) {
-	case VR_NORMAL:
-	case VR_200X100:
-	    th = (tagLineFont->fontHeight()/2)+MARGIN_TOP+MARGIN_BOT;	// half VR_FINE
-	    break;
-	case VR_FINE:
-	case VR_200X200:
-	    th = tagLineFont->fontHeight()+MARGIN_TOP+MARGIN_BOT;	// reference resolution
-	    break;
-	case VR_R8:
-	case VR_R16:
-	case VR_200X400:
-	case VR_300X300:	// not proportionate but legible
-	    th = (tagLineFont->fontHeight()*2)+MARGIN_TOP+MARGIN_BOT;	// double VR_FINE
-	    break;
-    }
+    u_int th = tagLineHeight(tagLineFont->fontHeight(), params.vr);	// actual tagline height
     /*
      * imageText assumes that raster is word-aligned; we use
      * longs here to optimize the scaling done below for the
@@ -0,0 +1,242 @@
+/*	$Id$ */
+/*
+ * Copyright (c) 2026 iFAX Solutions, Inc.
+ * HylaFAX is a trademark of Silicon Graphics
+ *
+ * Permission to use, copy, modify, distribute, and sell this software and
+ * its documentation for any purpose is hereby granted without fee, provided
+ * that (i) the above copyright notices and this permission notice appear in
+ * all copies of the software and related documentation, and (ii) the names of
+ * Sam Leffler and Silicon Graphics may not be used in any advertising or
+ * publicity relating to the software without the specific, prior written
+ * permission of Sam Leffler and Silicon Graphics.
+ *
+ * THE SOFTWARE IS PROVIDED "AS-IS" AND WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS, IMPLIED OR OTHERWISE, INCLUDING WITHOUT LIMITATION, ANY
+ * WARRANTY OF MERCHANTABILITY OR FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * IN NO EVENT SHALL SAM LEFFLER OR SILICON GRAPHICS BE LIABLE FOR
+ * ANY SPECIAL, INCIDENTAL, INDIRECT OR CONSEQUENTIAL DAMAGES OF ANY KIND,
+ * OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS,
+ * WHETHER OR NOT ADVISED OF THE POSSIBILITY OF DAMAGE, AND ON ANY THEORY OF
+ * LIABILITY, ARISING OUT OF OR IN CONNECTION WITH THE USE OR PERFORMANCE
+ * OF THIS SOFTWARE.
+ */
+
+/*
+ * Program for measuring the speed of the G3 decoder.
+ *
+ * Each page of each file is decoded from memory and
+ * then again with the data fed one byte at a time through
+ * nextByte, as is done for data received from a modem.
+ * The decoded rasters are compared and the decoding rates
+ * reported for MH, MR, and MMR pages.
+ *
+ * Usage: dectest [-n passes] input.tif ...
+ */
+#include <sys/time.h>
+#include "G3Decoder.h"
+#include "Sys.h"
+#include "NLS.h"
+#include "tiffio.h"
+
+const char* appName;
+
+void
+usage()
+{
+    fprintf(stderr, _("usage: %s [-n passes] input.tif ...\n"), appName);
+    exit(-1);
+}
+
+void
+fatal(const char* fmt ...)
+{
+    fprintf(stderr, "%s: ", appName);
+    va_list ap;
+    va_start(ap, fmt);
+    vfprintf(stderr, fmt, ap);
+    va_end(ap);
+    fputs(".\n", stderr);
+    exit(-1);
+}
+
+struct PageDecoder : public G3Decoder {
+    u_char*	data;		// encoded page data
+    u_long	cc;		// size of page data
+    u_char*	bp;		// next byte for nextByte
+    u_long	left;		// bytes left for nextByte
+    bool	buffered;	// decode from memory
+    tiff_runlen_t* runs;
+
+    PageDecoder(u_char* data, u_long cc, u_int w);
+    ~PageDecoder();
+
+    u_int	decodePage(u_char* raster, u_int w, u_int h,
+		    u_int fillorder, bool is2D, bool isG4, bool buffered);
+    int		decodeNextByte();
+};
+
+PageDecoder::PageDecoder(u_char* d, u_long n, u_int w)
+{
+    data = d;
+    cc = n;
+    runs = new tiff_runlen_t[2*w];
+}
+PageDecoder::~PageDecoder()	{ delete runs; }
+
+int
+PageDecoder::decodeNextByte()
+{
+    if (buffered || left == 0)
+	raiseRTC();
+    left--;
+    return (*bp++);
+}
+
+/*
+ * Decode up to h rows into raster and return
+ * the number of rows decoded.
+ */
+u_int
+PageDecoder::decodePage(u_char* raster, u_int w, u_int h,
+    u_int fillorder, bool is2D, bool isG4, bool buf)
+{
+    u_int rowbytes = howmany(w, 8);
+    memset(raster, 0, rowbytes*h);
+    buffered = buf;
+    bp = data;
+    left = cc;
+    setupDecoder(fillorder, is2D, isG4);
+    setRuns(runs, runs+w, w);
+    if (buffered)
+	setInput(data, cc);
+    else
+	setInput(NULL, 0);			// use nextByte
+    u_int row = 0;
+    if (!RTCraised()) {
+	while (row < h) {
+	    (void) decodeRow(raster + row*rowbytes, w);
+	    if (seenRTC())
+		break;
+	    row++;
+	}
+    }
+    return (row);
+}
+
+static double
+now()
+{
+    struct timeval tv;
+    gettimeofday(&tv, 0);
+    return (tv.tv_sec + tv.tv_usec / 1000000.);
+}
+
+static const char* formats[3] = { "MH", "MR", "MMR" };
+
+int
+main(int argc, char* argv[])
+{
+    extern int optind;
+    extern char* optarg;
+    u_int passes = 10;
+    int c;
+
+    NLS::Setup("hylafax-server");
+    appName = argv[0];
+    while ((c = Sys::getopt(argc, argv, "n:")) != -1)
+	switch (c) {
+	case 'n':
+	    passes = atoi(optarg);
+	    break;
+	case '?':
+	    usage();
+	    /*NOTREACHED*/
+	}
+    if (argc - optind < 1 || passes == 0)
+	usage();
+
+    u_long rows[3];
+    double byteTime[3], bufTime[3];
+    for (u_int i = 0; i < 3; i++)
+	rows[i] = 0, byteTime[i] = bufTime[i] = 0;
+    u_int errors = 0;
+    for (; optind < argc; optind++) {
+	const char* name = argv[optind];
+	TIFF* tif = TIFFOpen(name, "r");
+	if (!tif)
+	    fatal(_("%s: Cannot open, or not a TIFF file"), name);
+	u_int page = 0;
+	do {
+	    page++;
+	    uint16 comp;
+	    TIFFGetField(tif, TIFFTAG_COMPRESSION, &comp);
+	    if (comp != COMPRESSION_CCITTFAX3 && comp != COMPRESSION_CCITTFAX4) {
+		printf(_("%s page %u: Not Group 3 or Group 4-encoded, skipped\n"),
+		    name, page);
+		continue;
+	    }
+	    if (TIFFNumberOfStrips(tif) != 1) {
+		printf(_("%s page %u: Multiple strips, skipped\n"), name, page);
+		continue;
+	    }
+	    uint32 w, h, opts = 0;
+	    uint16 fillorder;
+	    TIFFGetField(tif, TIFFTAG_IMAGEWIDTH, &w);
+	    TIFFGetField(tif, TIFFTAG_IMAGELENGTH, &h);
+	    TIFFGetField(tif, TIFFTAG_GROUP3OPTIONS, &opts);
+	    TIFFGetFieldDefaulted(tif, TIFFTAG_FILLORDER, &fillorder);
+	    bool isG4 = (comp == COMPRESSION_CCITTFAX4);
+	    bool is2D = isG4 || (opts & GROUP3OPT_2DENCODING);
+	    u_int df = isG4 ? 2 : is2D ? 1 : 0;
+
+	    tiff_bytecount_t* stripbytecount;
+	    (void) TIFFGetField(tif, TIFFTAG_STRIPBYTECOUNTS, &stripbytecount);
+	    u_long totbytes = (u_long) stripbytecount[0];
+	    if (totbytes == 0)
+		continue;
+	    u_char* data = new u_char[totbytes];
+	    if (TIFFReadRawStrip(tif, 0, data, totbytes) < 0) {
+		delete data;
+		continue;
+	    }
+	    u_int rowbytes = howmany(w, 8);
+	    u_char* raster1 = new u_char[rowbytes*h];
+	    u_char* raster2 = new u_char[rowbytes*h];
+	    PageDecoder dec(data, totbytes, w);
+
+	    u_int n1 = 0, n2 = 0;
+	    double t = now();
+	    for (u_int i = 0; i < passes; i++)
+		n1 = dec.decodePage(raster1, w, h, fillorder, is2D, isG4, false);
+	    double t1 = now() - t;
+	    t = now();
+	    for (u_int i = 0; i < passes; i++)
+		n2 = dec.decodePage(raster2, w, h, fillorder, is2D, isG4, true);
+	    double t2 = now() - t;
+
+	    bool same = (n1 == n2 && memcmp(raster1, raster2, rowbytes*h) == 0);
+	    if (!same)
+		errors++;
+	    printf(_("%s page %u: %s %lux%lu, %u rows, %lu bytes: "
+		"%.0f rows/sec by byte, %.0f rows/sec from memory%s\n"),
+		name, page, formats[df], (u_long) w, (u_long) h, n1, totbytes,
+		t1 > 0 ? n1*passes / t1 : 0., t2 > 0 ? n2*passes / t2 : 0.,
+		same ? "" : _(", DECODED DATA DIFFERS"));
+	    rows[df] += n1*passes;
+	    byteTime[df] += t1;
+	    bufTime[df] += t2;
+	    delete raster1;
+	    delete raster2;
+	    delete data;
+	} while (TIFFReadDirectory(tif));
+	TIFFClose(tif);
+    }
+    for (u_int i = 0; i < 3; i++)
+	if (rows[i] && byteTime[i] > 0 && bufTime[i] > 0)
+	    printf(_("%s: %.0f rows/sec by byte, %.0f rows/sec from memory (%.2fx)\n"),
+		formats[i], rows[i] / byteTime[i], rows[i] / bufTime[i],
+		byteTime[i] / bufTime[i]);
+    return (errors ? 1 : 0);
+}
@@ -0,0 +1,853 @@
+/*	$Id$ */
+/*
+ * Copyright (c) 2026 iFAX Solutions, Inc.
+ * HylaFAX is a trademark of Silicon Graphics
+ *
+ * Permission to use, copy, modify, distribute, and sell this software and
+ * its documentation for any purpose is hereby granted without fee, provided
+ * that (i) the above copyright notices and this permission notice appear in
+ * all copies of the software and related documentation, and (ii) the names of
+ * Sam Leffler and Silicon Graphics may not be used in any advertising or
+ * publicity relating to the software without the specific, prior written
+ * permission of Sam Leffler and Silicon Graphics.
+ *
+ * THE SOFTWARE IS PROVIDED "AS-IS" AND WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS, IMPLIED OR OTHERWISE, INCLUDING WITHOUT LIMITATION, ANY
+ * WARRANTY OF MERCHANTABILITY OR FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * IN NO EVENT SHALL SAM LEFFLER OR SILICON GRAPHICS BE LIABLE FOR
+ * ANY SPECIAL, INCIDENTAL, INDIRECT OR CONSEQUENTIAL DAMAGES OF ANY KIND,
+ * OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS,
+ * WHETHER OR NOT ADVISED OF THE POSSIBILITY OF DAMAGE, AND ON ANY THEORY OF
+ * LIABILITY, ARISING OUT OF OR IN CONNECTION WITH THE USE OR PERFORMANCE
+ * OF THIS SOFTWARE.
+ */
+
+/*
+ * Program for measuring the speed of the G3 encoder.
+ *
+ * Each page of each file is decoded and the resulting raster
+ * is re-encoded as MH, MR, and MMR data, both by the encoder
+ * and by a reference copy of the encoder as it was before
+ * spans were found a word at a time.  The program fails if
+ * the two differ by a single byte or if the encoded data
+ * does not decode back to the original raster.  The encoding
+ * rates of both are reported for each data format.  Because
+ * fax pages are all a multiple of 8 pixels wide, synthetic
+ * rasters of other widths are checked the same way first.
+ * With -o the encoded pages are also written to a TIFF file.
+ *
+ * Usage: enctest [-n passes] [-o output.tif] [input.tif ...]
+ */
+#include <sys/time.h>
+#include "G3Decoder.h"
+#include "G3Encoder.h"
+#include "StackBuffer.h"
+#include "t4.h"
+#include "Sys.h"
+#include "NLS.h"
+#include "tiffio.h"
+
+const char* appName;
+
+void
+usage()
+{
+    fprintf(stderr, _("usage: %s [-n passes] [-o output.tif] [input.tif ...]\n"),
+	appName);
+    exit(-1);
+}
+
+void
+fatal(const char* fmt ...)
+{
+    fprintf(stderr, "%s: ", appName);
+    va_list ap;
+    va_start(ap, fmt);
+    vfprintf(stderr, fmt, ap);
+    va_end(ap);
+    fputs(".\n", stderr);
+    exit(-1);
+}
+
+struct PageDecoder : public G3Decoder {
+    tiff_runlen_t* runs;
+    u_int	nruns;			// length of each run array
+
+    PageDecoder(u_int w);
+    ~PageDecoder();
+
+    u_int	decodePage(const u_char* data, u_long cc, u_char* raster,
+		    u_int w, u_int h, u_int fillorder, bool is2D, bool isG4);
+    int		decodeNextByte();
+};
+
+/*
+ * A row of w pixels may have w+1 runs plus the
+ * terminating entries that 2-D decoding adds.
+ */
+PageDecoder::PageDecoder(u_int w)
+{
+    nruns = w+4;
+    runs = new tiff_runlen_t[2*nruns];
+}
+PageDecoder::~PageDecoder()		{ delete runs; }
+
+int
+PageDecoder::decodeNextByte()
+{
+    raiseRTC();
+    return (0);
+}
+
+/*
+ * Decode up to h rows into raster and return
+ * the number of rows decoded.
+ */
+u_int
+PageDecoder::decodePage(const u_char* data, u_long cc, u_char* raster,
+    u_int w, u_int h, u_int fillorder, bool is2D, bool isG4)
+{
+    u_int rowbytes = howmany(w, 8);
+    memset(raster, 0, rowbytes*h);
+    setupDecoder(fillorder, is2D, isG4);
+    setRuns(runs, runs+nruns, w);
+    setInput((u_char*) data, cc);
+    u_int row = 0;
+    if (!RTCraised()) {
+	while (row < h) {
+	    (void) decodeRow(raster + row*rowbytes, w);
+	    if (seenRTC())
+		break;
+	    row++;
+	}
+    }
+    return (row);
+}
+
+/*
+ * The G3 encoder before spans were found a word at a time.
+ * It is unchanged but for one fix: 1-D rows left the raster
+ * pointer on the last byte of a row whose width is not a
+ * multiple of 8, so every following row was encoded from
+ * the wrong pixels.
+ */
+class RefEncoder {
+private:
+    bool	is2D;		// data is to be 1d/2d-encoded
+    bool	isG4;		// data is to be G4-encoded
+    bool	firstEOL;	// first EOL is not byte-aligned
+    const u_char* bitmap;	// bit reversal table
+    short	data;		// current input/output byte
+    short	bit;		// current bit in input/output byte
+    fxStackBuffer& buf;
+
+    static const u_char zeroruns[256];
+    static const u_char oneruns[256];
+
+    static int findspan(const u_char**, int, int, const u_char*);
+    static int find0span(const u_char*, int, int);
+    static int find1span(const u_char*, int, int);
+
+    void	putBits(u_int bits, u_int length);
+    void	putcode(const tableentry& te);
+    void	putspan(int span, const tableentry* tab);
+    void	flushBits();
+public:
+    RefEncoder(fxStackBuffer&);
+    virtual ~RefEncoder();
+
+    void	setupEncoder(u_int fillOrder, bool, bool);
+    void	encode(const void* raster, u_int w, u_int h, u_char* rp = NULL);
+    void	encoderCleanup();
+};
+
+RefEncoder::RefEncoder(fxStackBuffer& b) : buf(b) {}
+RefEncoder::~RefEncoder() {}
+
+/*
+ * Reset encoding state.
+ */
+void
+RefEncoder::setupEncoder(u_int fillOrder, bool is2d, bool isg4)
+{
+    is2D = is2d;
+    isG4 = isg4;
+    /*
+     * G3-encoded data is generated in MSB2LSB bit order, so we
+     * need to bit reverse only if the desired order is different.
+     */
+    bitmap = TIFFGetBitRevTable(fillOrder != FILLORDER_MSB2LSB);
+    data = 0;
+    bit = 8;
+    firstEOL = true;
+}
+
+/*
+ * Flush 8-bits of encoded data to the output buffer.
+ */
+inline void
+RefEncoder::flushBits()
+{
+    buf.put(bitmap[data]);
+    data = 0;
+    bit = 8;
+}
+
+static const tableentry horizcode =
+    { 3, 0x1 };		/* 001 */
+static const tableentry passcode =
+    { 4, 0x1 };		/* 0001 */
+static const tableentry vcodes[7] = {   
+    { 7, 0x03 },	/* 0000 011 */
+    { 6, 0x03 },	/* 0000 11 */
+    { 3, 0x03 },	/* 011 */
+    { 1, 0x1 },		/* 1 */
+    { 3, 0x2 },		/* 010 */
+    { 6, 0x02 },	/* 0000 10 */
+    { 7, 0x02 }		/* 0000 010 */  
+};
+
+#define isAligned(p,t)  ((((u_long)(p)) & (sizeof (t)-1)) == 0)
+
+/*
+ * Find a span of ones or zeros using the supplied
+ * table.  The byte-aligned start of the bit string
+ * is supplied along with the start+end bit indices.
+ * The table gives the number of consecutive ones or
+ * zeros starting from the msb and is indexed by byte
+ * value.
+ */
+int
+RefEncoder::findspan(const u_char** bpp, int bs, int be, const u_char* tab)
+{
+    const u_char *bp = *bpp;
+    int bits = be - bs;
+    int n, span;
+
+    /*
+     * Check partial byte on lhs.
+     */
+    if (bits > 0 && (n = (bs & 7))) {
+	span = tab[(*bp << n) & 0xff];
+	if (span > 8-n)        /* table value too generous */
+	    span = 8-n;
+	if (span > bits)	/* constrain span to bit range */
+	    span = bits;
+	if (n+span < 8)        /* doesn't extend to edge of byte */
+	    goto done;
+	bits -= span;
+	bp++;
+    } else
+	span = 0;
+    /*
+     * Scan full bytes for all 1's or all 0's.
+     */
+    while (bits >= 8) {
+	n = tab[*bp];
+	span += n;
+	bits -= n;
+	if (n < 8)        /* end of run */
+	    goto done;
+	bp++;
+    }
+    /*
+     * Check partial byte on rhs.
+     */
+    if (bits > 0) {
+	n = tab[*bp];
+	span += (n > bits ? bits : n);
+    }
+done:
+    *bpp = bp;
+    return (span);
+}
+
+/*
+ * Find a span of ones or zeros using the supplied
+ * table.  The ``base'' of the bit string is supplied
+ * along with the start+end bit indices.
+ */
+int
+RefEncoder::find0span(const u_char* bp, int bs, int be)
+{
+	int32 bits = be - bs;
+	int32 n, span;
+
+	bp += bs>>3;
+	/*
+	 * Check partial byte on lhs.
+	 */
+	if (bits > 0 && (n = (bs & 7))) {
+		span = zeroruns[(*bp << n) & 0xff];
+		if (span > 8-n)		/* table value too generous */
+			span = 8-n;
+		if (span > bits)	/* constrain span to bit range */
+			span = bits;
+		if (n+span < 8)		/* doesn't extend to edge of byte */
+			return (span);
+		bits -= span;
+		bp++;
+	} else
+		span = 0;
+	if ((uint32) bits >= 2*8*sizeof (long)) {
+		long* lp;
+		/*
+		 * Align to longword boundary and check longwords.
+		 */
+		while (!isAligned(bp, long)) {
+			if (*bp != 0x00)
+				return (span + zeroruns[*bp]);
+			span += 8, bits -= 8;
+			bp++;
+		}
+		lp = (long*) bp;
+		while ((uint32) bits >= 8*sizeof (long) && *lp == 0) {
+			span += 8*sizeof (long), bits -= 8*sizeof (long);
+			lp++;
+		}
+		bp = (u_char*) lp;
+	}
+	/*
+	 * Scan full bytes for all 0's.
+	 */
+	while (bits >= 8) {
+		if (*bp != 0x00)	/* end of run */
+			return (span + zeroruns[*bp]);
+		span += 8, bits -= 8;
+		bp++;
+	}
+	/*
+	 * Check partial byte on rhs.
+	 */
+	if (bits > 0) {
+		n = zeroruns[*bp];
+		span += (n > bits ? bits : n);
+	}
+	return (span);
+}
+
+int
+RefEncoder::find1span(const u_char* bp, int bs, int be)
+{
+	int32 bits = be - bs;
+	int32 n, span;
+
+	bp += bs>>3;
+	/*
+	 * Check partial byte on lhs.
+	 */
+	if (bits > 0 && (n = (bs & 7))) {
+		span = oneruns[(*bp << n) & 0xff];
+		if (span > 8-n)		/* table value too generous */
+			span = 8-n;
+		if (span > bits)	/* constrain span to bit range */
+			span = bits;
+		if (n+span < 8)		/* doesn't extend to edge of byte */
+			return (span);
+		bits -= span;
+		bp++;
+	} else
+		span = 0;
+	if ((uint32) bits >= 2*8*sizeof (long)) {
+		long* lp;
+		/*
+		 * Align to longword boundary and check longwords.
+		 */
+		while (!isAligned(bp, long)) {
+			if (*bp != 0xff)
+				return (span + oneruns[*bp]);
+			span += 8, bits -= 8;
+			bp++;
+		}
+		lp = (long*) bp;
+		while ((uint32) bits >= 8*sizeof (long) && *lp == ~0) {
+			span += 8*sizeof (long), bits -= 8*sizeof (long);
+			lp++;
+		}
+		bp = (u_char*) lp;
+	}
+	/*
+	 * Scan full bytes for all 1's.
+	 */
+	while (bits >= 8) {
+		if (*bp != 0xff)	/* end of run */
+			return (span + oneruns[*bp]);
+		span += 8, bits -= 8;
+		bp++;
+	}
+	/*
+	 * Check partial byte on rhs.
+	 */
+	if (bits > 0) {
+		n = oneruns[*bp];
+		span += (n > bits ? bits : n);
+	}
+	return (span);
+}
+
+/*
+ * Write a code to the output stream.
+ */
+inline void
+RefEncoder::putcode(const tableentry& te)
+{
+    putBits(te.code, te.length);
+}
+
+/*
+ * Return the offset of the next bit in the range
+ * [bs..be] that is different from the specified
+ * color.  The end, be, is returned if no such bit
+ * exists.
+ */
+#define finddiff(_cp, _bs, _be, _color) \
+	(_bs + (_color ? find1span(_cp,_bs,_be) : find0span(_cp,_bs,_be)))
+
+/*
+ * Like finddiff, but also check the starting bit
+ * against the end in case start > end. 
+ */
+#define finddiff2(_cp, _bs, _be, _color) \
+	(_bs < _be ? finddiff(_cp,_bs,_be,_color) : _be)
+
+/*
+ * Encode a multi-line raster.  For MH and MR we can do everything with
+ * 1D-data, if desired, inserting the appropriate tag bits in MR.  For 
+ * MMR we must do everything with 2D-data, thus when coding 2D-data a 
+ * reference line, rp, is required.
+ */
+void
+RefEncoder::encode(const void* vp, u_int w, u_int h, u_char* rp)
+{
+#define PIXEL(buf,ix)   ((((buf)[(ix)>>3]) >> (7-((ix)&7))) & 1)
+    u_int rowbytes = howmany(w, 8);
+    const u_char* bp = (const unsigned char*) vp;
+
+    while (h-- > 0) {
+	if (!isG4) {						// put the EOL
+	    if( firstEOL )					// according to T.4 first EOL 
+		firstEOL = false;				// should not be aligned
+	    else if (bit != 4)
+		putBits(0, (bit < 4) ? bit+4 : bit-4);		// byte-align other EOLs
+	    if (is2D)
+		if (rp)
+		    putBits((EOL<<1)|0, 12+1);			// T.4 4.2.2
+		else
+		    putBits((EOL<<1)|1, 12+1);
+	    else
+		putBits(EOL, 12);
+	}
+	if (rp) {						// 2-D line
+	    uint32 a0 = 0;
+	    uint32 a1 = (PIXEL(bp, 0) != 0 ? 0 : finddiff(bp, 0, w, 0));
+	    uint32 b1 = (PIXEL(rp, 0) != 0 ? 0 : finddiff(rp, 0, w, 0));
+	    uint32 a2, b2;
+	    for (;;) {
+		b2 = finddiff2(rp, b1, w, PIXEL(rp,b1));
+		if (b2 >= a1) {
+		    int32 d = b1 - a1;
+		    if (!(-3 <= d && d <= 3)) {		/* horizontal mode */
+			a2 = finddiff2(bp, a1, w, PIXEL(bp,a1));
+			putcode(horizcode);
+			if (a0+a1 == 0 || PIXEL(bp, a0) == 0) {
+			    putspan(a1-a0, TIFFFaxWhiteCodes);
+			    putspan(a2-a1, TIFFFaxBlackCodes);
+			} else {
+			    putspan(a1-a0, TIFFFaxBlackCodes);
+			    putspan(a2-a1, TIFFFaxWhiteCodes);
+			}
+			a0 = a2;
+		    } else {				/* vertical mode */
+			putcode(vcodes[d+3]);
+			a0 = a1;
+		    }
+		} else {				/* pass mode */
+		    putcode(passcode);
+		    a0 = b2;
+		}
+		if (a0 >= w)
+		    break;
+		a1 = finddiff(bp, a0, w, PIXEL(bp,a0));
+		b1 = finddiff(rp, a0, w, !PIXEL(bp,a0));
+		b1 = finddiff(rp, b1, w, PIXEL(bp,a0));
+	    }
+	    memcpy(rp, bp, rowbytes);
+	    bp += rowbytes;					// advance raster row
+	} else {						// 1-D line
+	    const u_char* rowp = bp;
+	    int bs = 0, span;
+	    for (;;) {
+		span = findspan(&bp, bs, w, zeroruns);		// white span
+		putspan(span, TIFFFaxWhiteCodes);
+		bs += span;
+		if ((u_int) bs >= w)
+		    break;
+		span = findspan(&bp, bs, w, oneruns);		// black span
+		putspan(span, TIFFFaxBlackCodes);
+		bs += span;
+		if ((u_int) bs >= w)
+		    break;
+	    }
+	    bp = rowp + rowbytes;				// advance raster row
+	}
+    }
+#undef PIXEL
+}
+
+void
+RefEncoder::encoderCleanup()
+{
+    if (isG4) {
+	putBits(EOL, 12);
+	putBits(EOL, 12);
+    }
+    if (bit != 8)					// flush partial byte
+	flushBits();
+}
+
+/*
+ * Write the sequence of codes that describes
+ * the specified span of zero's or one's.  The
+ * appropriate table that holds the make-up and
+ * terminating codes is supplied.
+ */
+void
+RefEncoder::putspan(int span, const tableentry* tab)
+{
+    while (span >= 2624) {
+	const tableentry& te = tab[63 + (2560>>6)];
+	putcode(te);
+	span -= te.runlen;
+    }
+    if (span >= 64) {
+	const tableentry& te = tab[63 + (span>>6)];
+	putcode(te);
+	span -= te.runlen;
+    }
+    putcode(tab[span]);
+}
+
+/*
+ * Write a variable-length bit-value to the output
+ * stream. Values are assumed to be at most 16 bits.
+ */
+void
+RefEncoder::putBits(u_int bits, u_int length)
+{
+    static const u_int mask[9] =
+	{ 0x00, 0x01, 0x03, 0x07, 0x0f, 0x1f, 0x3f, 0x7f, 0xff };
+
+    while (length > (u_short) bit) {
+	data |= bits >> (length - bit);
+	length -= bit;
+	flushBits();
+    }
+    data |= (bits & mask[length]) << (bit - length);
+    bit -= length;
+    if (bit == 0)
+	flushBits();
+}
+
+const u_char RefEncoder::zeroruns[256] = {
+    8, 7, 6, 6, 5, 5, 5, 5, 4, 4, 4, 4, 4, 4, 4, 4,    /* 0x00 - 0x0f */
+    3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3,    /* 0x10 - 0x1f */
+    2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2,    /* 0x20 - 0x2f */
+    2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2,    /* 0x30 - 0x3f */
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,    /* 0x40 - 0x4f */
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,    /* 0x50 - 0x5f */
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,    /* 0x60 - 0x6f */
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,    /* 0x70 - 0x7f */
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,    /* 0x80 - 0x8f */
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,    /* 0x90 - 0x9f */
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,    /* 0xa0 - 0xaf */
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,    /* 0xb0 - 0xbf */
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,    /* 0xc0 - 0xcf */
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,    /* 0xd0 - 0xdf */
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,    /* 0xe0 - 0xef */
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,    /* 0xf0 - 0xff */
+};
+const u_char RefEncoder::oneruns[256] = {
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,    /* 0x00 - 0x0f */
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,    /* 0x10 - 0x1f */
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,    /* 0x20 - 0x2f */
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,    /* 0x30 - 0x3f */
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,    /* 0x40 - 0x4f */
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,    /* 0x50 - 0x5f */
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,    /* 0x60 - 0x6f */
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,    /* 0x70 - 0x7f */
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,    /* 0x80 - 0x8f */
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,    /* 0x90 - 0x9f */
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,    /* 0xa0 - 0xaf */
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,    /* 0xb0 - 0xbf */
+    2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2,    /* 0xc0 - 0xcf */
+    2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2,    /* 0xd0 - 0xdf */
+    3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3,    /* 0xe0 - 0xef */
+    4, 4, 4, 4, 4, 4, 4, 4, 5, 5, 5, 5, 6, 6, 7, 8,    /* 0xf0 - 0xff */
+};
+
+/*
+ * Encode a raster in the specified format.  MR data
+ * uses a 1-D line every fourth row as is done when
+ * converting received data for transmission.
+ */
+template <class Encoder> static void
+encodePage(fxStackBuffer& result, const u_char* raster, u_int w, u_int h,
+    u_int fillorder, u_int df)
+{
+    u_int rowbytes = howmany(w, 8);
+    u_char* refrow = new u_char[rowbytes];
+    memset(refrow, 0, rowbytes);
+    result.reset();
+    Encoder enc(result);
+    enc.setupEncoder(fillorder, df != 0, df == 2);
+    if (df == 2)
+	enc.encode(raster, w, h, refrow);
+    else if (df == 1) {
+	for (u_int row = 0; row < h; row++) {
+	    if (row % 4)
+		enc.encode(raster + row*rowbytes, w, 1, refrow);
+	    else {
+		enc.encode(raster + row*rowbytes, w, 1);
+		memcpy(refrow, raster + row*rowbytes, rowbytes);
+	    }
+	}
+    } else
+	enc.encode(raster, w, h);
+    enc.encoderCleanup();
+    delete refrow;
+}
+
+static void
+writePage(TIFF* out, const fxStackBuffer& data, u_int w, u_int h,
+    u_int fillorder, u_int df)
+{
+    TIFFSetField(out, TIFFTAG_SUBFILETYPE, FILETYPE_PAGE);
+    TIFFSetField(out, TIFFTAG_IMAGEWIDTH, (uint32) w);
+    TIFFSetField(out, TIFFTAG_IMAGELENGTH, (uint32) h);
+    TIFFSetField(out, TIFFTAG_BITSPERSAMPLE, 1);
+    TIFFSetField(out, TIFFTAG_SAMPLESPERPIXEL, 1);
+    TIFFSetField(out, TIFFTAG_PLANARCONFIG, PLANARCONFIG_CONTIG);
+    TIFFSetField(out, TIFFTAG_PHOTOMETRIC, PHOTOMETRIC_MINISWHITE);
+    TIFFSetField(out, TIFFTAG_FILLORDER, fillorder);
+    TIFFSetField(out, TIFFTAG_ROWSPERSTRIP, (uint32) h);
+    if (df == 2)
+	TIFFSetField(out, TIFFTAG_COMPRESSION, COMPRESSION_CCITTFAX4);
+    else {
+	TIFFSetField(out, TIFFTAG_COMPRESSION, COMPRESSION_CCITTFAX3);
+	TIFFSetField(out, TIFFTAG_GROUP3OPTIONS,
+	    (uint32) (df == 1 ? GROUP3OPT_2DENCODING : 0));
+    }
+    TIFFWriteRawStrip(out, 0, (tdata_t) (const u_char*) data, data.getLength());
+    TIFFWriteDirectory(out);
+}
+
+static double
+now()
+{
+    struct timeval tv;
+    gettimeofday(&tv, 0);
+    return (tv.tv_sec + tv.tv_usec / 1000000.);
+}
+
+static const char* formats[3] = { "MH", "MR", "MMR" };
+
+/*
+ * Check the encoded data against that of the reference
+ * encoder and against the raster it was encoded from.
+ * Return why the data is wrong or NULL if it is not.
+ */
+static const char*
+checkPage(PageDecoder& dec, fxStackBuffer& result, const fxStackBuffer& ref,
+    const u_char* raster, u_char* check, u_int w, u_int h,
+    u_int fillorder, u_int df)
+{
+    if (result.getLength() != ref.getLength() ||
+      memcmp((const u_char*) result, (const u_char*) ref, ref.getLength()) != 0)
+	return (_(" (DIFFERS FROM REFERENCE)"));
+    /*
+     * Pad the data so that the decoder does not run
+     * out of bits while decoding the last row.
+     */
+    result.put((u_char) 0);
+    result.put((u_char) 0);
+    u_int n = dec.decodePage((const u_char*) result,
+	result.getLength(), check, w, h, fillorder, df != 0, df == 2);
+    if (n != h || memcmp(raster, check, howmany(w, 8)*h) != 0)
+	return (_(" (DECODED DATA DIFFERS)"));
+    return (NULL);
+}
+
+/*
+ * Check rasters of pseudo-random runs that are 1 to 64
+ * pixels wide, and some of about a page width, in all
+ * data formats and both fill orders.  Return the number
+ * of failures.
+ */
+static u_int
+checkWidths()
+{
+    static const u_int pagewidths[] = { 1727, 1728, 1729, 1735, 2431, 2433 };
+    const u_int nwidths = 64 + sizeof (pagewidths) / sizeof (pagewidths[0]);
+    const u_int h = 16;
+    u_int errors = 0;
+
+    srandom(1);
+    for (u_int i = 0; i < nwidths; i++) {
+	u_int w = (i < 64 ? i+1 : pagewidths[i-64]);
+	u_int rowbytes = howmany(w, 8);
+	u_char* raster = new u_char[rowbytes*h];
+	u_char* check = new u_char[rowbytes*h];
+	memset(raster, 0, rowbytes*h);
+	for (u_int row = 0; row < h; row++) {
+	    u_char* rp = raster + row*rowbytes;
+	    u_int color = random() & 1;
+	    for (u_int x = 0; x < w; color ^= 1) {
+		u_int run = 1 + random() % ((random() & 1) ? 4 : 64);
+		for (; run > 0 && x < w; run--, x++)
+		    if (color)
+			rp[x>>3] |= 0x80 >> (x&7);
+	    }
+	}
+	PageDecoder dec(w);
+	for (u_int fillorder = FILLORDER_MSB2LSB; fillorder <= FILLORDER_LSB2MSB; fillorder++)
+	    for (u_int df = 0; df < 3; df++) {
+		fxStackBuffer result, ref;
+		encodePage<G3Encoder>(result, raster, w, h, fillorder, df);
+		encodePage<RefEncoder>(ref, raster, w, h, fillorder, df);
+		const char* why = checkPage(dec, result, ref, raster, check,
+		    w, h, fillorder, df);
+		if (why) {
+		    printf(_("%u pixels wide, fill order %u, %s:%s\n"),
+			w, fillorder, formats[df], why);
+		    errors++;
+		}
+	    }
+	delete raster;
+	delete check;
+    }
+    printf(_("%u synthetic raster widths checked, %u failures\n"),
+	nwidths, errors);
+    return (errors);
+}
+
+int
+main(int argc, char* argv[])
+{
+    extern int optind;
+    extern char* optarg;
+    u_int passes = 10;
+    const char* output = NULL;
+    int c;
+
+    NLS::Setup("hylafax-server");
+    appName = argv[0];
+    while ((c = Sys::getopt(argc, argv, "n:o:")) != -1)
+	switch (c) {
+	case 'n':
+	    passes = atoi(optarg);
+	    break;
+	case 'o':
+	    output = optarg;
+	    break;
+	case '?':
+	    usage();
+	    /*NOTREACHED*/
+	}
+    if (passes == 0)
+	usage();
+    TIFF* out = NULL;
+    if (output && !(out = TIFFOpen(output, "w")))
+	fatal(_("%s: Cannot create TIFF file"), output);
+
+    u_long rows[3];
+    double encTime[3], refTime[3];
+    for (u_int i = 0; i < 3; i++)
+	rows[i] = 0, encTime[i] = 0, refTime[i] = 0;
+    u_int errors = checkWidths();
+    for (; optind < argc; optind++) {
+	const char* name = argv[optind];
+	TIFF* tif = TIFFOpen(name, "r");
+	if (!tif)
+	    fatal(_("%s: Cannot open, or not a TIFF file"), name);
+	u_int page = 0;
+	do {
+	    page++;
+	    uint16 comp;
+	    TIFFGetField(tif, TIFFTAG_COMPRESSION, &comp);
+	    if (comp != COMPRESSION_CCITTFAX3 && comp != COMPRESSION_CCITTFAX4) {
+		printf(_("%s page %u: Not Group 3 or Group 4-encoded, skipped\n"),
+		    name, page);
+		continue;
+	    }
+	    if (TIFFNumberOfStrips(tif) != 1) {
+		printf(_("%s page %u: Multiple strips, skipped\n"), name, page);
+		continue;
+	    }
+	    uint32 w, h, opts = 0;
+	    uint16 fillorder;
+	    TIFFGetField(tif, TIFFTAG_IMAGEWIDTH, &w);
+	    TIFFGetField(tif, TIFFTAG_IMAGELENGTH, &h);
+	    TIFFGetField(tif, TIFFTAG_GROUP3OPTIONS, &opts);
+	    TIFFGetFieldDefaulted(tif, TIFFTAG_FILLORDER, &fillorder);
+	    bool isG4 = (comp == COMPRESSION_CCITTFAX4);
+	    bool is2D = isG4 || (opts & GROUP3OPT_2DENCODING);
+
+	    tiff_bytecount_t* stripbytecount;
+	    (void) TIFFGetField(tif, TIFFTAG_STRIPBYTECOUNTS, &stripbytecount);
+	    u_long totbytes = (u_long) stripbytecount[0];
+	    if (totbytes == 0)
+		continue;
+	    u_char* data = new u_char[totbytes];
+	    if (TIFFReadRawStrip(tif, 0, data, totbytes) < 0) {
+		delete data;
+		continue;
+	    }
+	    u_int rowbytes = howmany(w, 8);
+	    u_char* raster = new u_char[rowbytes*h];
+	    u_char* check = new u_char[rowbytes*h];
+	    PageDecoder dec(w);
+	    u_int n = dec.decodePage(data, totbytes, raster, w, h,
+		fillorder, is2D, isG4);
+
+	    printf(_("%s page %u: %lux%lu, %u rows:"),
+		name, page, (u_long) w, (u_long) h, n);
+	    for (u_int df = 0; df < 3; df++) {
+		fxStackBuffer result, ref;
+		double t = now();
+		for (u_int i = 0; i < passes; i++)
+		    encodePage<G3Encoder>(result, raster, w, n, fillorder, df);
+		t = now() - t;
+		double rt = now();
+		for (u_int i = 0; i < passes; i++)
+		    encodePage<RefEncoder>(ref, raster, w, n, fillorder, df);
+		rt = now() - rt;
+		u_long cc = result.getLength();
+		if (out)
+		    writePage(out, result, w, n, fillorder, df);
+		const char* why = checkPage(dec, result, ref, raster, check,
+		    w, n, fillorder, df);
+		if (why)
+		    errors++;
+		printf(_(" %s %lu bytes %.0f rows/sec (reference %.0f)%s"),
+		    formats[df], cc, t > 0 ? n*passes / t : 0.,
+		    rt > 0 ? n*passes / rt : 0., why ? why : "");
+		rows[df] += n*passes;
+		encTime[df] += t;
+		refTime[df] += rt;
+	    }
+	    putchar('\n');
+	    delete raster;
+	    delete check;
+	    delete data;
+	} while (TIFFReadDirectory(tif));
+	TIFFClose(tif);
+    }
+    if (out)
+	TIFFClose(out);
+    for (u_int i = 0; i < 3; i++)
+	if (rows[i] && encTime[i] > 0 && refTime[i] > 0)
+	    printf(_("%s: %.0f rows/sec, reference %.0f rows/sec\n"),
+		formats[i], rows[i] / encTime[i], rows[i] / refTime[i]);
+    return (errors ? 1 : 0);
+}
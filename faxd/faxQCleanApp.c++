@@ -150,6 +150,7 @@ faxQCleanApp::scanDirectory(void)
 	    if (flock(fd, LOCK_SH|LOCK_NB) >= 0) {
 		FaxRequest* req = new FaxRequest(filename, fd);
 		bool reject;
+		bool removed = false;
 		if (req->readQFile(reject) && !reject) {
 		    if (now - sb.st_mtime < minJobAge) {
 			/*
@@ -173,8 +174,10 @@ faxQCleanApp::scanDirectory(void)
 				, (const char*) req->doneop
 				, nowork ? _(" (not done)") : ""
 			    );
-			if (!nowork)
+			if (!nowork) {
 			    archiveJob(*req);
+			    removed = true;
+			}
 		    } else {
 			if (verbose)
 			    printf(_("JOB %s: remove (%s) %s.\n")
@@ -183,7 +186,7 @@ faxQCleanApp::scanDirectory(void)
 				, nowork ? _(" (not done)") : ""
 			    );
 			if (!nowork)
-			    Sys::unlink(req->qfile);
+			    removed = (Sys::unlink(req->qfile) >= 0);
 		    }
 		} else {
 		    /*
@@ -197,9 +200,15 @@ faxQCleanApp::scanDirectory(void)
 			printf(_("%s: malformed queue file: remove\n"),
 			    (const char*) filename);
 		    if (!nowork)
-			Sys::unlink(filename);
+			removed = (Sys::unlink(filename) >= 0);
 		}
 		delete req;			// NB: implicit close+unlock
+		/*
+		 * Tell the scheduler so it can bring its job
+		 * status index up to date.
+		 */
+		if (removed)
+		    (void) sendQueuer("I%s", &dp->d_name[1]);
 	    } else {
 		if (verbose)
 		    printf("%s: flock(LOCK_SH|LOCK_NB): %s\n",
@@ -30,7 +30,12 @@
 #include <math.h>
 #include <limits.h>
 #include <sys/file.h>
+#include <sys/time.h>
+#include <signal.h>
 #include <tiffio.h>
+#if HAS_PTHREAD
+#include <pthread.h>
+#endif
 
 #include "Dispatcher.h"
 
@@ -47,6 +52,7 @@
 #include "Trigger.h"
 #include "faxQueueApp.h"
 #include "HylaClient.h"
+#include "StrArray.h"
 #include "MemoryDecoder.h"
 #include "FaxSendInfo.h"
 #include "config.h"
@@ -73,6 +79,7 @@ faxQueueApp::SchedTimeout::~SchedTimeout() {}
 void
 faxQueueApp::SchedTimeout::timerExpired(long, long)
 {
+    pending = false;			// NB: else later pokes are lost
     if (faxQueueApp::instance().scheduling() ) {
     	start(0);
 	return;
@@ -158,6 +165,10 @@ void
 faxQueueApp::open()
 {
     faxApp::open();
+    preparePool.start();		// fork workers while we are small
+    if (jobIndexSize > 0 && !jobIndex.create(FAX_JOBINDEX, jobIndexSize))
+	logError("Unable to create job status index %s: %m", FAX_JOBINDEX);
+    documentCache.scan();
     scanQueueDirectory();
     Modem::broadcast("HELLO");		// announce queuer presence
     scanClientDirectory();		// announce queuer presence
@@ -198,9 +209,165 @@ faxQueueApp::scanForModems()
     closedir(dir);
 }
 
+/*
+ * A queue file read (possibly by a worker thread)
+ * during startup recovery, waiting to be submitted
+ * to the scheduler by the main thread.
+ */
+struct QueueFileEntry {
+    enum {
+	notRegular,		// not a regular file
+	openFailed,		// could not open file
+	lockFailed,		// could not lock file
+	parsed			// file was read (see req)
+    };
+    fxStr	jobid;
+    u_short	state;		// result of reading the file
+    int		err;		// errno for open/lock failure
+    bool	readOK;		// readQFile result
+    bool	reject;		// readQFile reject indicator
+    FaxRequest*	req;		// request read from the file
+
+    QueueFileEntry() : state(notRegular), err(0),
+	readOK(false), reject(false), req(NULL) {}
+    ~QueueFileEntry() { delete req; }
+
+    void read();
+    void relock();
+};
+
+/*
+ * Open, lock, and parse the queue file.  This does
+ * not touch any scheduler state and so may be done
+ * in parallel with other reads.
+ */
+void
+QueueFileEntry::read()
+{
+    fxStr filename(FAX_SENDDIR "/" FAX_QFILEPREF | jobid);
+    if (!Sys::isRegularFile(filename)) {
+	state = notRegular;
+	return;
+    }
+    int fd = Sys::open(filename, O_RDWR);
+    if (fd < 0) {
+	state = openFailed;
+	err = errno;
+	return;
+    }
+    if (flock(fd, LOCK_SH) < 0) {
+	state = lockFailed;
+	err = errno;
+	Sys::close(fd);
+	return;
+    }
+    state = parsed;
+    req = new FaxRequest(filename, fd);
+    readOK = req->readQFile(reject);
+}
+
+/*
+ * Reopen and lock the queue file of a request that
+ * was read and then released, without parsing it again.
+ */
+void
+QueueFileEntry::relock()
+{
+    int fd = Sys::open(req->qfile, O_RDWR);
+    if (fd < 0) {
+	state = openFailed;
+	err = errno;
+	return;
+    }
+    if (flock(fd, LOCK_SH) < 0) {
+	state = lockFailed;
+	err = errno;
+	Sys::close(fd);
+	return;
+    }
+    req->fd = fd;
+}
+
+#if HAS_PTHREAD
+/*
+ * Work shared by the queue file reader threads.
+ */
+struct QueueScan {
+    QueueFileEntry* entries;
+    u_int	next;		// next entry to be read
+    u_int	end;		// end of entries to be read
+    pthread_mutex_t lock;
+};
+
+static void*
+queueScanReader(void* arg)
+{
+    QueueScan& scan = *(QueueScan*) arg;
+    pthread_mutex_lock(&scan.lock);
+    while (scan.next < scan.end) {
+	/*
+	 * Claim a small batch of entries at a time to
+	 * keep lock traffic down when files are cached.
+	 */
+	u_int first = scan.next;
+	u_int last = fxmin(first + 16, scan.end);
+	scan.next = last;
+	pthread_mutex_unlock(&scan.lock);
+	for (u_int i = first; i < last; i++)
+	    scan.entries[i].read();
+	pthread_mutex_lock(&scan.lock);
+    }
+    pthread_mutex_unlock(&scan.lock);
+    return (NULL);
+}
+
+/*
+ * Read entries [first,end) using up to nthreads threads
+ * besides the caller and return the number of threads
+ * that could be started.  All threads have been joined
+ * on return.
+ */
+static u_int
+readQueueFiles(QueueFileEntry* entries, u_int first, u_int end, u_int nthreads)
+{
+    QueueScan scan;
+    scan.entries = entries;
+    scan.next = first;
+    scan.end = end;
+    pthread_mutex_init(&scan.lock, NULL);
+    /*
+     * Block signals in the readers so that
+     * they are always handled by the main thread.
+     */
+    sigset_t all, omask;
+    sigfillset(&all);
+    pthread_sigmask(SIG_SETMASK, &all, &omask);
+    pthread_t* threads = new pthread_t[nthreads];
+    u_int started = 0;
+    for (; started < nthreads; started++)
+	if (pthread_create(&threads[started], NULL, queueScanReader, &scan) != 0)
+	    break;
+    pthread_sigmask(SIG_SETMASK, &omask, NULL);
+    (void) queueScanReader(&scan);
+    for (u_int i = 0; i < started; i++)
+	pthread_join(threads[i], NULL);
+    delete [] threads;
+    pthread_mutex_destroy(&scan.lock);
+    return (started);
+}
+#endif
+
 /*
  * Scan the spool directory for queue files and
  * enter them in the queues of outgoing jobs.
+ *
+ * After a crash there may be a large backlog of jobs
+ * so the queue files are read and parsed by a pool of
+ * threads (see QueueRecoveryThreads).  Submitting a job
+ * may fork (e.g. to notify the submitter of a rejected
+ * job) so it is done only by the main thread and only
+ * once the readers have been joined: jobs are read a
+ * batch at a time and then the batch is submitted.
  */
 void
 faxQueueApp::scanQueueDirectory()
@@ -211,11 +378,53 @@ faxQueueApp::scanQueueDirectory()
 		(const char*)sendDir);
 	return;
     }
+    timeval start;
+    gettimeofday(&start, 0);
+    fxStrArray jobids;
     for (dirent* dp = readdir(dir); dp; dp = readdir(dir)) {
 	if (dp->d_name[0] == 'q')
-	    submitJob(&dp->d_name[1], true);
+	    jobids.append(&dp->d_name[1]);
     }
     closedir(dir);
+
+    u_int n = jobids.length();
+    if (n == 0)
+	return;
+    QueueFileEntry* entries = new QueueFileEntry[n];
+    for (u_int i = 0; i < n; i++)
+	entries[i].jobid = jobids[i];
+    u_int nsubmitted = 0;
+    u_int nthreads = (u_int) fxmin((u_long) queueRecoveryThreads, (u_long) n);
+    u_int batch = nthreads > 1 ? 64*nthreads : 1;
+    for (u_int first = 0; first < n; first += batch) {
+	u_int end = fxmin(first + batch, n);
+#if HAS_PTHREAD
+	if (nthreads > 1) {
+	    u_int started = readQueueFiles(entries, first, end, nthreads-1);
+	    if (started < nthreads-1) {
+		logError("Could only start %u of %u queue recovery threads",
+		    started+1, nthreads);
+		nthreads = started+1;
+	    }
+	} else
+#endif
+	for (u_int i = first; i < end; i++)
+	    entries[i].read();
+	for (u_int i = first; i < end; i++) {
+	    QueueFileEntry& e = entries[i];
+	    if (submitJob(e, true))
+		nsubmitted++;
+	    delete e.req, e.req = NULL;		// NB: unlock qfile
+	}
+    }
+    delete [] entries;
+
+    timeval end;
+    gettimeofday(&end, 0);
+    long ms = (end.tv_sec - start.tv_sec) * 1000
+	+ (end.tv_usec - start.tv_usec) / 1000;
+    logInfo("QUEUE: recovered %u of %u jobs in %ld ms (%lu jobs/sec)",
+	nsubmitted, n, ms, (u_long) (ms > 0 ? n*1000L/ms : n*1000L));
 }
 
 /*
@@ -436,6 +645,11 @@ void
 faxQueueApp::prepareStart(Batch& batch, Job& job, FaxRequest* req)
 {
     traceQueue(job, "PREPARE START");
+    if (preparePool.isEnabled()) {
+	delete req;			// worker rereads the qfile
+	preparePool.submit(batch, job);
+	return;
+    }
     abortPrepare = false;
     pid_t pid = fork();
     switch (pid) {
@@ -454,6 +668,7 @@ faxQueueApp::prepareStart(Batch& batch, Job& job, FaxRequest* req)
 	 */
 	signal(SIGTERM, fxSIGHANDLER(faxQueueApp::prepareCleanup));
 	signal(SIGINT, fxSIGHANDLER(faxQueueApp::prepareCleanup));
+	jobIndex.close();		// the scheduler maintains the index
 	_exit(prepareJob(job, *req, batch));
 	/*NOTREACHED*/
     case -1:				// fork failed, sleep and retry
@@ -522,6 +737,80 @@ faxQueueApp::prepareDone(Batch& batch, int status)
     fillBatch(batch);
 }
 
+/*
+ * Main loop of a job preparation worker (see PreparePool).
+ * Jobs are read from the scheduler and the status of each
+ * is written back until the scheduler closes the socket.
+ */
+void
+faxQueueApp::runPrepareWorker(int fd)
+{
+    signal(SIGTERM, fxSIGHANDLER(faxQueueApp::prepareCleanup));
+    signal(SIGINT, fxSIGHANDLER(faxQueueApp::prepareCleanup));
+    requestCache.setMaxEntries(0);	// the scheduler owns the qfiles
+    jobIndex.close();			// ...and the job status index
+    fxStr msg;
+    while (PreparePool::readMessage(fd, msg)) {
+	fxStr fields[4];
+	u_int pos = 0;
+	for (u_int i = 0; i < 4 && pos < msg.length(); i++) {
+	    u_int next = msg.next(pos, '\0');
+	    fields[i] = msg.extract(pos, next-pos);
+	    pos = next+1;
+	}
+	fxStr jci(pos < msg.length() ? msg.tail(msg.length()-pos) : fxStr::null);
+	abortPrepare = false;
+	int status = prepareWorkerJob(fields[0], fields[1],
+	    fields[2], fields[3], jci);
+	if (Sys::write(fd, (const char*) &status, sizeof (status)) != sizeof (status))
+	    break;
+    }
+}
+
+/*
+ * Prepare a job in a worker.  The job, modem, and
+ * destination information are reconstructed from what
+ * the scheduler sent and the qfile is read and locked
+ * as the scheduler would have done.
+ */
+JobStatus
+faxQueueApp::prepareWorkerJob(const fxStr& jobid, const fxStr& dest,
+    const fxStr& devid, const fxStr& caps, const fxStr& jci)
+{
+    fxStr file(FAX_SENDDIR "/" FAX_QFILEPREF | jobid);
+    int fd = Sys::open(file, O_RDWR);
+    if (fd < 0) {
+	logError("JOB %s: Could not open job file: %m", (const char*) jobid);
+	return (Job::requeued);
+    }
+    if (flock(fd, LOCK_EX) < 0) {
+	logError("JOB %s: Could not lock job file: %m", (const char*) jobid);
+	Sys::close(fd);
+	return (Job::requeued);
+    }
+    FaxRequest req(file, fd);
+    bool reject;
+    if (!req.readQFile(reject) || reject) {
+	logError("JOB %s: Could not read job file", (const char*) jobid);
+	return (Job::failed);
+    }
+    if (req.external == "")
+	req.external = dest;
+    Job job(req);
+    job.dest = dest;
+    if (devid != "") {
+	job.modem = &Modem::getModemByID(devid);
+	job.modem->setCapabilities(caps);
+    }
+    if (jci != "")
+	job.jci = new JobControlInfo(jci);
+    FaxMachineInfo info;
+    info.updateConfig(dest);
+    JobStatus status = prepareJob(job, req, info);
+    delete job.jci, job.jci = NULL;
+    return (status);
+}
+
 /*
  * Document Use Database.
  *
@@ -1158,6 +1447,29 @@ faxQueueApp::convertDocument(Job& job,
 	    jobError(job, "CONVERT DOCUMENT: %s: %m", result.string());
     } else {
 	(void) flock(fd, LOCK_EX);		// XXX check for errors?
+	/*
+	 * Check the content-addressed cache for a document
+	 * with the same contents imaged the same way.  The
+	 * scheduler is told the outcome so it can maintain
+	 * the cache index and statistics.
+	 */
+	const char* converter = "";
+	switch (req.op) {
+	case FaxRequest::send_postscript: converter = ps2faxCmd; break;
+	case FaxRequest::send_pdf:	  converter = pdf2faxCmd; break;
+	case FaxRequest::send_pcl:	  converter = pcl2faxCmd; break;
+	case FaxRequest::send_tiff:	  converter = tiff2faxCmd; break;
+	}
+	fxStr key;
+	u_long size = 0;
+	if (documentCacheSize > 0)
+	    key = DocumentCache::makeKey(req.item, converter, req.op, params,
+		job.getJCI().getMaxSendPages(), useUnlimitedLN);
+	if (key != "" && DocumentCache::fetch(key, outFile, size)) {
+	    sendJobStatus(job.jobid, "h%lu %s", size, (const char*) key);
+	    (void) Sys::close(fd);		// NB: implicit unlock
+	    return (Job::done);
+	}
 	/*
 	 * Imaged document does not exist, run the document converter
 	 * to generate it.  The converter is invoked according to:
@@ -1174,12 +1486,7 @@ faxQueueApp::convertDocument(Job& job,
 	fxStr mbuf = fxStr::format("%u", job.getJCI().getMaxSendPages());
 	const char* argv[30];
 	int ac = 0;
-	switch (req.op) {
-	case FaxRequest::send_postscript: argv[ac++] = ps2faxCmd; break;
-	case FaxRequest::send_pdf:	  argv[ac++] = pdf2faxCmd; break;
-	case FaxRequest::send_pcl:	  argv[ac++] = pcl2faxCmd; break;
-	case FaxRequest::send_tiff:	  argv[ac++] = tiff2faxCmd; break;
-	}
+	argv[ac++] = converter;
 	argv[ac++] = "-o"; argv[ac++] = outFile;
 	argv[ac++] = "-r"; argv[ac++] = (const char*)rbuf;
 	argv[ac++] = "-w"; argv[ac++] = (const char*)wbuf;
@@ -1222,9 +1529,14 @@ faxQueueApp::convertDocument(Job& job,
 		status = Job::format_failed;
 		result = Status(322, "Could not reopen converted document to verify format");
 	    }
-	    if (status == Job::done)	// discard any debugging output
+	    if (status == Job::done) {	// discard any debugging output
 		result.clear();
-	    else
+		if (key != "") {
+		    if (!DocumentCache::store(key, outFile, size))
+			size = 0;
+		    sendJobStatus(job.jobid, "m%lu %s", size, (const char*) key);
+		}
+	    } else
 		jobError(job, "CONVERT DOCUMENT: %s", result.string());
 	} else if (status == Job::rejected)
 	    jobError(job, "SEND REJECT: %s", result.string());
@@ -1996,10 +2308,16 @@ faxQueueApp::setPending(Job& job)
 {
     traceJob(job, "PENDING FOR %s", (const char*)strTime(job.tts - Sys::now()));
     Trigger::post(Trigger::JOB_SLEEP, job);
-    JobIter iter(pendq);
-    for (; iter.notDone() && iter.job().tts <= job.tts; iter++)
-	;
-    job.insert(iter.job());
+    /*
+     * Jobs mostly arrive in order of their tts (a batch
+     * all comes at once), so look for the place from the
+     * end of the queue; jobs with the same tts keep the
+     * order they were queued in.
+     */
+    QLink* ql = pendq.prev;
+    while (ql != &pendq && ((Job*) ql)->tts > job.tts)
+	ql = ql->prev;
+    job.insert(*ql->next);
     job.startTTSTimer(job.tts);
 }
 
@@ -2232,7 +2550,7 @@ faxQueueApp::suspendJob(Job& job, bool abortActive)
 	 * Unfortunately, faxq doesn't have a way to communicate this to
 	 * hfaxd - we just have to hope they can see the logs.
 	 */
-	if (job.pid == 0)
+	if (job.pid == 0 && !preparePool.isQueued(job))
 	{
 	    traceJob(job, "Cannot kill job that is batched but not active");
 	    return false;
@@ -2246,7 +2564,9 @@ faxQueueApp::suspendJob(Job& job, bool abortActive)
 	 * mistakenly terminate the job (see sendJobDone).
 	 */
 	job.suspendPending = true;		// mark thread waiting
-	if (abortActive)
+	if (job.pid == 0)			// still waiting for a worker
+	    (void) preparePool.cancel(job);
+	else if (abortActive)
 	    (void) kill(job.pid, SIGTERM);	// signal subprocess
 	job.stopKillTimer();
 	while (job.suspendPending)		// wait for subprocess to exit
@@ -2454,56 +2774,131 @@ faxQueueApp::submitJob(const fxStr& jobid, bool checkState)
      * Create a job from a queue file and add it
      * to the scheduling queues.
      */
-    fxStr filename(FAX_SENDDIR "/" FAX_QFILEPREF | jobid);
-    if (!Sys::isRegularFile(filename)) {
+    QueueFileEntry e;
+    e.jobid = jobid;
+    e.read();
+    return (submitJob(e, checkState));
+}
+
+/*
+ * Submit a contiguous block of new jobs written by a
+ * client in one batch.  The message arguments are the
+ * first job ID and the number of jobs.  The scheduler
+ * is run once for the whole batch rather than per job.
+ *
+ * Every queue file is read and checked before any job
+ * is submitted so that a bad batch is refused as a whole
+ * (the client then removes it).  The requests read are
+ * kept for submission; their files are closed in between
+ * so a large batch does not hold a descriptor per job.
+ * Once the batch has been accepted a job that fails to
+ * submit is dealt with as for any other job (e.g. it is
+ * rejected and its owner notified).
+ */
+bool
+faxQueueApp::submitJobBatch(const char* args)
+{
+    char* cp;
+    u_long first = strtoul(args, &cp, 10);
+    u_long count = strtoul(cp, &cp, 10);
+    if (first == 0 || count == 0 || *cp != '\0') {
+	logError("Bad batch submission \"%s\"", args);
+	return (false);
+    }
+    QueueFileEntry* batch = new QueueFileEntry[count];
+    u_long i;
+    for (i = 0; i < count; i++) {
+	QueueFileEntry& e = batch[i];
+	e.jobid = fxStr::format("%lu", first+i);
+	requestCache.invalidate(FAX_SENDDIR "/" FAX_QFILEPREF | e.jobid);
+	if (Job::getJobByID(e.jobid)) {
+	    logError("JOB %s: Batch job is already known to the scheduler.",
+		(const char*) e.jobid);
+	    break;
+	}
+	e.read();
+	if (e.state != QueueFileEntry::parsed || !e.readOK || e.reject ||
+	  e.req->state == FaxRequest::state_done ||
+	  e.req->state == FaxRequest::state_failed) {
+	    logError("JOB %s: Invalid job description file in batch.",
+		(const char*) e.jobid);
+	    break;
+	}
+	Sys::close(e.req->fd);			// NB: unlock qfile
+	e.req->fd = -1;
+    }
+    if (i < count) {
+	logError("Batch %lu-%lu refused; no jobs submitted.",
+	    first, first+count-1);
+	delete [] batch;
+	return (false);
+    }
+    for (i = 0; i < count; i++) {
+	QueueFileEntry& e = batch[i];
+	e.relock();
+	(void) submitJob(e);
+	delete e.req, e.req = NULL;		// NB: unlock qfile
+    }
+    delete [] batch;
+    return (true);
+}
+
+/*
+ * Submit a job whose queue file has been read.
+ */
+bool
+faxQueueApp::submitJob(QueueFileEntry& e, bool checkState)
+{
+    const fxStr& jobid = e.jobid;
+    switch (e.state) {
+    case QueueFileEntry::notRegular:
 	logError("JOB %s: qfile %s is not a regular file.",
-	    (const char*) jobid, (const char*) filename);
+	    (const char*) jobid, (const char*) (FAX_SENDDIR "/" FAX_QFILEPREF | jobid));
+	return (false);
+    case QueueFileEntry::openFailed:
+	logError("JOB %s: Could not open job file; %s.",
+	    (const char*) jobid, strerror(e.err));
+	return (false);
+    case QueueFileEntry::lockFailed:
+	logError("JOB %s: Could not lock job file; %s.",
+	    (const char*) jobid, strerror(e.err));
 	return (false);
     }
     bool status = false;
-    int fd = Sys::open(filename, O_RDWR);
-    if (fd >= 0) {
-	if (flock(fd, LOCK_SH) >= 0) {
-	    FaxRequest req(filename, fd);
-	    /*
-	     * There are four possibilities:
-	     *
-	     * 1. The queue file was read properly and the job
-	     *    can be submitted.
-	     * 2. There were problems reading the file, but
-	     *    enough information was obtained to purge the
-	     *    job from the queue.
-	     * 3. The job was previously submitted and completed
-	     *    (either with success or failure).
-	     * 4. Insufficient information was obtained to purge
-	     *    the job; just skip it.
-	     */
-	    bool reject;
-	    if (req.readQFile(reject) && !reject &&
-	      req.state != FaxRequest::state_done &&
-	      req.state != FaxRequest::state_failed) {
-		status = submitJob(req, checkState);
-	    } else if (reject) {
-		Job job(req);
-		job.state = FaxRequest::state_failed;
-		req.status = send_failed;
-		req.result = Status(326, "Invalid or corrupted job description file");
-		traceServer("JOB %s : %s", (const char*)jobid, req.result.string());
-		// NB: this may not work, but we try...
-		deleteRequest(job, req, Job::rejected, true);
-	    } else if (req.state == FaxRequest::state_done ||
-	      req.state == FaxRequest::state_failed) {
-		logError("JOB %s: Cannot resubmit a completed job",
-		    (const char*) jobid);
-	    } else
-		traceServer("%s: Unable to purge job, ignoring it",
-			(const char*)filename);
-	} else
-	    logError("JOB %s: Could not lock job file; %m.",
-		(const char*) jobid);
-	Sys::close(fd);
+    FaxRequest& req = *e.req;
+    /*
+     * There are four possibilities:
+     *
+     * 1. The queue file was read properly and the job
+     *    can be submitted.
+     * 2. There were problems reading the file, but
+     *    enough information was obtained to purge the
+     *    job from the queue.
+     * 3. The job was previously submitted and completed
+     *    (either with success or failure).
+     * 4. Insufficient information was obtained to purge
+     *    the job; just skip it.
+     */
+    if (e.readOK && !e.reject &&
+      req.state != FaxRequest::state_done &&
+      req.state != FaxRequest::state_failed) {
+	jobIndex.update(req);
+	status = submitJob(req, checkState);
+    } else if (e.reject) {
+	Job job(req);
+	job.state = FaxRequest::state_failed;
+	req.status = send_failed;
+	req.result = Status(326, "Invalid or corrupted job description file");
+	traceServer("JOB %s : %s", (const char*)jobid, req.result.string());
+	// NB: this may not work, but we try...
+	deleteRequest(job, req, Job::rejected, true);
+    } else if (req.state == FaxRequest::state_done ||
+      req.state == FaxRequest::state_failed) {
+	logError("JOB %s: Cannot resubmit a completed job",
+	    (const char*) jobid);
     } else
-	logError("JOB %s: Could not open job file; %m.", (const char*) jobid);
+	traceServer("%s: Unable to purge job, ignoring it",
+		(const char*)req.qfile);
     return (status);
 }
 
@@ -2590,6 +2985,21 @@ faxQueueApp::isJobSendOK (Job& job, FaxRequest* req)
     return true;
 }
 
+/*
+ * Return a key that identifies the set of modems that could
+ * service a job.  Jobs with the same key compete for the same
+ * modems, so once one of them finds no ready modem during a
+ * scheduler pass the others need not be considered either.
+ */
+static fxStr
+modemClassKey(const Job& job)
+{
+    return job.device
+	| "|" | job.getJCI().getModem()
+	| fxStr::format("|%d|%u|%u|%u", job.willpoll,
+	    job.pagewidth, job.pagelength, job.resolution);
+}
+
 /*
  * Scan the list of jobs and process those that are ready
  * to go.  Note that the scheduler should only ever be
@@ -2613,13 +3023,19 @@ faxQueueApp::runScheduler()
      * not be necessary to restart the process to have
      * config file changes take effect.
      */
-    (void) updateConfig(configFile);
+    if (updateConfig(configFile))
+	preparePool.configChanged();	// workers have a copy of the config
     /*
      * Scan the job queue and locate a compatible modem to
      * use in processing the job.  Doing things in this order
      * insures the highest priority job is always processed
      * first.
      */
+    timeval start;
+    gettimeofday(&start, 0);
+    u_int considered = 0;		// destinations looked at
+    u_int qfilesRead = 0;		// qfiles read from disk
+    fxStrDict unavailable;		// modem classes with no ready modem
     if (! quit) 
     {
 	for (QLink* ql = runq.next; ql != &runq; ql = ql->next)
@@ -2656,7 +3072,27 @@ faxQueueApp::runScheduler()
 
 	    fxAssert(job.tts <= Sys::now(), "Sleeping job on run queue");
 	    fxAssert(job.modem == NULL, "Job on run queue holding modem");
+	    considered++;
 
+	    /*
+	     * With indexed scheduling we don't touch the on-disk
+	     * job state unless some ready modem could take the job.
+	     * The runq is kept in priority order, so skipping jobs
+	     * here does not change the order of dispatch; the
+	     * result is remembered per modem class for the rest of
+	     * this pass since assigning modems only ever makes
+	     * fewer of them ready.
+	     */
+	    if (indexedScheduler) {
+		fxStr key(modemClassKey(job));
+		if (unavailable.find(key))
+		    continue;
+		if (! Modem::isReadyFor(job)) {
+		    traceJob(job, "No ready modem for job");
+		    unavailable[key] = "";
+		    continue;
+		}
+	    }
 
 	    /*
 	     * Read the on-disk job state and process the job.
@@ -2670,6 +3106,7 @@ faxQueueApp::runScheduler()
 	    traceJob(job, "PROCESS");
 	    Trigger::post(Trigger::JOB_PROCESS, job);
 	    FaxRequest* req = readRequest(job);
+	    qfilesRead++;
 	    if (!req) {			// problem reading job state on-disk
 		setDead(job);
 		continue;
@@ -2714,6 +3151,11 @@ faxQueueApp::runScheduler()
 		delete req;
 	}
     }
+    timeval end;
+    gettimeofday(&end, 0);
+    traceQueue("SCHEDULER: %u destinations considered, %u job files read in %ld ms",
+	considered, qfilesRead,
+	(end.tv_sec - start.tv_sec) * 1000 + (end.tv_usec - start.tv_usec) / 1000);
     /*
      * Reap dead jobs.
      */
@@ -2865,7 +3307,11 @@ faxQueueApp::pokeScheduler(u_short s)
 
 /*
  * Create a request instance and read the
- * associated queue file into it.
+ * associated queue file into it.  The file is
+ * only parsed if the contents are not already
+ * in the request cache.  Active jobs are being
+ * updated by a subprocess so the cache is not
+ * used for them.
  */
 FaxRequest*
 faxQueueApp::readRequest(Job& job)
@@ -2874,8 +3320,17 @@ faxQueueApp::readRequest(Job& job)
     if (fd >= 0) {
 	if (flock(fd, LOCK_EX) >= 0) {
 	    FaxRequest* req = new FaxRequest(job.file, fd);
-	    bool reject;
-	    if (req->readQFile(reject) && !reject) {
+	    bool cacheable = (job.state != FaxRequest::state_active);
+	    bool cached = cacheable && requestCache.lookup(*req);
+	    bool reject = false;
+	    if (cached || (req->readQFile(reject) && !reject)) {
+		if (!cached) {
+		    if (cacheable)
+			requestCache.update(*req);
+		    else
+			requestCache.invalidate(req->qfile);
+		}
+		jobIndex.update(*req);
 		if (req->external == "")
 		    req->external = job.dest;
 		return (req);
@@ -2893,6 +3348,37 @@ faxQueueApp::readRequest(Job& job)
     return (NULL);
 }
 
+/*
+ * Bring the job status index up to date for a job
+ * whose queue file a client has rewritten or removed
+ * (e.g. hfaxd deleting a job, or faxqclean expiring
+ * one from the doneq).  A file that is locked is being
+ * changed by someone who will tell us when they are done.
+ */
+void
+faxQueueApp::reindexJob(const char* jobid)
+{
+    static const char* dirs[] = { FAX_SENDDIR, FAX_DONEDIR };
+    for (u_int i = 0; i < sizeof (dirs) / sizeof (dirs[0]); i++) {
+	fxStr qfile(fxStr(dirs[i]) | "/" FAX_QFILEPREF | jobid);
+	int fd = Sys::open(qfile, O_RDWR);
+	if (fd < 0)
+	    continue;
+	if (flock(fd, LOCK_SH|LOCK_NB) < 0) {
+	    Sys::close(fd);
+	    return;
+	}
+	FaxRequest req(qfile, fd);		// NB: implicit close+unlock
+	bool reject;
+	if (req.readQFile(reject) && !reject) {
+	    jobIndex.update(req, true);
+	    return;
+	}
+	break;
+    }
+    jobIndex.remove(jobid);
+}
+
 /*
  * Update the request instance with information
  * from the job structure and then write the
@@ -2904,6 +3390,9 @@ faxQueueApp::updateRequest(FaxRequest& req, Job& job)
     req.state = job.state;
     req.pri = job.pri;
     req.writeQFile();
+    if (job.state != FaxRequest::state_active)
+	requestCache.update(req, true);
+    jobIndex.update(req, true);
 }
 
 /*
@@ -2921,6 +3410,7 @@ void
 faxQueueApp::deleteRequest(Job& job, FaxRequest& req, JobStatus why,
     bool force, const char* duration)
 {
+    requestCache.invalidate(req.qfile);
     fxStr dest = FAX_DONEDIR |
 	req.qfile.tail(req.qfile.length() - (sizeof (FAX_SENDDIR)-1));
     /*
@@ -2952,7 +3442,9 @@ faxQueueApp::deleteRequest(Job& job, FaxRequest& req, JobStatus why,
 	    req.state = FaxRequest::state_failed;// job is definitely done
 	req.pri = job.pri;			// just in case someone cares
 	req.tts = Sys::now();			// mark job termination time
+	req.binary = false;			// doneq is read by scripts
 	req.writeQFile();
+	jobIndex.update(req, true);
 	notifySender(job, why, duration);
     } else {
 	/*
@@ -3035,6 +3527,15 @@ void
 faxQueueApp::FIFOMessage(char cmd, const fxStr& id, const char* args)
 {
     bool status = false;
+    /*
+     * Job commands are sent by clients that may also have
+     * rewritten the job's queue file; drop any cached copy.
+     */
+    switch (cmd) {
+    case 'R': case 'K': case 'S': case 'X': case 'Y': case 'I':
+	requestCache.invalidate(fxStr(FAX_SENDDIR "/" FAX_QFILEPREF) | args);
+	break;
+    }
     switch (cmd) {
     case '+':				// modem status msg
 	FIFOModemMessage(id, args);
@@ -3062,6 +3563,8 @@ faxQueueApp::FIFOMessage(char cmd, const fxStr& id, const char* args)
     case 'C':				// configuration control
 	traceServer("CONFIG %s", args);
 	status = readConfigItem(args);
+	if (status)
+	    preparePool.configChanged();
 	break;
     case 'D':				// cancel an existing trigger
 	traceServer("DELETE %s", args);
@@ -3080,6 +3583,16 @@ faxQueueApp::FIFOMessage(char cmd, const fxStr& id, const char* args)
 	if (status = submitJob(args))
 	    pokeScheduler();
 	break;
+    case 'B':				// submit a batch of outbound jobs
+	traceServer("SUBMIT BATCH %s", args);
+	if (status = submitJobBatch(args))
+	    pokeScheduler();
+	break;
+    case 'I':				// re-index job
+	traceServer("REINDEX JOB %s", args);
+	reindexJob(args);
+	status = true;
+	break;
     case 'U':				// unreference file
 	traceServer("UNREF DOC %s", args);
 	unrefDoc(args);
@@ -3239,6 +3752,25 @@ faxQueueApp::FIFOJobMessage(const fxStr& jobid, const char* msg)
 	{ FaxSendInfo si; si.decode(msg+1); unrefDoc(si.qfile); }
 	Trigger::post(Trigger::SEND_DOC, *jp, msg+1);
 	break;
+    case 'h':			// imaged document found in cache
+    case 'm':			// document imaged (and maybe cached)
+	{
+	    char* cp;
+	    u_long size = strtoul(msg+1, &cp, 10);
+	    fxStr key(cp[0] == ' ' ? cp+1 : cp);
+	    if (msg[0] == 'h') {
+		documentCache.noteHit(key, size);
+		traceQueue(*jp, "DOC CACHE HIT: %lu bytes, %u hits, %u misses, "
+		    "%lu Kbytes saved", size, documentCache.hits,
+		    documentCache.misses, documentCache.bytesSaved/1024);
+	    } else {
+		documentCache.noteMiss(key, size);
+		traceQueue(*jp, "DOC CACHE MISS: %s, %u hits, %u misses",
+		    size ? "cached" : "not cached",
+		    documentCache.hits, documentCache.misses);
+	    }
+	}
+	break;
     case 'p':			// polled document received
 	Trigger::post(Trigger::SEND_POLLRCVD, *jp, msg+1);
 	break;
@@ -3337,11 +3869,17 @@ faxQueueApp::numbertag faxQueueApp::numbers[] = {
 { "maxdials",		&faxQueueApp::maxDials,		(u_int) FAX_REDIALS },
 { "jobreqother",	&faxQueueApp::requeueInterval,	FAX_REQUEUE },
 { "polllockwait",	&faxQueueApp::pollLockWait,	30 },
+{ "requestcachesize",	&faxQueueApp::requestCacheSize,	1024 },
+{ "queuerecoverythreads",	&faxQueueApp::queueRecoveryThreads, 4 },
+{ "documentcachesize",	&faxQueueApp::documentCacheSize, 32*1024 },
+{ "prepareworkers",	&faxQueueApp::prepareWorkers,	0 },
+{ "jobindexsize",	&faxQueueApp::jobIndexSize,	4096 },
 };
 
 faxQueueApp::booltag faxQueueApp::booleans[] = {
 { "use2d",		&faxQueueApp::use2D,		true },
 { "useunlimitedln",	&faxQueueApp::useUnlimitedLN,	true },
+{ "indexedscheduler",	&faxQueueApp::indexedScheduler,	false },
 };
 
 void
@@ -3362,6 +3900,9 @@ faxQueueApp::setupConfig()
     ModemGroup::set(MODEM_ANY, new RE(".*"));
     pageChop = FaxRequest::chop_last;
     pageChopThreshold = 3.0;		// minimum of 3" of white space
+    requestCache.setMaxEntries(requestCacheSize);
+    documentCache.setMaxSize(documentCacheSize);
+    preparePool.setMaxWorkers(prepareWorkers);
 }
 
 void
@@ -3447,6 +3988,10 @@ faxQueueApp::setConfigItem(const char* tag, const char* value)
 	    }
 	    break;
 	case 2: UUCPLock::setLockTimeout(uucpLockTimeout); break;
+	case 12: requestCache.setMaxEntries(requestCacheSize); break;
+	case 14: documentCache.setMaxSize(documentCacheSize); break;
+	case 15: preparePool.setMaxWorkers(prepareWorkers); break;
+	case 16: if (jobIndexSize == 0) jobIndex.close(); break;
 	}
     } else if (findTag(tag, (const tags*) booleans, N(booleans), ix)) {
 	(*this).*booleans[ix].p = getBoolean(value);
@@ -3825,6 +4370,23 @@ faxQueueApp::showDebugState(void)
 	traceJob(job, "In suspend queue");
     }
     traceServer("DEBUG: inSchedule: %s", inSchedule ? "YES" : "NO");
+    traceServer("DEBUG: request cache: %u of %u entries, %u hits, %u misses, "
+	"%u evictions, %u invalidations",
+	requestCache.size(), requestCache.getMaxEntries(),
+	requestCache.hits, requestCache.misses,
+	requestCache.evictions, requestCache.invalidations);
+    traceServer("DEBUG: document cache: %u files, %lu of %lu Kbytes, "
+	"%u hits, %u misses, %u evictions, %lu Kbytes saved",
+	documentCache.size(), documentCache.getTotalBytes()/1024,
+	documentCache.getMaxSize()/1024, documentCache.hits,
+	documentCache.misses, documentCache.evictions,
+	documentCache.bytesSaved/1024);
+    traceServer("DEBUG: prepare workers: %u of %u, %u queued, "
+	"%u jobs, %u started", preparePool.workerCount(),
+	preparePool.getMaxWorkers(), preparePool.queueLength(),
+	preparePool.jobs, preparePool.spawned);
+    traceServer("DEBUG: job status index: %u of %u slots, generation %u",
+	jobIndex.size(), jobIndex.slots(), jobIndex.generation());
 
     // This is a hack to easlily *poke* it at any time we want to force
     // a runSchedule() for debugging purposes
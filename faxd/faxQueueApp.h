@@ -35,6 +35,10 @@
 #include "Batch.h"
 #include "DestInfo.h"
 #include "JobControl.h"
+#include "FaxRequestCache.h"
+#include "DocumentCache.h"
+#include "PreparePool.h"
+#include "JobStatusIndex.h"
 #include "StrDict.h"
 #include "Range.h"
 
@@ -47,6 +51,7 @@ class FaxItem;
 class Modem;
 class Trigger;
 class Status;
+struct QueueFileEntry;
 
 /*
  * This class represents a thread of control that manages the
@@ -112,6 +117,7 @@ private:
     u_int	requeueInterval;	// job requeue interval
     bool	use2D;			// ok to use 2D-encoded data
     bool	useUnlimitedLN;		// ok to use unlimited page length
+    bool	indexedScheduler;	// skip jobs no ready modem can take
     u_int	pageChop;		// default page chop handling
     float	pageChopThreshold;	// minimum space before page chop
     fxStr	notifyCmd;		// external command for notification
@@ -125,6 +131,11 @@ private:
     fxStr	sendUUCPCmd;		// external command for UUCP calls
     fxStr	wedgedCmd;		// external command for wedged modems
     fxStr	jobCtrlCmd;		// external command for JobControl
+    u_int	requestCacheSize;	// max qfiles held in requestCache
+    u_int	queueRecoveryThreads;	// threads reading qfiles at startup
+    u_int	documentCacheSize;	// max Kbytes held in documentCache
+    u_int	prepareWorkers;		// pre-forked job preparation workers
+    u_int	jobIndexSize;		// initial slots in jobIndex, 0 disables
 
     static stringtag strings[];
     static numbertag numbers[];
@@ -144,6 +155,10 @@ private:
     SchedTimeout schedTimeout;		// timeout for running scheduler
     DestInfoDict destJobs;		// jobs organized by destination
     fxStrDict	pendingDocs;		// documents waiting for removal
+    FaxRequestCache requestCache;	// parsed qfile contents
+    DocumentCache documentCache;	// imaged documents by content
+    PreparePool preparePool;		// job preparation workers
+    JobStatusIndex jobIndex;		// job status for hfaxd listings
     bool	inSchedule;
 
     static faxQueueApp* _instance;
@@ -156,6 +171,7 @@ private:
     friend class JobKillHandler;	// for acccess to timeoutJob
     friend class JobCtrlHandler;	// for acccess to ctrlJobDone
     friend class Batch;			// for acccess to prepareDone and senddone
+    friend class PreparePool;		// for access to prepareDone and workers
     friend class faxQueueApp::SchedTimeout;// for access to runScheduler
     friend class ModemLockWaitHandler;	// for access to pollForModemLock
 
@@ -216,7 +232,9 @@ private:
     void	delayJob(Job&, FaxRequest&, const Status&, time_t);
     void	rejectJob(Job& job, FaxRequest& req, const Status&);
     bool	submitJob(const fxStr& jobid, bool checkState = false);
+    bool	submitJobBatch(const char* args);
     bool	suspendJob(const fxStr& jobid, bool abortActive);
+    void	reindexJob(const char* jobid);
     void	rejectSubmission(Job&, FaxRequest&, const Status&);
 
     void	startBatch(Modem*, Job&, FaxRequest*, DestInfo&);
@@ -234,6 +252,7 @@ private:
     void	setPending(Job& job);
     void	setSuspend(Job& job);
     bool	submitJob(FaxRequest&, bool checkState = false);
+    bool	submitJob(QueueFileEntry&, bool checkState = false);
     bool	submitJob(Job& job, FaxRequest& req, bool checkState = false);
     bool	suspendJob(Job& job, bool abortActive);
     bool	terminateJob(const fxStr& filename, JobStatus why);
@@ -251,6 +270,9 @@ private:
     static void prepareCleanup(int s);
     void	prepareStart(Batch&, Job&, FaxRequest*);
     void	prepareDone(Batch&, int status);
+    void	runPrepareWorker(int fd);
+    JobStatus	prepareWorkerJob(const fxStr& jobid, const fxStr& dest,
+		    const fxStr& devid, const fxStr& caps, const fxStr& jci);
     JobStatus	prepareJob(Job& job, FaxRequest& req,
 		    const FaxMachineInfo&);
     JobStatus	convertDocument(Job&,
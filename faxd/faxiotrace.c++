@@ -0,0 +1,157 @@
+/*	$Id$ */
+/*
+ * Copyright (c) 2026 iFAX Solutions, Inc.
+ * HylaFAX is a trademark of Silicon Graphics
+ *
+ * Permission to use, copy, modify, distribute, and sell this software and
+ * its documentation for any purpose is hereby granted without fee, provided
+ * that (i) the above copyright notices and this permission notice appear in
+ * all copies of the software and related documentation, and (ii) the names of
+ * Sam Leffler and Silicon Graphics may not be used in any advertising or
+ * publicity relating to the software without the specific, prior written
+ * permission of Sam Leffler and Silicon Graphics.
+ *
+ * THE SOFTWARE IS PROVIDED "AS-IS" AND WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS, IMPLIED OR OTHERWISE, INCLUDING WITHOUT LIMITATION, ANY
+ * WARRANTY OF MERCHANTABILITY OR FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * IN NO EVENT SHALL SAM LEFFLER OR SILICON GRAPHICS BE LIABLE FOR
+ * ANY SPECIAL, INCIDENTAL, INDIRECT OR CONSEQUENTIAL DAMAGES OF ANY KIND,
+ * OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS,
+ * WHETHER OR NOT ADVISED OF THE POSSIBILITY OF DAMAGE, AND ON ANY THEORY OF
+ * LIABILITY, ARISING OUT OF OR IN CONNECTION WITH THE USE OR PERFORMANCE
+ * OF THIS SOFTWARE.
+ */
+/*
+ * Render a binary modem I/O trace (see SessionIOTraceSize)
+ * in the format of the session log, optionally merged with
+ * the session log itself.
+ *
+ * Usage: faxiotrace [-l logfile] tracefile
+ */
+#include <sys/types.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <errno.h>
+
+#include "ModemIOTrace.h"
+#include "StackBuffer.h"
+#include "Sys.h"
+#include "NLS.h"
+
+extern	void fxFatal(const char* va_alist ...);
+
+static	const char* appName;
+
+static void
+usage()
+{
+    fxFatal(_("usage: %s [-l logfile] tracefile"), appName);
+}
+
+/*
+ * Format a record as FaxMachineLog would have.
+ */
+static void
+formatRecord(fxStackBuffer& buf, const ModemIOTrace::Record& r,
+    const u_char* data, u_int pid)
+{
+    static const char hexdigits[] = "0123456789ABCDEF";
+    char tbuf[64];
+    time_t t = r.sec;
+    strftime(tbuf, sizeof (tbuf), "%h %d %T", localtime(&t));
+    buf.reset();
+    buf.fput("%s.%02u: [%5d]: %s <%u:", tbuf, r.usec / 10000, pid,
+	r.dir == ModemIOTrace::DIR_SEND ? "<--" : "-->", r.len);
+    for (u_int i = 0; i < r.len; i++) {
+	u_char b = data[i];
+	if (i > 0)
+	    buf.put(' ');
+	buf.put(hexdigits[b>>4]);
+	buf.put(hexdigits[b&0xf]);
+    }
+    buf.put(">\n");
+    buf.put('\0');
+}
+
+/*
+ * Lines are merged on the "dd hh:mm:ss.cc" part of the
+ * timestamp; a log line that has no timestamp sorts
+ * with the line before it.
+ */
+static bool
+logKey(const char* line, char key[15])
+{
+    if (strlen(line) < 18 || line[15] != '.' || line[3] != ' ')
+	return (false);
+    memcpy(key, line+4, 14);
+    key[14] = '\0';
+    return (true);
+}
+
+int
+main(int argc, char* argv[])
+{
+    extern int optind;
+    extern char* optarg;
+    const char* logFile = NULL;
+    int c;
+
+    NLS::Setup("hylafax-server");
+    appName = argv[0];
+    while ((c = Sys::getopt(argc, argv, ":l:")) != -1)
+	switch (c) {
+	case 'l':
+	    logFile = optarg;
+	    break;
+	case '?':
+	    usage();
+	    /*NOTREACHED*/
+	}
+    if (argc - optind != 1)
+	usage();
+    fxStr emsg;
+    ModemIOTrace* trace = ModemIOTrace::open(argv[optind], emsg);
+    if (!trace)
+	fxFatal("%s", (const char*) emsg);
+    FILE* log = NULL;
+    if (logFile && (log = fopen(logFile, "r")) == NULL)
+	fxFatal(_("%s: Cannot open: %s"), logFile, strerror(errno));
+
+    u_char* data = new u_char[0x10000];
+    fxStackBuffer buf;
+    char line[8192];
+    char logkey[15], reckey[15];
+    bool haveLine = false;
+    logkey[0] = '\0';
+    u_int pos = trace->getTail();
+    ModemIOTrace::Record r;
+    while (trace->next(pos, r, data)) {
+	formatRecord(buf, r, data, trace->getPid());
+	(void) logKey(buf, reckey);
+	while (log) {
+	    if (!haveLine) {
+		if (!fgets(line, sizeof (line), log))
+		    break;
+		(void) logKey(line, logkey);
+		haveLine = true;
+	    }
+	    if (strcmp(logkey, reckey) > 0)
+		break;
+	    fputs(line, stdout);
+	    haveLine = false;
+	}
+	fputs(buf, stdout);
+    }
+    if (log) {
+	if (haveLine)
+	    fputs(line, stdout);
+	while (fgets(line, sizeof (line), log))
+	    fputs(line, stdout);
+	fclose(log);
+    }
+    delete [] data;
+    delete trace;
+    return (0);
+}
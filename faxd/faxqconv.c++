@@ -0,0 +1,135 @@
+/*	$Id$ */
+/*
+ * Copyright (c) 2026 iFAX Solutions, Inc.
+ * HylaFAX is a trademark of Silicon Graphics
+ *
+ * Permission to use, copy, modify, distribute, and sell this software and
+ * its documentation for any purpose is hereby granted without fee, provided
+ * that (i) the above copyright notices and this permission notice appear in
+ * all copies of the software and related documentation, and (ii) the names of
+ * Sam Leffler and Silicon Graphics may not be used in any advertising or
+ * publicity relating to the software without the specific, prior written
+ * permission of Sam Leffler and Silicon Graphics.
+ *
+ * THE SOFTWARE IS PROVIDED "AS-IS" AND WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS, IMPLIED OR OTHERWISE, INCLUDING WITHOUT LIMITATION, ANY
+ * WARRANTY OF MERCHANTABILITY OR FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * IN NO EVENT SHALL SAM LEFFLER OR SILICON GRAPHICS BE LIABLE FOR
+ * ANY SPECIAL, INCIDENTAL, INDIRECT OR CONSEQUENTIAL DAMAGES OF ANY KIND,
+ * OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS,
+ * WHETHER OR NOT ADVISED OF THE POSSIBILITY OF DAMAGE, AND ON ANY THEORY OF
+ * LIABILITY, ARISING OUT OF OR IN CONNECTION WITH THE USE OR PERFORMANCE
+ * OF THIS SOFTWARE.
+ */
+/*
+ * Convert job description files between the text
+ * and binary formats.
+ *
+ * Usage: faxqconv [-b|-t|-p] qfile...
+ */
+#include <sys/types.h>
+#include <sys/file.h>
+#include <stdio.h>
+#include <stdarg.h>
+#include <string.h>
+#include <errno.h>
+
+#include "FaxRequest.h"
+#include "StackBuffer.h"
+#include "Sys.h"
+#include "NLS.h"
+
+extern	void fxFatal(const char* va_alist ...);
+
+static	const char* appName;
+
+class ConvRequest : public FaxRequest {
+public:
+    ConvRequest(const fxStr& qf, int fd) : FaxRequest(qf, fd) {}
+
+    bool checkDocument(const char*)	{ return (true); }
+    void error(const char* fmt ...);
+    void printText(FILE*);
+};
+
+void
+ConvRequest::error(const char* fmt ...)
+{
+    fprintf(stderr, "%s: %s: ", appName, (const char*) qfile);
+    va_list ap;
+    va_start(ap, fmt);
+    vfprintf(stderr, fmt, ap);
+    va_end(ap);
+    fputc('\n', stderr);
+}
+
+void
+ConvRequest::printText(FILE* fp)
+{
+    fxStackBuffer sb;
+    writeTextQFile(sb);
+    fwrite((const char*) sb, 1, sb.getLength(), fp);
+}
+
+static void
+usage()
+{
+    fxFatal(_("usage: %s [-b|-t|-p] qfile..."), appName);
+}
+
+int
+main(int argc, char* argv[])
+{
+    enum { toBinary, toText, printText } op = printText;
+    extern int optind;
+    int c;
+
+    NLS::Setup("hylafax-server");
+    appName = argv[0];
+    while ((c = Sys::getopt(argc, argv, ":btp")) != -1)
+	switch (c) {
+	case 'b':
+	    op = toBinary;
+	    break;
+	case 't':
+	    op = toText;
+	    break;
+	case 'p':
+	    op = printText;
+	    break;
+	case '?':
+	    usage();
+	    /*NOTREACHED*/
+	}
+    if (optind >= argc)
+	usage();
+    int status = 0;
+    for (; optind < argc; optind++) {
+	const char* qfile = argv[optind];
+	int fd = Sys::open(qfile, op == printText ? O_RDONLY : O_RDWR);
+	if (fd < 0) {
+	    fprintf(stderr, _("%s: %s: Cannot open: %s\n"),
+		appName, qfile, strerror(errno));
+	    status = 1;
+	    continue;
+	}
+	/*
+	 * Lock the file as the servers do so that the
+	 * conversion does not race with an update.
+	 */
+	(void) flock(fd, op == printText ? LOCK_SH : LOCK_EX);
+	ConvRequest req(qfile, fd);
+	bool reject;
+	if (!req.readQFile(reject)) {
+	    status = 1;
+	} else if (op == printText) {
+	    req.printText(stdout);
+	} else {
+	    req.binary = (op == toBinary);
+	    req.writeQFile();
+	}
+	// NB: the FaxRequest destructor closes fd and drops the lock
+    }
+    return (status);
+}
@@ -0,0 +1,371 @@
+/*	$Id$ */
+/*
+ * Copyright (c) 2026 iFAX Solutions, Inc.
+ * HylaFAX is a trademark of Silicon Graphics
+ *
+ * Permission to use, copy, modify, distribute, and sell this software and
+ * its documentation for any purpose is hereby granted without fee, provided
+ * that (i) the above copyright notices and this permission notice appear in
+ * all copies of the software and related documentation, and (ii) the names of
+ * Sam Leffler and Silicon Graphics may not be used in any advertising or
+ * publicity relating to the software without the specific, prior written
+ * permission of Sam Leffler and Silicon Graphics.
+ *
+ * THE SOFTWARE IS PROVIDED "AS-IS" AND WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS, IMPLIED OR OTHERWISE, INCLUDING WITHOUT LIMITATION, ANY
+ * WARRANTY OF MERCHANTABILITY OR FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * IN NO EVENT SHALL SAM LEFFLER OR SILICON GRAPHICS BE LIABLE FOR
+ * ANY SPECIAL, INCIDENTAL, INDIRECT OR CONSEQUENTIAL DAMAGES OF ANY KIND,
+ * OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS,
+ * WHETHER OR NOT ADVISED OF THE POSSIBILITY OF DAMAGE, AND ON ANY THEORY OF
+ * LIABILITY, ARISING OUT OF OR IN CONNECTION WITH THE USE OR PERFORMANCE
+ * OF THIS SOFTWARE.
+ */
+
+/*
+ * Program for measuring the speed of ECM HDLC frame handling.
+ *
+ * A 64 KB ECM block is built from 256 frames of 256 bytes, as
+ * Class1Modem would send it, and run through the FCS calculation
+ * and the transparent zero-bit insertion and removal used for
+ * ECM.  Each step is done both bit-serially, as it was originally
+ * written, and with the tables now used by HDLCFrame and
+ * HDLCStuffer; the two results are compared and the rate at which
+ * each processes frame data is reported in MB/s.  The frame data
+ * is random unless a fill byte is given with -f (e.g. -f 0xff for
+ * the most zero bits inserted).
+ *
+ * Usage: hdlctest [-n passes] [-f fill]
+ */
+#include <sys/time.h>
+#include "HDLCFrame.h"
+#include "HDLCStuffer.h"
+#include "Sys.h"
+#include "NLS.h"
+
+#define	FRAMESIZE	256			// ECM frame data
+#define	FRAMES		256			// frames in a block
+#define	FRAMELEN	(FRAMESIZE+6)		// with A, C, FCF, FNUM and FCS
+#define	SYNCFLAGS	360			// 200 ms of flags at 14400 bit/s
+
+const char* appName;
+
+void
+usage()
+{
+    fprintf(stderr, _("usage: %s [-n passes] [-f fill]\n"), appName);
+    exit(-1);
+}
+
+static double
+now()
+{
+    struct timeval tv;
+    gettimeofday(&tv, 0);
+    return (tv.tv_sec + tv.tv_usec / 1000000.);
+}
+
+/*
+ * Bit-serial FCS from the "typical implementation" in T.30 5.3.7.
+ */
+static u_int
+crcBits(const u_char* cp, u_int cc)
+{
+    u_int crc = 0xffff;
+    while (cc-- > 0) {
+	u_char c = *cp++;
+	for (int i = 7; i >= 0; i--) {
+	    crc ^= (c & (1 << i)) << (15 - i);
+	    crc <<= 1;
+	    if (crc >> 16) crc ^= 0x11021;
+	}
+    }
+    return (crc);
+}
+
+/*
+ * Bit-serial zero-bit insertion as done by Class1Modem::blockData.
+ */
+struct BitStuffer {
+    u_char*	buf;
+    u_int	pos;
+    u_int	byte;
+    u_int	bitpos;
+    u_int	ones;
+
+    BitStuffer(u_char* b) : buf(b), pos(0), byte(0), bitpos(0), ones(0) {}
+    void put(u_int c, bool flag);
+};
+
+void
+BitStuffer::put(u_int c, bool flag)
+{
+    for (u_int j = 8; j > 0; j--) {
+	u_int bit = (c & (1 << (j - 1))) != 0 ? 1 : 0;
+	byte |= (bit << bitpos);
+	if (++bitpos == 8) {
+	    buf[pos++] = byte;
+	    bitpos = 0;
+	    byte = 0;
+	}
+	if (bit == 1 && !flag) ones++;
+	else ones = 0;
+	if (ones == 5) {
+	    if (++bitpos == 8) {
+		buf[pos++] = byte;
+		bitpos = 0;
+		byte = 0;
+	    }
+	    ones = 0;
+	}
+    }
+}
+
+/*
+ * Bit source with the interface of ModemServer::getModemBit
+ * and ModemServer::peekModemBits.
+ */
+struct BitSource {
+    const u_char* cp;
+    const u_char* ep;
+    int		gotByte;
+    u_int	rcvBit;
+
+    BitSource(const u_char* b, u_int cc) : cp(b), ep(b+cc), gotByte(0), rcvBit(0) {}
+    int peekBits(u_int& count);
+    int getBit();
+    void skipBits(u_int count)	{ rcvBit -= count; }
+};
+
+int
+BitSource::peekBits(u_int& count)
+{
+    if (rcvBit < 1) {
+	rcvBit = 8;
+	gotByte = (cp < ep ? *cp++ : EOF);
+    }
+    count = rcvBit;
+    return (gotByte);
+}
+
+int
+BitSource::getBit()
+{
+    u_int count;
+    if (peekBits(count) == EOF)
+	return (EOF);
+    return ((gotByte & (0x80 >> --rcvBit)) != 0);
+}
+
+/*
+ * Receive the next frame following a flag as is done by
+ * Class1Modem::recvECMFrame, either bit-by-bit or with
+ * the table lookups of HDLCStuffer.
+ */
+static u_int
+recvFrame(BitSource& in, const HDLCStuffer* st, u_char* frame)
+{
+    u_int ones = 0;
+    int bit = in.getBit();
+    while (bit != 1 && bit != EOF) {
+	do {
+	    if (bit == 0 || ones > 6) ones = 0;
+	    bit = in.getBit();
+	    if (bit == 1) ones++;
+	} while (!(ones == 6 && bit == 0) && bit != EOF);
+	ones = 0;
+	bit = in.getBit();
+    }
+    if (bit == EOF)
+	return (0);
+    u_int len = 0;
+    u_int bitpos = 7;
+    u_int byte = (bit << bitpos);
+    ones = 1;
+    do {
+	u_int count;
+	int c;
+	if (st && (c = in.peekBits(count)) != EOF && count == 8) {
+	    const HDLCStuffer::Unstuffed& u = st->unstuff(ones, c);
+	    if (!u.flag && len + (u.len >= bitpos) < FRAMELEN) {
+		in.skipBits(8);
+		ones = u.ones;
+		if (u.len >= bitpos) {
+		    u_int rem = u.len - bitpos;
+		    frame[len++] = byte | (u.bits >> rem);
+		    bitpos = 8 - rem;
+		    byte = (u.bits << bitpos) & 0xff;
+		} else {
+		    bitpos -= u.len;
+		    byte |= (u.bits << bitpos);
+		}
+		continue;
+	    }
+	}
+	bit = in.getBit();
+	if (bit == 1)
+	    ones++;
+	if (!(ones == 5 && bit == 0) && bit != EOF) {
+	    bitpos--;
+	    byte |= (bit << bitpos);
+	    if (bitpos == 0) {
+		frame[len++] = byte;
+		bitpos = 8;
+		byte = 0;
+	    }
+	}
+	if (bit == 0) ones = 0;
+    } while (ones != 6 && bit != EOF && len < FRAMELEN);
+    return (len);
+}
+
+/*
+ * Check that every frame is received intact from a stuffed block.
+ */
+static bool
+checkFrames(const u_char* frames, const u_char* stuffed, u_int cc,
+    const HDLCStuffer* st)
+{
+    BitSource in(stuffed, cc);
+    u_char frame[FRAMELEN];
+    for (u_int i = 0; i < FRAMES; i++) {
+	if (recvFrame(in, st, frame) != FRAMELEN ||
+	  memcmp(frame, frames + i*FRAMELEN, FRAMELEN) != 0)
+	    return (false);
+    }
+    return (true);
+}
+
+static void
+report(const char* what, double t0, double t1, u_int passes)
+{
+    double mb = (double) FRAMES*FRAMELEN*passes / (1024.*1024.);
+    printf("%s: %.1f MB/s bit-serial, %.1f MB/s by table (%.1fx)\n",
+	what, mb/t0, mb/t1, t0/t1);
+}
+
+int
+main(int argc, char* argv[])
+{
+    extern int optind;
+    extern char* optarg;
+    u_int passes = 20;
+    int fill = -1;
+    int c;
+
+    NLS::Setup("hylafax-server");
+    appName = argv[0];
+    while ((c = Sys::getopt(argc, argv, "n:f:")) != -1)
+	switch (c) {
+	case 'n':
+	    passes = atoi(optarg);
+	    break;
+	case 'f':
+	    fill = strtol(optarg, NULL, 0) & 0xff;
+	    break;
+	case '?':
+	    usage();
+	    /*NOTREACHED*/
+	}
+    if (argc != optind || passes == 0)
+	usage();
+
+    /*
+     * Build the frames: address, control, FCD, frame number,
+     * data and FCS; the data is kept MSB2LSB as for sending.
+     */
+    u_char* frames = new u_char[FRAMES*FRAMELEN];
+    srandom(1);
+    for (u_int i = 0; i < FRAMES; i++) {
+	HDLCFrame frame(5);
+	frame.put(0xff); frame.put(0xc0); frame.put(0x60); frame.put(i);
+	for (u_int j = 0; j < FRAMESIZE; j++)
+	    frame.put(fill < 0 ? random() & 0xff : fill);
+	u_int fcs = frame.getCRC();
+	frame.put(fcs >> 8); frame.put(fcs & 0xff);
+	memcpy(frames + i*FRAMELEN, (u_char*) frame, FRAMELEN);
+    }
+    u_int errors = 0;
+
+    double t0 = now();
+    for (u_int p = 0; p < passes; p++) {
+	for (u_int i = 0; i < FRAMES; i++)
+	    if (crcBits(frames + i*FRAMELEN, FRAMELEN) != 0x1d0f)
+		errors++;
+    }
+    double t1 = now();
+    for (u_int p = 0; p < passes; p++) {
+	for (u_int i = 0; i < FRAMES; i++) {
+	    HDLCFrame frame(5);
+	    const u_char* fp = frames + i*FRAMELEN;
+	    for (u_int j = 0; j < FRAMELEN; j++)
+		frame.put(fp[j]);
+	    if (!frame.checkCRC())
+		errors++;
+	}
+    }
+    double t2 = now();
+    report("FCS", t1-t0, t2-t1, passes);
+
+    /*
+     * Stuff the block between sync flags as blockFrame does.
+     */
+    u_int size = SYNCFLAGS + FRAMES*(FRAMELEN*6/5+2) + 2;
+    u_char* stuffed0 = new u_char[size];
+    u_char* stuffed1 = new u_char[size];
+    u_int len0 = 0, len1 = 0;
+    t0 = now();
+    for (u_int p = 0; p < passes; p++) {
+	BitStuffer bs(stuffed0);
+	for (u_int i = 0; i < SYNCFLAGS; i++)
+	    bs.put(0x7e, true);
+	for (u_int i = 0; i < FRAMES; i++) {
+	    const u_char* fp = frames + i*FRAMELEN;
+	    for (u_int j = 0; j < FRAMELEN; j++)
+		bs.put(fp[j], false);
+	    bs.put(0x7e, true);
+	}
+	bs.put(0x7e, true);
+	len0 = bs.pos;
+    }
+    t1 = now();
+    HDLCStuffer st;
+    for (u_int p = 0; p < passes; p++) {
+	u_int n;
+	st.reset();
+	n = st.putFlags(stuffed1, SYNCFLAGS);
+	for (u_int i = 0; i < FRAMES; i++) {
+	    n += st.putData(stuffed1 + n, frames + i*FRAMELEN, FRAMELEN);
+	    n += st.putFlags(stuffed1 + n, 1);
+	}
+	n += st.putFlags(stuffed1 + n, 1);
+	len1 = n;
+    }
+    t2 = now();
+    report("stuff", t1-t0, t2-t1, passes);
+    if (len0 != len1 || memcmp(stuffed0, stuffed1, len0) != 0) {
+	printf("stuffed blocks differ (%u and %u bytes)\n", len0, len1);
+	errors++;
+    }
+
+    t0 = now();
+    for (u_int p = 0; p < passes; p++)
+	if (!checkFrames(frames, stuffed0, len0, NULL))
+	    errors++;
+    t1 = now();
+    for (u_int p = 0; p < passes; p++)
+	if (!checkFrames(frames, stuffed0, len0, &st))
+	    errors++;
+    t2 = now();
+    report("unstuff", t1-t0, t2-t1, passes);
+
+    delete frames;
+    delete stuffed0;
+    delete stuffed1;
+    if (errors) {
+	printf("%u errors\n", errors);
+	return (1);
+    }
+    return (0);
+}
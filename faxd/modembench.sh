@@ -0,0 +1,291 @@
+#! /bin/sh
+#	$Id$
+#
+# HylaFAX Facsimile Software
+#
+# Copyright (c) 2026 iFAX Solutions, Inc.
+# HylaFAX is a trademark of Silicon Graphics
+#
+# Permission to use, copy, modify, distribute, and sell this software and
+# its documentation for any purpose is hereby granted without fee, provided
+# that (i) the above copyright notices and this permission notice appear in
+# all copies of the software and related documentation, and (ii) the names of
+# Sam Leffler and Silicon Graphics may not be used in any advertising or
+# publicity relating to the software without the specific, prior written
+# permission of Sam Leffler and Silicon Graphics.
+#
+# THE SOFTWARE IS PROVIDED "AS-IS" AND WITHOUT WARRANTY OF ANY KIND,
+# EXPRESS, IMPLIED OR OTHERWISE, INCLUDING WITHOUT LIMITATION, ANY
+# WARRANTY OF MERCHANTABILITY OR FITNESS FOR A PARTICULAR PURPOSE.
+#
+# IN NO EVENT SHALL SAM LEFFLER OR SILICON GRAPHICS BE LIABLE FOR
+# ANY SPECIAL, INCIDENTAL, INDIRECT OR CONSEQUENTIAL DAMAGES OF ANY KIND,
+# OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS,
+# WHETHER OR NOT ADVISED OF THE POSSIBILITY OF DAMAGE, AND ON ANY THEORY OF
+# LIABILITY, ARISING OUT OF OR IN CONNECTION WITH THE USE OR PERFORMANCE
+# OF THIS SOFTWARE.
+#
+
+#
+# modembench [-n jobs] [-s speed] [-e ber] [-t tracing] [-b bindir] [-u user] [-k] document.tif
+#
+# Measure the send+receive pipeline of faxsend and faxgetty.
+#
+# A scratch spooling area is created, modemsim is started to provide
+# a pair of back-to-back Class 1 modems, faxgetty is run on one of
+# them and the document is then sent the requested number of times
+# with faxsend on the other.  Each job is timed from the start of
+# faxsend until faxgetty has logged the received document; the time
+# faxgetty then spends resetting its modem is not counted, and the
+# throughput is calculated from the job times alone.  The CPU
+# time of faxsend, faxgetty and the modem emulator is reported per
+# page.  The speed and bit error rate are passed to modemsim; a speed
+# of 0 (the default) takes the line out of the measurement.
+#
+# The document must be a TIFF/F file such as one found in recvq.  The
+# programs are taken from bindir (default the current directory) and
+# the page count is found with faxinfo, which is looked for in
+# bindir/../util and then in the search path.  The servers must be
+# started by root; the spooling area and devices are given to the fax
+# user (default uucp).  With -k the spooling area is kept for inspection.
+#
+JOBS=10
+SPEED=0
+BER=0
+TRACING=1
+BINDIR=.
+FAXUSER=uucp
+KEEP=no
+
+usage()
+{
+    echo "Usage: $0 [-n jobs] [-s speed] [-e ber] [-t tracing] [-b bindir] [-u user] [-k] document.tif"
+    exit 1
+}
+
+while [ $# -gt 0 ]; do
+    case "$1" in
+    -n)	shift; JOBS=$1;;
+    -s)	shift; SPEED=$1;;
+    -e)	shift; BER=$1;;
+    -t)	shift; TRACING=$1;;
+    -b)	shift; BINDIR=$1;;
+    -u)	shift; FAXUSER=$1;;
+    -k)	KEEP=yes;;
+    -*)	usage;;
+    *)	break;;
+    esac
+    shift
+done
+[ $# -eq 1 ] || usage
+DOC=$1
+[ -f "$DOC" ] || { echo "$0: $DOC: No such file"; exit 1; }
+case "$BINDIR" in
+/*)	;;
+*)	BINDIR=`pwd`/$BINDIR;;
+esac
+for p in modemsim faxsend faxgetty; do
+    [ -x $BINDIR/$p ] || { echo "$0: $BINDIR/$p: Not found"; exit 1; }
+done
+FAXINFO=$BINDIR/../util/faxinfo
+[ -x $FAXINFO ] || FAXINFO=faxinfo
+PAGES=`$FAXINFO "$DOC" 2>/dev/null | sed -n 's/^ *Pages: *//p'`
+[ -n "$PAGES" ] && [ "$PAGES" -gt 0 ] 2>/dev/null || {
+    echo "$0: $DOC: Can not determine the number of pages"
+    exit 1
+}
+
+#
+# The device IDs are derived from the device pathnames,
+# so the spooling area must not have '_' in its name.
+#
+SPOOL=`mktemp -d /tmp/modembenchXXXXXX` || exit 1
+SENDDEV=$SPOOL/dev/ttysend
+RECVDEV=$SPOOL/dev/ttyrecv
+SENDID=`echo $SENDDEV | tr / _`
+RECVID=`echo $RECVDEV | tr / _`
+SIMPID=
+GETTYPID=
+CATPID=
+
+cleanup()
+{
+    [ -n "$GETTYPID" ] && kill $GETTYPID 2>/dev/null && wait $GETTYPID
+    [ -n "$SIMPID" ] && kill $SIMPID 2>/dev/null && wait $SIMPID
+    [ -n "$CATPID" ] && kill $CATPID 2>/dev/null
+    exec 3>&-
+    if [ $KEEP = yes ]; then
+	echo "Spooling area kept in $SPOOL"
+    else
+	rm -rf $SPOOL
+    fi
+}
+trap 'cleanup; exit 1' 1 2 15
+
+for d in bin client dev docq etc info log recvq sendq status tmp; do
+    mkdir $SPOOL/$d
+done
+cp "$DOC" $SPOOL/docq/doc.tif
+mkfifo $SPOOL/FIFO
+exec 3<>$SPOOL/FIFO			# absorb messages for faxq
+cat <&3 >/dev/null 2>&1 &
+CATPID=$!
+
+for id in $SENDID $RECVID; do
+    cat > $SPOOL/etc/config.$id <<EOF
+ModemType:		Class1
+ModemRate:		115200
+ModemFlowControl:	rtscts
+CountryCode:		1
+AreaCode:		555
+FAXNumber:		+1.555.555.0100
+LongDistancePrefix:	1
+InternationalPrefix:	011
+RingsBeforeAnswer:	1
+ServerTracing:		$TRACING
+SessionTracing:		$TRACING
+LogFileMode:		0600
+RecvFileMode:		0600
+FaxRcvdCmd:		/bin/true
+EOF
+done
+
+$BINDIR/modemsim -s $SPEED -e $BER $SENDDEV $RECVDEV > $SPOOL/tmp/modemsim.log 2>&1 &
+SIMPID=$!
+n=0
+while [ ! -h $RECVDEV ] || [ ! -h $SENDDEV ]; do
+    n=`expr $n + 1`
+    [ $n -gt 100 ] && { echo "$0: modemsim did not start"; cleanup; exit 1; }
+    sleep 0.1
+done
+chown -R $FAXUSER $SPOOL $SENDDEV $RECVDEV || { cleanup; exit 1; }
+
+idle()					# wait for faxgetty to reset the modem
+{
+    n=0
+    until grep -q "Running and idle" $SPOOL/status/$RECVID 2>/dev/null; do
+	n=`expr $n + 1`
+	[ $n -gt 600 ] && { echo "$0: faxgetty did not become ready"; cleanup; exit 1; }
+	sleep 0.1
+    done
+}
+
+$BINDIR/faxgetty -q $SPOOL $RECVDEV > $SPOOL/tmp/faxgetty.log 2>&1 &
+GETTYPID=$!
+idle
+
+#
+# Session parameters for each page; all pages are
+# assumed to share the parameters of the first.
+#
+PPH=`awk "BEGIN { s = \"00\"; for (i = 1; i < $PAGES; i++) s = s \"S00\"; print s \"P\" }"`
+
+HZ=`getconf CLK_TCK 2>/dev/null || echo 100`
+cputime()				# user+system seconds of a process
+{
+    awk -v hz=$HZ '{ sub(/.*\) /, ""); print ($12 + $13) / hz }' /proc/$1/stat 2>/dev/null || echo 0
+}
+secs()					# sum the child times reported by times
+{
+    sed -n 2p $1 | tr 'ms' '  ' | awk '{ print $1*60 + $2 + $3*60 + $4 }'
+}
+
+cd $SPOOL
+GETTY0=`cputime $GETTYPID`
+SIM0=`cputime $SIMPID`
+START=`date +%s.%N`
+: > $SPOOL/tmp/latency
+SENT=0
+FAILED=0
+i=1
+while [ $i -le $JOBS ]; do
+    cat > sendq/q$i <<EOF
+tts:0
+killtime:2000000000
+state:3
+npages:0
+totpages:$PAGES
+maxdials:1
+maxtries:1
+pagewidth:209
+resolution:98
+pagelength:296
+priority:127
+desiredbr:13
+desiredec:2
+desireddf:3
+number:5550199
+external:5550199
+mailaddr:modembench@localhost
+sender:modembench
+jobid:$i
+owner:modembench
+modem:any
+client:localhost
+jobtype:facsimile
+notify:none
+pagechop:none
+pagehandling:$PPH
+fax:0::docq/doc.tif
+EOF
+    t0=`date +%s.%N`
+    times > tmp/times0
+    $BINDIR/faxsend -m $SENDID sendq/q$i >> tmp/faxsend.log 2>&1
+    times > tmp/times1
+    n=0
+    until [ `cat etc/xferfaxlog 2>/dev/null | grep -c '	RECV	'` -ge $i ]; do
+	n=`expr $n + 1`
+	[ $n -gt 3000 ] && break	# 30 seconds
+	sleep 0.01
+    done
+    t1=`date +%s.%N`
+    #
+    # The receiving modem is reset after each call;
+    # keep that out of the next job's latency.
+    #
+    until [ `cat etc/xferfaxlog 2>/dev/null | grep -c '	CALL	'` -ge $i ]; do
+	n=`expr $n + 1`
+	[ $n -gt 3000 ] && break
+	sleep 0.01
+    done
+    idle
+    p=`sed -n 's/^npages://p' sendq/q$i`
+    if [ "$p" = "$PAGES" ]; then
+	SENT=`expr $SENT + $p`
+    else
+	FAILED=`expr $FAILED + 1`
+	echo "Job $i: `sed -n 's/^status://p' sendq/q$i`"
+    fi
+    echo "$t0 $t1 `secs tmp/times0` `secs tmp/times1`" >> tmp/latency
+    i=`expr $i + 1`
+done
+END=`date +%s.%N`
+GETTY1=`cputime $GETTYPID`
+SIM1=`cputime $SIMPID`
+cd /
+
+awk -v jobs=$JOBS -v pages=$SENT -v failed=$FAILED \
+    -v start=$START -v end=$END \
+    -v g0=$GETTY0 -v g1=$GETTY1 -v s0=$SIM0 -v s1=$SIM1 '
+{
+    lat = $2 - $1
+    sum += lat
+    if (NR == 1 || lat < min) min = lat
+    if (lat > max) max = lat
+    send += $4 - $3
+}
+END {
+    elapsed = end - start
+    printf "%d jobs, %d pages sent, %d jobs failed, %.2f seconds\n", \
+	jobs, pages, failed, elapsed
+    if (pages == 0)
+	exit
+    printf "throughput: %.3f pages/sec\n", pages / sum
+    printf "latency per job: avg %.1f ms, min %.1f ms, max %.1f ms\n", \
+	1000*sum/NR, 1000*min, 1000*max
+    printf "CPU per page: faxsend %.1f ms, faxgetty %.1f ms, modemsim %.1f ms\n", \
+	1000*send/pages, 1000*(g1-g0)/pages, 1000*(s1-s0)/pages
+}' $SPOOL/tmp/latency
+
+cleanup
+[ $FAILED -eq 0 ]
@@ -0,0 +1,1210 @@
+/*	$Id$ */
+/*
+ * Copyright (c) 2026 iFAX Solutions, Inc.
+ * HylaFAX is a trademark of Silicon Graphics
+ *
+ * Permission to use, copy, modify, distribute, and sell this software and
+ * its documentation for any purpose is hereby granted without fee, provided
+ * that (i) the above copyright notices and this permission notice appear in
+ * all copies of the software and related documentation, and (ii) the names of
+ * Sam Leffler and Silicon Graphics may not be used in any advertising or
+ * publicity relating to the software without the specific, prior written
+ * permission of Sam Leffler and Silicon Graphics.
+ *
+ * THE SOFTWARE IS PROVIDED "AS-IS" AND WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS, IMPLIED OR OTHERWISE, INCLUDING WITHOUT LIMITATION, ANY
+ * WARRANTY OF MERCHANTABILITY OR FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * IN NO EVENT SHALL SAM LEFFLER OR SILICON GRAPHICS BE LIABLE FOR
+ * ANY SPECIAL, INCIDENTAL, INDIRECT OR CONSEQUENTIAL DAMAGES OF ANY KIND,
+ * OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS,
+ * WHETHER OR NOT ADVISED OF THE POSSIBILITY OF DAMAGE, AND ON ANY THEORY OF
+ * LIABILITY, ARISING OUT OF OR IN CONNECTION WITH THE USE OR PERFORMANCE
+ * OF THIS SOFTWARE.
+ */
+
+/*
+ * Class 1 modem emulator for testing faxsend and faxgetty.
+ *
+ * Two emulated Class 1 (T.31) modems are created on a pair of
+ * pseudo-ttys and connected back-to-back, so that dialing out on
+ * one device rings the other.  Each device answers the subset of
+ * the AT command set that Class1Modem uses, including the +FTH,
+ * +FRH, +FTM, +FRM, +FTS and +FRS carrier commands.  HDLC frames
+ * are given a real FCS so that damaged frames are reported with
+ * ERROR just as a modem would.
+ *
+ * The line is modelled as a queue of carriers (``bursts'') sent by
+ * each modem to its peer.  With -s the carriers are clocked out at
+ * the signalling rate multiplied by the speed factor, including the
+ * V.21 preamble and the training time of each modulation; a factor
+ * of 0 (the default) passes data as fast as the hosts can move it.
+ * With -e bits on the line are flipped at the given bit error rate.
+ *
+ * The slave side of each pty is made available through a symbolic
+ * link with the name given on the command line; these are removed
+ * again when the program is terminated.
+ *
+ * Usage: modemsim [-v] [-e ber] [-s speed] device1 device2
+ */
+#include "Sys.h"
+#include "NLS.h"
+#include "Str.h"
+#include "StackBuffer.h"
+#include "Dispatcher.h"
+#include "IOHandler.h"
+
+#include <ctype.h>
+#include <errno.h>
+#include <math.h>
+#include <termios.h>
+#include <sys/time.h>
+
+#define	DLE	0x10
+#define	ETX	0x03
+#define	SUB	0x1a
+
+#define	V21	3			// modulation code for V.21 HDLC
+
+static const struct {
+    u_int	code;			// +FTM/+FRM modulation code
+    u_int	bps;			// signalling rate
+    u_int	trainms;		// training time before data
+} modulations[] = {
+    {   3,   300, 1000 },		// V.21 channel 2 (flag preamble)
+    {  24,  2400,  943 },		// V.27ter
+    {  48,  4800,  708 },		// V.27ter
+    {  72,  7200,  253 },		// V.29
+    {  73,  7200, 1393 },		// V.17 long train
+    {  74,  7200,  142 },		// V.17 short train
+    {  96,  9600,  253 },		// V.29
+    {  97,  9600, 1393 },		// V.17 long train
+    {  98,  9600,  142 },		// V.17 short train
+    { 121, 12000, 1393 },		// V.17 long train
+    { 122, 12000,  142 },		// V.17 short train
+    { 145, 14400, 1393 },		// V.17 long train
+    { 146, 14400,  142 },		// V.17 short train
+};
+#define	NMODS	(sizeof (modulations) / sizeof (modulations[0]))
+static const char modList[] = "24,48,72,73,74,96,97,98,121,122,145,146";
+
+static double	speed = 0;		// line speed factor (0 = unlimited)
+static double	ber = 0;		// bit error rate
+static bool	verbose = false;
+static const double carrierHold = 3.0;	// secs a finished carrier is heard
+static const u_int txHighWater = 1024;	// paced bytes buffered from host
+
+static double
+now()
+{
+    timeval tv;
+    gettimeofday(&tv, 0);
+    return (tv.tv_sec + tv.tv_usec / 1e6);
+}
+
+/*
+ * HDLC frame check sequence (ITO-T V.42 / ISO 3309) computed
+ * over the frame as it appears on the DTE-DCE interface.
+ */
+static u_short fcsTab[256];
+
+static void
+setupFCS()
+{
+    for (u_int b = 0; b < 256; b++) {
+	u_int v = b;
+	for (u_int i = 0; i < 8; i++)
+	    v = (v & 1) ? (v >> 1) ^ 0x8408 : (v >> 1);
+	fcsTab[b] = v;
+    }
+}
+
+static inline u_short
+updateFCS(u_short fcs, u_char c)
+{
+    return ((fcs >> 8) ^ fcsTab[(fcs ^ c) & 0xff]);
+}
+
+#define	FCS_INIT	0xffff
+#define	FCS_GOOD	0xf0b8		// residue over frame + FCS
+
+/*
+ * A carrier sent from one modem to the other.  Bytes are
+ * appended as they are clocked onto the line and the
+ * receiving modem passes them on to its host as they arrive.
+ */
+struct Burst {
+    Burst*	next;
+    u_int	mod;			// modulation code
+    fxStackBuffer data;		// bytes on the line so far
+    bool	done;			// carrier has dropped
+    bool	dropped;		// receiver gave up on the carrier
+    double	doneAt;			// time carrier dropped
+
+    Burst(u_int m) : next(NULL), mod(m), done(false), dropped(false), doneAt(0) {}
+};
+
+class SimModem : public IOHandler {
+public:
+    enum State {
+	CMD,				// AT command mode
+	DIALING,			// waiting for the other side to answer
+	DELAY,				// +FTS/+FRS silence
+	TXHDLC,				// +FTH: host sending HDLC frames
+	TXDATA,				// +FTM: host sending data
+	RXHDLC,				// +FRH: passing HDLC frames to the host
+	RXDATA				// +FRM: passing data to the host
+    };
+private:
+    fxStr	name;			// device name
+    int		fd;			// pty master
+    int		slave;			// pty slave held open
+    SimModem*	peer;			// modem at the far end of the line
+    State	state;
+    bool	echo;			// E1
+    bool	offHook;
+    bool	connected;		// call established with peer
+    bool	ringing;
+    u_int	rings;
+    u_int	fclass;			// +FCLASS (0 or 1)
+    u_int	sreg[100];		// S registers
+    fxStackBuffer line;		// command line being collected
+    fxStackBuffer obuf;		// output pending for host
+    fxStackBuffer ibuf;		// input from host not yet processed
+    u_int	ioff;			// next unprocessed byte in ibuf
+    bool	reading;		// host fd linked for input
+    bool	writing;		// host fd linked for output
+
+    Burst*	rxq;			// carriers received from peer
+    Burst*	rxBurst;		// carrier being passed to host
+    u_int	rxOff;			// next byte of rxBurst for host
+    u_int	rxMod;			// +FRM modulation
+
+    Burst*	txBurst;		// carrier being sent to peer
+    u_int	txMod;			// current transmit modulation
+    u_int	txBps;			// current transmit bit rate
+    bool	txCarrier;		// carrier on (HDLC frames continue)
+    fxStackBuffer txBuf;		// data from host to go onto the line
+    u_int	txOff;			// next byte of txBuf for the line
+    bool	txDLE;			// previous host byte was DLE
+    bool	txEnd;			// host sent <DLE><ETX>
+    u_short	txFCS;			// running FCS of HDLC frame
+    double	txStart;		// time data may start (after training)
+    double	txLast;			// time of last release
+    double	txCredit;		// bytes owed to the line
+    bool	ticking;		// clock tick pending for transmit
+
+    void	trace(const char* fmt ...);
+    void	put(const char* s, u_int len);
+    void	putStuffed(const u_char* s, u_int len);
+    void	result(const char* s);
+    void	flush();
+    void	setReading(bool);
+    void	setMasks();
+    void	schedule(double secs);
+
+    void	process();
+    void	doLine();
+    int		doCommand(const char*& cp);
+    int		doExtended(const char*& cp);
+    void	reset();
+    void	hangup();
+    void	dial();
+    void	answer();
+    void	delay(u_int ms);
+    void	startTransmit(State, u_int mod);
+    void	startReceive(State, u_int mod);
+
+    void	txByte(u_char c);
+    void	txKick();
+    void	txRelease();
+    void	txFinish();
+    void	lineSend(const u_char* cp, u_int n);
+
+    Burst*	carrier();
+    void	rxCheck();
+    void	rxAbort();
+    void	flushReceive();
+public:
+    SimModem(const char* name);
+    ~SimModem();
+
+    bool	open(const char* link);
+    void	setPeer(SimModem* p)		{ peer = p; }
+
+    void	ring();
+    void	stopRinging();
+    void	answered();
+    void	remoteHangup();
+    void	carrierData(Burst*);
+    Burst*	newBurst(u_int mod);
+
+    int		inputReady(int);
+    int		outputReady(int);
+    void	timerExpired(long, long);
+};
+
+SimModem::SimModem(const char* n) : name(n)
+{
+    fd = slave = -1;
+    peer = NULL;
+    rxq = rxBurst = txBurst = NULL;
+    ioff = 0;
+    ticking = false;
+    reading = writing = false;
+    offHook = connected = ringing = false;
+    rings = 0;
+    reset();
+}
+
+SimModem::~SimModem()
+{
+    if (fd >= 0)
+	Sys::close(fd);
+    if (slave >= 0)
+	Sys::close(slave);
+}
+
+void
+SimModem::trace(const char* fmt ...)
+{
+    if (verbose) {
+	va_list ap;
+	va_start(ap, fmt);
+	fprintf(stderr, "%.3f %s: ", fmod(now(), 1000.), (const char*) name);
+	vfprintf(stderr, fmt, ap);
+	fputc('\n', stderr);
+	va_end(ap);
+    }
+}
+
+/*
+ * Create the pty and make its slave side
+ * available through the link.  The slave is
+ * kept open so that the master never sees
+ * a hangup when the host closes the device.
+ */
+bool
+SimModem::open(const char* link)
+{
+    fd = posix_openpt(O_RDWR|O_NOCTTY);
+    if (fd < 0 || grantpt(fd) < 0 || unlockpt(fd) < 0) {
+	fprintf(stderr, "%s: Can not allocate pty: %s\n", link, strerror(errno));
+	return (false);
+    }
+    const char* dev = ptsname(fd);
+    slave = Sys::open(dev, O_RDWR|O_NOCTTY);
+    if (slave < 0) {
+	fprintf(stderr, "%s: Can not open: %s\n", dev, strerror(errno));
+	return (false);
+    }
+    struct termios tio;
+    if (tcgetattr(slave, &tio) == 0) {
+	cfmakeraw(&tio);
+	(void) tcsetattr(slave, TCSANOW, &tio);
+    }
+    (void) fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
+    (void) Sys::unlink(link);
+    if (symlink(dev, link) < 0) {
+	fprintf(stderr, "%s: Can not create link to %s: %s\n",
+	    link, dev, strerror(errno));
+	return (false);
+    }
+    printf("%s -> %s\n", link, dev);
+    setReading(true);
+    return (true);
+}
+
+/*
+ * Reset the modem to its power-on state.
+ */
+void
+SimModem::reset()
+{
+    state = CMD;
+    echo = true;
+    fclass = 0;
+    memset(sreg, 0, sizeof (sreg));
+    sreg[3] = '\r';
+    sreg[4] = '\n';
+    sreg[7] = 60;
+    line.reset();
+    txCarrier = false;
+    txEnd = txDLE = false;
+    txBuf.reset();
+    txOff = 0;
+}
+
+void
+SimModem::setReading(bool on)
+{
+    if (on != reading) {
+	reading = on;
+	setMasks();
+    }
+}
+
+void
+SimModem::setMasks()
+{
+    Dispatcher::instance().unlink(fd);
+    if (reading)
+	Dispatcher::instance().link(fd, Dispatcher::ReadMask, this);
+    if (obuf.getLength())
+	Dispatcher::instance().link(fd, Dispatcher::WriteMask, this);
+}
+
+void
+SimModem::schedule(double secs)
+{
+    Dispatcher::instance().stopTimer(this);
+    if (secs < 0)
+	secs = 0;
+    long sec = (long) secs;
+    Dispatcher::instance().startTimer(sec, (long) ((secs - sec) * 1e6), this);
+}
+
+/*
+ * Output to the host.  Anything that can not be
+ * written immediately is kept until the pty drains.
+ * If the host has gone away altogether the output
+ * is eventually discarded.
+ */
+void
+SimModem::put(const char* s, u_int len)
+{
+    if (obuf.getLength() > 256*1024)
+	return;
+    obuf.put(s, len);
+    flush();
+}
+
+void
+SimModem::putStuffed(const u_char* s, u_int len)
+{
+    const u_char* ep = s + len;
+    while (s < ep) {
+	const u_char* cp = (const u_char*) memchr(s, DLE, ep - s);
+	if (cp == NULL) {
+	    put((const char*) s, ep - s);
+	    break;
+	}
+	put((const char*) s, cp+1 - s);	// up to and including DLE
+	put("\020", 1);			// ... doubled
+	s = cp+1;
+    }
+}
+
+void
+SimModem::result(const char* s)
+{
+    trace("<-- %s", s);
+    fxStr r = fxStr::format("\r\n%s\r\n", s);
+    put(r, r.length());
+}
+
+void
+SimModem::flush()
+{
+    u_int len = obuf.getLength();
+    u_int off = 0;
+    while (off < len) {
+	int n = Sys::write(fd, (const char*) obuf + off, len - off);
+	if (n <= 0)
+	    break;
+	off += n;
+    }
+    if (off == len) {
+	obuf.reset();
+	if (len > 0 && writing)
+	    writing = false, setMasks();
+    } else {
+	if (off > 0) {
+	    fxStackBuffer rest;
+	    rest.put((const char*) obuf + off, len - off);
+	    obuf = rest;
+	}
+	if (!writing)
+	    writing = true, setMasks();
+    }
+}
+
+int
+SimModem::outputReady(int)
+{
+    flush();
+    return (0);
+}
+
+int
+SimModem::inputReady(int)
+{
+    char buf[4096];
+    int n = Sys::read(fd, buf, sizeof (buf));
+    if (n > 0) {
+	if (ioff == ibuf.getLength()) {
+	    ibuf.reset();
+	    ioff = 0;
+	}
+	ibuf.put(buf, n);
+	process();
+    }
+    return (0);
+}
+
+/*
+ * Process input from the host according to the
+ * current state.  Processing stops if data is
+ * arriving faster than it can be put on the line.
+ */
+void
+SimModem::process()
+{
+    while (ioff < ibuf.getLength()) {
+	u_char c = ibuf[ioff];
+	switch (state) {
+	case CMD:
+	    ioff++;
+	    if (echo)
+		put((const char*) &c, 1);
+	    if (c == sreg[3])
+		doLine();
+	    else if (c != sreg[4] && line.getLength() < 256)
+		line.put(c);
+	    break;
+	case DIALING:
+	    ioff++;
+	    trace("dial aborted");
+	    Dispatcher::instance().stopTimer(this);
+	    peer->stopRinging();
+	    offHook = false;
+	    state = CMD;
+	    result("NO CARRIER");
+	    break;
+	case DELAY:
+	    ioff++;
+	    Dispatcher::instance().stopTimer(this);
+	    state = CMD;
+	    result("OK");
+	    break;
+	case RXHDLC:
+	case RXDATA:
+	    ioff++;
+	    rxAbort();
+	    break;
+	case TXHDLC:
+	case TXDATA:
+	    if (txEnd) {			// waiting for data to drain
+		setReading(false);
+		return;
+	    }
+	    if (speed > 0 && txBuf.getLength() - txOff >= txHighWater) {
+		setReading(false);
+		return;
+	    }
+	    ioff++;
+	    txByte(c);
+	    break;
+	}
+    }
+    setReading(true);
+}
+
+/*
+ * Handle a byte of transmit data from the host.
+ */
+void
+SimModem::txByte(u_char c)
+{
+    if (txDLE) {
+	txDLE = false;
+	switch (c) {
+	case ETX:
+	    txEnd = true;
+	    txKick();
+	    return;
+	case DLE:
+	    break;
+	case SUB:			// <DLE><SUB> => <DLE><DLE>
+	    txByte(DLE), txByte(DLE);
+	    return;
+	default:			// unknown shielded code, ignore
+	    return;
+	}
+    } else if (c == DLE) {
+	txDLE = true;
+	return;
+    }
+    if (state == TXHDLC)
+	txFCS = updateFCS(txFCS, c);
+    if (txOff == txBuf.getLength()) {
+	txBuf.reset();
+	txOff = 0;
+    }
+    txBuf.put(c);
+    txKick();
+}
+
+/*
+ * Arrange for buffered data to be put on the line;
+ * when pacing this happens on the next clock tick.
+ */
+void
+SimModem::txKick()
+{
+    if (speed == 0)
+	txRelease();
+    else if (!ticking) {
+	ticking = true;
+	double t = txStart - now();
+	schedule(t > 0.010 ? t : 0.010);
+    }
+}
+
+/*
+ * Clock host data onto the line.
+ */
+void
+SimModem::txRelease()
+{
+    u_int avail = txBuf.getLength() - txOff;
+    u_int n = avail;
+    if (speed > 0) {
+	double t = now();
+	txCredit += (t - txLast) * txBps/8 * speed;
+	txLast = t;
+	if (n > txCredit)
+	    n = (txCredit > 0 ? (u_int) txCredit : 0);
+	txCredit -= n;
+    }
+    if (n > 0) {
+	lineSend((const u_char*) (const char*) txBuf + txOff, n);
+	txOff += n;
+    }
+    if (txOff < txBuf.getLength() ||
+      (txEnd && state == TXHDLC && speed > 0 && txCredit < 2)) {
+	ticking = true;			// more to send (or the FCS)
+	schedule(0.010);
+	return;
+    }
+    if (speed > 0 && !txEnd)
+	txCredit = 0;			// no credit for idle time
+    if (txEnd)
+	txFinish();
+    if (!reading)
+	process();
+}
+
+/*
+ * The host has completed a frame or its data and
+ * everything has been put on the line.
+ */
+void
+SimModem::txFinish()
+{
+    txEnd = false;
+    txDLE = false;
+    txBuf.reset();
+    txOff = 0;
+    if (state == TXHDLC) {
+	u_short fcs = ~txFCS;
+	u_char b[2];
+	b[0] = fcs & 0xff;
+	b[1] = fcs >> 8;
+	lineSend(b, 2);
+	bool final = true;
+	if (txBurst && txBurst->data.getLength() > 1)
+	    final = (txBurst->data[1] & 0x10) != 0;	// P/F bit, LSB first
+	if (txBurst) {
+	    txBurst->done = true;
+	    txBurst->doneAt = now();
+	    peer->carrierData(txBurst);
+	    txBurst = NULL;
+	}
+	txFCS = FCS_INIT;
+	if (final) {
+	    txCarrier = false;
+	    state = CMD;
+	    result("OK");
+	} else {
+	    txBurst = connected ? peer->newBurst(V21) : NULL;
+	    result("CONNECT");
+	}
+    } else {
+	if (txBurst) {
+	    txBurst->done = true;
+	    txBurst->doneAt = now();
+	    peer->carrierData(txBurst);
+	    txBurst = NULL;
+	}
+	txCarrier = false;
+	state = CMD;
+	result("OK");
+    }
+}
+
+/*
+ * Put bytes on the line, applying bit errors.
+ */
+void
+SimModem::lineSend(const u_char* cp, u_int n)
+{
+    if (!txBurst || txBurst->dropped)
+	return;
+    if (ber > 0) {
+	double pbyte = 1 - pow(1 - ber, 8);
+	for (u_int i = 0; i < n; i++) {
+	    u_char c = cp[i];
+	    if (drand48() < pbyte)
+		c ^= 1 << (lrand48() & 7);
+	    txBurst->data.put(c);
+	}
+    } else
+	txBurst->data.put((const char*) cp, n);
+    peer->carrierData(txBurst);
+}
+
+Burst*
+SimModem::newBurst(u_int mod)
+{
+    Burst* b = new Burst(mod);
+    Burst** bpp;
+    for (bpp = &rxq; *bpp; bpp = &(*bpp)->next)
+	;
+    *bpp = b;
+    return (b);
+}
+
+/*
+ * Begin transmitting: +FTH, +FTM or answering.
+ */
+void
+SimModem::startTransmit(State s, u_int mod)
+{
+    u_int i;
+    for (i = 0; i < NMODS && modulations[i].code != mod; i++)
+	;
+    state = s;
+    txEnd = txDLE = false;
+    txBuf.reset();
+    txOff = 0;
+    txFCS = FCS_INIT;
+    txCredit = 0;
+    txBps = modulations[i].bps;
+    double train = (s == TXHDLC && txCarrier) ? 0 : modulations[i].trainms / 1000.;
+    txStart = txLast = now() + (speed > 0 ? train / speed : 0);
+    txMod = mod;
+    txCarrier = true;
+    txBurst = connected ? peer->newBurst(mod) : NULL;
+    result("CONNECT");
+}
+
+void
+SimModem::startReceive(State s, u_int mod)
+{
+    state = s;
+    rxMod = mod;
+    rxBurst = NULL;
+    rxOff = 0;
+    rxCheck();
+}
+
+/*
+ * Return the carrier currently heard on the line,
+ * discarding those that ended too long ago.
+ */
+Burst*
+SimModem::carrier()
+{
+    double t = now();
+    while (rxq && rxq->done && (rxq->dropped || t - rxq->doneAt > carrierHold)) {
+	Burst* b = rxq;
+	rxq = b->next;
+	if (!b->dropped)
+	    trace("carrier %u lost (%u bytes)", b->mod, b->data.getLength());
+	delete b;
+    }
+    Burst* b = rxq;
+    while (b && b->dropped)
+	b = b->next;
+    return (b);
+}
+
+/*
+ * Pass received carrier to the host when in +FRH or +FRM.
+ */
+void
+SimModem::rxCheck()
+{
+    if (state != RXHDLC && state != RXDATA)
+	return;
+    if (!rxBurst) {
+	Burst* b = carrier();
+	if (!b) {
+	    if (!connected) {
+		state = CMD;
+		result("NO CARRIER");
+	    }
+	    return;
+	}
+	if (b->mod != (state == RXHDLC ? V21 : rxMod)) {
+	    state = CMD;
+	    result("+FCERROR");
+	    return;
+	}
+	rxBurst = b;
+	rxOff = 0;
+	result("CONNECT");
+    }
+    u_int n = rxBurst->data.getLength();
+    if (rxOff < n) {
+	putStuffed((const u_char*) (const char*) rxBurst->data + rxOff, n - rxOff);
+	rxOff = n;
+    }
+    if (rxBurst->done) {
+	put("\020\003", 2);
+	bool ok = true;
+	if (state == RXHDLC) {
+	    u_short fcs = FCS_INIT;
+	    for (u_int i = 0; i < n; i++)
+		fcs = updateFCS(fcs, rxBurst->data[i]);
+	    ok = (n > 2 && fcs == FCS_GOOD);
+	}
+	rxBurst->dropped = true;	// consumed
+	rxBurst = NULL;
+	(void) carrier();
+	const char* r = (state == RXDATA ? "NO CARRIER" : ok ? "OK" : "ERROR");
+	state = CMD;
+	result(r);
+    }
+}
+
+/*
+ * The host interrupted +FRH or +FRM.
+ */
+void
+SimModem::rxAbort()
+{
+    if (rxBurst) {
+	rxBurst->dropped = true;
+	rxBurst = NULL;
+	(void) carrier();
+    }
+    state = CMD;
+    result("OK");
+}
+
+/*
+ * Discard everything received.  Carriers still
+ * being sent are marked so the sender's data
+ * is thrown away; they are reclaimed once done.
+ */
+void
+SimModem::flushReceive()
+{
+    rxBurst = NULL;
+    for (Burst** bpp = &rxq; *bpp; ) {
+	Burst* b = *bpp;
+	if (b->done) {
+	    *bpp = b->next;
+	    delete b;
+	} else {
+	    b->dropped = true;
+	    bpp = &b->next;
+	}
+    }
+}
+
+/*
+ * New data from the peer's carrier.
+ */
+void
+SimModem::carrierData(Burst*)
+{
+    if (state == RXHDLC || state == RXDATA)
+	rxCheck();
+}
+
+/*
+ * AT command processing.
+ */
+#define	CMD_NEXT	0		// continue with the next command
+#define	CMD_ERROR	1		// reply ERROR
+#define	CMD_ACTION	2		// command has taken over
+
+static u_int
+number(const char*& cp)
+{
+    u_int v = 0;
+    while (isdigit(*cp))
+	v = 10*v + (*cp++ - '0');
+    return (v);
+}
+
+void
+SimModem::doLine()
+{
+    fxStr cmd((const char*) line, line.getLength());
+    line.reset();
+    trace("--> %s", (const char*) cmd);
+    const char* cp = cmd;
+    while (isspace(*cp))
+	cp++;
+    if (strncasecmp(cp, "AT", 2) != 0)
+	return;
+    cp += 2;
+    int r = CMD_NEXT;
+    while (*cp && r == CMD_NEXT)
+	r = doCommand(cp);
+    if (r == CMD_NEXT)
+	result("OK");
+    else if (r == CMD_ERROR)
+	result("ERROR");
+}
+
+int
+SimModem::doCommand(const char*& cp)
+{
+    char c = toupper(*cp++);
+    u_int n;
+    switch (c) {
+    case ' ':
+	break;
+    case '+':
+	return (doExtended(cp));
+    case 'D':
+	trace("dial %s", cp);
+	cp += strlen(cp);
+	dial();
+	return (CMD_ACTION);
+    case 'A':
+	answer();
+	return (CMD_ACTION);
+    case 'H':
+	(void) number(cp);
+	hangup();
+	break;
+    case 'Z':
+	(void) number(cp);
+	hangup();
+	reset();
+	break;
+    case 'E':
+	echo = (number(cp) != 0);
+	break;
+    case 'I':
+	switch (number(cp)) {
+	case 0:	result("modemsim"); break;
+	case 3:	result("HylaFAX"); break;
+	}
+	break;
+    case 'S':
+	n = number(cp);
+	if (n >= 100)
+	    return (CMD_ERROR);
+	if (*cp == '=') {
+	    cp++;
+	    sreg[n] = number(cp);
+	} else if (*cp == '?') {
+	    cp++;
+	    result(fxStr::format("%03u", sreg[n]));
+	}
+	break;
+    case '&':
+    case '\\':
+    case '%':
+	if (*cp)
+	    cp++;
+	(void) number(cp);
+	break;
+    default:
+	if (!isalpha(c))
+	    return (CMD_ERROR);
+	(void) number(cp);
+	break;
+    }
+    return (CMD_NEXT);
+}
+
+/*
+ * Extended (+F) commands.  Anything not
+ * understood is accepted and ignored.
+ */
+int
+SimModem::doExtended(const char*& cp)
+{
+    fxStr name;
+    while (isalnum(*cp))
+	name.append(toupper(*cp++));
+    bool test = false, query = false;
+    fxStr arg;
+    if (*cp == '=') {
+	cp++;
+	if (*cp == '?')
+	    test = true, cp++;
+	else
+	    while (*cp && *cp != ';')
+		arg.append(*cp++);
+    } else if (*cp == '?')
+	query = true, cp++;
+    if (*cp == ';')
+	cp++;
+
+    if (name == "FCLASS") {
+	if (test)
+	    result("0,1,1.0");
+	else if (query)
+	    result(fclass ? "1" : "0");
+	else
+	    fclass = (arg == "0" ? 0 : 1);
+    } else if (name == "FTM" || name == "FRM") {
+	if (test)
+	    result(modList);
+	else if (!query) {
+	    u_int mod = atoi(arg);
+	    u_int i;
+	    for (i = 1; i < NMODS && modulations[i].code != mod; i++)
+		;
+	    if (i == NMODS)
+		return (CMD_ERROR);
+	    if (name == "FTM")
+		startTransmit(TXDATA, mod);
+	    else
+		startReceive(RXDATA, mod);
+	    return (CMD_ACTION);
+	}
+    } else if (name == "FTH" || name == "FRH") {
+	if (test)
+	    result("3");
+	else if (!query) {
+	    if (atoi(arg) != V21)
+		return (CMD_ERROR);
+	    if (name == "FTH")
+		startTransmit(TXHDLC, V21);
+	    else
+		startReceive(RXHDLC, V21);
+	    return (CMD_ACTION);
+	}
+    } else if (name == "FTS" || name == "FRS") {
+	if (test)
+	    result("0-255");
+	else if (!query) {
+	    delay(10*atoi(arg));
+	    return (CMD_ACTION);
+	}
+    } else if (name == "FMI" || name == "GMI") {
+	result("HylaFAX");
+    } else if (name == "FMM" || name == "GMM") {
+	result("modemsim");
+    } else if (name == "FMR" || name == "GMR") {
+	result("1.0");
+    }
+    return (CMD_NEXT);
+}
+
+/*
+ * +FTS and +FRS: wait for the given time.
+ */
+void
+SimModem::delay(u_int ms)
+{
+    if (speed == 0 || ms == 0) {
+	result("OK");
+	return;
+    }
+    state = DELAY;
+    schedule(ms / 1000. / speed);
+}
+
+void
+SimModem::hangup()
+{
+    if (!offHook)
+	return;
+    trace("on hook");
+    if (state == DIALING)
+	peer->stopRinging();
+    Dispatcher::instance().stopTimer(this);
+    ticking = false;
+    if (txBurst) {
+	txBurst->done = true;
+	txBurst->doneAt = now();
+	peer->carrierData(txBurst);
+	txBurst = NULL;
+    }
+    txCarrier = false;
+    bool wasConnected = connected;
+    offHook = connected = false;
+    flushReceive();
+    state = CMD;
+    if (wasConnected)
+	peer->remoteHangup();
+}
+
+void
+SimModem::dial()
+{
+    if (peer->offHook) {
+	result("BUSY");
+	return;
+    }
+    offHook = true;
+    flushReceive();
+    state = DIALING;
+    peer->ring();
+    schedule(sreg[7] ? sreg[7] : 60);
+}
+
+void
+SimModem::answer()
+{
+    if (!ringing) {
+	result("NO CARRIER");
+	return;
+    }
+    trace("answer");
+    stopRinging();
+    offHook = true;
+    connected = true;
+    flushReceive();
+    peer->answered();
+    startTransmit(TXHDLC, V21);		// T.31: answer in V.21 transmit
+}
+
+/*
+ * Incoming call from the peer.
+ */
+void
+SimModem::ring()
+{
+    ringing = true;
+    rings = 0;
+    schedule(speed > 0 ? 1 / speed : 0);
+}
+
+void
+SimModem::stopRinging()
+{
+    if (ringing) {
+	ringing = false;
+	Dispatcher::instance().stopTimer(this);
+    }
+}
+
+/*
+ * The peer answered our call: wait for its
+ * V.21 carrier as for +FRH=3.
+ */
+void
+SimModem::answered()
+{
+    Dispatcher::instance().stopTimer(this);
+    connected = true;
+    startReceive(RXHDLC, V21);
+}
+
+void
+SimModem::remoteHangup()
+{
+    trace("remote on hook");
+    connected = false;
+    rxCheck();
+}
+
+void
+SimModem::timerExpired(long, long)
+{
+    switch (state) {
+    case DIALING:
+	peer->stopRinging();
+	offHook = false;
+	state = CMD;
+	result("NO CARRIER");
+	break;
+    case DELAY:
+	state = CMD;
+	result("OK");
+	break;
+    case TXHDLC:
+    case TXDATA:
+	ticking = false;
+	txRelease();
+	break;
+    default:
+	if (ringing) {
+	    sreg[1] = ++rings;
+	    result("RING");
+	    if (sreg[0] && rings >= sreg[0])
+		answer();
+	    else
+		schedule(speed > 0 ? 6 / speed : 6);
+	}
+	break;
+    }
+}
+
+const char* appName;
+static const char* links[2];
+
+static void
+usage()
+{
+    fprintf(stderr, _("usage: %s [-v] [-e ber] [-s speed] device1 device2\n"), appName);
+    _exit(-1);
+}
+
+static void
+cleanup(int)
+{
+    for (u_int i = 0; i < 2; i++)
+	if (links[i])
+	    (void) Sys::unlink(links[i]);
+    _exit(0);
+}
+
+int
+main(int argc, char* argv[])
+{
+    extern int optind;
+    extern char* optarg;
+    int c;
+
+    NLS::Setup("hylafax-server");
+    appName = argv[0];
+    while ((c = Sys::getopt(argc, argv, "e:s:v")) != -1)
+	switch (c) {
+	case 'e':
+	    ber = atof(optarg);
+	    break;
+	case 's':
+	    speed = atof(optarg);
+	    break;
+	case 'v':
+	    verbose = true;
+	    break;
+	case '?':
+	    usage();
+	    /*NOTREACHED*/
+	}
+    if (argc - optind != 2 || speed < 0 || ber < 0 || ber >= 1)
+	usage();
+    setupFCS();
+    srand48(1);				// repeatable error patterns
+    SimModem a(argv[optind]);
+    SimModem b(argv[optind+1]);
+    a.setPeer(&b);
+    b.setPeer(&a);
+    signal(SIGINT, fxSIGHANDLER(cleanup));
+    signal(SIGTERM, fxSIGHANDLER(cleanup));
+    signal(SIGHUP, fxSIGHANDLER(cleanup));
+    links[0] = argv[optind];
+    if (!a.open(links[0]))
+	cleanup(0);
+    links[1] = argv[optind+1];
+    if (!b.open(links[1]))
+	cleanup(0);
+    fflush(stdout);
+    for (;;)
+	Dispatcher::instance().dispatch();
+    /*NOTREACHED*/
+}
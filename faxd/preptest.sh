@@ -0,0 +1,230 @@
+#! /bin/sh
+#	$Id$
+#
+# HylaFAX Facsimile Software
+#
+# Copyright (c) 2026 iFAX Solutions, Inc.
+# HylaFAX is a trademark of Silicon Graphics
+#
+# Permission to use, copy, modify, distribute, and sell this software and
+# its documentation for any purpose is hereby granted without fee, provided
+# that (i) the above copyright notices and this permission notice appear in
+# all copies of the software and related documentation, and (ii) the names of
+# Sam Leffler and Silicon Graphics may not be used in any advertising or
+# publicity relating to the software without the specific, prior written
+# permission of Sam Leffler and Silicon Graphics.
+#
+# THE SOFTWARE IS PROVIDED "AS-IS" AND WITHOUT WARRANTY OF ANY KIND,
+# EXPRESS, IMPLIED OR OTHERWISE, INCLUDING WITHOUT LIMITATION, ANY
+# WARRANTY OF MERCHANTABILITY OR FITNESS FOR A PARTICULAR PURPOSE.
+#
+# IN NO EVENT SHALL SAM LEFFLER OR SILICON GRAPHICS BE LIABLE FOR
+# ANY SPECIAL, INCIDENTAL, INDIRECT OR CONSEQUENTIAL DAMAGES OF ANY KIND,
+# OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS,
+# WHETHER OR NOT ADVISED OF THE POSSIBILITY OF DAMAGE, AND ON ANY THEORY OF
+# LIABILITY, ARISING OUT OF OR IN CONNECTION WITH THE USE OR PERFORMANCE
+# OF THIS SOFTWARE.
+#
+
+#
+# preptest [-n jobs] [-w workers] [-b bindir] [-u user] [-k] document.tif
+#
+# Run jobs through faxq's pool of job preparation workers.
+#
+# A scratch spooling area is set up with PrepareWorkers set and faxq
+# is started on it.  Each job sends its own copy of the document as
+# a TIFF file to be imaged, so each is prepared by a worker: the
+# document is imaged with a stub converter that copies it (and logs
+# each run), and the job is handed to a stub send command that saves
+# the prepared job description and reports the job done.  Another
+# job is then sent after etc/config has been changed.  The test fails
+# unless every job is imaged and done, the same workers prepare all
+# of the jobs before the change and none of them is left after it,
+# and the document is imaged only once (the other jobs must find
+# it in the document cache).  faxq and faxqconv are taken from bindir
+# (default the current directory) and faxq must be started by root;
+# the spooling area is given to the fax user (default uucp).  With -k
+# the spooling area is kept for inspection.
+#
+JOBS=3
+WORKERS=2
+BINDIR=.
+FAXUSER=uucp
+KEEP=no
+
+usage()
+{
+    echo "Usage: $0 [-n jobs] [-w workers] [-b bindir] [-u user] [-k] document.tif"
+    exit 1
+}
+
+while [ $# -gt 0 ]; do
+    case "$1" in
+    -n)	shift; JOBS=$1;;
+    -w)	shift; WORKERS=$1;;
+    -b)	shift; BINDIR=$1;;
+    -u)	shift; FAXUSER=$1;;
+    -k)	KEEP=yes;;
+    -*)	usage;;
+    *)	break;;
+    esac
+    shift
+done
+[ $# -eq 1 ] || usage
+DOC=$1
+[ -f "$DOC" ] || { echo "$0: $DOC: No such file"; exit 1; }
+case "$BINDIR" in
+/*)	;;
+*)	BINDIR=`pwd`/$BINDIR;;
+esac
+for p in faxq faxqconv; do
+    [ -x $BINDIR/$p ] || { echo "$0: $BINDIR/$p: Not found"; exit 1; }
+done
+
+SPOOL=`mktemp -d /tmp/preptestXXXXXX` || exit 1
+FAXQPID=
+cleanup()
+{
+    [ -n "$FAXQPID" ] && kill $FAXQPID 2>/dev/null && wait $FAXQPID
+    rm -f /var/lock/LCK..ttyprep
+    if [ $KEEP = yes ]; then
+	echo "Spooling area kept in $SPOOL"
+    else
+	rm -rf $SPOOL
+    fi
+}
+trap 'cleanup; exit 1' 1 2 15
+fail()
+{
+    echo "$0: $*"
+    cleanup
+    exit 1
+}
+
+for d in bin client dev docq doneq etc info log recvq sendq status tmp; do
+    mkdir $SPOOL/$d
+done
+: > $SPOOL/etc/setup.cache
+cat > $SPOOL/etc/config <<EOF2
+LogFacility:		daemon
+CountryCode:		1
+AreaCode:		555
+LongDistancePrefix:	1
+InternationalPrefix:	011
+PrepareWorkers:		$WORKERS
+DocumentCacheSize:	1024
+Tiff2FaxCmd:		bin/tiff2fax
+SendFaxCmd:		bin/faxsend
+EOF2
+#
+# The converter is invoked as tiff2fax -o output ... input.
+#
+cat > $SPOOL/bin/tiff2fax <<'EOF2'
+#! /bin/sh
+while [ $# -gt 1 ]; do
+    case "$1" in
+    -o)	shift; out=$1;;
+    esac
+    shift
+done
+echo "$1" >> tmp/convert.log
+cp "$1" "$out"
+EOF2
+#
+# The send command is invoked as faxsend -m modem qfile ...
+#
+cat > $SPOOL/bin/faxsend <<EOF2
+#! /bin/sh
+LD_LIBRARY_PATH=$LD_LIBRARY_PATH; export LD_LIBRARY_PATH
+shift; shift
+for q do
+    j=\`basename \$q\`
+    $BINDIR/faxqconv -p \$q > tmp/prepared.\$j
+    $BINDIR/faxqconv -t \$q
+    sed 's/^returned:.*/returned:2/' \$q > tmp/returned
+    cat tmp/returned > \$q
+done
+EOF2
+chmod 755 $SPOOL/bin/tiff2fax $SPOOL/bin/faxsend
+chown -R $FAXUSER $SPOOL || fail "Can not give the spooling area to $FAXUSER"
+
+workers()				# sorted PIDs of the workers
+{
+    ps -o pid= --ppid $FAXQPID | sort -n | tr -d ' ' | tr '\n' ' '
+}
+submit()				# send job $1 and wait for it to be done
+{
+    cp "$DOC" $SPOOL/docq/doc$1.tif
+    cat > $SPOOL/sendq/q$1 <<EOF2
+tts:0
+killtime:`expr \`date +%s\` + 3600`
+state:3
+totpages:0
+maxdials:1
+maxtries:1
+pagewidth:209
+resolution:98
+pagelength:296
+priority:127
+desireddf:1
+number:5550199
+external:5550199
+mailaddr:preptest@localhost
+sender:preptest
+jobid:$1
+owner:preptest
+modem:any
+client:localhost
+jobtype:facsimile
+notify:none
+tiff:0::docq/doc$1.tif
+EOF2
+    chown $FAXUSER $SPOOL/docq/doc$1.tif $SPOOL/sendq/q$1
+    printf "+ttyprep:R\0" > $SPOOL/FIFO
+    printf "S$1\0" > $SPOOL/FIFO
+    n=0
+    until [ -f $SPOOL/doneq/q$1 ]; do
+	n=`expr $n + 1`
+	[ $n -gt 300 ] && fail "Job $1 was not done"
+	sleep 0.1
+    done
+    grep -q '^fax:.*docq/' $SPOOL/tmp/prepared.q$1 ||
+	fail "Job $1 was not prepared"
+}
+
+$BINDIR/faxq -D -q $SPOOL > /dev/null 2>&1 &
+FAXQPID=$!
+n=0
+until [ -p $SPOOL/FIFO ]; do
+    n=`expr $n + 1`
+    [ $n -gt 100 ] && fail "faxq did not start"
+    sleep 0.1
+done
+
+submit 1
+FIRST=`workers`
+i=2
+while [ $i -le $JOBS ]; do
+    submit $i
+    [ "`workers`" = "$FIRST" ] || fail "Workers were replaced without a configuration change"
+    i=`expr $i + 1`
+done
+set -- $FIRST
+[ $# -eq $WORKERS ] || fail "$# workers running, expected $WORKERS"
+
+sleep 1					# config mtime must change
+echo "JobReqOther:		301" >> $SPOOL/etc/config
+submit $i
+NEXT=`workers`				# replacements are forked on demand
+[ -n "$NEXT" ] || fail "No workers running after a configuration change"
+for p in $FIRST; do
+    case " $NEXT " in
+    *" $p "*)	fail "Worker $p was kept after a configuration change";;
+    esac
+done
+CONVERTED=`wc -l < $SPOOL/tmp/convert.log`
+[ $CONVERTED -eq 1 ] || fail "Document imaged $CONVERTED times, expected once"
+
+echo "$i jobs prepared by workers" $FIRST "then" $NEXT
+cleanup
+exit 0
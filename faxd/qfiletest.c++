@@ -0,0 +1,249 @@
+/*	$Id$ */
+/*
+ * Copyright (c) 2026 iFAX Solutions, Inc.
+ * HylaFAX is a trademark of Silicon Graphics
+ *
+ * Permission to use, copy, modify, distribute, and sell this software and
+ * its documentation for any purpose is hereby granted without fee, provided
+ * that (i) the above copyright notices and this permission notice appear in
+ * all copies of the software and related documentation, and (ii) the names of
+ * Sam Leffler and Silicon Graphics may not be used in any advertising or
+ * publicity relating to the software without the specific, prior written
+ * permission of Sam Leffler and Silicon Graphics.
+ *
+ * THE SOFTWARE IS PROVIDED "AS-IS" AND WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS, IMPLIED OR OTHERWISE, INCLUDING WITHOUT LIMITATION, ANY
+ * WARRANTY OF MERCHANTABILITY OR FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * IN NO EVENT SHALL SAM LEFFLER OR SILICON GRAPHICS BE LIABLE FOR
+ * ANY SPECIAL, INCIDENTAL, INDIRECT OR CONSEQUENTIAL DAMAGES OF ANY KIND,
+ * OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS,
+ * WHETHER OR NOT ADVISED OF THE POSSIBILITY OF DAMAGE, AND ON ANY THEORY OF
+ * LIABILITY, ARISING OUT OF OR IN CONNECTION WITH THE USE OR PERFORMANCE
+ * OF THIS SOFTWARE.
+ */
+
+/*
+ * Program for measuring the cost of reading and writing job
+ * description files in the text and binary formats.
+ *
+ * A representative job with a few documents is written to a
+ * temporary file in each format, then each file is read n times
+ * (default 10000) through a new FaxRequest, as faxq does when it
+ * loads a job, and rewritten n times, as faxq and faxsend do when
+ * they update one.  The time per read and per write is reported.
+ * The program fails if either file does not read back to the job
+ * that was written.
+ *
+ * Usage: qfiletest [-n iterations] [-d dir]
+ */
+#include <sys/time.h>
+#include <stdarg.h>
+#include <string.h>
+#include <errno.h>
+#include "FaxRequest.h"
+#include "StackBuffer.h"
+#include "Sys.h"
+#include "NLS.h"
+
+const char* appName;
+
+void
+usage()
+{
+    fprintf(stderr, _("usage: %s [-n iterations] [-d dir]\n"), appName);
+    exit(-1);
+}
+
+static double
+now()
+{
+    struct timeval tv;
+    gettimeofday(&tv, 0);
+    return (tv.tv_sec + tv.tv_usec / 1000000.);
+}
+
+class TestRequest : public FaxRequest {
+public:
+    TestRequest(const fxStr& qf, int fd) : FaxRequest(qf, fd) {}
+
+    bool checkDocument(const char*)	{ return (true); }
+    void error(const char* fmt ...);
+    void text(fxStackBuffer& sb)	{ writeTextQFile(sb); }
+};
+
+void
+TestRequest::error(const char* fmt ...)
+{
+    fprintf(stderr, "%s: %s: ", appName, (const char*) qfile);
+    va_list ap;
+    va_start(ap, fmt);
+    vfprintf(stderr, fmt, ap);
+    va_end(ap);
+    fputc('\n', stderr);
+}
+
+/*
+ * Fill in a job much like one submitted by sendfax
+ * with a cover page and two PostScript documents.
+ */
+static void
+setupJob(FaxRequest& req)
+{
+    req.tts = Sys::now();
+    req.killtime = req.tts + 3*60*60;
+    req.retrytime = 300;
+    req.state = FaxRequest::state_ready;
+    req.pri = req.usrpri = 127;
+    req.pagewidth = 209;
+    req.pagelength = 296;
+    req.resolution = 196;
+    req.totpages = 5;
+    req.maxdials = 12;
+    req.maxtries = 3;
+    req.notify = FaxRequest::when_done;
+    req.jobid = "1234";
+    req.groupid = "1234";
+    req.owner = "jsmith";
+    req.sender = "John Smith";
+    req.mailaddr = "jsmith@example.com";
+    req.jobtag = "quarterly report";
+    req.number = "15551234567";
+    req.external = "+1 555 123 4567";
+    req.modem = "any";
+    req.client = "client.example.com";
+    req.receiver = "Jane Doe";
+    req.company = "Example Corp";
+    req.regarding = "Q3 figures";
+    req.comments = "Figures as discussed; please call with questions.";
+    req.tagline = "From %%n|%c|Page %%P of %%T";
+    req.doneop = "default";
+    req.items.append(FaxItem(FaxRequest::send_postscript, 0, "",
+	"docq/doc1234.cover"));
+    req.items.append(FaxItem(FaxRequest::send_postscript, 0, "",
+	"docq/doc1235.ps"));
+    req.items.append(FaxItem(FaxRequest::send_postscript, 0, "",
+	"docq/doc1236.ps"));
+}
+
+/*
+ * Write the job to a new temporary file in the
+ * given format and return the open descriptor.
+ */
+static int
+writeJob(const fxStr& dir, bool binary, fxStr& qfile)
+{
+    char templ[1024];
+    snprintf(templ, sizeof (templ), "%s/qfiletestXXXXXX", (const char*) dir);
+    int fd = Sys::mkstemp(templ);
+    if (fd < 0) {
+	fprintf(stderr, _("%s: %s: Cannot create: %s\n"),
+	    appName, templ, strerror(errno));
+	exit(-1);
+    }
+    qfile = templ;
+    TestRequest req(qfile, fd);
+    setupJob(req);
+    req.binary = binary;
+    req.writeQFile();
+    req.fd = -1;				// keep file open
+    return (fd);
+}
+
+/*
+ * Time n reads and n writes of the file and check that
+ * it reads back to the expected text form.
+ */
+static bool
+runJob(const fxStr& qfile, int fd, bool binary, u_int n,
+    const fxStackBuffer& expect)
+{
+    bool ok = true;
+    bool reject;
+    double start = now();
+    for (u_int i = 0; i < n; i++) {
+	TestRequest req(qfile, fd);
+	if (!req.readQFile(reject) || reject)
+	    ok = false;
+	req.fd = -1;
+    }
+    double read = now();
+    TestRequest req(qfile, fd);
+    if (!req.readQFile(reject) || reject || req.binary != binary)
+	ok = false;
+    double start2 = now();
+    for (u_int i = 0; i < n; i++)
+	req.writeQFile();
+    double written = now();
+    req.fd = -1;
+
+    TestRequest check(qfile, fd);
+    fxStackBuffer sb;
+    if (check.readQFile(reject) && !reject) {
+	check.text(sb);
+	if (sb.getLength() != expect.getLength() ||
+	  memcmp((const char*) sb, (const char*) expect, sb.getLength()) != 0)
+	    ok = false;
+    } else
+	ok = false;
+    check.fd = -1;
+    printf(_("%-6s %5lu bytes  read %6.2f us  write %6.2f us%s\n"),
+	binary ? "binary" : "text", (u_long) lseek(fd, 0L, SEEK_END),
+	1000000*(read - start) / n, 1000000*(written - start2) / n,
+	ok ? "" : _("  MISMATCH"));
+    return (ok);
+}
+
+int
+main(int argc, char* argv[])
+{
+    extern int optind;
+    extern char* optarg;
+    u_int n = 10000;
+    fxStr dir("/tmp");
+    int c;
+
+    NLS::Setup("hylafax-server");
+    appName = argv[0];
+    while ((c = Sys::getopt(argc, argv, "d:n:")) != -1)
+	switch (c) {
+	case 'd':
+	    dir = optarg;
+	    break;
+	case 'n':
+	    n = atoi(optarg);
+	    break;
+	case '?':
+	    usage();
+	    /*NOTREACHED*/
+	}
+    if (argc != optind || n < 1)
+	usage();
+
+    /*
+     * The text form of a job that has been read back is
+     * the reference, since reading fills in defaults.
+     */
+    fxStr tqfile, bqfile;
+    int tfd = writeJob(dir, false, tqfile);
+    int bfd = writeJob(dir, true, bqfile);
+    fxStackBuffer expect;
+    {
+	bool reject;
+	TestRequest req(tqfile, tfd);
+	if (!req.readQFile(reject) || reject) {
+	    fprintf(stderr, _("%s: Cannot read back text job\n"), appName);
+	    exit(-1);
+	}
+	req.text(expect);
+	req.fd = -1;
+    }
+    bool ok = runJob(tqfile, tfd, false, n, expect);
+    if (!runJob(bqfile, bfd, true, n, expect))
+	ok = false;
+    Sys::close(tfd);
+    Sys::close(bfd);
+    Sys::unlink(tqfile);
+    Sys::unlink(bqfile);
+    return (ok ? 0 : 1);
+}
@@ -0,0 +1,185 @@
+#! /bin/sh
+#	$Id$
+#
+# HylaFAX Facsimile Software
+#
+# Copyright (c) 2026 iFAX Solutions, Inc.
+# HylaFAX is a trademark of Silicon Graphics
+#
+# Permission to use, copy, modify, distribute, and sell this software and
+# its documentation for any purpose is hereby granted without fee, provided
+# that (i) the above copyright notices and this permission notice appear in
+# all copies of the software and related documentation, and (ii) the names of
+# Sam Leffler and Silicon Graphics may not be used in any advertising or
+# publicity relating to the software without the specific, prior written
+# permission of Sam Leffler and Silicon Graphics.
+#
+# THE SOFTWARE IS PROVIDED "AS-IS" AND WITHOUT WARRANTY OF ANY KIND,
+# EXPRESS, IMPLIED OR OTHERWISE, INCLUDING WITHOUT LIMITATION, ANY
+# WARRANTY OF MERCHANTABILITY OR FITNESS FOR A PARTICULAR PURPOSE.
+#
+# IN NO EVENT SHALL SAM LEFFLER OR SILICON GRAPHICS BE LIABLE FOR
+# ANY SPECIAL, INCIDENTAL, INDIRECT OR CONSEQUENTIAL DAMAGES OF ANY KIND,
+# OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS,
+# WHETHER OR NOT ADVISED OF THE POSSIBILITY OF DAMAGE, AND ON ANY THEORY OF
+# LIABILITY, ARISING OUT OF OR IN CONNECTION WITH THE USE OR PERFORMANCE
+# OF THIS SOFTWARE.
+#
+
+
+#
+# schedbench [-n "jobs ..."] [-p passes] [-b bindir] [-u user] [-k]
+#
+# Measure the cost of a faxq scheduler pass as the send queue grows.
+#
+# For each queue size a scratch spooling area is filled with that many
+# jobs, each to a different destination and each bound to a modem group
+# that never has a ready modem, and faxq is started on it.  Another modem is then
+# repeatedly announced as ready; each announcement makes faxq run the
+# scheduler over the whole queue without being able to start any job.
+# The CPU time faxq uses per pass is reported with IndexedScheduler
+# disabled and enabled.  The queue sizes default to 1000, 10000 and
+# 100000.  faxq is taken from bindir (default the current directory)
+# and must be started by root; the spooling area is given to the fax
+# user (default uucp).  With -k the spooling areas are kept.
+#
+SIZES="1000 10000 100000"
+PASSES=20
+BINDIR=.
+FAXUSER=uucp
+KEEP=no
+
+usage()
+{
+    echo "Usage: $0 [-n \"jobs ...\"] [-p passes] [-b bindir] [-u user] [-k]"
+    exit 1
+}
+
+while [ $# -gt 0 ]; do
+    case "$1" in
+    -n)	shift; SIZES=$1;;
+    -p)	shift; PASSES=$1;;
+    -b)	shift; BINDIR=$1;;
+    -u)	shift; FAXUSER=$1;;
+    -k)	KEEP=yes;;
+    *)	usage;;
+    esac
+    shift
+done
+case "$BINDIR" in
+/*)	;;
+*)	BINDIR=`pwd`/$BINDIR;;
+esac
+[ -x $BINDIR/faxq ] || { echo "$0: $BINDIR/faxq: Not found"; exit 1; }
+
+HZ=`getconf CLK_TCK 2>/dev/null || echo 100`
+cputicks()				# user+system clock ticks of a process
+{
+    awk '{ sub(/.*\) /, ""); print $12 + $13 }' /proc/$1/stat 2>/dev/null || echo 0
+}
+idle()					# wait for a process to stop using CPU
+{
+    t=`cputicks $1`
+    while :; do
+	sleep 0.2
+	n=`cputicks $1`
+	[ "$n" = "$t" ] && break
+	t=$n
+    done
+}
+
+#
+# faxq runs the scheduler at most once a second and defers
+# requests that come sooner, so space the passes out.
+#
+poke()					# run one scheduler pass
+{
+    sleep 1
+    printf "+ttybench:R\0" > $SPOOL/FIFO
+    idle $1
+}
+
+SPOOL=
+FAXQPID=
+cleanup()
+{
+    [ -n "$FAXQPID" ] && kill $FAXQPID 2>/dev/null && wait $FAXQPID
+    FAXQPID=
+    if [ -n "$SPOOL" ]; then
+	if [ $KEEP = yes ]; then
+	    echo "Spooling area kept in $SPOOL"
+	else
+	    rm -rf $SPOOL
+	fi
+    fi
+    SPOOL=
+}
+trap 'cleanup; exit 1' 1 2 15
+
+printf "%8s  %-9s  %s\n" jobs scheduler "ms/pass"
+for jobs in $SIZES; do
+    for indexed in no yes; do
+	SPOOL=`mktemp -d /tmp/schedbenchXXXXXX` || exit 1
+	for d in bin client dev docq etc info log recvq sendq status tmp; do
+	    mkdir $SPOOL/$d
+	done
+	: > $SPOOL/etc/setup.cache
+	cat > $SPOOL/etc/config <<EOF2
+LogFacility:		daemon
+CountryCode:		1
+AreaCode:		555
+LongDistancePrefix:	1
+InternationalPrefix:	011
+IndexedScheduler:	$indexed
+MaxConcurrentCalls:	1
+ModemGroup:		"unused:^ttyunused$"
+EOF2
+	killtime=`expr \`date +%s\` + 30 \* 24 \* 60 \* 60`
+	awk -v n=$jobs -v dir=$SPOOL/sendq -v kt=$killtime 'BEGIN {
+	    for (i = 1; i <= n; i++) {
+		f = dir "/q" i
+		print "tts:0" > f
+		print "killtime:" kt > f
+		print "state:3" > f
+		print "totpages:1" > f
+		print "maxdials:1" > f
+		print "maxtries:1" > f
+		print "priority:127" > f
+		printf "number:555%07d\n", i > f
+		printf "external:555%07d\n", i > f
+		print "mailaddr:schedbench@localhost" > f
+		print "sender:schedbench" > f
+		print "jobid:" i > f
+		print "owner:schedbench" > f
+		print "modem:unused" > f
+		print "client:localhost" > f
+		print "jobtype:facsimile" > f
+		print "notify:none" > f
+		print "fax:0::docq/doc.tif" > f
+		close(f)
+	    }
+	}'
+	chown -R $FAXUSER $SPOOL || { cleanup; exit 1; }
+
+	$BINDIR/faxq -D -q $SPOOL > /dev/null 2>&1 &
+	FAXQPID=$!
+	n=0
+	until [ -p $SPOOL/FIFO ]; do
+	    n=`expr $n + 1`
+	    [ $n -gt 100 ] && { echo "$0: faxq did not start"; cleanup; exit 1; }
+	    sleep 0.1
+	done
+	idle $FAXQPID			# queue recovery
+	poke $FAXQPID			# first pass builds the run queue
+	t0=`cputicks $FAXQPID`
+	i=0
+	while [ $i -lt $PASSES ]; do
+	    poke $FAXQPID
+	    i=`expr $i + 1`
+	done
+	t1=`cputicks $FAXQPID`
+	awk -v j=$jobs -v m=$indexed -v t=`expr $t1 - $t0` -v p=$PASSES -v hz=$HZ \
+	    'BEGIN { printf "%8d  %-9s  %.2f\n", j, m == "yes" ? "indexed" : "linear", 1000*t/hz/p }'
+	cleanup
+    done
+done
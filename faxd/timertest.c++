@@ -0,0 +1,186 @@
+/*	$Id$ */
+/*
+ * Copyright (c) 2026 iFAX Solutions, Inc.
+ * HylaFAX is a trademark of Silicon Graphics
+ *
+ * Permission to use, copy, modify, distribute, and sell this software and
+ * its documentation for any purpose is hereby granted without fee, provided
+ * that (i) the above copyright notices and this permission notice appear in
+ * all copies of the software and related documentation, and (ii) the names of
+ * Sam Leffler and Silicon Graphics may not be used in any advertising or
+ * publicity relating to the software without the specific, prior written
+ * permission of Sam Leffler and Silicon Graphics.
+ *
+ * THE SOFTWARE IS PROVIDED "AS-IS" AND WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS, IMPLIED OR OTHERWISE, INCLUDING WITHOUT LIMITATION, ANY
+ * WARRANTY OF MERCHANTABILITY OR FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * IN NO EVENT SHALL SAM LEFFLER OR SILICON GRAPHICS BE LIABLE FOR
+ * ANY SPECIAL, INCIDENTAL, INDIRECT OR CONSEQUENTIAL DAMAGES OF ANY KIND,
+ * OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS,
+ * WHETHER OR NOT ADVISED OF THE POSSIBILITY OF DAMAGE, AND ON ANY THEORY OF
+ * LIABILITY, ARISING OUT OF OR IN CONNECTION WITH THE USE OR PERFORMANCE
+ * OF THIS SOFTWARE.
+ */
+
+/*
+ * Program for testing the Dispatcher's timer queue.
+ *
+ * A timer is started for each of n handlers (default 100000) with
+ * a pseudo-random delay of up to one second, every other one is
+ * then stopped and the dispatcher is run until the rest expire.
+ * The time taken to start and stop the timers is reported.  The
+ * program fails if a stopped timer expires, if a timer expires
+ * early, more than once or not at all, or if a timer expires
+ * before another one that was certainly due earlier.  Since a
+ * timer's deadline is taken when it is started, "certainly" means
+ * by more than the time it took to start all of them.
+ *
+ * Usage: timertest [-n timers] [-s seed]
+ */
+#include <sys/time.h>
+#include "Dispatcher.h"
+#include "IOHandler.h"
+#include "Sys.h"
+#include "NLS.h"
+
+#define	MAXDELAY	1000000			// longest delay (usecs)
+
+const char* appName;
+
+void
+usage()
+{
+    fprintf(stderr, _("usage: %s [-n timers] [-s seed]\n"), appName);
+    exit(-1);
+}
+
+static double
+now()
+{
+    struct timeval tv;
+    gettimeofday(&tv, 0);
+    return (tv.tv_sec + tv.tv_usec / 1000000.);
+}
+
+struct Tick : public IOHandler {
+    long	delay;				// usecs from start
+    bool	stopped;			// timer was stopped
+    u_int	fired;				// # times expired
+    double	when;				// time of expiration
+    u_int	seq;				// order of expiration
+
+    static u_int nfired;
+
+    Tick() : delay(0), stopped(false), fired(0), when(0), seq(0) {}
+    void timerExpired(long sec, long usec);
+};
+u_int Tick::nfired = 0;
+
+void
+Tick::timerExpired(long sec, long usec)
+{
+    fired++;
+    when = sec + usec / 1000000.;
+    seq = nfired++;
+}
+
+int
+main(int argc, char* argv[])
+{
+    extern int optind;
+    extern char* optarg;
+    u_int n = 100000;
+    u_long seed = 1;
+    int c;
+
+    NLS::Setup("hylafax-server");
+    appName = argv[0];
+    while ((c = Sys::getopt(argc, argv, "n:s:")) != -1)
+	switch (c) {
+	case 'n':
+	    n = atoi(optarg);
+	    break;
+	case 's':
+	    seed = strtoul(optarg, NULL, 0);
+	    break;
+	case '?':
+	    usage();
+	    /*NOTREACHED*/
+	}
+    if (argc != optind || n < 2)
+	usage();
+
+    Tick* ticks = new Tick[n];
+    srandom(seed);
+    for (u_int i = 0; i < n; i++)
+	ticks[i].delay = random() % MAXDELAY;
+
+    Dispatcher& d = Dispatcher::instance();
+    double start = now();
+    for (u_int i = 0; i < n; i++)
+	d.startTimer(0, ticks[i].delay, &ticks[i]);
+    double started = now();
+    for (u_int i = 0; i < n; i += 2) {
+	d.stopTimer(&ticks[i]);
+	ticks[i].stopped = true;
+    }
+    double stopped = now();
+    printf(_("%u timers started in %.2f ms, %u stopped in %.2f ms\n"),
+	n, 1000*(started - start), (n+1)/2, 1000*(stopped - started));
+
+    u_int expected = n/2;
+    double deadline = started + 2*MAXDELAY/1000000. + 5;
+    while (Tick::nfired < expected && now() < deadline) {
+	long sec = 1, usec = 0;
+	d.dispatch(sec, usec);
+    }
+
+    u_int errors = 0;
+    Tick** order = new Tick*[expected];
+    for (u_int i = 0; i < expected; i++)
+	order[i] = NULL;
+    for (u_int i = 0; i < n; i++) {
+	Tick& t = ticks[i];
+	if (t.stopped) {
+	    if (t.fired) {
+		printf(_("Stopped timer %u expired\n"), i);
+		errors++;
+	    }
+	} else if (t.fired != 1) {
+	    printf(_("Timer %u expired %u times\n"), i, t.fired);
+	    errors++;
+	} else {
+	    if (t.when < start + t.delay / 1000000.) {
+		printf(_("Timer %u expired %.3f ms early\n"), i,
+		    1000*(start + t.delay / 1000000. - t.when));
+		errors++;
+	    }
+	    if (t.seq < expected)
+		order[t.seq] = &t;
+	}
+    }
+    /*
+     * Timer i was due between start+delay and started+delay;
+     * no timer may expire after one that was due later than
+     * it could have been.
+     */
+    double latest = 0;
+    for (u_int i = 0; i < expected && order[i]; i++) {
+	Tick& t = *order[i];
+	if (started + t.delay / 1000000. < latest) {
+	    printf(_("Timer %u expired after a later one\n"), (u_int) (&t - ticks));
+	    errors++;
+	}
+	if (start + t.delay / 1000000. > latest)
+	    latest = start + t.delay / 1000000.;
+    }
+    delete [] order;
+    delete [] ticks;
+    if (errors) {
+	printf(_("%u errors\n"), errors);
+	return (1);
+    }
+    printf(_("%u timers expired in order, no stopped timer expired\n"), expected);
+    return (0);
+}
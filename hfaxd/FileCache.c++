@@ -24,11 +24,33 @@
  * OF THIS SOFTWARE.
  */
 #include "FileCache.h"
+#include "Dictionary.h"
 #include "Sys.h"
 
-u_int FileCache::master = 0;		// master serial number
-FileCache* FileCache::cache[4096];	// cache of stat results
-#define	CACHESIZE	(sizeof (cache) / sizeof (cache[0]))
+#include <fcntl.h>
+
+/*
+ * Per-directory state used to invalidate cached
+ * entries when the contents of a directory change.
+ */
+struct FileCacheDir {
+    dev_t	dev;			// identity of directory
+    ino_t	ino;
+    time_t	mtime;			// last modification time seen
+    bool	settled;		// mtime not in the current second
+    u_int	gen;			// bumped each time a change is seen
+
+    FileCacheDir() : dev(0), ino(0), mtime(0), settled(false), gen(0) {}
+};
+fxDECLARE_StrKeyDictionary(FileCacheDirDict, FileCacheDir*)
+fxIMPLEMENT_StrKeyPtrValueDictionary(FileCacheDirDict, FileCacheDir*)
+static FileCacheDirDict dirs;
+
+FileCache** FileCache::cache = NULL;	// cache of stat results
+u_int FileCache::cacheSize = 0;		// # slots in cache
+u_int FileCache::maxEntries = 4096;	// max # entries in cache
+u_int FileCache::numEntries = 0;	// current # entries in cache
+u_int FileCache::hand = 0;		// clock hand for replacement
 
 					// statistics
 u_int FileCache::lookups = 0;		// total # lookups
@@ -36,6 +58,9 @@ u_int FileCache::hits = 0;		// # lookups that hit in the cache
 u_int FileCache::probes = 0;		// total # probes during lookups
 u_int FileCache::displaced = 0;		// # entries reused
 u_int FileCache::flushed = 0;		// # entries flushed
+u_int FileCache::invalidated = 0;	// # entries discarded on dir change
+u_int FileCache::dirchanges = 0;	// # directory changes noticed
+u_int FileCache::scanned = 0;		// # entries loaded by scan
 
 void
 FileCache::printStats(FILE* fd)
@@ -45,23 +70,28 @@ FileCache::printStats(FILE* fd)
 	, hits
 #define	NZ(v)	((v) == 0 ? 1 : (v))
 	, (100.*hits)/NZ(lookups)
-	, float(lookups+probes)/float(NZ(lookups))
+	, float(probes)/float(NZ(lookups))
     );
-    u_int n = 0;
     u_int space = 0;
-    for (u_int i = 0; i < CACHESIZE; i++) {
+    for (u_int i = 0; i < cacheSize; i++) {
 	const FileCache* fi = cache[i];
-	if (fi) {
-	    n++;
+	if (fi)
 	    space += sizeof (*fi) + fi->name.length();
-	}
     }
     fprintf(fd, "        %u entries (%.1f KB), %u entries displaced, %u entries flushed\r\n"
-	, n
+	, numEntries
 	, space / 1024.
 	, displaced
 	, flushed
     );
+    fprintf(fd, "        %u max entries, %u slots, %u directories, %u directory changes, %u entries invalidated, %u entries scanned\r\n"
+	, maxEntries
+	, cacheSize
+	, dirs.size()
+	, dirchanges
+	, invalidated
+	, scanned
+    );
 }
 
 FileCache::FileCache() {}
@@ -70,19 +100,194 @@ FileCache::~FileCache() {}
 void
 FileCache::reset(void)
 {
-    for (u_int i = 0; i < CACHESIZE; i++)
+    for (u_int i = 0; i < cacheSize; i++) {
 	delete cache[i];
-    memset(cache, 0, sizeof (cache));
-    master = 0;					// doesn't matter???
+	cache[i] = NULL;
+    }
+    numEntries = 0;
+    hand = 0;
+    for (FileCacheDirDictIter iter(dirs); iter.notDone(); iter++)
+	iter.value()->settled = false;		// force re-examination
+}
+
+/*
+ * Set the maximum number of entries held in the cache;
+ * zero disables caching.  The table is sized to keep
+ * the load at or below one half and any current entries
+ * are rehashed into it (discarding the excess if the
+ * cache is shrinking).
+ */
+void
+FileCache::setMaxEntries(u_int n)
+{
+    u_int size = 16;
+    while (size < 2*n)
+	size <<= 1;
+    FileCache** ocache = cache;
+    u_int osize = cacheSize;
+    maxEntries = n;
+    cacheSize = size;
+    cache = new FileCache*[cacheSize];
+    memset(cache, 0, cacheSize * sizeof (FileCache*));
+    numEntries = 0;
+    hand = 0;
+    for (u_int i = 0; i < osize; i++) {
+	FileCache* fi = ocache[i];
+	if (!fi)
+	    continue;
+	if (numEntries < maxEntries) {
+	    u_int j = fi->hashval & (cacheSize-1);
+	    while (cache[j])
+		j = (j+1) & (cacheSize-1);
+	    cache[j] = fi;
+	    numEntries++;
+	} else {
+	    displaced++;
+	    delete fi;
+	}
+    }
+    delete [] ocache;
 }
 
+/*
+ * FNV-1a hash of a pathname.
+ */
 u_int
 FileCache::hash(const char* pathname)
 {
-    u_int h = 0;
-    while (*pathname)
-	h ^= *pathname++;
-    return (h % CACHESIZE);
+    u_int h = 2166136261U;
+    while (*pathname) {
+	h ^= (u_char) *pathname++;
+	h *= 16777619U;
+    }
+    return (h);
+}
+
+/*
+ * Locate pathname in the table; return its slot or -1.
+ */
+int
+FileCache::find(const char* pathname, u_int h, bool count)
+{
+    if (cacheSize == 0)
+	return (-1);
+    for (u_int i = h & (cacheSize-1);; i = (i+1) & (cacheSize-1)) {
+	if (count)
+	    probes++;
+	const FileCache* fi = cache[i];
+	if (!fi)
+	    return (-1);
+	if (fi->hashval == h && fi->name == pathname)
+	    return ((int) i);
+    }
+}
+
+/*
+ * Remove the entry in the specified slot.  Entries later
+ * in the probe sequence are shifted back to fill the hole
+ * so that lookups never need tombstones.
+ */
+void
+FileCache::remove(u_int i)
+{
+    delete cache[i];
+    cache[i] = NULL;
+    numEntries--;
+    u_int mask = cacheSize-1;
+    for (u_int j = (i+1) & mask; cache[j]; j = (j+1) & mask) {
+	u_int k = cache[j]->hashval & mask;
+	/*
+	 * Leave the entry alone if its home slot lies
+	 * cyclically in (i,j]; otherwise move it into
+	 * the hole and continue from its old slot.
+	 */
+	if (i <= j ? (i < k && k <= j) : (i < k || k <= j))
+	    continue;
+	cache[i] = cache[j];
+	cache[j] = NULL;
+	i = j;
+    }
+}
+
+/*
+ * Add a new entry, reclaiming one first if the cache is full.
+ */
+void
+FileCache::enter(const char* pathname, u_int h, const struct stat& sb,
+    FileCacheDir* dir)
+{
+    if (maxEntries == 0)
+	return;
+    if (cacheSize == 0)
+	setMaxEntries(maxEntries);
+    while (numEntries >= maxEntries) {
+	hand &= cacheSize-1;
+	FileCache* fi = cache[hand];
+	if (fi && fi->used)
+	    fi->used = false;
+	else if (fi) {
+	    displaced++;
+	    remove(hand);
+	    continue;				// re-examine shifted slot
+	}
+	hand++;
+    }
+    u_int i = h & (cacheSize-1);
+    while (cache[i])
+	i = (i+1) & (cacheSize-1);
+    FileCache* fi = cache[i] = new FileCache;
+    numEntries++;
+    fi->name = pathname;
+    fi->sb = sb;
+    fi->hashval = h;
+    fi->used = true;
+    fi->dir = dir ? dir : getDir(pathname);
+    fi->dirgen = fi->dir->gen;
+}
+
+/*
+ * Return the directory state for the directory that
+ * holds pathname; the key is everything up to and
+ * including the last ``/''.
+ */
+FileCacheDir*
+FileCache::getDir(const char* pathname)
+{
+    const char* cp = strrchr(pathname, '/');
+    fxStr key(pathname, cp ? cp+1 - pathname : 0);
+    FileCacheDir*& dir = dirs[key];
+    if (!dir)
+	dir = new FileCacheDir;
+    return (dir);
+}
+
+/*
+ * Note the current state of a directory.  If it differs
+ * from what was last seen then entries cached for files in
+ * the directory are stale.  A modification time in the
+ * current second cannot be trusted (the directory may
+ * change again without it moving) so it is always treated
+ * as a change the next time the directory is examined.
+ */
+FileCacheDir*
+FileCache::noteDir(const char* dirname, const struct stat& sb)
+{
+    FileCacheDir* dir;
+    u_int l = strlen(dirname);
+    if (l > 0 && dirname[l-1] == '/')
+	dir = getDir(dirname);
+    else
+	dir = getDir(fxStr(dirname) | "/");
+    if (!dir->settled || dir->mtime != sb.st_mtime ||
+      dir->ino != sb.st_ino || dir->dev != sb.st_dev) {
+	dir->gen++;
+	dirchanges++;
+	dir->dev = sb.st_dev;
+	dir->ino = sb.st_ino;
+	dir->mtime = sb.st_mtime;
+    }
+    dir->settled = (sb.st_mtime < Sys::now());
+    return (dir);
 }
 
 bool
@@ -90,37 +295,27 @@ FileCache::lookup(const char* pathname, struct stat& sb, bool addToCache)
 {
     lookups++;
     u_int h = hash(pathname);
-    u_int maxprobes = 5;
-    FileCache* fi = cache[h];
-    FileCache* oldest = fi;
-    while (fi && --maxprobes) {
-	probes++;
-	if (fi->name == pathname) {
-	    fi->serial = master++;
+    int i = find(pathname, h);
+    if (i >= 0) {
+	FileCache* fi = cache[i];
+	if (fi->dirgen == fi->dir->gen) {
+	    fi->used = true;
 	    sb = fi->sb;
 	    hits++;
 	    return (true);
 	}
-	if (fi->serial < oldest->serial)
-	    oldest = fi;
-	h = (u_int)(h*h) % CACHESIZE;
-	fi = cache[h];
+	invalidated++;				// directory changed
+	remove(i);
     }
     /*
      * Pathname not found in the cache.
      */
     if (Sys::stat(pathname, sb) < 0)
 	return (false);
-    if (addToCache && pathname[0] != '.') {
-	if (fi) {
-	    fi = oldest;
-	    displaced++;
-	} else
-	    fi = cache[h] = new FileCache;
-	fi->name = pathname;
-	fi->serial = master++;
-	fi->sb = sb;
-    }
+    if (S_ISDIR(sb.st_mode))
+	(void) noteDir(pathname, sb);
+    if (addToCache && pathname[0] != '.')
+	enter(pathname, h, sb, NULL);
     return (true);
 }
 
@@ -133,18 +328,11 @@ FileCache::chmod(const char* pathname, mode_t mode)
     if (Sys::chmod(pathname, mode) < 0)
 	return (false);
     lookups++;
-    u_int h = hash(pathname);
-    u_int maxprobes = 5;
-    FileCache* fi = cache[h];
-    while (fi && --maxprobes) {
-	probes++;
-	if (fi->name == pathname) {
-	    hits++;
-	    fi->sb.st_mode = (fi->sb.st_mode&~0777) | (mode&0777);
-	    break;
-	}
-	h = (u_int)(h*h) % CACHESIZE;
-	fi = cache[h];
+    int i = find(pathname, hash(pathname));
+    if (i >= 0) {
+	hits++;
+	FileCache* fi = cache[i];
+	fi->sb.st_mode = (fi->sb.st_mode&~0777) | (mode&0777);
     }
     return (true);
 }
@@ -171,19 +359,12 @@ FileCache::chown(const char* pathname, uid_t uid, gid_t gid)
     (void) seteuid(ouid);
     if (ok) {
 	lookups++;
-	u_int h = hash(pathname);
-	u_int maxprobes = 5;
-	FileCache* fi = cache[h];
-	while (fi && --maxprobes) {
-	    probes++;
-	    if (fi->name == pathname) {
-		hits++;
-		fi->sb.st_uid = uid;
-		fi->sb.st_gid = gid;
-		break;
-	    }
-	    h = (u_int)(h*h) % CACHESIZE;
-	    fi = cache[h];
+	int i = find(pathname, hash(pathname));
+	if (i >= 0) {
+	    hits++;
+	    FileCache* fi = cache[i];
+	    fi->sb.st_uid = uid;
+	    fi->sb.st_gid = gid;
 	}
     }
     return (ok);
@@ -197,61 +378,94 @@ FileCache::update(const char* pathname, struct stat& sb, bool addToCache)
 {
     lookups++;
     u_int h = hash(pathname);
-    u_int maxprobes = 5;
-    FileCache* fi = cache[h];
-    FileCache* oldest = fi;
-    while (fi && --maxprobes) {
-	probes++;
-	if (fi->name == pathname) {
-	    if (Sys::stat(pathname, sb) >= 0) {
-		hits++;
-		fi->serial = master++;
-		fi->sb = sb;
-		return (true);
-	    } else {
-		flushed++;
-		cache[h] = NULL;
-		delete fi;
-		return (false);
-	    }
+    int i = find(pathname, h);
+    if (Sys::stat(pathname, sb) < 0) {
+	if (i >= 0) {
+	    flushed++;
+	    remove(i);
 	}
-	if (fi->serial < oldest->serial)
-	    oldest = fi;
-	h = (u_int)(h*h) % CACHESIZE;
-	fi = cache[h];
-    }
-    /*
-     * Pathname not found in the cache.
-     */
-    if (Sys::stat(pathname, sb) < 0)
 	return (false);
-    if (addToCache && pathname[0] != '.') {
-	if (fi) {
-	    fi = oldest;
-	    displaced++;
-	} else
-	    fi = cache[h] = new FileCache;
-	fi->name = pathname;
-	fi->serial = master++;
-	fi->sb = sb;
     }
+    if (S_ISDIR(sb.st_mode))
+	(void) noteDir(pathname, sb);
+    if (i >= 0) {
+	hits++;
+	FileCache* fi = cache[i];
+	fi->used = true;
+	fi->sb = sb;
+	fi->dirgen = fi->dir->gen;
+    } else if (addToCache && pathname[0] != '.')
+	enter(pathname, h, sb, NULL);
     return (true);
 }
 
+/*
+ * Load the cache with the contents of an open directory;
+ * dirname is the pathname of the directory with a trailing
+ * ``/''.  Entries are stat'd relative to the directory
+ * (avoiding a full pathname lookup for each) and the
+ * directory is rewound afterwards so the caller can walk
+ * it, using lookup to retrieve the results.  Entries that
+ * are already cached are always refreshed since a file can
+ * be written or have its mode changed without changing the
+ * directory.  At most half the cache is loaded with new
+ * entries so that scanning a large directory does not flush
+ * everything else; files beyond that are stat'd when looked
+ * up.
+ */
 void
-FileCache::flush(const char* pathname)
+FileCache::scan(const char* dirname, DIR* dir)
 {
-    u_int h = hash(pathname);
-    u_int maxprobes = 5;
-    FileCache* fi = cache[h];
-    while (fi && --maxprobes) {
-	if (fi->name == pathname) {
-	    flushed++;
-	    cache[h] = NULL;
-	    delete fi;
-	    break;
+    if (maxEntries == 0)
+	return;
+    struct stat sb;
+#ifdef AT_FDCWD
+    int fd = dirfd(dir);
+    if (Sys::fstat(fd, sb) < 0 || !S_ISDIR(sb.st_mode))
+	return;
+#else
+    if (Sys::stat(dirname, sb) < 0 || !S_ISDIR(sb.st_mode))
+	return;
+#endif
+    FileCacheDir* fdir = noteDir(dirname, sb);
+    fxStr path(dirname);
+    u_int budget = maxEntries/2;
+    struct dirent* dp;
+    while ((dp = readdir(dir))) {
+	if (dp->d_name[0] == '.' &&
+	  (dp->d_name[1] == '\0' || strcmp(dp->d_name, "..") == 0))
+	    continue;
+	fxStr pathname(path | dp->d_name);
+	u_int h = hash(pathname);
+	int i = find(pathname, h, false);
+	if (i < 0 && (budget == 0 || pathname[0] == '.'))
+	    continue;
+#ifdef AT_FDCWD
+	if (fstatat(fd, dp->d_name, &sb, 0) < 0)
+	    continue;
+#else
+	if (Sys::stat(pathname, sb) < 0)
+	    continue;
+#endif
+	scanned++;
+	if (i >= 0) {
+	    FileCache* fi = cache[i];
+	    fi->sb = sb;
+	    fi->dirgen = fi->dir->gen;
+	} else {
+	    budget--;
+	    enter(pathname, h, sb, fdir);
 	}
-	h = (u_int)(h*h) % CACHESIZE;
-	fi = cache[h];
+    }
+    rewinddir(dir);
+}
+
+void
+FileCache::flush(const char* pathname)
+{
+    int i = find(pathname, hash(pathname), false);
+    if (i >= 0) {
+	flushed++;
+	remove(i);
     }
 }
@@ -28,37 +28,67 @@
 
 #include "Str.h"
 #include <sys/stat.h>
+#include <dirent.h>
+
+struct FileCacheDir;
 
 /*
  * Cache to reduce the number of stat system calls.
+ *
+ * Entries live in an open-addressed table that is sized to
+ * hold the configured number of entries at no more than half
+ * load; when the cache is full an entry is reclaimed using
+ * the ``clock'' algorithm.  Each entry remembers the directory
+ * it lives in; whenever a directory is seen to have changed
+ * (its modification time differs from the last time it was
+ * examined) all cached entries for files in it are discarded
+ * on their next reference.
  */
 struct FileCache {
     fxStr	name;
     struct stat sb;
-    u_int	serial;
+    u_int	hashval;		// full hash of name
+    bool	used;			// referenced since last clock sweep
+    FileCacheDir* dir;		// containing directory
+    u_int	dirgen;			// directory generation when cached
 
-    static u_int master;		// master serial # generator
-    static FileCache* cache[4096];
+    static FileCache** cache;		// open-addressed table
+    static u_int cacheSize;		// # slots in table (power of 2)
+    static u_int maxEntries;		// max # entries in table
+    static u_int numEntries;		// current # entries in table
+    static u_int hand;			// clock hand for replacement
 					// statistics
     static u_int lookups;		// total # lookups
     static u_int hits;			// # lookups that hit in the cache
     static u_int probes;		// total # probes during lookups
     static u_int displaced;		// # entries reused
     static u_int flushed;		// # entries flushed
+    static u_int invalidated;		// # entries discarded on dir change
+    static u_int dirchanges;		// # directory changes noticed
+    static u_int scanned;		// # entries loaded by scan
     static void printStats(FILE*);
 
     FileCache();
     ~FileCache();
 
     static u_int hash(const char* pathname);
+    static void setMaxEntries(u_int);
 
     static bool lookup(const char* pathname, struct stat& sb,
 	bool addToCache = true);
     static bool update(const char* pathname, struct stat& sb,
 	bool addToCache = true);
+    static void scan(const char* dirname, DIR* dir);
     static void flush(const char* pathname);
     static bool chmod(const char* pathname, mode_t mode);
     static bool chown(const char* pathname, uid_t uid, gid_t gid);
     static void reset(void);
+private:
+    static int find(const char* pathname, u_int h, bool count = true);
+    static void remove(u_int slot);
+    static void enter(const char* pathname, u_int h,
+	const struct stat& sb, FileCacheDir* dir);
+    static FileCacheDir* getDir(const char* pathname);
+    static FileCacheDir* noteDir(const char* dirname, const struct stat& sb);
 };
 #endif /* _FileCache_ */
@@ -501,13 +501,14 @@ HylaFAXServer::listDirectory(FILE* fd, const SpoolDir& sd, DIR* dir)
      * lookups to improve cache locality.
      */
     fxStr path(sd.pathname);
+    FileCache::scan(path, dir);
     struct dirent* dp;
     while ((dp = readdir(dir))) {
 	if (dp->d_name[0] == '.' &&
 	  (dp->d_name[1] == '\0' || strcmp(dp->d_name, "..") == 0))
 	    continue;
 	struct stat sb;
-	if (!FileCache::update(path | dp->d_name, sb))
+	if (!FileCache::lookup(path | dp->d_name, sb))
 	    continue;
 	if ((this->*sd.isVisibleFile)(dp->d_name, sb)) {
 	    if (fileSortFormat.length() == 0) {
@@ -749,13 +750,14 @@ HylaFAXServer::nlstDirectory(FILE* fd, const SpoolDir& sd, DIR* dir)
      * lookups to improve cache locality.
      */
     fxStr path(sd.pathname);
+    FileCache::scan(path, dir);
     struct dirent* dp;
     while ((dp = readdir(dir))) {
 	if (dp->d_name[0] == '.' &&
 	  (dp->d_name[1] == '\0' || strcmp(dp->d_name, "..") == 0))
 	    continue;
 	struct stat sb;
-	if (!FileCache::update(path | dp->d_name, sb))
+	if (!FileCache::lookup(path | dp->d_name, sb))
 	    continue;
 	if ((this->*sd.isVisibleFile)(dp->d_name, sb)) {
 	    (this->*sd.nlstFile)(fd, sd, dp->d_name, sb);
@@ -38,6 +38,10 @@
 #ifdef HAVE_STDINT_H
 #include <stdint.h>
 #endif
+#include <signal.h>
+#ifdef HAS_SENDFILE
+#include <sys/sendfile.h>
+#endif
 
 #ifndef CHAR_BIT
 #ifdef NBBY
@@ -204,6 +208,73 @@ typedef struct {
     uint32		yres[2];		// Y resolution indirect value
 } DirTemplate;
 
+#define	TIFFHDRSIZE \
+    (sizeof (TIFFHeader) + sizeof (uint16) + sizeof (DirTemplate))
+
+/*
+ * Index of the pages in a TIFF file retrieved with RETP.
+ * When a file is first accessed its directories are read
+ * once, in order, and for each page the TIFF header and IFD
+ * sent ahead of the image data are prebuilt and the location
+ * of the image data is recorded.  Any page can then be sent
+ * with a seek and a copy instead of having libtiff walk the
+ * directory chain up to it on every request.  The index is
+ * discarded when the file is seen to have changed.
+ */
+struct TIFFPage {
+    u_char	header[TIFFHDRSIZE];	// TIFF header+IFD sent for page
+    u_int	strip;			// first strip of page in index
+    u_int	nstrips;		// # strips in page
+    u_long	datasize;		// total image data bytes
+};
+
+struct TIFFPageIndex {
+    fxStr	name;			// file name
+    int		fd;			// open file
+    dev_t	dev;			// identity of indexed file
+    ino_t	ino;
+    off_t	size;
+    time_t	mtime;
+    TIFFPage*	pages;
+    u_int	npages;
+    off_t*	stripoff;		// image data offset of each strip
+    u_long*	stripsize;		// image data size of each strip
+    u_int	nstrips;
+    u_int	current;		// last page retrieved
+
+    TIFFPageIndex();
+    ~TIFFPageIndex();
+
+    bool isCurrent(const struct stat&) const;
+};
+
+TIFFPageIndex::TIFFPageIndex()
+{
+    fd = -1;
+    pages = NULL;
+    npages = 0;
+    stripoff = NULL;
+    stripsize = NULL;
+    nstrips = 0;
+    current = 0;
+}
+
+TIFFPageIndex::~TIFFPageIndex()
+{
+    if (fd != -1)
+	Sys::close(fd);
+    delete [] pages;
+    delete [] stripoff;
+    delete [] stripsize;
+}
+
+bool
+TIFFPageIndex::isCurrent(const struct stat& sb) const
+{
+    return (sb.st_dev == dev && sb.st_ino == ino &&
+	sb.st_size == size && sb.st_mtime == mtime);
+}
+
 /*
  * RETrieve one Page from a file.  For now the
  * file must be a TIFF image; we might try to
@@ -213,53 +284,47 @@ typedef struct {
 void
 HylaFAXServer::retrievePageCmd(const char* name)
 {
-    TIFF* tif = cachedTIFF;
-    if (tif != NULL && streq(name, TIFFFileName(tif))) {
+    struct stat sb;
+    SpoolDir* sd = fileAccess(name, R_OK, sb);
+    if (!sd)
+	return;
+    u_int page = (u_int) restart_point;
+    TIFFPageIndex* pi = pageIndex;
+    if (pi != NULL && pi->name == name) {
 	/*
-	 * Reuse the cached open file.  If no directory
+	 * Reuse the index for this file.  If no directory
 	 * has been specified with a REST command then
 	 * return the next consecutive directory in the file.
 	 */
 	if (restart_point == 0)			// advance to next directory
-	    restart_point = TIFFCurrentDirectory(tif)+1;
-    } else {
-	if (tif)				// close cached handle
-	    TIFFClose(tif), cachedTIFF = NULL;
-	tif = openTIFF(name);
+	    page = pi->current+1;
+	if (!pi->isCurrent(sb))			// file changed, rebuild
+	    pi = NULL;
+    } else
+	pi = NULL;
+    if (pi == NULL) {
+	discardPageIndex();
+	if ((pi = buildPageIndex(name)) == NULL)
+	    return;
+	pageIndex = pi;
     }
-    if (tif != NULL) {
-	if (restart_point && !TIFFSetDirectory(tif, (tdir_t) restart_point)) {
-	    reply(550, "%s: Unable to access directory %lu.",
-		name, (u_long) restart_point);
-	} else {
-	    time_t start_time = Sys::now();
-	    int code;
-	    FILE* dout = openDataConn("w", code);
-	    if (dout != NULL) {
-		/*
-		 * Calculate "file size" by totalling up the
-		 * amount of image data and then adding in
-		 * the expected data for the TIFF headers.
-		 */
-		tiff_bytecount_t* sb;
-		TIFFGetField(tif, TIFFTAG_STRIPBYTECOUNTS, &sb);
-		file_size = sizeof (DirTemplate) +
-		    sizeof (TIFFHeader) + sizeof (uint16);
-		for (tstrip_t s = 0, ns = TIFFNumberOfStrips(tif); s < ns; s++)
-		    file_size += sb[s];
-		reply(code, "%s for %s (%lu bytes).",
-		    dataConnMsg(code), name, (u_long) file_size);
-		if (sendTIFFData(tif, dout))
-		    reply(226, "Transfer complete.");
-		if (TRACE(OUTXFERS) && xferfaxlog != -1) {
-		    struct stat sb;
-		    SpoolDir* sd = fileAccess(name, R_OK, sb);
-		    logTransfer("o", *sd, name, start_time);
-		}
-		closeDataConn(dout);
-	    }
-	}
-	cachedTIFF = tif;
+    if (page >= pi->npages) {
+	reply(550, "%s: Unable to access directory %lu.", name, (u_long) page);
+	return;
+    }
+    pi->current = page;
+    time_t start_time = Sys::now();
+    int code;
+    FILE* dout = openDataConn("w", code);
+    if (dout != NULL) {
+	file_size = TIFFHDRSIZE + pi->pages[page].datasize;
+	reply(code, "%s for %s (%lu bytes).",
+	    dataConnMsg(code), name, (u_long) file_size);
+	if (sendTIFFData(*pi, page, dout))
+	    reply(226, "Transfer complete.");
+	if (TRACE(OUTXFERS) && xferfaxlog != -1)
+	    logTransfer("o", *sd, name, start_time);
+	closeDataConn(dout);
     }
 }
 
@@ -299,11 +364,95 @@ HylaFAXServer::openTIFF(const char* name)
     return (NULL);
 }
 
+static void makeTIFFHeader(TIFF* tif, u_long datasize, u_char* hdr);
+
 /*
- * Tranfer the current directory's contents of "tif" to "fdout".
+ * Read every directory in a TIFF file and build
+ * the page index used to satisfy RETP requests.
+ */
+TIFFPageIndex*
+HylaFAXServer::buildPageIndex(const char* name)
+{
+    TIFF* tif = openTIFF(name);
+    if (tif == NULL)
+	return (NULL);
+    struct stat sb;
+    TIFFPageIndex* pi = new TIFFPageIndex;
+    pi->name = name;
+    pi->fd = dup(TIFFFileno(tif));
+    if (pi->fd < 0 || Sys::fstat(pi->fd, sb) < 0) {
+	perror_reply(550, name, errno);
+	goto bad;
+    }
+    pi->dev = sb.st_dev;
+    pi->ino = sb.st_ino;
+    pi->size = sb.st_size;
+    pi->mtime = sb.st_mtime;
+    {
+	u_int maxpages = 0;
+	u_int maxstrips = 0;
+	do {
+	    tiff_offset_t* so;
+	    tiff_bytecount_t* sc;
+	    if (!TIFFGetField(tif, TIFFTAG_STRIPOFFSETS, &so) ||
+	      !TIFFGetField(tif, TIFFTAG_STRIPBYTECOUNTS, &sc)) {
+		reply(550, "%s: Incomplete or invalid TIFF file.", name);
+		goto bad;
+	    }
+	    if (pi->npages == maxpages) {
+		maxpages = maxpages ? 2*maxpages : 16;
+		TIFFPage* pages = new TIFFPage[maxpages];
+		if (pi->npages)
+		    memcpy(pages, pi->pages, pi->npages * sizeof (TIFFPage));
+		delete [] pi->pages;
+		pi->pages = pages;
+	    }
+	    tstrip_t ns = TIFFNumberOfStrips(tif);
+	    if (pi->nstrips + ns > maxstrips) {
+		maxstrips = fxmax(2*maxstrips, pi->nstrips + ns);
+		off_t* off = new off_t[maxstrips];
+		u_long* size = new u_long[maxstrips];
+		if (pi->nstrips) {
+		    memcpy(off, pi->stripoff, pi->nstrips * sizeof (off_t));
+		    memcpy(size, pi->stripsize, pi->nstrips * sizeof (u_long));
+		}
+		delete [] pi->stripoff;
+		delete [] pi->stripsize;
+		pi->stripoff = off;
+		pi->stripsize = size;
+	    }
+	    TIFFPage& pg = pi->pages[pi->npages++];
+	    pg.strip = pi->nstrips;
+	    pg.nstrips = ns;
+	    pg.datasize = 0;
+	    for (tstrip_t s = 0; s < ns; s++) {
+		pi->stripoff[pi->nstrips] = (off_t) so[s];
+		pi->stripsize[pi->nstrips] = (u_long) sc[s];
+		pg.datasize += sc[s];
+		pi->nstrips++;
+	    }
+	    makeTIFFHeader(tif, pg.datasize, pg.header);
+	} while (TIFFReadDirectory(tif));
+    }
+    TIFFClose(tif);
+    return (pi);
+bad:
+    TIFFClose(tif);
+    delete pi;
+    return (NULL);
+}
+
+void
+HylaFAXServer::discardPageIndex(void)
+{
+    delete pageIndex, pageIndex = NULL;
+}
+
+/*
+ * Tranfer a page of an indexed TIFF file to "fdout".
  */
 bool
-HylaFAXServer::sendTIFFData(TIFF* tif, FILE* fdout)
+HylaFAXServer::sendTIFFData(const TIFFPageIndex& pi, u_int page, FILE* fdout)
 {
     state |= S_TRANSFER;
     if (setjmp(urgcatch) != 0) {
@@ -314,8 +463,7 @@ HylaFAXServer::sendTIFFData(TIFF* tif, FILE* fdout)
     switch (PACK(type,mode)) {
     case PACK(TYPE_I,MODE_S):
     case PACK(TYPE_L,MODE_S):
-	if (sendTIFFHeader(tif, fileno(fdout)) &&
-	    sendITIFFData(tif, fileno(fdout))) {
+	if (sendTIFFPage(pi, page, fileno(fdout))) {
 	    state &= ~S_TRANSFER;
 	    return (true);
 	}
@@ -346,17 +494,18 @@ getShort(TIFF* tif, TIFFDirEntry& de)
 }
 
 /*
- * Send a TIFF header and IFD for the current directory
- * in the open TIFF file.  The image data is expected to
- * immediately follow this information (i.e. the value of
- * the StripByteOffsets tag is setup to point to the offset
- * immediately after this data) and it is assumed that
- * all image data is concatenated into a single strip.
+ * Construct a TIFF header and IFD for the current
+ * directory in the open TIFF file.  The image data is
+ * expected to immediately follow this information (i.e.
+ * the value of the StripByteOffsets tag is setup to point
+ * to the offset immediately after this data) and it is
+ * assumed that all image data is concatenated into a
+ * single strip.
  */
-bool
-HylaFAXServer::sendTIFFHeader(TIFF* tif, int fdout)
+static void
+makeTIFFHeader(TIFF* tif, u_long datasize, u_char* hdr)
 {
-    static DirTemplate templ = {
+    static const DirTemplate proto = {
 #define	TIFFdiroff(v) \
     (uint32) (sizeof (TIFFHeader) + sizeof (uint16) + \
       (intptr_t) &(((DirTemplate*) 0)->v))
@@ -391,16 +540,13 @@ HylaFAXServer::sendTIFFHeader(TIFF* tif, int fdout)
      * In case it's not obvious, this code assumes a lot
      * of things about the contents of the TIFF file.
      */
-    struct {
-	TIFFHeader h;
-	uint16	dircount;
-	u_char	dirstuff[sizeof (templ)];
-    } buf;
+    DirTemplate templ = proto;
+    TIFFHeader h;
     union { int32 i; char c[4]; } u; u.i = 1;
-    buf.h.tiff_magic = (u.c[0] == 0 ? TIFF_BIGENDIAN : TIFF_LITTLEENDIAN);
-    buf.h.tiff_version = TIFF_VERSION;
-    buf.h.tiff_diroff = sizeof (TIFFHeader);
-    buf.dircount = (uint16) NTAGS;
+    h.tiff_magic = (u.c[0] == 0 ? TIFF_BIGENDIAN : TIFF_LITTLEENDIAN);
+    h.tiff_version = TIFF_VERSION;
+    h.tiff_diroff = sizeof (TIFFHeader);
+    uint16 dircount = (uint16) NTAGS;
     getLong(tif, templ.SubFileType);
     getLong(tif, templ.ImageWidth);
     getLong(tif, templ.ImageLength);
@@ -408,7 +554,7 @@ HylaFAXServer::sendTIFFHeader(TIFF* tif, int fdout)
     getShort(tif, templ.Photometric);
     getShort(tif, templ.FillOrder);
     getShort(tif, templ.Orientation);
-    templ.StripByteCounts.tdir_offset = (uint32) file_size - sizeof (buf);
+    templ.StripByteCounts.tdir_offset = (uint32) datasize;
     float res;
     TIFFGetField(tif, TIFFTAG_XRESOLUTION, &res);
 	templ.xres[0] = (uint32) res;
@@ -422,69 +568,88 @@ HylaFAXServer::sendTIFFHeader(TIFF* tif, int fdout)
 	getLong(tif, templ.Options);
     }
     getShort(tif, templ.ResolutionUnit);
-    TIFFGetField(tif, TIFFTAG_PAGENUMBER,  &templ.PageNumber.tdir_offset);
+    uint16 pn[2] = { 0, 0 };			// stored in file order below
+    TIFFGetField(tif, TIFFTAG_PAGENUMBER, &pn[0], &pn[1]);
+    memcpy(&templ.PageNumber.tdir_offset, pn, sizeof (pn));
     getLong(tif, templ.BadFaxLines);
     getShort(tif, templ.CleanFaxData);
     getLong(tif, templ.ConsecutiveBadFaxLines);
-    if (buf.h.tiff_magic == TIFF_BIGENDIAN) {
+    if (h.tiff_magic == TIFF_BIGENDIAN) {
 	TIFFDirEntry* dp = &templ.SubFileType;
 	for (u_int i = 0; i < NTAGS; i++) {
-	    if (dp->tdir_type == TIFF_SHORT)
+	    if (dp->tdir_type == TIFF_SHORT && dp->tdir_count == 1)
 		dp->tdir_offset <<= 16;
 	    dp++;
 	}
     }
-    memcpy(buf.dirstuff, &templ, sizeof (templ));
-    if (write(fdout, (const char*) &buf, sizeof (buf)) != sizeof (buf)) {
-	perror_reply(426, "Data connection", errno);
-	return (false);
-    } else {
-	byte_count += sizeof (buf);
-	return (true);
-    }
+    memcpy(hdr, &h, sizeof (h));
+    memcpy(hdr + sizeof (h), &dircount, sizeof (dircount));
+    memcpy(hdr + sizeof (h) + sizeof (dircount), &templ, sizeof (templ));
 #undef NTAGS
 #undef offsetof
 }
 
 /*
- * Send the raw image data for the current directory
- * in the open TIFF file.  If multiple strips are
- * present in the file they are concatenated w/o
+ * Send the prebuilt header and the raw image data for
+ * a page of an indexed TIFF file.  If multiple strips
+ * are present in the file they are concatenated w/o
  * consideration for any padding that might be present
- * or might be needed.
+ * or might be needed.  The image data is moved by the
+ * kernel with sendfile when possible.
  */
 bool
-HylaFAXServer::sendITIFFData(TIFF* tif, int fdout)
+HylaFAXServer::sendTIFFPage(const TIFFPageIndex& pi, u_int page, int fdout)
 {
-    tiff_bytecount_t* sb;
-    (void) TIFFGetField(tif, TIFFTAG_STRIPBYTECOUNTS, &sb);
-    tdata_t buf = _TIFFmalloc(sb[0]);
-    tsize_t bsize = sb[0];
-    for (tstrip_t s = 0, ns = TIFFNumberOfStrips(tif); s < ns; s++) {
-	tsize_t cc = sb[s];
-	if (cc > bsize) {
-	    buf = _TIFFrealloc(buf, cc);
-	    bsize = cc;
-	}
-	if (buf == NULL) {
-	    reply(551, "Error allocating intermediate buffer");
-	    return (false);
-	}
-	if (TIFFReadRawStrip(tif, s, buf, cc) != cc) {
-	    reply(551, "Error reading input file at strip %u", s);
-	    goto bad;
-	}
-	if (write(fdout, buf, (u_int) cc) != cc) {
-	    perror_reply(426, "Data connection", errno);
-	    goto bad;
+    const TIFFPage& pg = pi.pages[page];
+    if (write(fdout, pg.header, TIFFHDRSIZE) != (ssize_t) TIFFHDRSIZE) {
+	perror_reply(426, "Data connection", errno);
+	return (false);
+    }
+    byte_count += TIFFHDRSIZE;
+#ifdef HAS_SENDFILE
+    bool usesendfile = true;
+#endif
+    for (u_int s = 0; s < pg.nstrips; s++) {
+	off_t off = pi.stripoff[pg.strip + s];
+	u_long cc = pi.stripsize[pg.strip + s];
+	while (cc > 0) {
+	    ssize_t n;
+#ifdef HAS_SENDFILE
+	    if (usesendfile) {
+		n = sendfile(fdout, pi.fd, &off, cc);
+		if (n < 0) {
+		    if (byte_count == (off_t) TIFFHDRSIZE &&
+		      (errno == EINVAL || errno == ENOSYS)) {
+			usesendfile = false;	// copy through a buffer
+			continue;
+		    }
+		    perror_reply(426, "Data connection", errno);
+		    return (false);
+		}
+	    } else
+#endif
+	    {
+		char buf[16*1024];
+		if (lseek(pi.fd, off, SEEK_SET) != off ||
+		  (n = Sys::read(pi.fd, buf, (u_int) fxmin(cc, (u_long) sizeof (buf)))) < 0) {
+		    perror_reply(551, "Error reading input file", errno);
+		    return (false);
+		}
+		if (n > 0 && write(fdout, buf, n) != n) {
+		    perror_reply(426, "Data connection", errno);
+		    return (false);
+		}
+		off += n;
+	    }
+	    if (n == 0) {
+		reply(551, "Error reading input file at strip %u", s);
+		return (false);
+	    }
+	    cc -= n;
+	    byte_count += n;
 	}
-	byte_count += cc;
     }
-    _TIFFfree(buf);
     return (true);
-bad:
-    _TIFFfree(buf);
-    return (false);
 }
 
 const char*
@@ -667,6 +832,33 @@ HylaFAXServer::sendData(FILE* fdin, FILE* fdout)
 bool
 HylaFAXServer::sendIData(int fdin, int fdout)
 {
+#ifdef HAS_SENDFILE
+    /*
+     * When sending a regular file have the kernel move the
+     * data directly from the file to the data connection.
+     * The current file offset is used and updated so any
+     * restart point set with REST is honored.  If sendfile
+     * refuses this pair of descriptors before anything has
+     * been sent fall back to copying through a buffer.
+     */
+    struct stat sb;
+    if (Sys::fstat(fdin, sb) >= 0 && S_ISREG(sb.st_mode)) {
+	bool sent = false;
+	for (;;) {
+	    ssize_t cc = sendfile(fdout, fdin, NULL, 1024*1024);
+	    if (cc == 0)
+		return (true);
+	    if (cc < 0) {
+		if (!sent && (errno == EINVAL || errno == ENOSYS))
+		    break;
+		perror_reply(426, "Data connection", errno);
+		return (false);
+	    }
+	    byte_count += cc;
+	    sent = true;
+	}
+    }
+#endif
     char buf[16*1024];
     for (;;) {
 	int cc = read(fdin, buf, sizeof (buf));
@@ -685,74 +877,68 @@ HylaFAXServer::sendIData(int fdin, int fdout)
     return (false);
 }
 
+/*
+ * Output function for the block deflater.  Urgent data
+ * (ABOR/STAT) is held off while compression is underway
+ * and only let through here, when no compression thread
+ * state is locked, so that an ABOR can longjmp out safely.
+ */
+struct ZDataSink {
+    HylaFAXServer* server;
+    int		fd;
+};
+
 bool
-HylaFAXServer::sendZData(int fdin, int fdout)
+HylaFAXServer::putZData(void* arg, const char* buf, int cc, fxStr& emsg)
 {
-    z_stream zstream;
-    zstream.zalloc = NULL;
-    zstream.zfree = NULL;
-    zstream.opaque = NULL;
-    zstream.data_type = Z_BINARY;
-    if (deflateInit(&zstream, Z_DEFAULT_COMPRESSION) == Z_OK) {
-	char obuf[16*1024];
-	zstream.next_out = (Bytef*) obuf;
-	zstream.avail_out = sizeof (obuf);
+    ZDataSink* sink = (ZDataSink*) arg;
+#ifdef SIGURG
+    sigset_t urg, omask;
+    sigemptyset(&urg);
+    sigaddset(&urg, SIGURG);
+    sigprocmask(SIG_UNBLOCK, &urg, &omask);
+    sigprocmask(SIG_SETMASK, &omask, NULL);
+#endif
+    if (write(sink->fd, buf, cc) != cc) {
+	emsg = strerror(errno);
+	return (false);
+    }
+    sink->server->byte_count += cc;
+    return (true);
+}
 
-	int cc;
-	for (;;) {
-	    char buf[16*1024];
-	    cc = read(fdin, buf, sizeof (buf));
-	    if (cc == 0)
-		break;
-	    if (cc < 0) {
-		perror_reply(551, "Error reading input file", errno);
-		goto bad;
-	    }
-	    zstream.next_in = (Bytef*) buf;
-	    zstream.avail_in = cc;
-	    do {
-		if (deflate(&zstream, Z_NO_FLUSH) != Z_OK) {
-		    reply(452, "Compressor error: %s", zstream.msg);
-		    goto bad;
-		}
-		if (zstream.avail_out == 0) {
-		    if (write(fdout, obuf, sizeof (obuf)) != sizeof (obuf)) {
-			perror_reply(426, "Data connection", errno);
-			goto bad;
-		    }
-		    byte_count += sizeof (obuf);
-		    zstream.next_out = (Bytef*) obuf;
-		    zstream.avail_out = sizeof (obuf);
-		}
-	    } while (zstream.avail_in > 0);
-	}
-	int state;
-	do {
-	    switch (state = deflate(&zstream, Z_FINISH)) {
-	    case Z_STREAM_END:
-	    case Z_OK:
-		if (zstream.avail_out != sizeof (obuf)) {
-		    cc = sizeof (obuf) - zstream.avail_out;
-		    if (write(fdout, obuf, cc) != cc) {
-			perror_reply(426, "Data connection", errno);
-			goto bad;
-		    }
-		    byte_count += cc;
-		    zstream.next_out = (Bytef*) obuf;
-		    zstream.avail_out = sizeof (obuf);
-		}
-		break;
-	    default:
-		reply(426, "Compressor error: %s", zstream.msg);
-		goto bad;
-	    }
-	} while (state != Z_STREAM_END);
-	deflateEnd(&zstream);
+bool
+HylaFAXServer::sendZData(int fdin, int fdout)
+{
+    zdeflater.setLevel(zlevel);
+    zdeflater.setThreads(compressionThreads);
+#ifdef SIGURG
+    sigset_t urg, omask;
+    sigemptyset(&urg);
+    sigaddset(&urg, SIGURG);
+    sigprocmask(SIG_BLOCK, &urg, &omask);
+#endif
+    ZDataSink sink;
+    sink.server = this;
+    sink.fd = fdout;
+    fxStr emsg;
+    BlockDeflater::Status status = zdeflater.deflate(fdin, putZData, &sink, emsg);
+#ifdef SIGURG
+    sigprocmask(SIG_SETMASK, &omask, NULL);
+#endif
+    switch (status) {
+    case BlockDeflater::OK:
 	return (true);
-bad:
-	deflateEnd(&zstream);
-    } else
-	reply(452, "Can not initialize compression library: %s", zstream.msg);
+    case BlockDeflater::READ_ERROR:
+	reply(551, "Error reading input file: %s.", (const char*) emsg);
+	break;
+    case BlockDeflater::WRITE_ERROR:
+	reply(426, "Data connection: %s.", (const char*) emsg);
+	break;
+    case BlockDeflater::ZLIB_ERROR:
+	reply(452, "%s", (const char*) emsg);
+	break;
+    }
     return (false);
 }
 
@@ -1017,18 +1203,27 @@ HylaFAXServer::typeCmd(const char* name)
     reply(200, "Type set to %s.", typenames[type]);
 }
 
+/*
+ * Set the transfer mode.  Compressed mode takes an
+ * optional zlib compression level (0-9); a level of
+ * -1, or none, selects the zlib default.
+ */
 void
-HylaFAXServer::modeCmd(const char* name)
+HylaFAXServer::modeCmd(const char* name, long level)
 {
-    if (strcasecmp(name, "S") == 0)
+    if (strcasecmp(name, "S") == 0 && level == -1)
 	mode = MODE_S;
-    else if (strcasecmp(name, "Z") == 0)
+    else if (strcasecmp(name, "Z") == 0 && -1 <= level && level <= 9) {
 	mode = MODE_Z;
-    else {
+	zlevel = (int) level;
+    } else {
 	reply(504, "Mode %s not supported.", name);
 	return;
     }
-    reply(200, "Mode set to %s.", modenames[mode]);
+    if (mode == MODE_Z && zlevel != Z_DEFAULT_COMPRESSION)
+	reply(200, "Mode set to %s, level %d.", modenames[mode], zlevel);
+    else
+	reply(200, "Mode set to %s.", modenames[mode]);
 }
 
 void
@@ -1054,9 +1249,8 @@ HylaFAXServer::printTransferStatus(FILE* fd)
     fprintf(fd, "    TYPE: %s", typenames[type]);
     if (type == TYPE_L)
         fprintf(fd, " %d", CHAR_BIT);
-    fprintf(fd, "; STRU: %s; MODE: %s; FORM: %s\r\n"
-	, strunames[stru]
-	, modenames[mode]
-	, formats[form].name
-    );
+    fprintf(fd, "; STRU: %s; MODE: %s", strunames[stru], modenames[mode]);
+    if (mode == MODE_Z && zlevel != Z_DEFAULT_COMPRESSION)
+	fprintf(fd, " %d", zlevel);
+    fprintf(fd, "; FORM: %s\r\n", formats[form].name);
 }
@@ -44,6 +44,9 @@
 const char* HylaFAXServer::version = HYLAFAX_VERSION;
 int HylaFAXServer::_debugSleep = 0;
 fxStrArray HylaFAXServer::configOptions;
+bool HylaFAXServer::poolReuse = false;
+bool HylaFAXServer::sessionOver = false;
+int HylaFAXServer::workerChan = -1;
 
 /*
  * NB: The remainder of the instance state is
@@ -55,6 +58,7 @@ fxStrArray HylaFAXServer::configOptions;
  */
 HylaFAXServer::HylaFAXServer()
     : defJob("")
+    , indexJob("")
 {
     state = 0;
     xferfaxlog = -1;
@@ -68,11 +72,17 @@ HylaFAXServer::HylaFAXServer()
     faxqFd = -1;
     clientFd = -1;
 
+    jobCacheHits = 0;		// job cache statistics
+    jobCacheMisses = 0;
+    jobCacheEvictions = 0;
+    jobIndexHits = 0;
+
     char buff[64];
     (void) gethostname(buff, sizeof(buff));
     hostname = buff;
     hostaddr = "unknown";	// derived classes should fill-in
 
+    configTime = 0;		// config files not read yet
     lastModTime = 0;		// shutdown file mod time
     discTime = 0;		// shutdown forced disconnect time
     denyTime = 0;		// shutdown service denial time
@@ -119,7 +129,7 @@ HylaFAXServer::HylaFAXServer()
     		(gmtoff / 3600), ((gmtoff / 60) % 60));
     setenv("TZ", tz, 0);
 
-    cachedTIFF = NULL;
+    pageIndex = NULL;
 }
 
 HylaFAXServer::~HylaFAXServer()
@@ -161,6 +171,7 @@ HylaFAXServer::initServer(void)
 
     restart_point = 0;		// data-transfer-related state
     mode = MODE_S;
+    zlevel = -1;		// Z_DEFAULT_COMPRESSION
     form = FORM_PS;
     type = TYPE_A;
     stru = STRU_F;
@@ -185,11 +196,15 @@ HylaFAXServer::initServer(void)
     recvNext = 0;
     consecutiveBadCmds = 0;
 
-    resetConfig();
-    readConfig(FAX_SYSCONF);
-    readConfig(FAX_LIBDATA "/hfaxd.conf");
-    for (u_int i = 0; i < configOptions.length(); i++)
-	readConfigItem(configOptions[i]);
+    /*
+     * A pooled worker reads the configuration before it
+     * takes a connection (see SuperServer::runWorker) so
+     * only the values a client may have changed are reset.
+     */
+    if (workerChan == -1)
+	configure();
+    else
+	restoreSessionConfig();
 }
 
 static void
@@ -453,6 +468,7 @@ HylaFAXServer::statusCmd(void)
     if (IS(WAITFIFO))
 	printf("    Waiting for response from HylaFAX scheduler\r\n");
     FileCache::printStats(stdout);
+    printJobCacheStats(stdout);
     printTransferStatus(stdout);
 
     netStatus(stdout);		// transport-dependent status
@@ -479,6 +495,7 @@ HylaFAXServer::fatal(const char* fmt, ...)
     vreply(451, fxStr::format("Error in server: %s", fmt), ap);
     va_end(ap);
     reply(221, "Closing connection due to server error.");
+    poolReuse = false;			// state is suspect, don't reuse worker
     dologout(0);
     /*NOTREACHED*/
 }
@@ -561,8 +578,8 @@ HylaFAXServer::cvtTime(const time_t& t) const
     return IS(USEGMT) ? gmtime(&t) : localtime(&t);
 }
 
-u_int HylaFAXServer::getJobNumber(fxStr& emsg)
-    { return (Sequence::getNext(FAX_SENDDIR "/" FAX_SEQF, emsg)); }
+u_int HylaFAXServer::getJobNumber(fxStr& emsg, u_int count)
+    { return (Sequence::getNext(FAX_SENDDIR "/" FAX_SEQF, count, emsg)); }
 u_int HylaFAXServer::getDocumentNumber(fxStr& emsg)
     { return (Sequence::getNext(FAX_DOCDIR "/" FAX_SEQF, emsg)); }
 
@@ -609,6 +626,81 @@ HylaFAXServer::resetConfig()
     setupConfig();
 }
 
+static const char* configFiles[] = {
+    FAX_SYSCONF,
+    FAX_LIBDATA "/hfaxd.conf",
+};
+#define	N(a)	(sizeof (a) / sizeof (a[0]))
+
+/*
+ * Read the configuration files and any options given
+ * on the command line.  The values a client may change
+ * during a session are saved to be restored for later
+ * sessions served by the same process.
+ */
+void
+HylaFAXServer::configure(void)
+{
+    configTime = 0;
+    for (u_int i = 0; i < N(configFiles); i++) {
+	struct stat sb;
+	if (Sys::stat(configFiles[i], sb) == 0 && sb.st_mtime > configTime)
+	    configTime = sb.st_mtime;
+    }
+    resetConfig();
+    for (u_int i = 0; i < N(configFiles); i++)
+	readConfig(configFiles[i]);
+    for (u_int i = 0; i < configOptions.length(); i++)
+	readConfigItem(configOptions[i]);
+
+    sessionConfig.jobFormat = jobFormat;
+    sessionConfig.jobSortFormat = jobSortFormat;
+    sessionConfig.recvFormat = recvFormat;
+    sessionConfig.recvSortFormat = recvSortFormat;
+    sessionConfig.modemFormat = modemFormat;
+    sessionConfig.modemSortFormat = modemSortFormat;
+    sessionConfig.fileFormat = fileFormat;
+    sessionConfig.fileSortFormat = fileSortFormat;
+    sessionConfig.idleTimeout = idleTimeout;
+    sessionConfig.lockTimeout = lockTimeout;
+}
+
+/*
+ * Return whether a configuration file has been
+ * changed since the configuration was read.
+ */
+bool
+HylaFAXServer::configChanged(void) const
+{
+    for (u_int i = 0; i < N(configFiles); i++) {
+	struct stat sb;
+	if (Sys::stat(configFiles[i], sb) == 0 && sb.st_mtime > configTime)
+	    return (true);
+    }
+    return (false);
+}
+
+/*
+ * Undo the changes a client made to the configuration
+ * with the SITE IDLE, SITE LOCKWAIT, and the format
+ * commands.
+ */
+void
+HylaFAXServer::restoreSessionConfig(void)
+{
+    jobFormat = sessionConfig.jobFormat;
+    jobSortFormat = sessionConfig.jobSortFormat;
+    recvFormat = sessionConfig.recvFormat;
+    recvSortFormat = sessionConfig.recvSortFormat;
+    modemFormat = sessionConfig.modemFormat;
+    modemSortFormat = sessionConfig.modemSortFormat;
+    fileFormat = sessionConfig.fileFormat;
+    fileSortFormat = sessionConfig.fileSortFormat;
+    idleTimeout = sessionConfig.idleTimeout;
+    lockTimeout = sessionConfig.lockTimeout;
+}
+#undef N
+
 #define	N(a)	(sizeof (a) / sizeof (a[0]))
 
 /*
@@ -651,11 +743,15 @@ HylaFAXServer::numbertag HylaFAXServer::numbers[] = {
 { "maxloginattempts",	&HylaFAXServer::maxLoginAttempts,	5 },
 { "maxadminattempts",	&HylaFAXServer::maxAdminAttempts,	5 },
 { "maxconsecutivebadcmds",&HylaFAXServer::maxConsecutiveBadCmds,10 },
+{ "jobcachesize",	&HylaFAXServer::jobCacheSize,		1000 },
+{ "filecachesize",	&HylaFAXServer::fileCacheSize,		4096 },
+{ "compressionthreads",	&HylaFAXServer::compressionThreads,	0 },
 };
 HylaFAXServer::booltag HylaFAXServer::booleans[] = {
 { "allowsorting",	&HylaFAXServer::allowSorting,		true },
 { "publicjobq",		&HylaFAXServer::publicJobQ,		false },
 { "publicrecvq",	&HylaFAXServer::publicRecvQ,		false },
+{ "binaryjobfiles",	&HylaFAXServer::binaryJobFiles,		false },
 };
 
 void
@@ -710,6 +806,8 @@ HylaFAXServer::setConfigItem(const char* tag, const char* value)
 		logError("JobProtection value must include 0600, forcing");
 		jobProtection |= 0600;
 	    }
+	    break;
+	case 10: FileCache::setMaxEntries(fileCacheSize); break;
 	}
     } else if (findTag(tag, (const tags*) booleans, N(booleans), ix)) {
 	(*this).*booleans[ix].p = getBoolean(value);
@@ -32,12 +32,15 @@
 #include "StrArray.h"
 #include "FaxRequest.h"
 #include "FaxRecvInfo.h"
+#include "QLink.h"
+#include "JobStatusIndex.h"
 #include "manifest.h"
 #include "FileCache.h"
 #include "Trace.h"
 #include "Trigger.h"
 #include "StackBuffer.h"
 #include "SystemLog.h"
+#include "BlockDeflater.h"
 
 #include "config.h"
 
@@ -49,9 +52,12 @@
 #include <errno.h>
 
 /*
- * In-memory copy of a job description file.
+ * In-memory copy of a job description file.  Jobs
+ * read from disk are cached and kept on a list in
+ * order of use so the least recently used can be
+ * discarded when the cache is full.
  */
-struct Job : public FaxRequest {
+struct Job : public FaxRequest, public QLink {
     time_t	lastmod;		// last file modify time, for updates
     bool	queued;			// for SNPP
 
@@ -115,7 +121,7 @@ enum Token {
     T_DELMODEM,	 T_DISABLE,	T_ENABLE,	T_EPSV,		T_EPRT,		T_FILEFMT,	T_FILESFMT,	T_FORM,
     T_HELP,	 T_IDLE,	T_LOCKWAIT,	T_JDELE,	T_JGDELE,	T_JGINTR,
     T_JGKILL,	 T_JGNEW,	T_JGPARM,	T_JGREST,	T_JGRP,
-    T_JGSUB,	 T_JGSUSP,	T_JGWAIT,	T_JINTR,	T_JKILL,
+    T_JBATCH,	 T_JGSUB,	T_JGSUSP,	T_JGWAIT,	T_JINTR,	T_JKILL,
     T_JNEW,	 T_JOB,		T_JOBFMT,	T_JOBSFMT,	T_JPARM,	T_JREST,
     T_JSUB,	 T_JSUSP,	T_JWAIT,	T_LIST,	 	T_MDTM,
     T_MODE,	 T_MODEMFMT,	T_MODEMSFMT,	T_NLST,		T_NOOP,		T_PASS,
@@ -162,10 +168,12 @@ struct ParamProtection;
 
 struct stat;
 typedef struct tiff TIFF;
+struct TIFFPageIndex;
 class JobExt;
 class ModemExt;
 class ModemConfig;
 class IDCache;
+fxDECLARE_StrKeyDictionary(ModemConfigDict, ModemConfig*)
 
 extern const char* fmtTime(time_t t);
 
@@ -191,6 +199,9 @@ public:
     };
     static int _debugSleep;
     static fxStrArray	configOptions;		// Pased on the command line
+    static bool	poolReuse;		// worker may serve another session
+    static bool	sessionOver;		// dologout ended a reusable session
+    static int	workerChan;		// pooled worker's channel to master
 protected:
     u_int	state;
 #define	S_LOGGEDIN	0x0001		// client is logged in
@@ -237,6 +248,7 @@ protected:
     bool	publicJobQ;		// Public/protection on recvq?
     bool	publicRecvQ;		// Public/protection on recvq?
     bool	allowSorting;		// Allow client to make us sort
+    bool	binaryJobFiles;		// write new job files in binary form
     /*
      * User authentication and login-related state.
      */
@@ -260,6 +272,7 @@ protected:
     off_t	byte_count;		// amount of data currently sent
     int		xferfaxlog;		// open transfer log file
     int		mode;			// data transfer mode
+    int		zlevel;			// compression level for MODE Z
     int		form;			// data transfer format
     int		type;			// data transfer type
     int		stru;			// file structure
@@ -267,7 +280,9 @@ protected:
     fxStrArray	tempFiles;		// files created with STOT
     fxStr	fileFormat;		// format string for directory listings
     fxStr	fileSortFormat;		// format string for directory listings
-    TIFF*	cachedTIFF;		// cached open TIFF file
+    TIFFPageIndex* pageIndex;		// page index of last file used with RETP
+    BlockDeflater zdeflater;		// MODE Z compressor
+    u_int	compressionThreads;	// max threads for MODE Z compression
     /*
      * Parser-related state.
      */
@@ -281,11 +296,20 @@ protected:
     char	recvBuf[1024];		// input data buffer
     u_int	consecutiveBadCmds;	// # consecutive invalid control cmds
     u_int	maxConsecutiveBadCmds;	// max # before forced disconnect
+    u_int	fileCacheSize;		// max # entries in stat cache
     /*
      * Job-related state.
      */
     Job		defJob;			// default job state information
     JobDict	jobs;			// non-default jobs
+    QLink	jobLRU;			// jobs in order of use, oldest first
+    u_int	jobCacheSize;		// max # jobs kept in memory
+    u_int	jobCacheHits;		// # lookups found in memory
+    u_int	jobCacheMisses;		// # lookups read from disk
+    u_int	jobCacheEvictions;	// # jobs discarded to make room
+    JobStatusIndex jobIndex;		// scheduler's index of job status
+    Job		indexJob;		// job state copied from the index
+    u_int	jobIndexHits;		// # listed jobs found in the index
     Job*	curJob;			// current job
     fxStr	jobFormat;		// job status format string
     fxStr	jobSortFormat;		// job status format string
@@ -306,6 +330,7 @@ protected:
      */
     fxStr	modemFormat;		// modem status format string
     fxStr	modemSortFormat;		// modem status format string
+    ModemConfigDict modemConfigs;	// parsed modem configuration files
 
     static gid_t faxuid;		// system gid of fax user = our uid
 #if HAS_TM_ZONE
@@ -321,7 +346,7 @@ protected:
     void formCmd(const char* name);	// FORM
     void formHelpCmd(void);		// FORM
     void typeCmd(const char* name);	// TYPE
-    void modeCmd(const char* name);	// MODE
+    void modeCmd(const char* name, long level);	// MODE
     void struCmd(const char* name);	// STRU
     void deleCmd(const char* name);	// DELE
     void mdtmCmd(const char* name);	// MDTM
@@ -330,6 +355,7 @@ protected:
     void retrieveCmd(const char* name);	// RETR
     void retrievePageCmd(const char* name);// RETP
     void listCmd(const char* name);	// LIST
+    void listSinceCmd(const char* name, u_int since);	// LIST ... SINCE
     void nlstCmd(const char* name);	// NLST
     void storeCmd(const char*, const char*);// STOR+APPE
     void storeUniqueCmd(bool isTemp);	// STOU+STOT
@@ -385,6 +411,7 @@ protected:
     bool isAdminGroup(const char* user=NULL);
 
     void login(int code);
+    bool forkSession(void);
     void end_login(void);
     virtual void dologout(int status);
     const char* fixPathname(const char* file);
@@ -405,8 +432,18 @@ protected:
     static numbertag numbers[];
     static booltag booleans[];
 
+    time_t	configTime;		// newest config file read
+    struct SessionConfig {		// configured values a client may change
+	fxStr	jobFormat, jobSortFormat;
+	fxStr	recvFormat, recvSortFormat;
+	fxStr	modemFormat, modemSortFormat;
+	fxStr	fileFormat, fileSortFormat;
+	u_int	idleTimeout, lockTimeout;
+    } sessionConfig;
+
     void resetConfig();
     void setupConfig();
+    void restoreSessionConfig();
     void configError(const char* fmt, ...);
     void configTrace(const char* fmt, ...);
     bool setConfigItem(const char* tag, const char* value);
@@ -431,6 +468,8 @@ protected:
     bool isVisibleSendQFile(const char*, const struct stat&);
     void listSendQ(FILE* fd, const SpoolDir& sd, DIR* dir);
     void listSendQFile(FILE*, const SpoolDir&, const char*, const struct stat&);
+    void listSendQChanges(FILE* fd, const SpoolDir& sd,
+	const fxStrArray& jobids, fxStrArray& removed);
     void nlstSendQ(FILE* fd, const SpoolDir& sd, DIR* dir);
     void nlstSendQFile(FILE*, const SpoolDir&, const char*, const struct stat&);
 
@@ -458,14 +497,16 @@ protected:
     bool sendData(FILE* fdin, FILE* fdout);
     bool sendIData(int fdin, int fdout);
     bool sendZData(int fdin, int fdout);
+    static bool putZData(void* arg, const char* buf, int cc, fxStr& emsg);
     bool recvData(FILE* instr, FILE* outstr);
     bool recvIData(int fdin, int fdout);
     bool recvZData(int fdin, int fdout);
 
     TIFF* openTIFF(const char* name);
-    bool sendTIFFData(TIFF* tif, FILE* fdout);
-    bool sendTIFFHeader(TIFF* tif, int fdout);
-    bool sendITIFFData(TIFF* tif, int fdout);
+    TIFFPageIndex* buildPageIndex(const char* name);
+    void discardPageIndex(void);
+    bool sendTIFFData(const TIFFPageIndex&, u_int page, FILE* fdout);
+    bool sendTIFFPage(const TIFFPageIndex&, u_int page, int fdout);
 
     void logTransfer(const char*, const SpoolDir&, const char*, time_t);
 
@@ -564,9 +605,16 @@ protected:
     void addPollOp(Job&, const char* sep, const char* pwd);
     void newJobCmd(void);
     bool newJob(fxStr& emsg);
+    Job* copyJob(const Job& from, const fxStr& jobid);
     Job* findJob(const char* jobid, fxStr& emsg);
     Job* findJobInMemmory(const char* jobid);
     Job* findJobOnDisk(const char* jobid, fxStr& emsg);
+    Job* findJobInIndex(const char* jobid);
+    Job* findJobForListing(const char* jobid, fxStr& emsg);
+    void cacheJob(Job*);
+    void uncacheJob(Job*);
+    void trimJobCache(void);
+    void printJobCacheStats(FILE*);
     bool updateJobFromDisk(Job& job);
     void replyCurrentJob(const char* leader);
     void setCurrentJob(const char* jobid);
@@ -579,6 +627,8 @@ protected:
     void interruptJob(const char* jobid);
     void suspendJob(const char* jobid);
     void submitJob(const char* jobid);
+    void submitJobBatch(void);
+    bool readBatchDestinations(fxStrArray& dests);
     void waitForJob(const char* jobid);
     bool updateJobOnDisk(Job& req, fxStr& emsg);
     bool lockJob(Job& job, int how, fxStr& emsg);
@@ -592,7 +642,7 @@ protected:
     void Jprintf(FILE* fd, const char* fmt, const Job& job);
     void Jprintf(fxStackBuffer& buf, const char* fmt, const Job& job);
 
-    u_int getJobNumber(fxStr&);
+    u_int getJobNumber(fxStr&, u_int count = 1);
     u_int getDocumentNumber(fxStr&);
 
     bool getRecvDocStatus(RecvInfo& ri);
@@ -602,6 +652,8 @@ protected:
     void Rprintf(fxStackBuffer&, const char*, const RecvInfo&, const struct stat&);
 
     void getServerStatus(const char* fileName, fxStr& status);
+    ModemConfig* getModemConfig(const char* modem, const char* configFile,
+	const struct stat& sb);
     void Mprintf(FILE*, const char*, const ModemConfig&);
     void Mprintf(fxStackBuffer&, const char*, const ModemConfig&);
 public:
@@ -618,6 +670,9 @@ public:
 
     virtual void open(void);
     virtual void close(void);
+    void configure(void);
+    bool configChanged(void) const;
+    void endSession(void);
 
     virtual int inputReady(int);
     void timerExpired(long, long);
@@ -327,6 +327,7 @@ InetFaxServer::handleUrgentData(void)
     char line[8];
     if (!getCmdLine(line, sizeof (line))) {
         reply(221, "You could at least say goodbye.");
+        poolReuse = false;		// in the middle of an operation
         dologout(0);
     } else if (strcasecmp(line, "ABOR\n") == 0) {
 	/*
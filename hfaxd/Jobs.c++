@@ -339,7 +339,7 @@ HylaFAXServer::checkJobState(Job* job)
      */
     struct stat sb;
     if (!FileCache::update("/" | job->qfile, sb)) {
-	jobs.remove(job->jobid);
+	uncacheJob(job);
 	if (job == curJob)			// make default job current
 	    curJob = &defJob;
 	delete job, job = NULL;
@@ -957,59 +957,71 @@ HylaFAXServer::newJob(fxStr& emsg)
     u_int id = getJobNumber(emsg);		// allocate unique job ID
     if (id == (u_int) -1)
 	return (false);
-    fxStr jobid = fxStr::format("%u", id);
+    curJob = copyJob(*curJob, fxStr::format("%u", id));
+    cacheJob(curJob);
+    return (true);
+}
+
+/*
+ * Create a new job with the specified job ID that
+ * inherits its parameters from another job.  The
+ * new job is not added to the in-memory cache and
+ * holds no documents.
+ */
+Job*
+HylaFAXServer::copyJob(const Job& from, const fxStr& jobid)
+{
     Job* job = new Job(FAX_SENDDIR "/" FAX_QFILEPREF | jobid);
     job->jobid = jobid;
-    job->groupid = curJob->groupid;
+    job->groupid = from.groupid;
     if (job->groupid == "")
 	job->groupid = jobid;
     job->owner = the_user;
     job->state = FaxRequest::state_suspended;
-    job->maxdials = curJob->maxdials;
-    job->maxtries = curJob->maxtries;
-    job->pagewidth = curJob->pagewidth;
-    job->pagelength = curJob->pagelength;
-    job->resolution = curJob->resolution;
-    job->usrpri = curJob->usrpri;
-    job->minbr = curJob->minbr;
-    job->desiredbr = curJob->desiredbr;
-    job->desiredst = curJob->desiredst;
-    job->desiredec = curJob->desiredec;
-    job->desireddf = curJob->desireddf;
-    job->desiredtl = curJob->desiredtl;
-    job->usexvres = curJob->usexvres;
-    job->useccover = curJob->useccover;
-    job->pagechop = curJob->pagechop;
-    job->notify = curJob->notify;
-    job->chopthreshold = curJob->chopthreshold;
-    job->tts = curJob->tts;
-    job->killtime = curJob->killtime;
-    job->retrytime = curJob->retrytime;
-    job->sender = curJob->sender;
-    job->mailaddr = curJob->mailaddr;
-    job->jobtag = curJob->jobtag;		// ???
-    job->number = curJob->number;
-    job->external = curJob->external;
-    job->modem = curJob->modem;
-    job->faxnumber = curJob->faxnumber;
-    job->tsi = curJob->tsi;
-    job->receiver = curJob->receiver;
-    job->company = curJob->company;
-    job->location = curJob->location;
-    job->voice = curJob->voice;
-    job->fromcompany = curJob->fromcompany;
-    job->fromlocation = curJob->fromlocation;
-    job->fromvoice = curJob->fromvoice;
-    job->regarding = curJob->regarding;
-    job->comments = curJob->comments;
-    job->jobtype = curJob->jobtype;
-    job->tagline = curJob->tagline;
+    job->binary = binaryJobFiles;
+    job->maxdials = from.maxdials;
+    job->maxtries = from.maxtries;
+    job->pagewidth = from.pagewidth;
+    job->pagelength = from.pagelength;
+    job->resolution = from.resolution;
+    job->usrpri = from.usrpri;
+    job->minbr = from.minbr;
+    job->desiredbr = from.desiredbr;
+    job->desiredst = from.desiredst;
+    job->desiredec = from.desiredec;
+    job->desireddf = from.desireddf;
+    job->desiredtl = from.desiredtl;
+    job->usexvres = from.usexvres;
+    job->useccover = from.useccover;
+    job->pagechop = from.pagechop;
+    job->notify = from.notify;
+    job->chopthreshold = from.chopthreshold;
+    job->tts = from.tts;
+    job->killtime = from.killtime;
+    job->retrytime = from.retrytime;
+    job->sender = from.sender;
+    job->mailaddr = from.mailaddr;
+    job->jobtag = from.jobtag;		// ???
+    job->number = from.number;
+    job->external = from.external;
+    job->modem = from.modem;
+    job->faxnumber = from.faxnumber;
+    job->tsi = from.tsi;
+    job->receiver = from.receiver;
+    job->company = from.company;
+    job->location = from.location;
+    job->voice = from.voice;
+    job->fromcompany = from.fromcompany;
+    job->fromlocation = from.fromlocation;
+    job->fromvoice = from.fromvoice;
+    job->regarding = from.regarding;
+    job->comments = from.comments;
+    job->jobtype = from.jobtype;
+    job->tagline = from.tagline;
     job->client = remotehost;
-    job->doneop = curJob->doneop;
-    job->queued = curJob->queued;
-    jobs[jobid] = job;
-    curJob = job;
-    return (true);
+    job->doneop = from.doneop;
+    job->queued = from.queued;
+    return (job);
 }
 
 /*
@@ -1046,8 +1058,12 @@ HylaFAXServer::findJobInMemmory(const char* jobid)
     if (curJob->jobid == jobid)				// fast check
 	return (curJob);
     Job** jpp = (Job**) jobs.find(jobid);
-    if (jpp)
-	return (*jpp);
+    if (jpp) {
+	Job* job = *jpp;
+	job->remove();				// move to most recently used
+	job->insert(jobLRU);
+	return (job);
+    }
     return (jobid == defJob.jobid ? &defJob : (Job*) NULL);
 }
 
@@ -1099,6 +1115,51 @@ HylaFAXServer::findJobOnDisk(const char* jid, fxStr& emsg)
     return (NULL);
 }
 
+/*
+ * Look for a job in the scheduler's job status index.
+ * The returned job is valid only until the next lookup
+ * and is not added to the in-memory cache.
+ */
+Job*
+HylaFAXServer::findJobInIndex(const char* jid)
+{
+    if (!jobIndex.isOpen() && !jobIndex.open("/" FAX_JOBINDEX))
+	return (NULL);
+    fxStr filename(fxStr::format("/" FAX_SENDDIR "/" FAX_QFILEPREF "%s", jid));
+    struct stat sb;
+    if (!FileCache::update(filename, sb)) {
+	filename = fxStr::format("/" FAX_DONEDIR "/" FAX_QFILEPREF "%s", jid);
+	if (!FileCache::update(filename, sb))
+	    return (NULL);
+    }
+    if (!S_ISREG(sb.st_mode) || !jobIndex.lookup(jid, sb, indexJob))
+	return (NULL);
+    indexJob.qfile = &filename[1];
+    if (publicJobQ || indexJob.owner == the_user ||
+      checkFileRights(A_READ, sb)) {
+	jobIndexHits++;
+	return (&indexJob);
+    }
+    return (NULL);
+}
+
+/*
+ * Find a job for a queue listing.  Jobs that are not
+ * in the in-memory cache are taken from the job status
+ * index when it has a current record for them; otherwise
+ * the job description file is read as usual.
+ */
+Job*
+HylaFAXServer::findJobForListing(const char* jobid, fxStr& emsg)
+{
+    if (curJob->jobid != jobid && !jobs.find(jobid)) {
+	Job* job = findJobInIndex(jobid);
+	if (job)
+	    return (job);
+    }
+    return (findJob(jobid, emsg));
+}
+
 /*
  * Update a job's state from the on-disk copy.
  */
@@ -1218,39 +1279,95 @@ HylaFAXServer::findJob(const char* jobid, fxStr& emsg)
             // We will re-check on disk in case a job was moved between queues
             job = NULL;
 	    emsg = "job deleted by another party";
-        }
+        } else
+	    jobCacheHits++;
     } 
     if (!job) {
-	/*
-	 * We can only afford a certain amount of space,
-	 * unfortunately, there is no "bright" way to remove jobs
-	 * Ideally we'ld have an "aging" method, so the LRU job
-	 * would be the one deleted...
-	 */
-	if (jobs.size() > 10)
-	{
-	    JobDictIter iter(jobs);
-	    job = iter.value();
-	    jobs.remove(job->jobid);
-	    delete job;
-	}
-
+	jobCacheMisses++;
 	job = findJobOnDisk(jobid, emsg);
-	if (job)
-	    jobs[job->jobid] = job;
+	if (job) {
+	    cacheJob(job);
+	    trimJobCache();
+	}
     }
     return (job);
 }
 
+/*
+ * Add a job to the in-memory cache as the
+ * most recently used entry.
+ */
+void
+HylaFAXServer::cacheJob(Job* job)
+{
+    jobs[job->jobid] = job;
+    job->insert(jobLRU);
+}
+
+/*
+ * Remove a job from the in-memory cache; the
+ * caller is responsible for deleting it.
+ */
+void
+HylaFAXServer::uncacheJob(Job* job)
+{
+    jobs.remove(job->jobid);
+    if (job->isOnList())
+	job->remove();
+}
+
+/*
+ * Discard the least recently used jobs until the cache
+ * is within its configured size.  The current job, jobs
+ * created during this session that have not been submitted,
+ * jobs that are locked, and the most recently used job (the
+ * one just returned by findJob) are never discarded.
+ */
+void
+HylaFAXServer::trimJobCache(void)
+{
+    QLink* ql = jobLRU.next;
+    while (jobs.size() > jobCacheSize && ql != jobLRU.prev) {
+	Job* job = (Job*) ql;
+	ql = ql->next;
+	if (job == curJob || job->fd != -1 || blankJobs.find(job->jobid))
+	    continue;
+	uncacheJob(job);
+	delete job;
+	jobCacheEvictions++;
+    }
+}
+
+void
+HylaFAXServer::printJobCacheStats(FILE* fd)
+{
+    fprintf(fd, "    Job cache: %u jobs (max %u), %u hits, %u misses, %u evictions\r\n"
+	, jobs.size()
+	, jobCacheSize
+	, jobCacheHits
+	, jobCacheMisses
+	, jobCacheEvictions
+    );
+    if (jobIndex.isOpen())
+	fprintf(fd, "    Job index: %u jobs, generation %u, %u jobs listed from index\r\n"
+	    , jobIndex.size()
+	    , jobIndex.generation()
+	    , jobIndexHits
+	);
+}
+
 /*
  * Purge all in-memory job state.
  */
 void
 HylaFAXServer::purgeJobs(void)
 {
-    for (JobDictIter iter(jobs); iter.notDone(); iter++) {
-	Job* job = iter.value();
-	jobs.remove(job->jobid);
+    fxStrArray ids;
+    for (JobDictIter iter(jobs); iter.notDone(); iter++)
+	ids.append(iter.key());
+    for (u_int i = 0, n = ids.length(); i < n; i++) {
+	Job* job = jobs[ids[i]];
+	uncacheJob(job);
 	delete job;
     }
 }
@@ -1419,10 +1536,15 @@ HylaFAXServer::deleteJob(const char* jobid)
 	    reply(504, "Deletion of queue file %s failed.", (const char*) job->qfile);
 	if (Sys::chdir(startdir) < 0)
 	    reply(504, "Cannot change to %s spool directory.", startdir);
-	jobs.remove(job->jobid);
+	uncacheJob(job);
 	if (job == curJob)			// make default job current
 	    curJob = &defJob;
 	delete job;				// NB: implicit unlock
+	/*
+	 * Have the scheduler drop the job from its status
+	 * index so incremental listings report it removed.
+	 */
+	(void) sendQueuerACK(emsg, "I%s", jobid);
 	replyCurrentJob(fxStr::format("Job %s deleted; current job:", jobid));
     }
 }
@@ -1535,6 +1657,190 @@ HylaFAXServer::submitJob(const char* jobid)
     }
 }
 
+/*
+ * Return the name to use for the link to a document
+ * when it is copied from one job to another.  The
+ * names follow those created by addDocument.
+ */
+static fxStr
+copyItemName(const fxStr& item, const fxStr& from, const fxStr& to)
+{
+    fxStr suffix("." | from);
+    if (item.length() > suffix.length() && item.tail(suffix.length()) == suffix)
+	return (item.head(item.length() - suffix.length()) | "." | to);
+    return (item | "." | to);
+}
+
+/*
+ * JBATCH command; submit a batch of jobs, one for each
+ * dial string read from the data connection.  Each job
+ * is a copy of the current job, which must be a job
+ * created in this session that has not been submitted,
+ * with links to the same documents.  A cover page is
+ * made for one recipient so a job with a cover page
+ * cannot be used.  The job IDs are reserved as one
+ * contiguous block and the scheduler is sent a single
+ * message to submit the whole block; if it refuses the
+ * batch the jobs are removed.
+ */
+void
+HylaFAXServer::submitJobBatch(void)
+{
+    Job& tmpl = *curJob;
+    if (!blankJobs.find(tmpl.jobid)) {
+	reply(504, "Job %s cannot be used for a batch; use JNEW first.",
+	    (const char*) tmpl.jobid);
+	return;
+    }
+    if (!IS(PRIVILEGED) && the_user != tmpl.owner) {
+	reply(504, "Permission denied; cannot inherit from job %s.",
+	    (const char*) tmpl.jobid);
+	return;
+    }
+    if (tmpl.mailaddr == "") {
+	replyBadJob(tmpl, T_NOTIFYADDR);
+	return;
+    }
+    if (tmpl.sender == "") {
+	replyBadJob(tmpl, T_FROM_USER);
+	return;
+    }
+    if (tmpl.modem == "") {
+	replyBadJob(tmpl, T_MODEM);
+	return;
+    }
+    if (tmpl.client == "") {
+	replyBadJob(tmpl, T_CLIENT);
+	return;
+    }
+    for (u_int j = 0, nitems = tmpl.items.length(); j < nitems; j++) {
+	const fxStr& item = tmpl.items[j].item;
+	if (item.length() > 7 && item.tail(6) == ".cover") {
+	    reply(504, "Job %s cannot be used for a batch; it has a cover page.",
+		(const char*) tmpl.jobid);
+	    return;
+	}
+    }
+    fxStrArray dests;
+    if (!readBatchDestinations(dests))
+	return;
+    u_int n = dests.length();
+    if (n == 0) {
+	reply(501, "No dial strings specified for batch.");
+	return;
+    }
+    fxStr emsg;
+    u_int first = getJobNumber(emsg, n);	// allocate block of job IDs
+    if (first == (u_int) -1) {
+	reply(503, "%s.", (const char*) emsg);
+	return;
+    }
+    fxStrArray files;				// files created for batch
+    u_int i;
+    for (i = 0; i < n; i++) {
+	Job* job = copyJob(tmpl, fxStr::format("%u", first+i));
+	job->number = dests[i];
+	job->external = dests[i];
+	u_int j, nitems = tmpl.items.length();
+	for (j = 0; j < nitems; j++) {
+	    const FaxItem& fitem = tmpl.items[j];
+	    if (fitem.op == FaxRequest::send_poll) {
+		job->items.append(fitem);
+		continue;
+	    }
+	    fxStr item = copyItemName(fitem.item, tmpl.jobid, job->jobid);
+	    if (Sys::link("/" | fitem.item, "/" | item) < 0) {
+		emsg = fxStr::format("Unable to link document %s to %s: %s",
+		    (const char*) fitem.item, (const char*) item,
+		    strerror(errno));
+		break;
+	    }
+	    files.append("/" | item);
+	    job->items.append(FaxItem(fitem.op, fitem.dirnum, fitem.addr, item));
+	}
+	bool ok = false;
+	if (j == nitems) {
+	    files.append("/" | job->qfile);
+	    if ((ok = updateJobOnDisk(*job, emsg))) {
+		setFileOwner(files[files.length()-1]);	// force ownership
+		FileCache::chmod(files[files.length()-1], jobProtection);
+	    }
+	}
+	delete job;				// NB: closes qfile
+	if (!ok)
+	    break;
+    }
+    if (i < n) {
+	/*
+	 * Back out the jobs already written so that
+	 * either all of the batch is submitted or none.
+	 */
+	for (u_int k = 0, nfiles = files.length(); k < nfiles; k++)
+	    Sys::unlink(files[k]);
+	reply(450, "%s.", (const char*) emsg);
+	return;
+    }
+    fifoResponse = "";
+    if (sendQueuerACK(emsg, "B%u %u", first, n))
+	reply(200, "Jobs %u-%u submitted: groupid: %s.",
+	    first, first+n-1, (const char*) tmpl.groupid);
+    else if (fifoResponse == "" || fifoResponse[0] == 'B') {
+	/*
+	 * The scheduler was not reached or refused the
+	 * batch; it submits none of a batch it refuses.
+	 */
+	for (u_int k = 0, nfiles = files.length(); k < nfiles; k++)
+	    Sys::unlink(files[k]);
+	reply(460, "Failed to submit jobs %u-%u: %s; jobs removed.",
+	    first, first+n-1, (const char*) emsg);
+    } else
+	reply(460, "Failed to submit jobs %u-%u: %s.",
+	    first, first+n-1, (const char*) emsg);
+}
+
+/*
+ * Read the dial strings for a batch submission from
+ * the data connection; one per line.  Blank lines and
+ * lines beginning with ``#'' are ignored.
+ */
+bool
+HylaFAXServer::readBatchDestinations(fxStrArray& dests)
+{
+    fxStr filename = fxStr::format("/" FAX_TMPDIR "/batch%u", getpid());
+    FILE* fout = fopen(filename, "w+");
+    if (fout == NULL) {
+	perror_reply(553, filename, errno);
+	return (false);
+    }
+    Sys::unlink(filename);			// NB: file goes away on close
+    bool ok = false;
+    int code;
+    FILE* din = openDataConn("r", code);
+    if (din != NULL) {
+	reply(code, "%s for batch dial strings.", dataConnMsg(code));
+	file_size = -1;
+	ok = recvData(din, fout);
+	closeDataConn(din);
+    }
+    if (ok) {
+	rewind(fout);
+	char line[1024];
+	while (fgets(line, sizeof (line), fout) != NULL) {
+	    char* cp = line;
+	    while (isspace(*cp))
+		cp++;
+	    char* ep = cp + strlen(cp);
+	    while (ep > cp && isspace(ep[-1]))
+		ep--;
+	    *ep = '\0';
+	    if (*cp != '\0' && *cp != '#')
+		dests.append(cp);
+	}
+    }
+    fclose(fout);
+    return (ok);
+}
+
 /*
  * Wait for a job to complete or for the operation
  * to be aborted.  A data channel is opened and 
@@ -2007,10 +2313,11 @@ HylaFAXServer::listSendQ(FILE* fd, const SpoolDir&, DIR* dir)
 {
     KeyStringArray listing;
     struct dirent* dp;
+    (void) jobIndex.open("/" FAX_JOBINDEX);	// pick up a rebuilt index
     while ((dp = readdir(dir)))
 	if (dp->d_name[0] == 'q') {
 	    fxStr emsg;
-	    Job* job = findJob(&dp->d_name[1], emsg);
+	    Job* job = findJobForListing(&dp->d_name[1], emsg);
 	    if (job) {
 		if (jobSortFormat.length() == 0) {
 		    Jprintf(fd, jobFormat, *job);
@@ -2038,12 +2345,126 @@ HylaFAXServer::listSendQ(FILE* fd, const SpoolDir&, DIR* dir)
 
 }
 
+/*
+ * List the changed jobs that are still in the queue;
+ * the other jobs have left it and are returned.
+ */
+void
+HylaFAXServer::listSendQChanges(FILE* fd, const SpoolDir& sd,
+    const fxStrArray& jobids, fxStrArray& removed)
+{
+    KeyStringArray listing;
+    fxStr path(sd.pathname);
+    for (u_int i = 0, n = jobids.length(); i < n; i++) {
+	struct stat sb;
+	if (!FileCache::update(path | FAX_QFILEPREF | jobids[i], sb) ||
+	  !S_ISREG(sb.st_mode)) {
+	    removed.append(jobids[i]);
+	    continue;
+	}
+	fxStr emsg;
+	Job* job = findJobForListing(jobids[i], emsg);
+	if (job) {
+	    if (jobSortFormat.length() == 0) {
+		Jprintf(fd, jobFormat, *job);
+		fputs("\r\n", fd);
+	    } else {
+		fxStackBuffer buf;
+		Jprintf(buf, jobFormat, *job);
+		fxStr content(buf, buf.getLength());
+		buf.reset();
+		Jprintf(buf, jobSortFormat, *job);
+		fxStr key(buf, buf.getLength());
+		listing.append(KeyString(key, content));
+	    }
+	}
+    }
+
+    if (listing.length() > 1)
+	listing.qsort();
+
+    for (u_int i = 0; i < listing.length(); i++)
+    {
+	fwrite(listing[i], listing[i].length(), 1, fd);
+	fputs("\r\n", fd);
+    }
+}
+
+/*
+ * List the jobs in the send or done queue that have changed
+ * since a generation of the scheduler's job status index.
+ * Jobs still in the queue are listed as for LIST and jobs
+ * that have left it are named in the reply.  If the changes
+ * cannot be determined, e.g. because the index was rebuilt,
+ * all jobs are listed and the reply says so.  The reply gives
+ * the generation to use for the next request.
+ */
+void
+HylaFAXServer::listSinceCmd(const char* pathname, u_int since)
+{
+    SpoolDir* sd = dirAccess(pathname);
+    if (!sd)
+	return;
+    if (sd->listDirectory != &HylaFAXServer::listSendQ) {
+	reply(504, "%s: SINCE is only supported for job queues.", pathname);
+	return;
+    }
+    (void) jobIndex.open("/" FAX_JOBINDEX);
+    fxStr queue(sd->pathname);
+    queue.remove(0);				// "/sendq/" -> "sendq"
+    queue.resize(queue.length()-1);
+    fxStrArray changed;
+    u_int gen;
+    bool incremental = jobIndex.changedSince(queue, since, gen, changed);
+    DIR* dir = NULL;
+    if (!incremental) {
+	gen = jobIndex.generation();
+	dir = opendir(pathname);
+	if (dir == NULL) {
+	    if (errno != 0)
+		perror_reply(550, pathname, errno);
+	    else
+		reply(550, "%s: Cannot open directory.", pathname);
+	    return;
+	}
+    }
+    int code;
+    FILE* dout = openDataConn("w", code);
+    if (dout != NULL) {
+	reply(code, "%s for \"%s\".", dataConnMsg(code), pathname);
+	if (setjmp(urgcatch) == 0) {
+	    state |= S_TRANSFER;
+	    fxStrArray removed;
+	    if (incremental)
+		listSendQChanges(dout, *sd, changed, removed);
+	    else
+		listSendQ(dout, *sd, dir);
+	    fflush(dout);
+	    for (u_int i = 0, n = removed.length(); i < n; ) {
+		fxStr line(removed[i++]);
+		for (u_int j = 1; j < 8 && i < n; j++)
+		    line.append(" " | removed[i++]);
+		lreply(226, "Removed: %s", (const char*) line);
+	    }
+	    if (incremental)
+		reply(226, "Transfer complete; generation %u.", gen);
+	    else
+		reply(226, "Transfer complete; all jobs listed, generation %u.",
+		    gen);
+	}
+	state &= ~S_TRANSFER;
+	closeDataConn(dout);
+    }
+    if (dir)
+	closedir(dir);
+}
+
 void
 HylaFAXServer::listSendQFile(FILE* fd, const SpoolDir& dir,
     const char* filename, const struct stat& sb)
 {
     fxStr emsg;
-    Job* job = findJob(filename, emsg);
+    Job* job = findJobForListing(filename, emsg);
     if (job)
 	Jprintf(fd, jobFormat, *job);
     else
@@ -2054,10 +2475,11 @@ void
 HylaFAXServer::nlstSendQ(FILE* fd, const SpoolDir&, DIR* dir)
 {
     struct dirent* dp;
+    (void) jobIndex.open("/" FAX_JOBINDEX);
     while ((dp = readdir(dir)))
 	if (dp->d_name[0] == 'q') {
 	    fxStr emsg;
-	    Job* job = findJob(&dp->d_name[1], emsg);
+	    Job* job = findJobForListing(&dp->d_name[1], emsg);
 	    if (job)
 		Jprintf(fd, "%j\r\n", *job);
 	}
@@ -2068,7 +2490,7 @@ HylaFAXServer::nlstSendQFile(FILE* fd, const SpoolDir&,
     const char* filename, const struct stat&)
 {
     fxStr emsg;
-    Job* job = findJob(filename, emsg);
+    Job* job = findJobForListing(filename, emsg);
     if (job)
 	Jprintf(fd, "%j", *job);
     else
@@ -24,6 +24,7 @@
  * OF THIS SOFTWARE.
  */
 #include "HylaFAXServer.h"
+#include "Dispatcher.h"
 #include "Sys.h"
 
 #include <unistd.h>
@@ -147,6 +148,7 @@ HylaFAXServer::passCmd(const char* pass)
 		, (const char*) remoteaddr
 	    );
 	    dologout(0);
+	    return;
 	}
 	reply(530, "Login incorrect.");
 	logInfo("Login failed from %s [%s], %s"
@@ -167,6 +169,8 @@ HylaFAXServer::passCmd(const char* pass)
 void
 HylaFAXServer::login(int code)
 {
+    if (workerChan != -1 && poolReuse && !forkSession())
+	return;			// session passed to a child process
     loginAttempts = 0;		// this time successful
     state |= S_LOGGEDIN;
 
@@ -187,7 +191,6 @@ HylaFAXServer::login(int code)
 	end_login();
 	return;
     }
-
     (void) isShutdown(false);	// display any shutdown messages
     reply(code, "User %s logged in.", (const char*) the_user);
     if (TRACE(LOGIN))
@@ -239,6 +242,64 @@ HylaFAXServer::adminCmd(const char* pass)
     reply(230, "Administrative privileges established.");
 }
 
+/*
+ * A logged in session is chroot'd to the spooling area
+ * and runs with the client's credentials, so a pooled
+ * worker that is to serve more connections forks a
+ * process to carry on with the session and goes back
+ * to waiting for connections.  This is true in the
+ * session process (and in the worker if the fork fails,
+ * which then exits when the session ends) and false in
+ * the worker.
+ */
+bool
+HylaFAXServer::forkSession(void)
+{
+    pid_t pid = fork();
+    switch (pid) {
+    case 0:				// session process
+	Sys::close(workerChan);
+	workerChan = -1;
+	poolReuse = false;		// exit at logout
+#ifdef F_SETOWN
+	if (fcntl(STDIN_FILENO, F_SETOWN, getpid()) == -1)
+	    logError("fcntl (F_SETOWN): %m");
+#endif
+	/*
+	 * The client FIFO is named for the process that reads
+	 * it; the worker removes its own.
+	 */
+	if (clientFd != -1) {
+	    Dispatcher::instance().unlink(clientFd);
+	    Sys::close(clientFd);
+	    clientFd = -1;
+	}
+	{ fxStr emsg;
+	  if (!initClientFIFO(emsg))
+	    fatal("%s", (const char*) emsg);
+	}
+	return (true);
+    case -1:
+	logError("Cannot fork session process: %m");
+	poolReuse = false;		// cannot leave the chroot
+	return (true);
+    }
+    /*
+     * Temporary files and new jobs now belong to the
+     * session process; endSession releases them (and
+     * the connection) without removing them.
+     */
+    if (clientFd != -1) {
+	Dispatcher::instance().unlink(clientFd);
+	Sys::close(clientFd);
+	clientFd = -1;
+    }
+    if (clientFIFOName != "")
+	Sys::unlink(clientFIFOName);
+    sessionOver = true;
+    return (false);
+}
+
 /*
  * Terminate login as previous user, if any,
  * resetting state; used when USER command is
@@ -291,5 +352,68 @@ HylaFAXServer::dologout(int status)
 	fxStr file("/" | job->qfile);
 	Sys::unlink(file);
     }
+    if (poolReuse && status == 0) {
+	/*
+	 * A pooled worker that can serve more sessions
+	 * returns to the command loop, which stops when
+	 * it sees sessionOver; the worker then releases
+	 * the connection and waits for another one.
+	 */
+	sessionOver = true;
+	return;
+    }
     _exit(status);		// beware of flushing buffers after a SIGPIPE
 }
+
+/*
+ * Release per-connection state after dologout in a
+ * pooled worker.  Cached jobs and received facsimile
+ * are purged since lookups that hit them skip the
+ * permission checks made when they were read; the
+ * file, modem status, and user name caches are kept.
+ * All other state is reset by initServer when the
+ * next session is opened.
+ */
+void
+HylaFAXServer::endSession(void)
+{
+    Dispatcher& disp = Dispatcher::instance();
+    tempFiles.resize(0);
+    xferfaxlog = -1;
+    if (clientFd != -1) {
+	disp.unlink(clientFd);
+	clientFd = -1;
+    }
+    clientFIFOName = "";
+    fxStrArray blank;
+    for (JobDictIter iter(blankJobs); iter.notDone(); iter++)
+	blank.append(iter.key());
+    for (u_int i = 0, n = blank.length(); i < n; i++) {
+	Job* job = blankJobs[blank[i]];
+	blankJobs.remove(blank[i]);
+	if (job != &defJob) {
+	    uncacheJob(job);
+	    delete job;
+	}
+    }
+    curJob = &defJob;
+    purgeJobs();
+    fxStrArray received;
+    for (RecvInfoDictIter iter(recvq); iter.notDone(); iter++)
+	received.append(iter.key());
+    for (u_int i = 0, n = received.length(); i < n; i++) {
+	RecvInfo* rip = recvq[received[i]];
+	recvq.remove(received[i]);
+	delete rip;
+    }
+    discardPageIndex();
+    if (data != -1)
+	Sys::close(data), data = -1;
+    if (pdata != -1)
+	Sys::close(pdata), pdata = -1;
+    loginAttempts = 0;
+    adminAttempts = 0;
+    disp.unlink(STDIN_FILENO);
+    Sys::close(STDIN_FILENO);
+    Sys::close(STDOUT_FILENO);
+}
@@ -62,6 +62,7 @@ static const tab cmdtab[] = {
 { "FILESORTFMT",  T_FILESFMT,	 true, true, "[format-string]" },
 { "FORM",         T_FORM,	 true, true, "format-type" },
 { "IDLE",         T_IDLE,	 true, true, "[max-idle-timeout]" },
+{ "JBATCH",       T_JBATCH,	 true, true, "(submit batch of jobs)" },
 { "JDELE",        T_JDELE,	 true, true, "[job-id]" },
 { "JINTR",        T_JINTR,	 true, true, "[job-id]" },
 { "JKILL",        T_JKILL,	 true, true, "[job-id]" },
@@ -84,9 +85,9 @@ static const tab cmdtab[] = {
 { "JGSUBM",       T_JGSUB,	 true,false, "[jobgroup-id]" },
 { "JGSUSP",       T_JGSUSP,	 true,false, "[jobgroup-id]" },
 { "JGWAIT",       T_JGWAIT,	 true,false, "[jobgroup-id]" },
-{ "LIST",         T_LIST,	 true, true, "[path-name]" },
+{ "LIST",         T_LIST,	 true, true, "[path-name [SINCE generation]]" },
 { "MDTM",         T_MDTM,	 true, true, "path-name" },
-{ "MODE",         T_MODE,	false, true, "(specify transfer mode)" },
+{ "MODE",         T_MODE,	false, true, "mode [level]" },
 { "MDMFMT",       T_MODEMFMT,	 true, true, "[format-string]" },
 { "MDMSORTFMT",   T_MODEMSFMT,	 true, true, "[format-string]" },
 { "NLST",         T_NLST,	 true, true, "[path-name]" },
@@ -290,9 +291,10 @@ HylaFAXServer::parse()
 	 * that this does not mean the connection has dropped; just
 	 * that data is not available at this instant.  Note also
 	 * that if a partial line of input is received a complete
-	 * line will be waited for (see below).
+	 * line will be waited for (see below).  A pooled
+	 * worker stops here when the session has ended.
 	 */
-	if (!getCmdLine(cbuf, sizeof (cbuf)))
+	if (sessionOver || !getCmdLine(cbuf, sizeof (cbuf)))
 	    break;
 	/*
 	 * Parse the line of input read above.
@@ -356,6 +358,8 @@ HylaFAXServer::parse()
 	    dologout(0);
 	}
     }
+    if (sessionOver)			// back to the worker loop
+	return (0);
     Dispatcher::instance().startTimer(idleTimeout, 0, this);
     return (0);
 }
@@ -438,11 +442,17 @@ HylaFAXServer::cmd(Token t)
 	    return (true);
 	}
 	break;
-    case T_MODE:			// data transfer mode
-	if (string_param(s, "transfer mode")) {
-	    logcmd(t, "%s", (const char*) s);
-	    modeCmd(s);
-	    return (true);
+    case T_MODE:			// data transfer mode [level]
+	if (SPACE() && STRING(s, "transfer mode")) {
+	    n = -1;
+	    if (opt_CRLF() || (SPACE() && NUMBER(n) && CRLF())) {
+		if (n == -1)
+		    logcmd(t, "%s", (const char*) s);
+		else
+		    logcmd(t, "%s %ld", (const char*) s, n);
+		modeCmd(s, n);
+		return (true);
+	    }
 	}
 	break;
     case T_STRU:			// data transfer file structure
@@ -511,13 +521,27 @@ HylaFAXServer::cmd(Token t)
 	    else
 		nlstCmd(".");
 	    return (true);
-	} else if (pathname_param(s)) {
-	    logcmd(t, "%s", (const char*) s);
-	    if (t == T_LIST)
-		listCmd(s);
-	    else
-		nlstCmd(s);
-	    return (true);
+	} else if (SPACE() && pathname(s)) {
+	    fxStr kw;
+	    long gen;
+	    if (opt_CRLF()) {
+		logcmd(t, "%s", (const char*) s);
+		if (t == T_LIST)
+		    listCmd(s);
+		else
+		    nlstCmd(s);
+		return (true);
+	    } else if (t == T_LIST && SPACE() && STRING(kw, "SINCE")) {
+		kw.raisecase();
+		if (kw != "SINCE")
+		    syntaxError("expecting SINCE");
+		else if (SPACE() && NUMBER(gen) && CRLF()) {
+		    logcmd(t, "%s SINCE %ld", (const char*) s, gen);
+		    listSinceCmd(s, (u_int) gen);
+		    return (true);
+		}
+	    } else if (t == T_NLST)
+		(void) CRLF();		// NB: generates syntax error
 	}
 	break;
     case T_CWD:				// change working directory
@@ -617,6 +641,12 @@ HylaFAXServer::cmd(Token t)
 	    return (true);
 	}
 	break;
+    case T_JBATCH:			// submit batch of jobs
+	if (CRLF()) {
+	    submitJobBatch();
+	    return (true);
+	}
+	break;
     case T_JOB:				// select current job
 	if (job_param(s)) {
 	    setCurrentJob(s);
@@ -250,12 +250,13 @@ HylaFAXServer::listRecvQ(FILE* fd, const SpoolDir& sd, DIR* dir)
      * lookups to improve cache locality.
      */
     fxStr path(sd.pathname);
+    FileCache::scan(path, dir);
     struct dirent* dp;
     while ((dp = readdir(dir))) {
 	struct stat sb;
 	fxStr qfile(path | dp->d_name);
 	RecvInfo* rip;
-	if (!FileCache::update(qfile, sb))
+	if (!FileCache::lookup(qfile, sb))
 	    continue;
 	if (!isVisibleRecvQFile(dp->d_name, sb))
 	    continue;
@@ -185,6 +185,9 @@ SNPPServer::dologout(int status)
 		    if (job->items[j].op == FaxRequest::send_data)
 			(void) Sys::unlink(job->items[j].item);
 		(void) Sys::unlink(job->qfile);
+		uncacheJob(job);
+		if (job == curJob)
+		    curJob = &defJob;
 		delete job;
 	    }
 	}
@@ -469,9 +472,10 @@ SNPPServer::parse()
 	 * that this does not mean the connection has dropped; just
 	 * that data is not available at this instant.  Note also
 	 * that if a partial line of input is received a complete
-	 * line will be waited for (see below).
+	 * line will be waited for (see below).  A pooled
+	 * worker stops here when the session has ended.
 	 */
-	if (!getCmdLine(cbuf, sizeof (cbuf)))
+	if (sessionOver || !getCmdLine(cbuf, sizeof (cbuf)))
 	    break;
 	/*
 	 * Parse the line of input read above.
@@ -524,6 +528,8 @@ SNPPServer::parse()
 	    dologout(0);
 	}
     }
+    if (sessionOver)			// back to the worker loop
+	return (0);
     Dispatcher::instance().startTimer(idleTimeout, 0, this);
     return (0);
 }
@@ -890,6 +896,9 @@ SNPPServer::dataCmd(void)
 		    // hence we must write bp, not buf. also blen is
 		    // the length of bp, not buf.
 		    (void) fwrite((const char*) bp, blen, 1, fout);
+		} else if (sessionOver) {	// connection dropped
+		    (void) fclose(fout);
+		    return;
 		}
 	    }
 	    if (fclose(fout)) {
@@ -1010,6 +1019,7 @@ SNPPServer::loginCmd(const char* loginID, const char* pass)
 			, (const char*) remoteaddr
 		    );
 		    dologout(0);
+		    return;
 		}
 		reply(550, "Login incorrect.");
 		logInfo("SNPP login failed from %s [%s], %s"
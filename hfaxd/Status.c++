@@ -52,26 +52,76 @@ public:
     fxStr	modemName;		// canonical modem name
     bool	isGettyRunning;		// true if faxgetty responds via FIFO
     fxStr	status;			// from status file
+    dev_t	dev;			// identity of the parsed config file
+    ino_t	ino;
+    off_t	size;
+    time_t	mtime;
 
     ModemConfig(const char* name);
     ~ModemConfig() {};
 
+    void resetConfig();
     bool setConfigItem(const char* tag, const char* value);
     void configError(const char* fmt, ...);
     void configTrace(const char* fmt, ...);
 
+    bool isCurrent(const struct stat& sb) const;
+    void setCurrent(const struct stat& sb);
     void checkGetty(const char* fifoFile);
 };
+fxIMPLEMENT_StrKeyPtrValueDictionary(ModemConfigDict, ModemConfig*)
+
 ModemConfig::ModemConfig(const char* name) : modemName(name)
 {
     HylaFAXServer::canonModem(modemName);
+    resetConfig();
+}
+void ModemConfig::configError(const char*, ...) {}
+void ModemConfig::configTrace(const char*, ...) {}
+
+void
+ModemConfig::resetConfig()
+{
+    FaxConfig::resetConfig();
     maxRecvPages = (u_int) -1;
     tracingLevel = 0;
     logTracingLevel = 0;
     speakerVolume = QUIET;
+    localIdentifier = "";
+    FAXNumber = "";
+    dev = 0;
+    ino = 0;
+    size = 0;
+    mtime = 0;
+}
+
+/*
+ * Return true if the parsed configuration
+ * was read from the file described by sb.
+ */
+bool
+ModemConfig::isCurrent(const struct stat& sb) const
+{
+    return (ino != 0 && sb.st_dev == dev && sb.st_ino == ino &&
+	sb.st_size == size && sb.st_mtime == mtime);
+}
+
+/*
+ * Record the identity of the file just parsed.  A file
+ * modified during the current second is not recorded
+ * since a later change in the same second would go
+ * unnoticed; it is parsed again on the next request.
+ */
+void
+ModemConfig::setCurrent(const struct stat& sb)
+{
+    if (sb.st_mtime < Sys::now()) {
+	dev = sb.st_dev;
+	ino = sb.st_ino;
+	size = sb.st_size;
+	mtime = sb.st_mtime;
+    }
 }
-void ModemConfig::configError(const char*, ...) {}
-void ModemConfig::configTrace(const char*, ...) {}
 
 void
 ModemConfig::checkGetty(const char* fifoFile)
@@ -108,6 +158,32 @@ ModemConfig::setConfigItem(const char* tag, const char* value)
     return (true);				// avoid complaints
 }
 
+/*
+ * Return the parsed configuration for a modem.  Parsed
+ * configurations are kept for the life of the session
+ * and a configuration file is parsed again only when it
+ * changes; sb must come from a fresh stat of the file.
+ */
+ModemConfig*
+HylaFAXServer::getModemConfig(const char* modem, const char* configFile,
+    const struct stat& sb)
+{
+    ModemConfig* config;
+    ModemConfig** cpp = (ModemConfig**) modemConfigs.find(modem);
+    if (cpp) {
+	config = *cpp;
+	if (config->isCurrent(sb))
+	    return (config);
+	config->resetConfig();
+    } else {
+	config = new ModemConfig(modem);
+	modemConfigs[modem] = config;
+    }
+    config->readConfig(configFile);
+    config->setCurrent(sb);
+    return (config);
+}
+
 void
 HylaFAXServer::listStatus(FILE* fd, const SpoolDir& sd, DIR* dir)
 {
@@ -138,13 +214,13 @@ HylaFAXServer::listStatus(FILE* fd, const SpoolDir& sd, DIR* dir)
 	    continue;
 	// verify there is a modem config file
 	fxStr configFile = fxStr::format("/" FAX_CONFIG ".%s", dp->d_name);
-	if (!FileCache::lookup(configFile, sb) || !S_ISREG(sb.st_mode))
+	struct stat csb;
+	if (!FileCache::update(configFile, csb) || !S_ISREG(csb.st_mode))
 	    continue;
 	fxStr fifoFile(fifoPrefix | dp->d_name);
 	if (!FileCache::lookup(fifoFile, sb) || !S_ISFIFO(sb.st_mode))
 	    continue;
-	ModemConfig config(dp->d_name);
-	config.readConfig(configFile);			// read config file
+	ModemConfig& config = *getModemConfig(dp->d_name, configFile, csb);
 	config.checkGetty(fifoFile);			// check for faxgetty
 	getServerStatus(statusFile, config.status);	// XXX
 	if (modemSortFormat.length() == 0) {
@@ -177,28 +253,26 @@ HylaFAXServer::listStatusFile(FILE* fd, const SpoolDir& dir,
     listUnixFile(fd, dir, filename, sb);
 }
 
+/*
+ * Read a modem's status.  Status files hold a single
+ * line of text so one read into a fixed buffer is enough.
+ */
 void
 HylaFAXServer::getServerStatus(const char* fileName, fxStr& status)
 {
     int fd = Sys::open(fileName, O_RDONLY);
-    if (fd > 0) {
-        struct stat sb;
-        (void) Sys::fstat(fd, sb);
-        status.resize((u_int) sb.st_size);
-        char* buff = new char[sb.st_size];
-        int n = Sys::read(fd, buff, (size_t) sb.st_size);
-        status = buff;
-        Sys::close(fd);
-        if (n > 0 && status[n-1] == '\n') n--;
-        if (n == 0) {
-            status = "No status (empty file)";
-        } else {
-            status.resize(n);
-        }
-        delete [] buff;
-    } else {
-        status = "No status (cannot open file)";
-    }
+    if (fd >= 0) {
+	char buf[1024];
+	int n = Sys::read(fd, buf, sizeof (buf));
+	Sys::close(fd);
+	if (n > 0 && buf[n-1] == '\n')
+	    n--;
+	if (n > 0)
+	    status = fxStr(buf, n);
+	else
+	    status = "No status (empty file)";
+    } else
+	status = "No status (cannot open file)";
 }
 
 static const char mformat[] = {
@@ -342,15 +416,13 @@ HylaFAXServer::nlstStatus(FILE* fd, const SpoolDir& sd, DIR* dir)
 	    continue;
 	// verify there is a modem config file
 	fxStr configFile = fxStr::format("/" FAX_CONFIG ".%s", dp->d_name);
-	if (!FileCache::lookup(configFile, sb) || !S_ISREG(sb.st_mode))
+	struct stat csb;
+	if (!FileCache::update(configFile, csb) || !S_ISREG(csb.st_mode))
 	    continue;
 	fxStr fifoFile(fifoPrefix | dp->d_name);
 	if (!FileCache::lookup(fifoFile, sb) || !S_ISFIFO(sb.st_mode))
 	    continue;
-	ModemConfig config(dp->d_name);
-	config.readConfig(configFile);			// read config file
-	config.checkGetty(fifoFile);			// check for faxgetty
-	getServerStatus(statusFile, config.status);	// XXX
-	Mprintf(fd, "%m\r\n", config);
+	// NB: only the modem name is listed
+	Mprintf(fd, "%m\r\n", *getModemConfig(dp->d_name, configFile, csb));
     }
 }
@@ -29,15 +29,39 @@
 #include "SuperServer.h"
 #include "Socket.h"
 
+#include <sys/uio.h>
+#include <sys/wait.h>
+
 #define	MAXTRIES	10
 
+u_int SuperServer::poolSize = 0;	// fork a process per connection
+u_int SuperServer::maxSessions = 1;	// one session per worker
+
 SuperServer::SuperServer(const char* k, int bl) : kind(k)
 {
     backlog = bl;
     ntries = 0;
+    workers = NULL;
     Dispatcher::instance().startTimer(0,1,this);	// schedule setup
 }
-SuperServer::~SuperServer() {}
+SuperServer::~SuperServer()
+{
+    delete [] workers;
+}
+
+/*
+ * Configure the pool of pre-forked worker processes;
+ * a pool size of zero (the default) means a process
+ * is forked for each connection.  A worker serves up
+ * to sessions connections before exiting (zero means
+ * no limit) and is then replaced.
+ */
+void
+SuperServer::setWorkerPool(u_int n, u_int sessions)
+{
+    poolSize = n;
+    maxSessions = sessions;
+}
 
 void
 SuperServer::timerExpired(long, long)
@@ -51,13 +75,35 @@ SuperServer::timerExpired(long, long)
 	logNotice("HylaFAX %s: Unable to init server, "
 	    "trying again in %u seconds.", (const char*) kind, 5*ntries);
 	Dispatcher::instance().startTimer(5*ntries,0, this);
-    } else
+    } else {
 	logNotice("HylaFAX %s Protocol Server: restarted.", (const char*) kind);
+	startWorkers();
+    }
 }
 
 int
 SuperServer::inputReady(int fd)
 {
+    Worker* w = findWorker(fd);
+    if (w) {
+	/*
+	 * Status from a worker; a byte is written each time
+	 * the worker is ready to accept a connection.  EOF
+	 * means the worker is exiting--it is reaped and
+	 * replaced in childStatus.
+	 */
+	char c;
+	if (Sys::read(fd, &c, 1) == 1) {
+	    w->idle = true;
+	    w->ready = true;
+	} else {
+	    Dispatcher::instance().unlink(fd);
+	    Sys::close(fd);
+	    w->chan = -1;
+	    w->idle = false;
+	}
+	return (0);
+    }
     Socket::Address addr;
     socklen_t slen = sizeof(addr);
     int c = Socket::accept(fd, &addr, &slen);
@@ -78,6 +124,10 @@ SuperServer::inputReady(int fd)
 	}
     }
 #endif
+    if (passConnection(c)) {		// handed to a waiting worker
+	Sys::close(c);
+	return (0);
+    }
     pid_t pid = fork();
     switch (pid) {
     case 0:				// child
@@ -92,6 +142,7 @@ SuperServer::inputReady(int fd)
 	HylaFAXServer* app; app = newChild();	// XXX for __GNUC__
 	HylaFAXServer::closeLogging();		// close any open syslog fd
 	HylaFAXServer::closeAllDispatched();
+	dropWorkers();
 	Sys::close(STDERR_FILENO);
 	if (dup2(c, STDIN_FILENO) < 0 || dup2(c, STDOUT_FILENO) < 0) {
 	    logError("HylaFAX %s: dup2: %m", (const char*) kind);
@@ -114,10 +165,229 @@ SuperServer::inputReady(int fd)
 }
 
 void
-SuperServer::childStatus(pid_t, int)
+SuperServer::childStatus(pid_t pid, int)
 {
     /*
-     * Nothing to do here - childStatus means it's already been reaped, and
-     * thus off the queue from the Dispatcher
+     * Nothing to do here for per-connection processes -
+     * childStatus means it's already been reaped, and
+     * thus off the queue from the Dispatcher.  A worker
+     * is replaced unless it died without ever becoming
+     * ready (to avoid a fork loop if workers cannot start);
+     * connections are forked for as usual in that case.
      */
+    for (u_int i = 0; workers && i < poolSize; i++) {
+	Worker& w = workers[i];
+	if (w.pid == pid) {
+	    if (w.chan != -1) {
+		Dispatcher::instance().unlink(w.chan);
+		Sys::close(w.chan);
+	    }
+	    bool ready = w.ready;
+	    w.pid = 0;
+	    w.chan = -1;
+	    w.idle = false;
+	    if (ready)
+		(void) spawnWorker(w);
+	    else
+		logError("HylaFAX %s: Worker process %u exited during startup",
+		    (const char*) kind, (u_int) pid);
+	    break;
+	}
+    }
+}
+
+/*
+ * Forget the worker pool in a child process; the child
+ * inherits the master's record of workers (and of its
+ * children in the Dispatcher) and must not act on them.
+ */
+void
+SuperServer::dropWorkers(void)
+{
+    delete [] workers;
+    workers = NULL;
+}
+
+SuperServer::Worker*
+SuperServer::findWorker(int chan)
+{
+    for (u_int i = 0; workers && i < poolSize; i++)
+	if (workers[i].pid != 0 && workers[i].chan == chan)
+	    return (&workers[i]);
+    return (NULL);
+}
+
+/*
+ * Fill the worker pool.
+ */
+void
+SuperServer::startWorkers(void)
+{
+    if (poolSize == 0)
+	return;
+    if (!workers) {
+	workers = new Worker[poolSize];
+	for (u_int i = 0; i < poolSize; i++) {
+	    workers[i].pid = 0;
+	    workers[i].chan = -1;
+	    workers[i].idle = false;
+	    workers[i].ready = false;
+	}
+    }
+    for (u_int i = 0; i < poolSize; i++)
+	if (workers[i].pid == 0 && !spawnWorker(workers[i]))
+	    break;
+}
+
+bool
+SuperServer::spawnWorker(Worker& w)
+{
+    int sv[2];
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, sv) < 0) {
+	logError("HylaFAX %s: socketpair: %m", (const char*) kind);
+	return (false);
+    }
+    pid_t pid = fork();
+    switch (pid) {
+    case 0:				// child
+	Sys::close(sv[0]);
+	runWorker(sv[1]);
+	/*NOTREACHED*/
+    case -1:				// fork failure
+	logError("HylaFAX %s: Cannot fork: %m", (const char*) kind);
+	Sys::close(sv[0]);
+	Sys::close(sv[1]);
+	return (false);
+    }
+    Sys::close(sv[1]);
+    w.pid = pid;
+    w.chan = sv[0];
+    w.idle = false;
+    w.ready = false;
+    Dispatcher::instance().link(w.chan, Dispatcher::ReadMask, this);
+    Dispatcher::instance().startChild(pid, this);
+    return (true);
+}
+
+/*
+ * Pass an accepted connection to an idle worker
+ * using SCM_RIGHTS on the worker's control channel.
+ */
+bool
+SuperServer::passConnection(int c)
+{
+    for (u_int i = 0; workers && i < poolSize; i++) {
+	Worker& w = workers[i];
+	if (!w.idle)
+	    continue;
+	w.idle = false;
+	char b = 'C';
+	struct iovec iov;
+	iov.iov_base = &b;
+	iov.iov_len = 1;
+	union {
+	    struct cmsghdr hdr;
+	    char buf[CMSG_SPACE(sizeof (int))];
+	} cm;
+	memset(&cm, 0, sizeof (cm));
+	struct msghdr msg;
+	memset(&msg, 0, sizeof (msg));
+	msg.msg_iov = &iov;
+	msg.msg_iovlen = 1;
+	msg.msg_control = cm.buf;
+	msg.msg_controllen = sizeof (cm.buf);
+	struct cmsghdr* cmp = CMSG_FIRSTHDR(&msg);
+	cmp->cmsg_level = SOL_SOCKET;
+	cmp->cmsg_type = SCM_RIGHTS;
+	cmp->cmsg_len = CMSG_LEN(sizeof (int));
+	memcpy(CMSG_DATA(cmp), &c, sizeof (int));
+	if (sendmsg(w.chan, &msg, 0) == 1)
+	    return (true);
+	logError("HylaFAX %s: Cannot pass connection to worker %u: %m",
+	    (const char*) kind, (u_int) w.pid);
+    }
+    return (false);
+}
+
+/*
+ * Receive a connection passed by passConnection.
+ */
+static int
+recvConnection(int chan)
+{
+    char b;
+    struct iovec iov;
+    iov.iov_base = &b;
+    iov.iov_len = 1;
+    union {
+	struct cmsghdr hdr;
+	char buf[CMSG_SPACE(sizeof (int))];
+    } cm;
+    struct msghdr msg;
+    memset(&msg, 0, sizeof (msg));
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = cm.buf;
+    msg.msg_controllen = sizeof (cm.buf);
+    int n;
+    while ((n = recvmsg(chan, &msg, 0)) < 0 && errno == EINTR)
+	;
+    if (n != 1)
+	return (-1);
+    struct cmsghdr* cmp = CMSG_FIRSTHDR(&msg);
+    if (!cmp || cmp->cmsg_level != SOL_SOCKET || cmp->cmsg_type != SCM_RIGHTS)
+	return (-1);
+    int c;
+    memcpy(&c, CMSG_DATA(cmp), sizeof (int));
+    return (c);
+}
+
+/*
+ * Worker process.  The protocol server is created and
+ * logging setup once; then the worker repeatedly tells
+ * the master it is ready, waits for a connection, and
+ * serves it.  The configuration is read before the
+ * first connection and again only when a configuration
+ * file changes.  Until the worker has served its quota
+ * of sessions HylaFAXServer::dologout marks the session
+ * over (instead of exiting) and the server's command
+ * loop returns here.  A session that logs in is handed
+ * to a process of its own (see HylaFAXServer::login)
+ * which is reaped here.  Everything else is reset by
+ * the server's initServer.
+ */
+void
+SuperServer::runWorker(int chan)
+{
+    HylaFAXServer* app = newChild();
+    HylaFAXServer::closeLogging();		// close any open syslog fd
+    HylaFAXServer::closeAllDispatched();
+    dropWorkers();
+    Sys::close(STDERR_FILENO);
+    HylaFAXServer::setupLogging();		// reopen syslog before chroot
+    HylaFAXServer::workerChan = chan;
+
+    for (u_int sessions = 1;; sessions++) {
+	HylaFAXServer::poolReuse = (maxSessions == 0 || sessions < maxSessions);
+	HylaFAXServer::sessionOver = false;
+	while (waitpid(-1, NULL, WNOHANG) > 0)	// finished sessions
+	    ;
+	if (sessions == 1 || app->configChanged())
+	    app->configure();
+	if (Sys::write(chan, "R", 1) != 1)	// ready for a connection
+	    _exit(0);
+	int c = recvConnection(chan);
+	if (c < 0)				// master went away
+	    _exit(0);
+	if (dup2(c, STDIN_FILENO) < 0 || dup2(c, STDOUT_FILENO) < 0) {
+	    logError("HylaFAX %s: dup2: %m", (const char*) kind);
+	    _exit(-1);
+	}
+	if (c != STDIN_FILENO && c != STDOUT_FILENO)
+	    Sys::close(c);
+	app->open();				// opening greeting
+	while (!HylaFAXServer::sessionOver)
+	    Dispatcher::instance().dispatch();
+	app->endSession();
+    }
 }
@@ -31,6 +31,24 @@ private:
     int		ntries;
     int		backlog;
     fxStr	kind;
+
+    struct Worker {			// pre-forked worker process
+	pid_t	pid;			// process ID, 0 if slot unused
+	int	chan;			// master end of control channel
+	bool	idle;			// waiting for a connection
+	bool	ready;			// has reported ready at least once
+    };
+    Worker*	workers;		// pool of workers (if any)
+
+    static u_int poolSize;		// # workers kept per server
+    static u_int maxSessions;		// sessions served by a worker
+
+    void startWorkers(void);
+    bool spawnWorker(Worker&);
+    void runWorker(int chan);
+    bool passConnection(int c);
+    Worker* findWorker(int chan);
+    void dropWorkers(void);
 protected:
     SuperServer(const char* kind, int backlog);
 
@@ -45,5 +63,7 @@ public:
 
     const char* getKind(void) const	{ return kind; }
     int getBacklog(void) const		{ return backlog; }
+
+    static void setWorkerPool(u_int workers, u_int sessions);
 };
 #endif /* _SuperServer_ */
@@ -0,0 +1,459 @@
+#! /bin/sh
+#	$Id$
+#
+# HylaFAX Facsimile Software
+#
+# Copyright (c) 2026 iFAX Solutions, Inc.
+# HylaFAX is a trademark of Silicon Graphics
+#
+# Permission to use, copy, modify, distribute, and sell this software and
+# its documentation for any purpose is hereby granted without fee, provided
+# that (i) the above copyright notices and this permission notice appear in
+# all copies of the software and related documentation, and (ii) the names of
+# Sam Leffler and Silicon Graphics may not be used in any advertising or
+# publicity relating to the software without the specific, prior written
+# permission of Sam Leffler and Silicon Graphics.
+#
+# THE SOFTWARE IS PROVIDED "AS-IS" AND WITHOUT WARRANTY OF ANY KIND,
+# EXPRESS, IMPLIED OR OTHERWISE, INCLUDING WITHOUT LIMITATION, ANY
+# WARRANTY OF MERCHANTABILITY OR FITNESS FOR A PARTICULAR PURPOSE.
+#
+# IN NO EVENT SHALL SAM LEFFLER OR SILICON GRAPHICS BE LIABLE FOR
+# ANY SPECIAL, INCIDENTAL, INDIRECT OR CONSEQUENTIAL DAMAGES OF ANY KIND,
+# OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS,
+# WHETHER OR NOT ADVISED OF THE POSSIBILITY OF DAMAGE, AND ON ANY THEORY OF
+# LIABILITY, ARISING OUT OF OR IN CONNECTION WITH THE USE OR PERFORMANCE
+# OF THIS SOFTWARE.
+#
+
+
+#
+# hfaxdtest [-n count] [-c clients] [-w workers] [-m modems] [-z size]
+#	[-b topdir] [-s hfaxd] [-S faxq] [-p port] [-u user] [-k] test ...
+#
+# Run client requests against hfaxd on a scratch spooling area and
+# report how long they take and how much CPU time the server uses.
+#
+# Tests:
+#
+# batch		Like submit, but the jobs are submitted with one JBATCH.
+#
+# connect	Run a number of clients at once (default 4), each of which
+#		connects, logs in, and QUITs count times (default 500).
+#		This is done with a process forked for each connection,
+#		with a pool of workers (default 4) that serve one session
+#		each (-w), and with a pool of workers that serve any
+#		number of sessions (-w -W 0).  The sessions per second
+#		and the server CPU time per session are reported.
+#
+# retr		Retrieve a document of the given size in megabytes
+#		(default 256) count times (default 8) in image mode,
+#		checking the size received.  The transfer rate and
+#		the server CPU time per gigabyte are reported.
+#
+# since		Submit count jobs (default 20) as for submit, kill them
+#		so faxq moves them to the done queue, delete them, and
+#		check that LIST doneq SINCE reports every one removed.
+#		The time taken by the LIST is reported.
+#
+# submit	Submit count jobs (default 2000) in one session, each
+#		with JNEW, JPARM, and JSUBM.  faxq is run to queue the
+#		jobs, which are not sent.  The jobs per second and the
+#		CPU time per job of hfaxd and of faxq are reported.
+#
+# status	Configure a number of modems (default 100), each with a
+#		config file like one made by faxaddmodem for a Class 1
+#		modem and a status file, and list their status count
+#		times (default 500) in one session.  The time and server
+#		CPU time per LIST status are reported.  No faxgetty is
+#		running so each modem's FIFO is found but can not be
+#		opened.
+#
+# Each test is run against a new spooling area with its own hfaxd.
+# hfaxd is taken from topdir/hfaxd, faxq from topdir/faxd, and the
+# client, hfaxdtest, from topdir/util (topdir defaults to the parent of
+# the current directory); another hfaxd or faxq can be given with -s
+# or -S to compare builds.  hfaxd listens
+# on the given port (default 14559) of the loopback interface and must
+# be started by root; the spooling area is given to the fax user
+# (default uucp).  With -k the spooling areas are kept.
+#
+COUNT=
+CLIENTS=4
+WORKERS=4
+MODEMS=100
+SIZE=256
+TOPDIR=..
+HFAXD=
+FAXQ=
+PORT=14559
+FAXUSER=uucp
+KEEP=no
+
+usage()
+{
+    echo "Usage: $0 [-n count] [-c clients] [-w workers] [-m modems] [-z size] [-b topdir] [-s hfaxd] [-S faxq] [-p port] [-u user] [-k] test ..."
+    exit 1
+}
+
+while [ $# -gt 0 ]; do
+    case "$1" in
+    -n)	shift; COUNT=$1;;
+    -c)	shift; CLIENTS=$1;;
+    -w)	shift; WORKERS=$1;;
+    -m)	shift; MODEMS=$1;;
+    -z)	shift; SIZE=$1;;
+    -b)	shift; TOPDIR=$1;;
+    -s)	shift; HFAXD=$1;;
+    -S)	shift; FAXQ=$1;;
+    -p)	shift; PORT=$1;;
+    -u)	shift; FAXUSER=$1;;
+    -k)	KEEP=yes;;
+    -*)	usage;;
+    *)	break;;
+    esac
+    shift
+done
+[ $# -gt 0 ] || usage
+case "$TOPDIR" in
+/*)	;;
+*)	TOPDIR=`pwd`/$TOPDIR;;
+esac
+[ -n "$HFAXD" ] || HFAXD=$TOPDIR/hfaxd/hfaxd
+case "$HFAXD" in
+/*)	;;
+*)	HFAXD=`pwd`/$HFAXD;;
+esac
+[ -n "$FAXQ" ] || FAXQ=$TOPDIR/faxd/faxq
+case "$FAXQ" in
+/*)	;;
+*)	FAXQ=`pwd`/$FAXQ;;
+esac
+CLIENT=$TOPDIR/util/hfaxdtest
+for p in $HFAXD $FAXQ $CLIENT; do
+    [ -x $p ] || { echo "$0: $p: Not found"; exit 1; }
+done
+
+HZ=`getconf CLK_TCK 2>/dev/null || echo 100`
+cputicks()				# CPU clock ticks of a process and its reaped children
+{
+    awk '{ sub(/.*\) /, ""); print $12 + $13 + $14 + $15 }' /proc/$1/stat 2>/dev/null || echo 0
+}
+proccpu()				# CPU clock ticks used by a process and its descendants
+{
+    t=0
+    for p in `ps -e -o pid= -o ppid= | awk -v top=$1 '
+	{ parent[$1] = $2 }
+	END {
+	    for (p in parent)
+		for (q = p; q in parent; q = parent[q])
+		    if (q == top) { print p; break }
+	}'`; do
+	t=`expr $t + \`cputicks $p\``
+    done
+    echo $t
+}
+servercpu()				# CPU clock ticks used by hfaxd and faxq
+{
+    t=`proccpu $HFAXDPID`
+    [ -n "$FAXQPID" ] && t=`expr $t + \`proccpu $FAXQPID\``
+    echo $t
+}
+settle()				# wait for hfaxd to stop using CPU
+{
+    t=`servercpu`
+    while :; do
+	sleep 0.2
+	n=`servercpu`
+	[ "$n" = "$t" ] && break
+	t=$n
+    done
+}
+
+SPOOL=
+HFAXDPID=
+FAXQPID=
+cleanup()
+{
+    [ -n "$HFAXDPID" ] && kill $HFAXDPID 2>/dev/null && wait $HFAXDPID 2>/dev/null
+    [ -n "$FAXQPID" ] && kill $FAXQPID 2>/dev/null && wait $FAXQPID 2>/dev/null
+    HFAXDPID=
+    FAXQPID=
+    if [ -n "$SPOOL" ]; then
+	if [ $KEEP = yes ]; then
+	    echo "Spooling area kept in $SPOOL"
+	else
+	    rm -rf $SPOOL
+	fi
+    fi
+    SPOOL=
+}
+trap 'cleanup; exit 1' 1 2 15
+
+setup()					# create an empty spooling area
+{
+    SPOOL=`mktemp -d /tmp/hfaxdtestXXXXXX` || exit 1
+    for d in archive bin client dev docq doneq etc info log pollq recvq \
+      sendq status tmp; do
+	mkdir $SPOOL/$d
+    done
+    : > $SPOOL/etc/setup.cache
+    echo "127.0.0.1" > $SPOOL/etc/hosts.hfaxd
+    chmod 600 $SPOOL/etc/hosts.hfaxd
+    cat > $SPOOL/etc/config <<EOF2
+LogFacility:		daemon
+CountryCode:		1
+AreaCode:		555
+LongDistancePrefix:	1
+InternationalPrefix:	011
+EOF2
+}
+
+starthfaxd()				# start hfaxd on the spooling area
+{
+    chown -R $FAXUSER $SPOOL || { cleanup; exit 1; }
+    $HFAXD -d -q $SPOOL -i $PORT "$@" > /dev/null 2>&1 &
+    HFAXDPID=$!
+    n=0
+    until $CLIENT -h localhost:$PORT -n 1 status > /dev/null 2>&1; do
+	n=`expr $n + 1`
+	[ $n -gt 50 ] && { echo "$0: hfaxd did not start"; cleanup; exit 1; }
+	sleep 0.1
+    done
+    settle
+}
+
+now()					# wall clock time in seconds
+{
+    date +%s.%N
+}
+
+startfaxq()				# start faxq on the spooling area
+{
+    $FAXQ -D -q $SPOOL > /dev/null 2>&1 &
+    FAXQPID=$!
+    n=0
+    until [ -p $SPOOL/FIFO ]; do
+	n=`expr $n + 1`
+	[ $n -gt 50 ] && { echo "$0: faxq did not start"; cleanup; exit 1; }
+	sleep 0.1
+    done
+}
+
+#
+# Connect, log in, and quit.
+#
+test_connect()
+{
+    count=${COUNT:-500}
+    printf "%-16s  %8s  %12s  %14s\n" "server" "sessions" "sessions/s" "cpu ms/session"
+    for opts in "" "-w $WORKERS" "-w $WORKERS -W 0"; do
+	setup
+	starthfaxd $opts
+	t0=`servercpu`
+	s0=`now`
+	pids=
+	i=0
+	while [ $i -lt $CLIENTS ]; do
+	    $CLIENT -h localhost:$PORT -n $count connect > /dev/null &
+	    pids="$pids $!"
+	    i=`expr $i + 1`
+	done
+	for p in $pids; do
+	    wait $p || { echo "$0: connect: client failed"; cleanup; exit 1; }
+	done
+	s1=`now`
+	settle
+	t1=`servercpu`
+	awk -v o="${opts:-fork}" -v n=`expr $count \* $CLIENTS` -v s=$s0 -v e=$s1 \
+	  -v t=`expr $t1 - $t0` -v hz=$HZ 'BEGIN {
+	    printf "%-16s  %8d  %12.1f  %14.2f\n", o, n, n/(e-s), 1000*t/hz/n
+	}'
+	cleanup
+    done
+}
+
+#
+# Image mode RETR of a large document.
+#
+test_retr()
+{
+    count=${COUNT:-8}
+    setup
+    dd if=/dev/urandom of=$SPOOL/docq/doc1.ps bs=1048576 count=$SIZE 2>/dev/null
+    chmod 644 $SPOOL/docq/doc1.ps
+    starthfaxd
+    t0=`servercpu`
+    out=`$CLIENT -h localhost:$PORT -n $count -f docq/doc1.ps retr` || { cleanup; exit 1; }
+    set -- $out
+    settle
+    t1=`servercpu`
+    [ "$3" -eq `expr $SIZE \* 1048576 \* $count` ] || \
+	{ echo "$0: retr: $3 bytes received for $count transfers"; cleanup; exit 1; }
+    awk -v z=$SIZE -v n=$1 -v s=$2 -v b=$3 -v t=`expr $t1 - $t0` -v hz=$HZ 'BEGIN {
+	printf "%8s  %8s  %12s  %12s\n", "MB", "retrs", "MB/s", "cpu ms/GB"
+	printf "%8d  %8d  %12.0f  %12.0f\n", z, n, b/s/1e6, 1000*t/hz/(b/1e9)
+    }'
+    cleanup
+}
+
+setupjobs()				# spooling area with a document to send
+{
+    setup
+    cat > $SPOOL/test.ps <<EOF2
+%!PS-Adobe-3.0
+/Times-Roman findfont 12 scalefont setfont
+72 720 moveto (hfaxdtest) show
+showpage
+EOF2
+    chown -R $FAXUSER $SPOOL || { cleanup; exit 1; }
+    startfaxq
+    starthfaxd
+}
+
+#
+# Job submission, one job at a time or in a batch.
+#
+test_submit()
+{
+    how=$1
+    count=${COUNT:-2000}
+    printf "%-8s  %8s  %10s  %14s  %14s\n" "test" "jobs" "jobs/s" "hfaxd ms/job" "faxq ms/job"
+    setupjobs
+    h0=`proccpu $HFAXDPID`
+    q0=`proccpu $FAXQPID`
+    out=`$CLIENT -h localhost:$PORT -n $count -f $SPOOL/test.ps $how` || \
+	{ cleanup; exit 1; }
+    set -- $out
+    settle
+    h1=`proccpu $HFAXDPID`
+    q1=`proccpu $FAXQPID`
+    n=`ls $SPOOL/sendq | grep -c '^q'`
+    [ $n -eq $count ] || \
+	{ echo "$0: $how: $n jobs queued, not $count"; cleanup; exit 1; }
+    awk -v w=$how -v n=$1 -v s=$2 -v h=`expr $h1 - $h0` -v q=`expr $q1 - $q0` \
+      -v hz=$HZ 'BEGIN {
+	printf "%-8s  %8d  %10.0f  %14.3f  %14.3f\n", w, n, n/s, 1000*h/hz/n, 1000*q/hz/n
+    }'
+    cleanup
+}
+
+#
+# LIST doneq SINCE after jobs are deleted.
+#
+test_since()
+{
+    count=${COUNT:-20}
+    setupjobs
+    out=`$CLIENT -h localhost:$PORT -n $count -f $SPOOL/test.ps since` || \
+	{ cleanup; exit 1; }
+    set -- $out
+    n=`ls $SPOOL/doneq | grep -c '^q'`
+    [ $n -eq 0 ] || { echo "$0: since: $n jobs left in doneq"; cleanup; exit 1; }
+    awk -v n=$1 -v s=$2 -v r=$3 'BEGIN {
+	printf "%8s  %8s  %12s\n", "jobs", "removed", "ms/list"
+	printf "%8d  %8d  %12.2f\n", n, r, 1000*s
+    }'
+    cleanup
+}
+
+#
+# LIST status with many modems.
+#
+test_status()
+{
+    count=${COUNT:-500}
+    setup
+    i=1
+    while [ $i -le $MODEMS ]; do
+	dev=`printf "ttyB%03d" $i`
+	cat > $SPOOL/etc/config.$dev <<EOF2
+CountryCode:		1
+LongDistancePrefix:	1
+InternationalPrefix:	011
+AreaCode:		555
+DialStringRules:	etc/dialrules
+FAXNumber:		+1.555.000.`printf %04d $i`
+LocalIdentifier:	"hfaxdtest $dev"
+ServerTracing:		1
+SessionTracing:		11
+RecvFileMode:		0600
+LogFileMode:		0600
+DeviceMode:		0600
+GettyArgs:		"-h %l dx_%s"
+QualifyTSI:		""
+SpeakerVolume:		off
+RingsBeforeAnswer:	1
+TagLineFont:		etc/lutRS18.pcf
+TagLineFormat:		"From %%l|%c|Page %%P of %%T"
+MaxBadCalls:		5
+PostScriptTimeout:	300
+MaxSendPages:		25
+MaxRecvPages:		25
+ContCoverPage:		etc/cover.templ
+MaxConcurrentCalls:	1
+TimeOfDay:		"Any"
+ModemRate:		19200
+ModemFlowControl:	rtscts
+ModemSetupDTRCmd:	AT&D2
+ModemSetupDCDCmd:	AT&C1
+ModemDialCmd:		ATDT%s
+ModemResetCmds:		""
+ModemAnswerCmd:		ATA
+ModemNoFlowCmd:		AT&K
+ModemHardFlowCmd:	AT&K3
+ModemSoftFlowCmd:	AT&K4
+ModemNoAutoAnswerCmd:	ATS0=0
+ModemSetVolumeCmd:	"ATM0 ATL0M1 ATL1M1 ATL2M1 ATL3M1"
+ModemEchoOffCmd:	ATE0
+ModemVerboseResultsCmd:	ATV1
+ModemResultCodesCmd:	ATQ0
+ModemOnHookCmd:		ATH0
+ModemSoftResetCmd:	ATZ
+ModemWaitTimeCmd:	ATS7=60
+ModemCommaPauseTimeCmd:	ATS8=2
+ModemRecvFillOrder:	LSB2MSB
+ModemSendFillOrder:	LSB2MSB
+ModemType:		Class1
+Class1Cmd:		AT+FCLASS=1
+Class1PPMWaitCmd:	AT+FTS=7
+Class1TCFWaitCmd:	AT+FTS=7
+Class1EOPWaitCmd:	AT+FTS=9
+Class1SwitchingCmd:	AT+FRS=7
+Class1RecvAbortOK:	200
+Class1FrameOverhead:	4
+Class1RecvIdentTimer:	40000
+Class1TCFMaxNonZero:	10
+Class1TCFMinRun:	1000
+EOF2
+	echo "Running and idle" > $SPOOL/status/$dev
+	mkfifo $SPOOL/FIFO.$dev
+	i=`expr $i + 1`
+    done
+    starthfaxd
+    t0=`servercpu`
+    out=`$CLIENT -h localhost:$PORT -n $count status` || { cleanup; exit 1; }
+    set -- $out
+    settle
+    t1=`servercpu`
+    # one line for the scheduler and one for each modem
+    [ "$3" -eq `expr $MODEMS + 1` ] || \
+	{ echo "$0: status: $3 lines listed for $MODEMS modems"; cleanup; exit 1; }
+    awk -v m=$MODEMS -v n=$1 -v s=$2 -v t=`expr $t1 - $t0` -v hz=$HZ 'BEGIN {
+	printf "%8s  %8s  %12s  %12s\n", "modems", "lists", "ms/list", "cpu ms/list"
+	printf "%8d  %8d  %12.2f  %12.2f\n", m, n, 1000*s/n, 1000*t/hz/n
+    }'
+    cleanup
+}
+
+for test in "$@"; do
+    case "$test" in
+    batch)	test_submit batch;;
+    connect)	test_connect;;
+    retr)	test_retr;;
+    since)	test_since;;
+    status)	test_status;;
+    submit)	test_submit submit;;
+    *)		echo "$0: $test: Unknown test"; exit 1;;
+    esac
+done
@@ -174,7 +174,7 @@ detachFromTTY(void)
 static void
 usage(const char* appName)
 {
-    fatal("usage: %s [-d] [-o port] [-O] [-h port] [-H] [-l bindaddress] [-i port] [-I] [-s port] [-S] [-u socket] [-q queue-directory]",
+    fatal("usage: %s [-d] [-o port] [-O] [-h port] [-H] [-l bindaddress] [-i port] [-I] [-s port] [-S] [-u socket] [-w workers] [-W sessions] [-q queue-directory]",
 	appName);
 }
 
@@ -207,7 +207,7 @@ main(int argc, char** argv, char** envp)
     optind = 1;
     opterr = 0;
     int c;
-    const char* opts = "c:dD:Hh:Ii:Oo:q:Ss:u:l:";
+    const char* opts = "c:dD:Hh:Ii:Oo:q:Ss:u:l:w:W:";
     /*
      * Deduce the spooling directory and whether or not to
      * detach the process from the controlling tty.  The
@@ -223,6 +223,8 @@ main(int argc, char** argv, char** envp)
      */
     fxStr queueDir(FAX_SPOOLDIR);
     int detach = -1;			// unknown state
+    u_int workers = 0;			// fork a process per connection
+    u_int sessions = 1;			// sessions served by each worker
     while ((c = Sys::getopt(argc, argv, opts)) != -1)
 	switch (c) {
 	case 'c':
@@ -240,8 +242,11 @@ main(int argc, char** argv, char** envp)
 	case 'd': detach = false; break;
 	case 'D': HylaFAXServer::_debugSleep = atoi(optarg); break;
 	case 'q': queueDir = optarg; break;
+	case 'w': workers = atoi(optarg); break;
+	case 'W': sessions = atoi(optarg); break;
 	case '?': usage(appName);
 	}
+    SuperServer::setWorkerPool(workers, sessions);
     if (detach == -1)			// no protocol options means -I
 	detach = false;
     if (Sys::chdir(queueDir) < 0)
@@ -177,8 +177,11 @@ protected:
     ~ARRAY();								\
     virtual const char* className() const;				\
     ARRAY& operator=(ARRAY const& a) {					\
-        maxi = a.maxi; num = a.num; if (data) free(data);	\
-        data = memmove(malloc(num), a.data, num); return (*this);}		\
+	if (this != &a) {						\
+	    destroy(); if (data) free(data);				\
+	    maxi = a.num; num = a.num; data = a.raw_copy();		\
+	}								\
+	return (*this);}						\
     ITEM & operator[](u_int index) {					\
       fxAssert(index*sizeof(ITEM) < num, "Invalid Array[] index");	\
       return *(ITEM *)((char *)((void *)data) + index*sizeof(ITEM));	\
@@ -256,7 +259,7 @@ __enddef__
     ARRAY::ARRAY() : fxArray(sizeof(ITEM))				\
 	{ if (data) createElements(data,num); }				\
     ARRAY::ARRAY(ARRAY const& a) : fxArray(a.elementsize) 		\
-	{ maxi = a.maxi; num = a.num; data = a.raw_copy(); }		\
+	{ maxi = a.num; num = a.num; data = a.raw_copy(); }		\
     ARRAY::ARRAY(u_int size) : fxArray(sizeof(ITEM),size)		\
 	{ createElements(data,num); }					\
     ARRAY::~ARRAY() { destroy(); }					\
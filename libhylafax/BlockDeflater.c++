@@ -0,0 +1,490 @@
+/*	$Id$ */
+/*
+ * Copyright (c) 2026 iFAX Solutions, Inc.
+ * HylaFAX is a trademark of Silicon Graphics
+ *
+ * Permission to use, copy, modify, distribute, and sell this software and
+ * its documentation for any purpose is hereby granted without fee, provided
+ * that (i) the above copyright notices and this permission notice appear in
+ * all copies of the software and related documentation, and (ii) the names of
+ * Sam Leffler and Silicon Graphics may not be used in any advertising or
+ * publicity relating to the software without the specific, prior written
+ * permission of Sam Leffler and Silicon Graphics.
+ *
+ * THE SOFTWARE IS PROVIDED "AS-IS" AND WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS, IMPLIED OR OTHERWISE, INCLUDING WITHOUT LIMITATION, ANY
+ * WARRANTY OF MERCHANTABILITY OR FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * IN NO EVENT SHALL SAM LEFFLER OR SILICON GRAPHICS BE LIABLE FOR
+ * ANY SPECIAL, INCIDENTAL, INDIRECT OR CONSEQUENTIAL DAMAGES OF ANY KIND,
+ * OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS,
+ * WHETHER OR NOT ADVISED OF THE POSSIBILITY OF DAMAGE, AND ON ANY THEORY OF
+ * LIABILITY, ARISING OUT OF OR IN CONNECTION WITH THE USE OR PERFORMANCE
+ * OF THIS SOFTWARE.
+ */
+#include "config.h"
+#include "Sys.h"
+#include "BlockDeflater.h"
+#include "zlib.h"
+
+#include <errno.h>
+#include <signal.h>
+#if HAS_PTHREAD
+#include <pthread.h>
+#endif
+
+#define	BLOCKSIZE	(128*1024)	// input bytes per block
+#define	DICTSIZE	(32*1024)	// deflate window carried across blocks
+#define	MAXTHREADS	8		// default limit on compression threads
+
+enum {
+    BLK_FREE,				// slot unused
+    BLK_FILLED,				// input read, not yet dispatched
+    BLK_QUEUED,				// waiting for a compression thread
+    BLK_BUSY,				// being compressed
+    BLK_DONE				// compressed output ready
+};
+
+struct DeflateBlock {
+    u_long	seq;			// position in stream
+    int		state;
+    const Bytef* in;			// input data
+    u_int	inlen;
+    Bytef*	ibuf;			// private input buffer
+    const Bytef* dict;			// preset dictionary
+    u_int	dictlen;
+    Bytef*	dbuf;			// private copy of dictionary
+    Bytef*	out;			// compressed data
+    u_long	outsize;
+    u_long	outlen;
+    u_long	check;			// Adler-32 of input
+    fxStr	emsg;			// compressor error, if any
+
+    DeflateBlock();
+    ~DeflateBlock();
+
+    void compress(int level);
+};
+
+DeflateBlock::DeflateBlock()
+{
+    seq = 0;
+    state = BLK_FREE;
+    in = NULL;
+    inlen = 0;
+    ibuf = NULL;
+    dict = NULL;
+    dictlen = 0;
+    dbuf = NULL;
+    out = NULL;
+    outsize = 0;
+    outlen = 0;
+    check = 0;
+}
+
+DeflateBlock::~DeflateBlock()
+{
+    delete [] ibuf;
+    delete [] dbuf;
+    delete [] out;
+}
+
+/*
+ * Raw-deflate the block, finishing with a sync flush so
+ * that the output ends on a byte boundary with no final
+ * block bit set and can be directly followed by the next
+ * block's output.
+ */
+void
+DeflateBlock::compress(int level)
+{
+    check = adler32(adler32(0L, Z_NULL, 0), in, inlen);
+    outlen = 0;
+    emsg = "";
+
+    z_stream zstream;
+    zstream.zalloc = NULL;
+    zstream.zfree = NULL;
+    zstream.opaque = NULL;
+    zstream.data_type = Z_BINARY;
+    if (deflateInit2(&zstream, level, Z_DEFLATED,
+      -MAX_WBITS, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+	emsg = fxStr::format("Can not initialize compression library: %s",
+	    zstream.msg ? zstream.msg : "unknown error");
+	return;
+    }
+    if (dictlen > 0)
+	(void) deflateSetDictionary(&zstream, dict, dictlen);
+    u_long need = deflateBound(&zstream, inlen) + 16;	// + sync marker
+    if (outsize < need) {
+	delete [] out;
+	out = new Bytef[need];
+	outsize = need;
+    }
+    zstream.next_in = (Bytef*) in;
+    zstream.avail_in = inlen;
+    zstream.next_out = out;
+    zstream.avail_out = (u_int) outsize;
+    int zstate;
+    while ((zstate = deflate(&zstream, Z_SYNC_FLUSH)) == Z_OK &&
+      zstream.avail_out == 0) {
+	/*
+	 * Should not happen given deflateBound, but
+	 * grow the output buffer rather than fail.
+	 */
+	Bytef* nout = new Bytef[2*outsize];
+	memcpy(nout, out, outsize);
+	delete [] out;
+	out = nout;
+	zstream.next_out = out + outsize;
+	zstream.avail_out = (u_int) outsize;
+	outsize *= 2;
+    }
+    if (zstate != Z_OK)
+	emsg = fxStr::format("Compressor error: %s",
+	    zstream.msg ? zstream.msg : "unknown error");
+    else
+	outlen = zstream.total_out;
+    deflateEnd(&zstream);
+}
+
+#if HAS_PTHREAD
+/*
+ * State shared with the compression threads.
+ */
+struct DeflatePool {
+    pthread_mutex_t lock;
+    pthread_cond_t work;		// a block has been queued
+    pthread_cond_t done;		// a block has been compressed
+    pthread_t*	threads;
+    u_int	nthreads;
+    DeflateBlock* blocks;
+    u_int	nblocks;
+    int		level;
+    bool	quit;			// threads should exit
+};
+
+static void*
+deflateWorker(void* arg)
+{
+    DeflatePool& pool = *(DeflatePool*) arg;
+    pthread_mutex_lock(&pool.lock);
+    while (!pool.quit) {
+	/*
+	 * Take the oldest queued block so that
+	 * output is ready in stream order.
+	 */
+	DeflateBlock* b = NULL;
+	for (u_int i = 0; i < pool.nblocks; i++) {
+	    DeflateBlock& bi = pool.blocks[i];
+	    if (bi.state == BLK_QUEUED && (b == NULL || bi.seq < b->seq))
+		b = &bi;
+	}
+	if (b == NULL) {
+	    pthread_cond_wait(&pool.work, &pool.lock);
+	    continue;
+	}
+	b->state = BLK_BUSY;
+	pthread_mutex_unlock(&pool.lock);
+	b->compress(pool.level);
+	pthread_mutex_lock(&pool.lock);
+	b->state = BLK_DONE;
+	pthread_cond_broadcast(&pool.done);
+    }
+    pthread_mutex_unlock(&pool.lock);
+    return (NULL);
+}
+#else
+struct DeflatePool {};
+#endif
+
+BlockDeflater::BlockDeflater(int l, u_int n)
+{
+    level = l;
+    threads = n;
+    totalIn = 0;
+    totalOut = 0;
+    blocks = NULL;
+    nblocks = 0;
+    pool = NULL;
+}
+
+BlockDeflater::~BlockDeflater()
+{
+    stopPool();
+}
+
+void BlockDeflater::setLevel(int l)	{ level = l; }
+void BlockDeflater::setThreads(u_int n)	{ threads = n; }
+
+BlockDeflater::Status
+BlockDeflater::deflate(int fd, Writer put, void* arg, fxStr& emsg)
+{
+    return (run(fd, NULL, 0, put, arg, emsg));
+}
+
+BlockDeflater::Status
+BlockDeflater::deflate(const void* buf, u_long cc, Writer put, void* arg, fxStr& emsg)
+{
+    return (run(-1, (const char*) buf, cc, put, arg, emsg));
+}
+
+/*
+ * Start threads to compress queued blocks.  If no
+ * thread can be started, blocks are compressed in
+ * the calling thread as they are drained.
+ */
+void
+BlockDeflater::startPool(u_int nthreads)
+{
+#if HAS_PTHREAD
+    DeflatePool* p = new DeflatePool;
+    pthread_mutex_init(&p->lock, NULL);
+    pthread_cond_init(&p->work, NULL);
+    pthread_cond_init(&p->done, NULL);
+    p->blocks = blocks;
+    p->nblocks = nblocks;
+    p->level = level;
+    p->quit = false;
+    /*
+     * Block signals in the compression threads so
+     * that they are always handled by the caller.
+     */
+    sigset_t all, omask;
+    sigfillset(&all);
+    pthread_sigmask(SIG_SETMASK, &all, &omask);
+    p->threads = new pthread_t[nthreads];
+    p->nthreads = 0;
+    for (; p->nthreads < nthreads; p->nthreads++)
+	if (pthread_create(&p->threads[p->nthreads], NULL, deflateWorker, p) != 0)
+	    break;
+    pthread_sigmask(SIG_SETMASK, &omask, NULL);
+    if (p->nthreads == 0) {
+	delete [] p->threads;
+	pthread_mutex_destroy(&p->lock);
+	pthread_cond_destroy(&p->work);
+	pthread_cond_destroy(&p->done);
+	delete p;
+    } else
+	pool = p;
+#else
+    (void) nthreads;
+#endif
+}
+
+/*
+ * Stop any compression threads and release the blocks.
+ * This is also done at the start of each run so that
+ * state left behind by a run that was abandoned (e.g.
+ * by a longjmp out of the output function) is reclaimed.
+ */
+void
+BlockDeflater::stopPool()
+{
+#if HAS_PTHREAD
+    if (pool) {
+	pthread_mutex_lock(&pool->lock);
+	pool->quit = true;
+	pthread_cond_broadcast(&pool->work);
+	pthread_mutex_unlock(&pool->lock);
+	for (u_int i = 0; i < pool->nthreads; i++)
+	    pthread_join(pool->threads[i], NULL);
+	delete [] pool->threads;
+	pthread_mutex_destroy(&pool->lock);
+	pthread_cond_destroy(&pool->work);
+	pthread_cond_destroy(&pool->done);
+	delete pool, pool = NULL;
+    }
+#endif
+    delete [] blocks, blocks = NULL;
+    nblocks = 0;
+}
+
+void
+BlockDeflater::queue(DeflateBlock& b)
+{
+#if HAS_PTHREAD
+    pthread_mutex_lock(&pool->lock);
+    b.state = BLK_QUEUED;
+    pthread_cond_signal(&pool->work);
+    pthread_mutex_unlock(&pool->lock);
+#else
+    (void) b;
+#endif
+}
+
+/*
+ * Load the next block of input, either by reading
+ * from fd or by pointing into the caller's buffer.
+ * A block is short only at the end of the input.
+ */
+bool
+BlockDeflater::fill(DeflateBlock& b, int fd, const char* addr, u_long size,
+    u_long& off, fxStr& emsg)
+{
+    if (addr) {
+	b.in = (const Bytef*) addr + off;
+	b.inlen = (u_int) fxmin(size - off, (u_long) BLOCKSIZE);
+    } else {
+	if (b.ibuf == NULL)
+	    b.ibuf = new Bytef[BLOCKSIZE];
+	b.in = b.ibuf;
+	b.inlen = 0;
+	while (b.inlen < BLOCKSIZE) {
+	    int cc = Sys::read(fd, (char*) b.ibuf + b.inlen, BLOCKSIZE - b.inlen);
+	    if (cc == 0)
+		break;
+	    if (cc < 0) {
+		if (errno == EINTR)
+		    continue;
+		emsg = strerror(errno);
+		return (false);
+	    }
+	    b.inlen += cc;
+	}
+    }
+    off += b.inlen;
+    return (true);
+}
+
+/*
+ * Wait for the block to be compressed (or compress
+ * it here if it was never dispatched) and pass the
+ * result to the output function.
+ */
+BlockDeflater::Status
+BlockDeflater::drain(DeflateBlock& b, u_long& check, Writer put, void* arg, fxStr& emsg)
+{
+#if HAS_PTHREAD
+    if (pool && b.state != BLK_FILLED) {
+	pthread_mutex_lock(&pool->lock);
+	while (b.state != BLK_DONE)
+	    pthread_cond_wait(&pool->done, &pool->lock);
+	pthread_mutex_unlock(&pool->lock);
+    } else
+#endif
+    b.compress(level);
+    b.state = BLK_FREE;
+    if (b.emsg != "") {
+	emsg = b.emsg;
+	return (ZLIB_ERROR);
+    }
+    if (!(*put)(arg, (const char*) b.out, (int) b.outlen, emsg))
+	return (WRITE_ERROR);
+    check = adler32_combine(check, b.check, b.inlen);
+    totalIn += b.inlen;
+    totalOut += b.outlen;
+    return (OK);
+}
+
+BlockDeflater::Status
+BlockDeflater::run(int fd, const char* addr, u_long size,
+    Writer put, void* arg, fxStr& emsg)
+{
+    stopPool();				// reclaim an abandoned run
+    totalIn = totalOut = 0;
+
+    u_int nthreads = threads;
+    if (nthreads == 0) {
+#ifdef _SC_NPROCESSORS_ONLN
+	long ncpu = sysconf(_SC_NPROCESSORS_ONLN);
+	nthreads = (ncpu < 1 ? 1 : ncpu > MAXTHREADS ? MAXTHREADS : (u_int) ncpu);
+#else
+	nthreads = 1;
+#endif
+    }
+    /*
+     * Keep two blocks per thread in flight so threads
+     * stay busy while output is being written.  Two
+     * blocks are needed even without threads since each
+     * block takes its dictionary from its predecessor.
+     */
+    nblocks = fxmax(2u, 2*nthreads);
+    blocks = new DeflateBlock[nblocks];
+
+    /*
+     * zlib header: deflate with a 32K window and the
+     * level hint that deflateInit would have chosen.
+     */
+    u_int flevel = (level == Z_DEFAULT_COMPRESSION || level == 6 ? 2 :
+	level < 2 ? 0 : level < 6 ? 1 : 3);
+    u_int head = (0x78 << 8) | (flevel << 6);
+    head += 31 - (head % 31);
+    char hdr[2];
+    hdr[0] = (char) (head >> 8);
+    hdr[1] = (char) head;
+    if (!(*put)(arg, hdr, 2, emsg)) {
+	stopPool();
+	return (WRITE_ERROR);
+    }
+    totalOut += 2;
+
+    Status status = OK;
+    u_long check = adler32(0L, Z_NULL, 0);
+    u_long off = 0;			// input consumed
+    u_long n = 0;			// next block to fill
+    u_long w = 0;			// next block to write
+    for (;; n++) {
+	DeflateBlock& b = blocks[n % nblocks];
+	if (n - w == nblocks) {		// ring full, write the oldest
+	    if ((status = drain(b, check, put, arg, emsg)) != OK)
+		break;
+	    w++;
+	}
+	if (!fill(b, fd, addr, size, off, emsg)) {
+	    status = READ_ERROR;
+	    break;
+	}
+	if (b.inlen == 0)
+	    break;
+	b.seq = n;
+	b.state = BLK_FILLED;
+	b.dictlen = 0;
+	if (n > 0) {
+	    const DeflateBlock& prev = blocks[(n-1) % nblocks];
+	    b.dictlen = fxmin(prev.inlen, (u_int) DICTSIZE);
+	    const Bytef* tail = prev.in + prev.inlen - b.dictlen;
+	    if (addr) {
+		b.dict = tail;
+	    } else {
+		/*
+		 * The previous block's buffer may be refilled
+		 * before this block is compressed; take a copy.
+		 */
+		if (b.dbuf == NULL)
+		    b.dbuf = new Bytef[DICTSIZE];
+		memcpy(b.dbuf, tail, b.dictlen);
+		b.dict = b.dbuf;
+	    }
+	}
+	if (n == 1 && nthreads > 1) {	// more than one block, go parallel
+	    startPool(nthreads);
+	    if (pool)
+		queue(blocks[0]);
+	}
+	if (pool)
+	    queue(b);
+    }
+    for (; status == OK && w < n; w++)
+	status = drain(blocks[w % nblocks], check, put, arg, emsg);
+    if (status == OK) {
+	/*
+	 * Terminate the deflate stream with an empty fixed
+	 * Huffman block that has the final bit set, then
+	 * append the Adler-32 of the uncompressed data.
+	 */
+	char trailer[6];
+	trailer[0] = 0x03;
+	trailer[1] = 0x00;
+	trailer[2] = (char) (check >> 24);
+	trailer[3] = (char) (check >> 16);
+	trailer[4] = (char) (check >> 8);
+	trailer[5] = (char) check;
+	if ((*put)(arg, trailer, sizeof (trailer), emsg))
+	    totalOut += sizeof (trailer);
+	else
+	    status = WRITE_ERROR;
+    }
+    stopPool();
+    return (status);
+}
@@ -0,0 +1,88 @@
+/*	$Id$ */
+/*
+ * Copyright (c) 2026 iFAX Solutions, Inc.
+ * HylaFAX is a trademark of Silicon Graphics
+ *
+ * Permission to use, copy, modify, distribute, and sell this software and
+ * its documentation for any purpose is hereby granted without fee, provided
+ * that (i) the above copyright notices and this permission notice appear in
+ * all copies of the software and related documentation, and (ii) the names of
+ * Sam Leffler and Silicon Graphics may not be used in any advertising or
+ * publicity relating to the software without the specific, prior written
+ * permission of Sam Leffler and Silicon Graphics.
+ *
+ * THE SOFTWARE IS PROVIDED "AS-IS" AND WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS, IMPLIED OR OTHERWISE, INCLUDING WITHOUT LIMITATION, ANY
+ * WARRANTY OF MERCHANTABILITY OR FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * IN NO EVENT SHALL SAM LEFFLER OR SILICON GRAPHICS BE LIABLE FOR
+ * ANY SPECIAL, INCIDENTAL, INDIRECT OR CONSEQUENTIAL DAMAGES OF ANY KIND,
+ * OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS,
+ * WHETHER OR NOT ADVISED OF THE POSSIBILITY OF DAMAGE, AND ON ANY THEORY OF
+ * LIABILITY, ARISING OUT OF OR IN CONNECTION WITH THE USE OR PERFORMANCE
+ * OF THIS SOFTWARE.
+ */
+#ifndef _BlockDeflater_
+#define	_BlockDeflater_
+/*
+ * Block-parallel zlib compression.
+ *
+ * The input is cut into fixed-size blocks that are raw-deflated
+ * independently on a small pool of threads, in the manner of pigz.
+ * Each block is primed with the tail of its predecessor as a preset
+ * dictionary and ends with a sync flush, so the blocks concatenate
+ * into a single deflate stream.  Wrapped in a zlib header and an
+ * Adler-32 trailer combined from the per-block checksums, the result
+ * is an ordinary zlib stream that any inflater can decode.
+ *
+ * Input that fits in one block is compressed in the calling thread;
+ * threads are only started once a second block turns up.
+ */
+#include "Types.h"
+#include "Str.h"
+
+struct DeflateBlock;
+struct DeflatePool;
+
+class BlockDeflater {
+public:
+    enum Status {
+	OK,			// stream completed
+	READ_ERROR,		// error reading input
+	WRITE_ERROR,		// output function failed
+	ZLIB_ERROR		// compressor error
+    };
+    typedef bool (*Writer)(void* arg, const char* buf, int cc, fxStr& emsg);
+private:
+    int		level;		// zlib compression level
+    u_int	threads;	// max compression threads
+    u_long	totalIn;	// bytes consumed
+    u_long	totalOut;	// bytes produced
+    DeflateBlock* blocks;	// ring of blocks in flight
+    u_int	nblocks;
+    DeflatePool* pool;		// compression threads, when running
+
+    Status run(int fd, const char* addr, u_long size,
+	Writer put, void* arg, fxStr& emsg);
+    bool fill(DeflateBlock&, int fd, const char* addr, u_long size,
+	u_long& off, fxStr& emsg);
+    Status drain(DeflateBlock&, u_long& check, Writer put, void* arg, fxStr& emsg);
+    void queue(DeflateBlock&);
+    void startPool(u_int nthreads);
+    void stopPool();
+public:
+    BlockDeflater(int level = -1, u_int threads = 0);
+    ~BlockDeflater();
+
+    void setLevel(int);
+    void setThreads(u_int);
+
+    // compress everything readable from fd
+    Status deflate(int fd, Writer put, void* arg, fxStr& emsg);
+    // compress an in-memory (e.g. mmap'd) buffer
+    Status deflate(const void* buf, u_long cc, Writer put, void* arg, fxStr& emsg);
+
+    u_long getTotalIn() const		{ return totalIn; }
+    u_long getTotalOut() const		{ return totalOut; }
+};
+#endif /* _BlockDeflater_ */
@@ -34,6 +34,7 @@ extern "C" {
 #include <limits.h>
 
 #include "Dispatcher.h"
+#include "EpollDispatcher.h"
 #include "IOHandler.h"
 
 Dispatcher* Dispatcher::_instance;
@@ -95,14 +96,29 @@ bool operator<(timeval src1, timeval src2) {
 
 /*
  * Interface to timers.
+ *
+ * Pending timers are kept in a binary heap ordered by
+ * expiration time (ties are broken by insertion order)
+ * so that insert, cancel, and expire are all O(log n).
+ * Each handler also has a chain of its pending timers
+ * so a timer can be found for cancellation without
+ * searching the heap.  Timer nodes are carved from
+ * blocks and recycled through a free list.
  */
 
 struct Timer {
-    Timer(timeval t, IOHandler* h, Timer* n);
-
     timeval timerValue;
+    u_long seq;			// insertion order for ties
     IOHandler* handler;
-    Timer* next;
+    u_int index;		// position in heap
+    Timer* next;		// next timer for handler/free list
+};
+
+#define	TIMERS_PER_BLOCK	256
+
+struct TimerBlock {
+    TimerBlock* next;
+    Timer timers[TIMERS_PER_BLOCK];
 };
 
 class TimerQueue {
@@ -119,31 +135,47 @@ public:
     void remove(IOHandler*);
     void expire(timeval);
 private:
-    Timer* _first;
+    Timer** _heap;		// heap of pending timers
+    u_int _count;		// # timers in heap
+    u_int _size;		// allocated size of heap
+    u_long _seq;		// next insertion sequence number
+    Timer* _free;		// free list of timer nodes
+    TimerBlock* _blocks;	// blocks of timer nodes
     static timeval _zeroTime;
-};
 
-Timer::Timer(timeval t, IOHandler* h, Timer* n) :
-    timerValue(t),
-    handler(h),
-    next(n) {}
+    static bool before(const Timer*, const Timer*);
+    void place(Timer*, u_int);
+    void siftUp(u_int);
+    void siftDown(u_int);
+    void removeAt(u_int);
+    Timer* alloc();
+    void release(Timer*);
+};
 
 timeval TimerQueue::_zeroTime;
 
-TimerQueue::TimerQueue() :
-    _first(NULL) {}
+TimerQueue::TimerQueue() {
+    _size = 64;
+    _heap = new Timer*[_size];
+    _count = 0;
+    _seq = 0;
+    _free = NULL;
+    _blocks = NULL;
+}
 
 TimerQueue::~TimerQueue() {
-    Timer* doomed = _first;
-    while (doomed != NULL) {
-	Timer* next = doomed->next;
-	delete doomed;
-	doomed = next;
+    while (_count > 0)
+	_heap[--_count]->handler->_timers = NULL;
+    delete [] _heap;
+    while (_blocks != NULL) {
+	TimerBlock* next = _blocks->next;
+	delete _blocks;
+	_blocks = next;
     }
 }
 
 inline bool TimerQueue::isEmpty() const {
-    return _first == NULL;
+    return _count == 0;
 }
 
 inline timeval TimerQueue::zeroTime() {
@@ -151,7 +183,7 @@ inline timeval TimerQueue::zeroTime() {
 }
 
 inline timeval TimerQueue::earliestTime() const {
-    return _first->timerValue;
+    return _heap[0]->timerValue;
 }
 
 timeval TimerQueue::currentTime() {
@@ -160,43 +192,126 @@ timeval TimerQueue::currentTime() {
     return curTime;
 }
 
-void TimerQueue::insert(timeval futureTime, IOHandler* handler) {
-    if (isEmpty() || futureTime < earliestTime()) {
-	_first = new Timer(futureTime, handler, _first);
-    } else {
-	Timer* before = _first;
-	Timer* after = _first->next;
-	while (after != NULL && futureTime > after->timerValue) {
-	    before = after;
-	    after = after->next;
+Timer* TimerQueue::alloc() {
+    if (_free == NULL) {
+	TimerBlock* b = new TimerBlock;
+	b->next = _blocks;
+	_blocks = b;
+	for (u_int i = 0; i < TIMERS_PER_BLOCK; i++) {
+	    b->timers[i].next = _free;
+	    _free = &b->timers[i];
 	}
-	before->next = new Timer(futureTime, handler, after);
     }
+    Timer* t = _free;
+    _free = t->next;
+    return t;
 }
 
-void TimerQueue::remove(IOHandler* handler) {
-    Timer* before = NULL;
-    Timer* doomed = _first;
-    while (doomed != NULL && doomed->handler != handler) {
-	before = doomed;
-	doomed = doomed->next;
+void TimerQueue::release(Timer* t) {
+    t->handler = NULL;
+    t->next = _free;
+    _free = t;
+}
+
+inline bool TimerQueue::before(const Timer* a, const Timer* b) {
+    return a->timerValue < b->timerValue ||
+	(!(b->timerValue < a->timerValue) && a->seq < b->seq);
+}
+
+inline void TimerQueue::place(Timer* t, u_int i) {
+    _heap[i] = t;
+    t->index = i;
+}
+
+void TimerQueue::siftUp(u_int i) {
+    Timer* t = _heap[i];
+    while (i > 0) {
+	u_int parent = (i-1)/2;
+	if (!before(t, _heap[parent]))
+	    break;
+	place(_heap[parent], i);
+	i = parent;
     }
-    if (doomed != NULL) {
-	if (before == NULL) {
-	    _first = doomed->next;
-	} else {
-	    before->next = doomed->next;
-	}
-	delete doomed;
+    place(t, i);
+}
+
+void TimerQueue::siftDown(u_int i) {
+    Timer* t = _heap[i];
+    for (;;) {
+	u_int child = 2*i+1;
+	if (child >= _count)
+	    break;
+	if (child+1 < _count && before(_heap[child+1], _heap[child]))
+	    child++;
+	if (!before(_heap[child], t))
+	    break;
+	place(_heap[child], i);
+	i = child;
+    }
+    place(t, i);
+}
+
+/*
+ * Remove the timer at heap position i; the caller
+ * is responsible for the handler's chain and for
+ * releasing the node.
+ */
+void TimerQueue::removeAt(u_int i) {
+    Timer* last = _heap[--_count];
+    if (i < _count) {
+	place(last, i);
+	if (i > 0 && before(last, _heap[(i-1)/2]))
+	    siftUp(i);
+	else
+	    siftDown(i);
+    }
+}
+
+void TimerQueue::insert(timeval futureTime, IOHandler* handler) {
+    if (_count == _size) {
+	Timer** heap = new Timer*[2*_size];
+	memcpy(heap, _heap, _count*sizeof (Timer*));
+	delete [] _heap;
+	_heap = heap;
+	_size *= 2;
+    }
+    Timer* t = alloc();
+    t->timerValue = futureTime;
+    t->seq = _seq++;
+    t->handler = handler;
+    t->next = handler->_timers;
+    handler->_timers = t;
+    place(t, _count++);
+    siftUp(t->index);
+}
+
+/*
+ * Cancel the handler's earliest pending timer.
+ */
+void TimerQueue::remove(IOHandler* handler) {
+    Timer** prev = NULL;
+    for (Timer** tp = &handler->_timers; *tp != NULL; tp = &(*tp)->next)
+	if (prev == NULL || before(*tp, *prev))
+	    prev = tp;
+    if (prev != NULL) {
+	Timer* doomed = *prev;
+	*prev = doomed->next;
+	removeAt(doomed->index);
+	release(doomed);
     }
 }
 
 void TimerQueue::expire(timeval curTime) {
     while (!isEmpty() && earliestTime() < curTime) {
-	Timer* expired = _first;
-	_first = _first->next;
-	expired->handler->timerExpired(curTime.tv_sec, curTime.tv_usec);
-	delete expired;
+	Timer* expired = _heap[0];
+	IOHandler* handler = expired->handler;
+	Timer** tp = &handler->_timers;
+	while (*tp != expired)
+	    tp = &(*tp)->next;
+	*tp = expired->next;
+	removeAt(0);
+	release(expired);
+	handler->timerExpired(curTime.tv_sec, curTime.tv_usec);
     }
 }
 
@@ -344,8 +459,19 @@ Dispatcher::~Dispatcher() {
     delete _cqueue;
 }
 
+/*
+ * The default dispatcher uses epoll where available;
+ * setting FAXDISPATCHER=select in the environment
+ * forces the select-based implementation.
+ */
 Dispatcher& Dispatcher::instance() {
     if (_instance == NULL) {
+#if HAS_EPOLL
+	const char* cp = getenv("FAXDISPATCHER");
+	if (cp == NULL || strcmp(cp, "select") != 0)
+	    _instance = EpollDispatcher::create();
+	if (_instance == NULL)
+#endif
 	_instance = new Dispatcher;
     }
     return *_instance;
@@ -501,10 +627,18 @@ bool Dispatcher::dispatch(timeval* howlong) {
     return (nfound != 0);
 }
 
+bool Dispatcher::hasChildren() const {
+    return !_cqueue->isEmpty();
+}
+
+bool Dispatcher::childrenReady() const {
+    return _cqueue->isReady();
+}
+
 bool Dispatcher::anyReady() const {
-    if (!_cqueue->isEmpty()) {
+    if (hasChildren()) {
         Dispatcher::sigCLD(0);		// poll for pending children
-        return _cqueue->isReady();
+        return childrenReady();
     }
     for (u_int i = 0; i < _nfds; i++) {
         if (FD_ISSET(i, &_rmaskready) ||
@@ -549,18 +683,20 @@ void Dispatcher::sigCLD(int)
 #define	SA_INTERRUPT	0
 #endif
 
-int Dispatcher::waitFor(
-    fd_set& rmaskret, fd_set& wmaskret, fd_set& emaskret, timeval* howlong
-) {
-    int nfound = 0;
 #if defined(SA_NOCLDSTOP)		// POSIX
-    static struct sigaction sa, osa;
+static struct sigaction sa, osa;
 #elif defined(SV_INTERRUPT)		// BSD-style
-    static struct sigvec sv, osv;
+static struct sigvec sv, osv;
 #else					// System V-style
-    void (*osig)();
+static void (*osig)();
 #endif
 
+/*
+ * Install the SIGCHLD handler while blocked waiting
+ * for I/O so that the wait is interrupted when a child
+ * process terminates.
+ */
+void Dispatcher::catchChildren() {
     if (!_cqueue->isEmpty()) {
 #if defined(SA_NOCLDSTOP)		// POSIX
 	sa.sa_handler = fxSIGACTIONHANDLER(&Dispatcher::sigCLD);
@@ -574,6 +710,26 @@ int Dispatcher::waitFor(
 	osig = (void (*)())signal(SIGCLD, fxSIGHANDLER(&Dispatcher::sigCLD));
 #endif
     }
+}
+
+void Dispatcher::releaseChildren() {
+    if (!_cqueue->isEmpty()) {
+#if defined(SA_NOCLDSTOP)		// POSIX
+	sigaction(SIGCHLD, &osa, (struct sigaction*) 0);
+#elif defined(SV_INTERRUPT)		// BSD-style
+	sigvec(SIGCHLD, &osv, (struct sigvec*) 0);
+#else					// System V-style
+	(void) signal(SIGCLD, fxSIGHANDLER(osig));
+#endif
+    }
+}
+
+int Dispatcher::waitFor(
+    fd_set& rmaskret, fd_set& wmaskret, fd_set& emaskret, timeval* howlong
+) {
+    int nfound = 0;
+
+    catchChildren();
     /*
      * If SIGCLD is pending then it may be delivered on
      * exiting from the kernel after the above sig* call;
@@ -596,15 +752,7 @@ int Dispatcher::waitFor(
 	    howlong = calculateTimeout(howlong);
 	} while (nfound < 0 && !handleError());
     }
-    if (!_cqueue->isEmpty()) {
-#if defined(SA_NOCLDSTOP)		// POSIX
-	sigaction(SIGCHLD, &osa, (struct sigaction*) 0);
-#elif defined(SV_INTERRUPT)		// BSD-style
-	sigvec(SIGCHLD, &osv, (struct sigvec*) 0);
-#else					// System V-style
-	(void) signal(SIGCLD, fxSIGHANDLER(osig));
-#endif
-    }
+    releaseChildren();
 
     return nfound;			// timed out or input available
 }
@@ -646,7 +794,13 @@ void Dispatcher::notify(int nfound,
             nfound--;
         }
     }
+    notifyQueues();
+}
 
+/*
+ * Run any expired timers and collected child processes.
+ */
+void Dispatcher::notifyQueues() {
     if (!_queue->isEmpty()) {
         _queue->expire(TimerQueue::currentTime());
     }
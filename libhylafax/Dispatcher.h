@@ -76,6 +76,11 @@ protected:
     virtual int fillInReady(fd_set&, fd_set&, fd_set&);
     virtual int waitFor(fd_set&, fd_set&, fd_set&, timeval*);
     virtual void notify(int, fd_set&, fd_set&, fd_set&);
+    virtual void notifyQueues();
+    bool hasChildren() const;
+    bool childrenReady() const;
+    void catchChildren();
+    void releaseChildren();
     virtual timeval* calculateTimeout(timeval*) const;
     virtual bool handleError();
     virtual void checkConnections();
@@ -93,10 +98,10 @@ protected:
     IOHandler** _etable;
     TimerQueue* _queue;
     ChildQueue* _cqueue;
-private:
-    static Dispatcher* _instance;
 
     static void sigCLD(int);
+private:
+    static Dispatcher* _instance;
 private:
     /* deny access since member-wise won't work */
     Dispatcher(const Dispatcher&);
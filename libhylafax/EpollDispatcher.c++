@@ -0,0 +1,464 @@
+/*	$Id$ */
+/*
+ * Copyright (c) 2026 iFAX Solutions, Inc.
+ * HylaFAX is a trademark of Silicon Graphics
+ *
+ * Permission to use, copy, modify, distribute, and sell this software and
+ * its documentation for any purpose is hereby granted without fee, provided
+ * that (i) the above copyright notices and this permission notice appear in
+ * all copies of the software and related documentation, and (ii) the names of
+ * Sam Leffler and Silicon Graphics may not be used in any advertising or
+ * publicity relating to the software without the specific, prior written
+ * permission of Sam Leffler and Silicon Graphics.
+ *
+ * THE SOFTWARE IS PROVIDED "AS-IS" AND WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS, IMPLIED OR OTHERWISE, INCLUDING WITHOUT LIMITATION, ANY
+ * WARRANTY OF MERCHANTABILITY OR FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * IN NO EVENT SHALL SAM LEFFLER OR SILICON GRAPHICS BE LIABLE FOR
+ * ANY SPECIAL, INCIDENTAL, INDIRECT OR CONSEQUENTIAL DAMAGES OF ANY KIND,
+ * OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS,
+ * WHETHER OR NOT ADVISED OF THE POSSIBILITY OF DAMAGE, AND ON ANY THEORY OF
+ * LIABILITY, ARISING OUT OF OR IN CONNECTION WITH THE USE OR PERFORMANCE
+ * OF THIS SOFTWARE.
+ */
+
+// EpollDispatcher waits for I/O using the Linux epoll interface.
+#include "Sys.h"			// NB: must be first
+
+#include "EpollDispatcher.h"
+
+#if HAS_EPOLL
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <sys/epoll.h>
+extern "C" {
+#include <sys/time.h>
+}
+
+#include "IOHandler.h"
+
+extern void fxFatal(const char* fmt, ...);
+
+#define	READY_READ	0x1
+#define	READY_WRITE	0x2
+#define	READY_EXCEPT	0x4
+#define	READY_PLAIN	0x8		// fd not supported by epoll
+#define	READY_INSET	0x10		// fd registered with the kernel
+
+static u_int
+maskBit(Dispatcher::DispatcherMask mask)
+{
+    switch (mask) {
+    case Dispatcher::ReadMask:	 return READY_READ;
+    case Dispatcher::WriteMask:	 return READY_WRITE;
+    case Dispatcher::ExceptMask: return READY_EXCEPT;
+    }
+    abort();
+    /*NOTREACHED*/
+    return 0;
+}
+
+/*
+ * Create a dispatcher; NULL is returned if the
+ * kernel does not support epoll.
+ */
+EpollDispatcher* EpollDispatcher::create() {
+    int epfd = epoll_create(64);
+    if (epfd < 0)
+	return NULL;
+    (void) fcntl(epfd, F_SETFD, FD_CLOEXEC);
+    return new EpollDispatcher(epfd);
+}
+
+EpollDispatcher::EpollDispatcher(int epfd) {
+    _epfd = epfd;
+    _pid = getpid();
+    _interest = new u_char[_max_fds];
+    _readybits = new u_char[_max_fds];
+    memset(_interest, 0, _max_fds);
+    memset(_readybits, 0, _max_fds);
+    _maxready = 16;
+    _readyfds = new int[_maxready];
+    _nready = 0;
+    _nplain = 0;
+    _maxevents = 64;
+    _events = new epoll_event[_maxevents];
+}
+
+EpollDispatcher::~EpollDispatcher() {
+    Sys::close(_epfd);
+    delete [] _interest;
+    delete [] _readybits;
+    delete [] _readyfds;
+    delete [] _events;
+}
+
+/*
+ * Grow the per-fd tables so that fd is a valid index.
+ * Unlike select there is no upper bound on the
+ * descriptor values that may be watched.
+ */
+void EpollDispatcher::growTables(u_int fd) {
+    u_int n = _max_fds;
+    while (n <= fd)
+	n *= 2;
+    IOHandler** rtable = new IOHandler*[n];
+    IOHandler** wtable = new IOHandler*[n];
+    IOHandler** etable = new IOHandler*[n];
+    u_char* interest = new u_char[n];
+    u_char* readybits = new u_char[n];
+    for (u_int i = 0; i < n; i++) {
+	if (i < _max_fds) {
+	    rtable[i] = _rtable[i];
+	    wtable[i] = _wtable[i];
+	    etable[i] = _etable[i];
+	    interest[i] = _interest[i];
+	    readybits[i] = _readybits[i];
+	} else {
+	    rtable[i] = wtable[i] = etable[i] = NULL;
+	    interest[i] = readybits[i] = 0;
+	}
+    }
+    delete [] _rtable, _rtable = rtable;
+    delete [] _wtable, _wtable = wtable;
+    delete [] _etable, _etable = etable;
+    delete [] _interest, _interest = interest;
+    delete [] _readybits, _readybits = readybits;
+    _max_fds = n;
+}
+
+void EpollDispatcher::growEvents(u_int n) {
+    if (n > _maxevents) {
+	while (_maxevents < n)
+	    _maxevents *= 2;
+	delete [] _events;
+	_events = new epoll_event[_maxevents];
+    }
+}
+
+IOHandler* EpollDispatcher::handler(int fd, DispatcherMask mask) const {
+    if (fd < 0)
+	abort();
+    if ((unsigned) fd >= _max_fds)
+	return NULL;
+    return Dispatcher::handler(fd, mask);
+}
+
+void EpollDispatcher::link(int fd, DispatcherMask mask, IOHandler* handler) {
+    if (fd < 0)
+	abort();
+    if ((unsigned) fd >= _max_fds)
+	growTables(fd);
+    attach(fd, mask, handler);
+}
+
+void EpollDispatcher::unlink(int fd) {
+    if (fd < 0)
+	abort();
+    if ((unsigned) fd < _max_fds)
+	detach(fd);
+}
+
+/*
+ * An epoll instance is shared across fork, so a child
+ * process (e.g. an hfaxd client session) that changed
+ * the interest set would change its parent's too.  On
+ * first use after a fork build a private instance with
+ * the same contents.
+ */
+void EpollDispatcher::checkFork() {
+    pid_t pid = getpid();
+    if (pid == _pid)
+	return;
+    _pid = pid;
+    rebuild();
+}
+
+/*
+ * Replace the epoll instance with a new one that
+ * holds just the descriptors in the handler tables.
+ */
+void EpollDispatcher::rebuild() {
+    int epfd = epoll_create(64);
+    if (epfd < 0)
+	fxFatal("Dispatcher: epoll_create: %s", strerror(errno));
+    (void) fcntl(epfd, F_SETFD, FD_CLOEXEC);
+    Sys::close(_epfd);
+    _epfd = epfd;
+    _nplain = 0;
+    for (u_int fd = 0; fd < _nfds; fd++) {
+	_interest[fd] = 0;
+	if (_rtable[fd] || _wtable[fd] || _etable[fd])
+	    update(fd);
+    }
+}
+
+/*
+ * Bring the kernel's interest set for fd in line
+ * with the handler tables.  The kernel drops a
+ * descriptor from the set when it is closed, which
+ * we do not see if it was not unlinked first; so
+ * when relink is set the registration is checked
+ * with the kernel even if the bits are unchanged.
+ */
+void EpollDispatcher::update(int fd, bool relink) {
+    checkFork();
+    u_int bits = 0;
+    if (_rtable[fd]) bits |= READY_READ;
+    if (_wtable[fd]) bits |= READY_WRITE;
+    if (_etable[fd]) bits |= READY_EXCEPT;
+    u_int old = _interest[fd];
+    if ((old & READY_PLAIN) && relink && bits != 0) {
+	_nplain--;			// may now be something epoll can watch
+	old = 0;
+    }
+    if (old & READY_PLAIN) {
+	if (bits == 0)
+	    _nplain--;
+	else
+	    bits |= READY_PLAIN;
+	_interest[fd] = bits;
+	return;
+    }
+    bool inset = (old & READY_INSET) != 0;
+    old &= ~READY_INSET;
+    if (bits == old && (inset || bits == 0) && !relink)
+	return;
+    if (bits == 0) {
+	// NB: EBADF/ENOENT means fd was already closed;
+	//     a registration left behind is caught by notify
+	if (inset)
+	    (void) epoll_ctl(_epfd, EPOLL_CTL_DEL, fd, NULL);
+	_interest[fd] = 0;
+	return;
+    }
+    epoll_event ev;
+    memset(&ev, 0, sizeof (ev));
+    ev.data.fd = fd;
+    if (bits & READY_READ)	ev.events |= EPOLLIN;
+    if (bits & READY_WRITE)	ev.events |= EPOLLOUT;
+    if (bits & READY_EXCEPT)	ev.events |= EPOLLPRI;
+    int op = (inset ? EPOLL_CTL_MOD : EPOLL_CTL_ADD);
+    if (epoll_ctl(_epfd, op, fd, &ev) == 0) {
+	bits |= READY_INSET;
+    } else if (op == EPOLL_CTL_ADD && errno == EPERM) {
+	/*
+	 * Regular files and the like can not be watched;
+	 * select always reports them ready so do the same.
+	 */
+	bits |= READY_PLAIN;
+	_nplain++;
+    } else if (op == EPOLL_CTL_ADD && errno == EEXIST) {
+	// fd was closed and reopened without an unlink
+	if (epoll_ctl(_epfd, EPOLL_CTL_MOD, fd, &ev) == 0)
+	    bits |= READY_INSET;
+    } else if (op == EPOLL_CTL_MOD && errno == ENOENT) {
+	// fd was closed (and so dropped) and reopened
+	if (epoll_ctl(_epfd, EPOLL_CTL_ADD, fd, &ev) == 0)
+	    bits |= READY_INSET;
+    }
+    // NB: without READY_INSET the next update tries again
+    _interest[fd] = bits;
+}
+
+void EpollDispatcher::attach(int fd, DispatcherMask mask, IOHandler* handler) {
+    if (fd < 0)
+	return;
+    if (mask == ReadMask) {
+	_rtable[fd] = handler;
+    } else if (mask == WriteMask) {
+	_wtable[fd] = handler;
+    } else if (mask == ExceptMask) {
+	_etable[fd] = handler;
+    } else {
+	abort();
+    }
+    if (_nfds < (unsigned)fd+1) {
+	_nfds = fd+1;
+    }
+    update(fd, true);
+}
+
+void EpollDispatcher::detach(int fd) {
+    _rtable[fd] = NULL;
+    _wtable[fd] = NULL;
+    _etable[fd] = NULL;
+    _readybits[fd] = 0;
+    update(fd);
+    if (_nfds == (unsigned)fd+1) {
+	while (_nfds > 0 && _rtable[_nfds-1] == NULL &&
+	       _wtable[_nfds-1] == NULL && _etable[_nfds-1] == NULL
+	) {
+	    _nfds--;
+	}
+    }
+}
+
+bool EpollDispatcher::setReady(int fd, DispatcherMask mask) {
+    if (handler(fd, mask) == NULL) {
+	return false;
+    }
+    if (_readybits[fd] == 0) {
+	if (_nready == _maxready) {
+	    int* fds = new int[2*_maxready];
+	    memcpy(fds, _readyfds, _nready*sizeof (int));
+	    delete [] _readyfds;
+	    _readyfds = fds;
+	    _maxready *= 2;
+	}
+	_readyfds[_nready++] = fd;
+    }
+    _readybits[fd] |= maskBit(mask);
+    return true;
+}
+
+bool EpollDispatcher::anyReady() const {
+    if (hasChildren()) {
+	Dispatcher::sigCLD(0);		// poll for pending children
+	return childrenReady();
+    }
+    return (_nready > 0);
+}
+
+/*
+ * Move the descriptors marked with setReady into
+ * the event buffer for notification.
+ */
+int EpollDispatcher::fillInReady() {
+    growEvents(_nready);
+    int n = 0;
+    for (u_int i = 0; i < _nready; i++) {
+	int fd = _readyfds[i];
+	u_int bits = _readybits[fd];
+	if (bits == 0)			// detached, or a duplicate
+	    continue;
+	_readybits[fd] = 0;
+	_events[n].data.fd = fd;
+	_events[n].events =
+	      ((bits & READY_READ)   ? EPOLLIN  : 0)
+	    | ((bits & READY_WRITE)  ? EPOLLOUT : 0)
+	    | ((bits & READY_EXCEPT) ? EPOLLPRI : 0);
+	n++;
+    }
+    _nready = 0;
+    return n;
+}
+
+int EpollDispatcher::waitFor(timeval* howlong) {
+    int nfound = 0;
+
+    catchChildren();
+    /*
+     * If SIGCLD is pending then it may be delivered on
+     * exiting from the kernel after the above sig* call;
+     * if so then we don't want to block in epoll_wait.
+     */
+    if (!childrenReady()) {
+	do {
+	    howlong = calculateTimeout(howlong);
+	    int ms;
+	    if (_nplain > 0)
+		ms = 0;
+	    else if (howlong == NULL)
+		ms = -1;
+	    else if (howlong->tv_sec >= INT_MAX/1000)
+		ms = INT_MAX;
+	    else
+		ms = howlong->tv_sec*1000 + (howlong->tv_usec+999)/1000;
+	    nfound = epoll_wait(_epfd, _events, _maxevents, ms);
+	    howlong = calculateTimeout(howlong);
+	} while (nfound < 0 && !handleError());
+    }
+    releaseChildren();
+    if (nfound >= 0 && _nplain > 0) {
+	growEvents(nfound + _nplain);
+	for (u_int fd = 0; fd < _nfds; fd++) {
+	    u_int bits = _interest[fd];
+	    if (bits & READY_PLAIN) {
+		_events[nfound].data.fd = fd;
+		_events[nfound].events =
+		      ((bits & READY_READ)  ? EPOLLIN  : 0)
+		    | ((bits & READY_WRITE) ? EPOLLOUT : 0);
+		nfound++;
+	    }
+	}
+    }
+    return nfound;			// timed out or input available
+}
+
+bool EpollDispatcher::dispatch(timeval* howlong) {
+    checkFork();
+    int nfound = (anyReady()) ? fillInReady() : waitFor(howlong);
+
+    notify(nfound);
+
+    return (nfound != 0);
+}
+
+void EpollDispatcher::notify(int nfound) {
+    bool stale = false;
+    for (int i = 0; i < nfound; i++) {
+	int fd = _events[i].data.fd;
+	u_int events = _events[i].events;
+	if (_interest[fd] == 0) {
+	    /*
+	     * The descriptor was closed before it was unlinked
+	     * while another process still holds it open; the
+	     * kernel keeps reporting it.  It can not be deleted
+	     * through a closed (or reused) descriptor so start
+	     * over with a fresh instance once we're done here.
+	     */
+	    if (epoll_ctl(_epfd, EPOLL_CTL_DEL, fd, NULL) < 0)
+		stale = true;
+	    continue;
+	}
+	/*
+	 * Hangup and error conditions are reported by
+	 * select as the descriptor being ready.
+	 */
+	if (events & (EPOLLERR|EPOLLHUP))
+	    events |= EPOLLIN|EPOLLOUT;
+	if ((events & EPOLLIN) && _rtable[fd]) {
+	    int status = _rtable[fd]->inputReady(fd);
+	    if (status < 0) {
+		detach(fd);
+	    } else if (status > 0) {
+		setReady(fd, ReadMask);
+	    }
+	}
+	if ((events & EPOLLOUT) && _wtable[fd]) {
+	    int status = _wtable[fd]->outputReady(fd);
+	    if (status < 0) {
+		detach(fd);
+	    } else if (status > 0) {
+		setReady(fd, WriteMask);
+	    }
+	}
+	if ((events & EPOLLPRI) && _etable[fd]) {
+	    int status = _etable[fd]->exceptionRaised(fd);
+	    if (status < 0) {
+		detach(fd);
+	    } else if (status > 0) {
+		setReady(fd, ExceptMask);
+	    }
+	}
+    }
+    if (stale)
+	rebuild();
+    notifyQueues();
+}
+
+/*
+ * Drop any descriptors that have been closed
+ * without being unlinked.
+ */
+void EpollDispatcher::checkConnections() {
+    for (u_int fd = 0; fd < _nfds; fd++) {
+	if ((_rtable[fd] || _wtable[fd] || _etable[fd]) &&
+	  fcntl(fd, F_GETFL) < 0 && errno == EBADF)
+	    detach(fd);
+    }
+}
+#endif /* HAS_EPOLL */
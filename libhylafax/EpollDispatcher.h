@@ -0,0 +1,90 @@
+/*	$Id$ */
+/*
+ * Copyright (c) 2026 iFAX Solutions, Inc.
+ * HylaFAX is a trademark of Silicon Graphics
+ *
+ * Permission to use, copy, modify, distribute, and sell this software and
+ * its documentation for any purpose is hereby granted without fee, provided
+ * that (i) the above copyright notices and this permission notice appear in
+ * all copies of the software and related documentation, and (ii) the names of
+ * Sam Leffler and Silicon Graphics may not be used in any advertising or
+ * publicity relating to the software without the specific, prior written
+ * permission of Sam Leffler and Silicon Graphics.
+ *
+ * THE SOFTWARE IS PROVIDED "AS-IS" AND WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS, IMPLIED OR OTHERWISE, INCLUDING WITHOUT LIMITATION, ANY
+ * WARRANTY OF MERCHANTABILITY OR FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * IN NO EVENT SHALL SAM LEFFLER OR SILICON GRAPHICS BE LIABLE FOR
+ * ANY SPECIAL, INCIDENTAL, INDIRECT OR CONSEQUENTIAL DAMAGES OF ANY KIND,
+ * OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS,
+ * WHETHER OR NOT ADVISED OF THE POSSIBILITY OF DAMAGE, AND ON ANY THEORY OF
+ * LIABILITY, ARISING OUT OF OR IN CONNECTION WITH THE USE OR PERFORMANCE
+ * OF THIS SOFTWARE.
+ */
+
+/*
+ * Dispatcher that waits for I/O with the Linux epoll interface.
+ */
+
+#ifndef dp_epolldispatcher_h
+#define dp_epolldispatcher_h
+
+#include "Dispatcher.h"
+
+#if HAS_EPOLL
+struct epoll_event;
+
+/*
+ * The select-based Dispatcher is limited to FD_SETSIZE
+ * descriptors and scans every descriptor each time it
+ * wakes up.  This class keeps the kernel's interest set
+ * in sync with the handler tables and only visits the
+ * descriptors that are reported ready.  Notification is
+ * level-triggered so handlers see the same behaviour as
+ * with select; in particular an end-of-file or error
+ * condition is reported as input (and output) ready.
+ */
+class EpollDispatcher : public Dispatcher {
+public:
+    virtual ~EpollDispatcher();
+
+    static EpollDispatcher* create();
+
+    virtual void link(int fd, DispatcherMask, IOHandler*);
+    virtual IOHandler* handler(int fd, DispatcherMask) const;
+    virtual void unlink(int fd);
+
+    virtual bool setReady(int fd, DispatcherMask);
+protected:
+    EpollDispatcher(int epfd);
+
+    virtual void attach(int fd, DispatcherMask, IOHandler*);
+    virtual void detach(int fd);
+    virtual bool dispatch(timeval*);
+    virtual bool anyReady() const;
+    virtual void checkConnections();
+
+    void checkFork();
+    void rebuild();
+    void growTables(u_int fd);
+    void growEvents(u_int n);
+    void update(int fd, bool relink = false);
+    int fillInReady();
+    int waitFor(timeval*);
+    void notify(int nfound);
+protected:
+    int _epfd;			// epoll instance
+    pid_t _pid;			// process that owns _epfd
+    u_char* _interest;		// per-fd registered event bits
+    u_char* _readybits;		// per-fd pending setReady bits
+    int* _readyfds;		// fds with pending setReady bits
+    u_int _nready;		// # entries in _readyfds
+    u_int _maxready;		// size of _readyfds
+    u_int _nplain;		// # fds epoll can not watch
+    epoll_event* _events;	// results buffer
+    u_int _maxevents;		// size of _events
+};
+#endif
+
+#endif
@@ -27,6 +27,7 @@
 #include "Sys.h"
 #include "FaxClient.h"
 #include "Transport.h"
+#include "BlockDeflater.h"
 #include "zlib.h"
 #include <pwd.h>
 #include <ctype.h>
@@ -262,6 +263,7 @@ FaxClient::setupConfig()
 	(*this).*strings[i].p = (strings[i].def ? strings[i].def : "");
     for (i = N(numbers)-1; i >= 0; i--)
 	(*this).*numbers[i].p = numbers[i].def;
+    zlevel = Z_DEFAULT_COMPRESSION;
     initServerState();
 }
 
@@ -316,6 +318,8 @@ FaxClient::setConfigItem(const char* tag, const char* value)
 	setFileStatusFormat(value);
     } else if (streq(tag, "passivemode")) {
 	pasv = getBoolean(value);
+    } else if (streq(tag, "compressionlevel")) {
+	setCompressionLevel(atoi(value));
     } else
 	return (false);
     return (true);
@@ -476,7 +480,36 @@ bool FaxClient::setType(u_int v)	{ return setCommon(typeParam, v); }
 static const char* modeNames[] = { "", "S", "B", "C", "Z" };
 FaxClient::FaxParam FaxClient::modeParam =
     { "MODE", modeNames, N(modeNames), &FaxClient::mode };
-bool FaxClient::setMode(u_int v)	{ return setCommon(modeParam, v); }
+bool
+FaxClient::setMode(u_int v)
+{
+    /*
+     * A non-default compression level is passed with
+     * MODE Z so that data the server compresses for us
+     * uses the same level as data we send.
+     */
+    if (v == MODE_Z && v != mode && zlevel != Z_DEFAULT_COMPRESSION) {
+	if (command("MODE Z %d", zlevel) != COMPLETE) {
+	    printError("%s", (const char*) lastResponse);
+	    return (false);
+	}
+	mode = v;
+	return (true);
+    }
+    return (setCommon(modeParam, v));
+}
+
+void
+FaxClient::setCompressionLevel(int l)
+{
+    if (l < Z_DEFAULT_COMPRESSION || l > Z_BEST_COMPRESSION) {
+	printWarning(NLS::TEXT("Bad compression level %d, using default."), l);
+	l = Z_DEFAULT_COMPRESSION;
+    }
+    if (l != zlevel && mode == MODE_Z)
+	mode = 0;			// force MODE Z to be resent
+    zlevel = l;
+}
 
 static const char* struNames[] = { "", "F", "R", "P", "T" };
 FaxClient::FaxParam FaxClient::struParam =
@@ -1191,126 +1224,73 @@ bad:
  * and the current transfer parameters.  The server-side
  * document name where data gets placed is returned.
  */
+bool
+FaxClient::putZData(void* arg, const char* buf, int cc, fxStr& emsg)
+{
+    return (((FaxClient*) arg)->sendRawData((void*) buf, cc, emsg));
+}
+
 bool
 FaxClient::sendZData(int fd,
     bool (FaxClient::*store)(fxStr&, fxStr&), fxStr& docname, fxStr& emsg)
 {
-    z_stream zstream;
-    zstream.zalloc = NULL;
-    zstream.zfree = NULL;
-    zstream.opaque = NULL;
-    zstream.data_type = Z_BINARY;
-    if (deflateInit(&zstream, Z_DEFAULT_COMPRESSION) == Z_OK) {
+    BlockDeflater deflater(zlevel);
+    BlockDeflater::Status status;
 #if HAS_MMAP
-	char* addr = (char*) -1;		// mmap'd file
+    char* addr = (char*) -1;		// mmap'd file
 #endif
-	char obuf[32*1024];			// XXX better if page-aligned
-	zstream.next_out = (Bytef*) obuf;
-	zstream.avail_out = sizeof (obuf);
-	struct stat sb;
-	size_t cc;
-	Sys::fstat(fd, sb);
-	if (getVerbose())
-	    traceServer(NLS::TEXT("SEND compressed data, %lu bytes"), (u_long) sb.st_size);
-	if (!initDataConn(emsg))
-	    goto bad;
-	if (!setMode(MODE_Z))
-	    goto bad;
-	if (!(this->*store)(docname, emsg))
-	    goto bad;
-	if (!openDataConn(emsg))
-	    goto bad;
+    struct stat sb;
+    Sys::fstat(fd, sb);
+    if (getVerbose())
+	traceServer(NLS::TEXT("SEND compressed data, %lu bytes"), (u_long) sb.st_size);
+    if (!initDataConn(emsg))
+	goto bad;
+    if (!setMode(MODE_Z))
+	goto bad;
+    if (!(this->*store)(docname, emsg))
+	goto bad;
+    if (!openDataConn(emsg))
+	goto bad;
 #if HAS_MMAP
+    if (sb.st_size > 0)
 	addr = (char*) mmap(NULL, (size_t) sb.st_size, PROT_READ, MAP_SHARED, fd, 0);
-	if (addr == (char*) -1) {		// revert to file reads
-#endif
-	    cc = (size_t) sb.st_size;
-	    while (cc > 0) {
-		char buf[32*1024];
-		int n = fxmin((size_t) cc, sizeof (buf));
-		if (read(fd, buf, n) != n) {
-		    protocolBotch(emsg, NLS::TEXT(" (data read: %s)"), strerror(errno));
-		    goto bad;
-		}
-		zstream.next_in = (Bytef*) buf;
-		zstream.avail_in = n;
-		do {
-		    if (deflate(&zstream, Z_NO_FLUSH) != Z_OK) {
-			emsg = fxStr::format(NLS::TEXT("zlib compressor error: %s"),
-			    zstream.msg);
-			goto bad;
-		    }
-		    if (zstream.avail_out == 0) {
-			if (!sendRawData(obuf, sizeof (obuf), emsg))
-			    goto bad2;
-			zstream.next_out = (Bytef*) obuf;
-			zstream.avail_out = sizeof (obuf);
-		    }
-		} while (zstream.avail_in > 0);
-		cc -= n;
-	    }
-	    zstream.avail_in = 0;
-#if HAS_MMAP
-	} else {
-	    zstream.next_in = (Bytef*) addr;
-	    zstream.avail_in = (u_int) sb.st_size;
-	    do {
-		if (deflate(&zstream, Z_NO_FLUSH) != Z_OK) {
-		    emsg = fxStr::format(NLS::TEXT("zlib compressor error: %s"),
-			zstream.msg);
-		    goto bad;
-		}
-		if (zstream.avail_out == 0) {
-		    if (!sendRawData(obuf, sizeof (obuf), emsg))
-			goto bad2;
-		    zstream.next_out = (Bytef*) obuf;
-		    zstream.avail_out = sizeof (obuf);
-		}
-	    } while (zstream.avail_in > 0);
-	}
+    if (addr != (char*) -1)
+	status = deflater.deflate(addr, (u_long) sb.st_size, putZData, this, emsg);
+    else				// revert to file reads
 #endif
-	int dstate;
-	do {
-	    switch (dstate = deflate(&zstream, Z_FINISH)) {
-	    case Z_STREAM_END:
-	    case Z_OK:
-		if (zstream.avail_out != sizeof (obuf)) {
-		    if (!sendRawData(obuf, sizeof (obuf) - zstream.avail_out, emsg))
-			goto bad2;
-		    zstream.next_out = (Bytef*) obuf;
-		    zstream.avail_out = sizeof (obuf);
-		}
-		break;
-	    default:
-		emsg = fxStr::format(NLS::TEXT("zlib compressor error: %s"),
-		    zstream.msg);
-		goto bad;
-	    }
-	} while (dstate != Z_STREAM_END);
-	if (getVerbose())
-	    traceServer(NLS::TEXT("SEND %lu bytes transmitted (%.1fx compression)"),
+	status = deflater.deflate(fd, putZData, this, emsg);
+    switch (status) {
+    case BlockDeflater::OK:
+	break;
+    case BlockDeflater::READ_ERROR:
+	protocolBotch(emsg, NLS::TEXT(" (data read: %s)"), (const char*) emsg);
+	goto bad;
+    case BlockDeflater::WRITE_ERROR:
+	goto bad2;
+    case BlockDeflater::ZLIB_ERROR:
+	emsg = fxStr::format(NLS::TEXT("zlib compressor error: %s"),
+	    (const char*) emsg);
+	goto bad;
+    }
+    if (getVerbose())
+	traceServer(NLS::TEXT("SEND %lu bytes transmitted (%.1fx compression)"),
 #define	NZ(x)	((x)?(x):1)
-		zstream.total_out, float(sb.st_size) / NZ(zstream.total_out));
-	closeDataConn();
+	    deflater.getTotalOut(), float(sb.st_size) / NZ(deflater.getTotalOut()));
+    closeDataConn();
 #if HAS_MMAP
-	if (addr != (char*) -1)
-	    munmap(addr, (size_t) sb.st_size);
+    if (addr != (char*) -1)
+	munmap(addr, (size_t) sb.st_size);
 #endif
-	deflateEnd(&zstream);
-	return (getReply(false) == COMPLETE);
+    return (getReply(false) == COMPLETE);
 bad2:
-	(void) getReply(false);
-	/* fall thru... */
+    (void) getReply(false);
+    /* fall thru... */
 bad:
-	closeDataConn();
+    closeDataConn();
 #if HAS_MMAP
-	if (addr != (char*) -1)
-	    munmap(addr, (size_t) sb.st_size);
+    if (addr != (char*) -1)
+	munmap(addr, (size_t) sb.st_size);
 #endif
-	deflateEnd(&zstream);
-    } else
-	emsg = fxStr::format(NLS::TEXT("Can not initialize compression library: %s"),
-	    zstream.msg);
     return (false);
 }
 
@@ -120,6 +120,7 @@ private:
     u_int	type;		// data transfer type
     u_int	stru;		// file structure
     u_int	mode;		// data transfer mode
+    int		zlevel;		// compression level for MODE Z
     u_int	format;		// document format
     u_int	tzone;		// use GMT or local timezone for time values
     fxStr	curjob;		// current job's ID
@@ -143,6 +144,7 @@ private:
     void init(void);
 
     bool sendRawData(void* buf, int cc, fxStr& emsg);
+    static bool putZData(void* arg, const char* buf, int cc, fxStr& emsg);
     bool setCommon(FaxParam&, u_int);
 protected:
     FaxClient();
@@ -265,6 +267,8 @@ public:
     bool setType(u_int);
     u_int getMode(void) const;
     bool setMode(u_int);
+    int getCompressionLevel(void) const;
+    void setCompressionLevel(int);
     u_int getStruct(void) const;
     bool setStruct(u_int);
     u_int getFormat(void) const;
@@ -339,6 +343,7 @@ inline bool FaxClient::isPassive(void) const	{ return pasv; }
 inline u_int FaxClient::getType(void) const		{ return type; }
 inline u_int FaxClient::getStruct(void) const		{ return stru; }
 inline u_int FaxClient::getMode(void) const		{ return mode; }
+inline int FaxClient::getCompressionLevel(void) const	{ return zlevel; }
 inline u_int FaxClient::getFormat(void) const		{ return format; }
 inline u_int FaxClient::getTimeZone(void) const		{ return tzone; }
 inline const fxStr& FaxClient::getCurrentJob(void) const{ return curjob; }
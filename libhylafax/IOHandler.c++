@@ -28,7 +28,15 @@
 // Implement conceptually abstract virtual functions in the base class
 // so derived classes don't have to implement unused ones.
 
-IOHandler::IOHandler() {}
+IOHandler::IOHandler() : _timers(NULL) {}
+
+// Pending timers belong to the original object, not to a copy.
+
+IOHandler::IOHandler(const IOHandler&) : _timers(NULL) {}
+
+IOHandler& IOHandler::operator=(const IOHandler&) {
+    return *this;
+}
 
 IOHandler::~IOHandler() {}
 
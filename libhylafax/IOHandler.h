@@ -32,9 +32,13 @@
 // number, handle an exception raised on a file number, or handle a
 // timer's expiration.
 
+struct Timer;
+
 class IOHandler {
 protected:
     IOHandler();
+    IOHandler(const IOHandler&);
+    IOHandler& operator=(const IOHandler&);
 public:
     virtual ~IOHandler();
 
@@ -43,5 +47,8 @@ public:
     virtual int exceptionRaised(int fd);
     virtual void timerExpired(long sec, long usec);
     virtual void childStatus(pid_t pid, int status);
+private:
+    friend class TimerQueue;
+    Timer* _timers;			// pending timers (see Dispatcher)
 };
 #endif
@@ -42,6 +42,20 @@ const fxStr Sequence::format("%09u");
 
 u_long Sequence::getNext(const char* name, fxStr& emsg)
 {
+    return (getNext(name, 1, emsg));
+}
+
+/*
+ * Reserve a block of count consecutive sequence numbers
+ * and return the first.  The block never wraps around
+ * MAXSEQNUM; if it would, numbering restarts at 1.
+ */
+u_long Sequence::getNext(const char* name, u_int count, fxStr& emsg)
+{
+    if (count < 1 || count >= MAXSEQNUM) {
+        emsg = fxStr::format(NLS::TEXT("Invalid sequence number count %u."), count);
+        return ((u_long) -1);
+    }
     struct stat sb;
     int fd;
     int rtn = lstat(name, &sb);
@@ -80,7 +94,9 @@ u_long Sequence::getNext(const char* name, fxStr& emsg)
             name, line);
         seqnum = 1;
     }
-    fxStr line2 = fxStr::format("%u", NEXTSEQNUM(seqnum));
+    if (seqnum + count > MAXSEQNUM)
+        seqnum = 1;
+    fxStr line2 = fxStr::format("%u", NEXTSEQNUM(seqnum + count-1));
     lseek(fd, 0, SEEK_SET);
     int len = line2.length();
     if (Sys::write(fd, (const char*)line2, len) != len ||
@@ -88,6 +104,7 @@ u_long Sequence::getNext(const char* name, fxStr& emsg)
         emsg = fxStr::format(
             NLS::TEXT("Unable update sequence number file %s; write failed."), name);
         logError("%s: Problem updating sequence number file", name);
+        Sys::close(fd);
         return ((u_long) -1);
     }
     Sys::close(fd);			// NB: implicit unlock
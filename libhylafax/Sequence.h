@@ -35,6 +35,7 @@ class Sequence
 {
     public:
 	static u_long getNext(const char* name, fxStr& emsg);
+	static u_long getNext(const char* name, u_int count, fxStr& emsg);
 
 	// static const char* const format;
 	static const fxStr format;
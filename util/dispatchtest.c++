@@ -0,0 +1,236 @@
+/*	$Id$ */
+/*
+ * Copyright (c) 2026 iFAX Solutions, Inc.
+ * HylaFAX is a trademark of Silicon Graphics
+ *
+ * Permission to use, copy, modify, distribute, and sell this software and
+ * its documentation for any purpose is hereby granted without fee, provided
+ * that (i) the above copyright notices and this permission notice appear in
+ * all copies of the software and related documentation, and (ii) the names of
+ * Sam Leffler and Silicon Graphics may not be used in any advertising or
+ * publicity relating to the software without the specific, prior written
+ * permission of Sam Leffler and Silicon Graphics.
+ *
+ * THE SOFTWARE IS PROVIDED "AS-IS" AND WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS, IMPLIED OR OTHERWISE, INCLUDING WITHOUT LIMITATION, ANY
+ * WARRANTY OF MERCHANTABILITY OR FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * IN NO EVENT SHALL SAM LEFFLER OR SILICON GRAPHICS BE LIABLE FOR
+ * ANY SPECIAL, INCIDENTAL, INDIRECT OR CONSEQUENTIAL DAMAGES OF ANY KIND,
+ * OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS,
+ * WHETHER OR NOT ADVISED OF THE POSSIBILITY OF DAMAGE, AND ON ANY THEORY OF
+ * LIABILITY, ARISING OUT OF OR IN CONNECTION WITH THE USE OR PERFORMANCE
+ * OF THIS SOFTWARE.
+ */
+
+/*
+ * Dispatch latency benchmark.
+ *
+ * Usage: dispatchtest [-i iterations] [nidle ...]
+ *
+ * For each count of idle descriptors (default 16, 256, 1000
+ * and 10000) link that many descriptors that never become
+ * ready plus one pipe that is written to and drained once per
+ * iteration, and report the average time taken to write a byte
+ * and have the dispatcher deliver it.  This is done for the
+ * select-based Dispatcher and, where available, EpollDispatcher.
+ * The select-based Dispatcher can not be given descriptors at
+ * or above FD_SETSIZE; those cases are reported as n/a.
+ *
+ * Before timing anything each dispatcher is checked to still
+ * deliver input on a descriptor that was closed without being
+ * unlinked and then reopened and linked with the same mask.
+ */
+#include "Sys.h"
+
+#include <stdlib.h>
+#include <sys/resource.h>
+#include <sys/time.h>
+
+#include "Dispatcher.h"
+#include "EpollDispatcher.h"
+#include "IOHandler.h"
+#include "config.h"
+
+class Drain : public IOHandler {
+public:
+    u_long count;
+
+    Drain() : count(0) {}
+    int inputReady(int fd)
+    {
+	char c;
+	if (Sys::read(fd, &c, 1) == 1)
+	    count++;
+	return (0);
+    }
+};
+
+static bool
+run(Dispatcher& d, bool limited, u_int nidle, u_int iterations, double& us)
+{
+    int idle[2], active[2];
+    if (pipe(idle) < 0 || pipe(active) < 0) {
+	perror("pipe");
+	exit(-1);
+    }
+    /*
+     * Duplicates of one pipe's read end serve as the idle
+     * descriptors so that only nidle+4 descriptors are used.
+     */
+    int* fds = new int[nidle];
+    u_int n;
+    for (n = 0; n < nidle; n++)
+	if ((fds[n] = dup(idle[0])) < 0)
+	    break;
+    bool ok = (n == nidle);
+    if (!ok)
+	fprintf(stderr, "Only %u of %u idle descriptors available\n", n, nidle);
+    // Dispatcher::link aborts on descriptors select can not handle
+    if (ok && limited && fxmax(active[0], n > 0 ? fds[n-1] : 0) >= FD_SETSIZE)
+	ok = false;
+    Drain drain;
+    Drain nothing;
+    if (ok) {
+	for (u_int i = 0; i < nidle; i++)
+	    d.link(fds[i], Dispatcher::ReadMask, &nothing);
+	d.link(active[0], Dispatcher::ReadMask, &drain);
+	timeval start, end;
+	gettimeofday(&start, 0);
+	for (u_int i = 0; i < iterations; i++) {
+	    (void) Sys::write(active[1], "x", 1);
+	    long sec = 1, usec = 0;
+	    d.dispatch(sec, usec);
+	}
+	gettimeofday(&end, 0);
+	for (u_int i = 0; i < nidle; i++)
+	    d.unlink(fds[i]);
+	d.unlink(active[0]);
+	if (drain.count != iterations) {
+	    fprintf(stderr, "Delivered %lu of %u writes\n", drain.count, iterations);
+	    exit(-1);
+	}
+	us = ((end.tv_sec - start.tv_sec)*1e6 + (end.tv_usec - start.tv_usec))
+	    / iterations;
+    }
+    for (u_int i = 0; i < n; i++)
+	Sys::close(fds[i]);
+    delete [] fds;
+    Sys::close(idle[0]), Sys::close(idle[1]);
+    Sys::close(active[0]), Sys::close(active[1]);
+    return (ok);
+}
+
+/*
+ * Link a pipe, close it without unlinking it, open a new pipe
+ * on the same descriptor and link that with the same mask; the
+ * dispatcher must notice input on the new pipe.
+ */
+static bool
+checkRelink(Dispatcher& d)
+{
+    int p[2], q[2];
+    if (pipe(p) < 0) {
+	perror("pipe");
+	exit(-1);
+    }
+    Drain drain;
+    d.link(p[0], Dispatcher::ReadMask, &drain);
+    long sec = 0, usec = 0;
+    d.dispatch(sec, usec);
+    int fd = p[0];
+    Sys::close(p[0]), Sys::close(p[1]);
+    if (pipe(q) < 0) {
+	perror("pipe");
+	exit(-1);
+    }
+    if (q[0] != fd) {				// move it into place
+	if (dup2(q[0], fd) < 0) {
+	    perror("dup2");
+	    exit(-1);
+	}
+	Sys::close(q[0]);
+    }
+    d.link(fd, Dispatcher::ReadMask, &drain);
+    (void) Sys::write(q[1], "x", 1);
+    sec = 1, usec = 0;
+    d.dispatch(sec, usec);
+    d.unlink(fd);
+    Sys::close(fd), Sys::close(q[1]);
+    return (drain.count == 1);
+}
+
+static void
+usage(const char* appName)
+{
+    fprintf(stderr, "usage: %s [-i iterations] [nidle ...]\n", appName);
+    exit(-1);
+}
+
+int
+main(int argc, char* argv[])
+{
+    extern int optind;
+    extern char* optarg;
+    const char* appName = argv[0];
+    u_int iterations = 10000;
+    int c;
+
+    while ((c = getopt(argc, argv, "i:")) != -1)
+	switch (c) {
+	case 'i':
+	    iterations = (u_int) atoi(optarg);
+	    break;
+	case '?':
+	    usage(appName);
+	    /*NOTREACHED*/
+	}
+    static const char* defaults[] = { "16", "256", "1000", "10000" };
+    const char** sizes = (const char**) &argv[optind];
+    int nsizes = argc - optind;
+    if (iterations == 0)
+	usage(appName);
+    if (nsizes == 0) {
+	sizes = defaults;
+	nsizes = sizeof (defaults) / sizeof (defaults[0]);
+    }
+    struct rlimit rl;				// room for the idle descriptors
+    if (getrlimit(RLIMIT_NOFILE, &rl) == 0 && rl.rlim_cur < rl.rlim_max) {
+	rl.rlim_cur = rl.rlim_max;
+	(void) setrlimit(RLIMIT_NOFILE, &rl);
+    }
+
+    Dispatcher* sd = new Dispatcher;
+#if HAS_EPOLL
+    Dispatcher* ed = EpollDispatcher::create();
+#else
+    Dispatcher* ed = NULL;
+#endif
+    int status = 0;
+    if (!checkRelink(*sd)) {
+	fprintf(stderr, "select: no input from a relinked descriptor\n");
+	status = -1;
+    }
+    if (ed && !checkRelink(*ed)) {
+	fprintf(stderr, "epoll: no input from a relinked descriptor\n");
+	status = -1;
+    }
+    printf("%8s  %12s  %12s\n", "idle", "select us", "epoll us");
+    for (int i = 0; i < nsizes; i++) {
+	u_int nidle = (u_int) atoi(sizes[i]);
+	double us;
+	printf("%8u", nidle);
+	if (run(*sd, true, nidle, iterations, us))
+	    printf("  %12.2f", us);
+	else
+	    printf("  %12s", "n/a");
+	if (ed && run(*ed, false, nidle, iterations, us))
+	    printf("  %12.2f", us);
+	else
+	    printf("  %12s", "n/a");
+	printf("\n");
+    }
+    delete sd;
+    delete ed;
+    return (status);
+}
@@ -0,0 +1,463 @@
+/*	$Id$ */
+/*
+ * Copyright (c) 2026 iFAX Solutions, Inc.
+ * HylaFAX is a trademark of Silicon Graphics
+ *
+ * Permission to use, copy, modify, distribute, and sell this software and
+ * its documentation for any purpose is hereby granted without fee, provided
+ * that (i) the above copyright notices and this permission notice appear in
+ * all copies of the software and related documentation, and (ii) the names of
+ * Sam Leffler and Silicon Graphics may not be used in any advertising or
+ * publicity relating to the software without the specific, prior written
+ * permission of Sam Leffler and Silicon Graphics.
+ *
+ * THE SOFTWARE IS PROVIDED "AS-IS" AND WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS, IMPLIED OR OTHERWISE, INCLUDING WITHOUT LIMITATION, ANY
+ * WARRANTY OF MERCHANTABILITY OR FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * IN NO EVENT SHALL SAM LEFFLER OR SILICON GRAPHICS BE LIABLE FOR
+ * ANY SPECIAL, INCIDENTAL, INDIRECT OR CONSEQUENTIAL DAMAGES OF ANY KIND,
+ * OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS,
+ * WHETHER OR NOT ADVISED OF THE POSSIBILITY OF DAMAGE, AND ON ANY THEORY OF
+ * LIABILITY, ARISING OUT OF OR IN CONNECTION WITH THE USE OR PERFORMANCE
+ * OF THIS SOFTWARE.
+ */
+
+/*
+ * Client side of the hfaxd tests (see hfaxd/hfaxdtest.sh).
+ *
+ * Usage: hfaxdtest [-h host] [-n count] [-f file] [-v] test
+ *
+ * Tests:
+ *   batch		submit count jobs to send file with one JBATCH
+ *   connect		connect, log in, and QUIT count times
+ *   retr		RETR file in image mode count times in one session
+ *   since		submit and kill count jobs to send file, delete them
+ *			from the done queue, and check that LIST doneq SINCE
+ *			reports them removed
+ *   status		LIST status count times in one session
+ *   submit		submit count jobs to send file with JNEW, JPARM,
+ *			and JSUBM for each
+ *
+ * The number of operations done and the time they took, in
+ * seconds, are printed on one line followed by anything else
+ * the test reports:
+ *
+ *   retr		the number of bytes received in all
+ *   since		the number of jobs reported removed
+ *   status		the number of lines in the last listing
+ *
+ * The exit status is non-zero if the test could not be done.
+ */
+#include "FaxClient.h"
+#include "StackBuffer.h"
+#include "StrArray.h"
+#include "Sys.h"
+#include "config.h"
+
+#include <sys/time.h>
+#include <errno.h>
+
+class hfaxdTestApp : public FaxClient {
+private:
+    fxStr	appName;
+    u_int	count;			// operations to do
+    fxStr	file;			// file to retrieve or send
+
+    void usage();
+    bool startSession(fxStr& emsg);
+    bool startJob(fxStr& docname, fxStr& emsg);
+    bool listSince(u_int& gen, fxStr& emsg);
+    bool testBatch(fxStr& emsg);
+    bool testConnect(fxStr& emsg);
+    bool testRetr(fxStr& emsg);
+    bool testSince(fxStr& emsg);
+    bool testStatus(fxStr& emsg);
+    bool testSubmit(fxStr& emsg);
+public:
+    hfaxdTestApp();
+    ~hfaxdTestApp();
+
+    bool run(int argc, char** argv);
+};
+
+hfaxdTestApp::hfaxdTestApp() {}
+hfaxdTestApp::~hfaxdTestApp() {}
+
+static double
+now(void)
+{
+    timeval tv;
+    gettimeofday(&tv, 0);
+    return (tv.tv_sec + tv.tv_usec / 1e6);
+}
+
+static bool
+countBytes(void* arg, const char*, int cc, fxStr&)
+{
+    *(u_long*) arg += cc;
+    return (true);
+}
+
+static bool
+countLines(void* arg, const char* buf, int cc, fxStr&)
+{
+    u_long& lines = *(u_long*) arg;
+    for (int i = 0; i < cc; i++)
+	if (buf[i] == '\n')
+	    lines++;
+    return (true);
+}
+
+/*
+ * Connect to the server and log in.
+ */
+bool
+hfaxdTestApp::startSession(fxStr& emsg)
+{
+    if (!callServer(emsg))
+	return (false);
+    if (!login(NULL, emsg)) {
+	hangupServer();
+	return (false);
+    }
+    return (true);
+}
+
+/*
+ * Send the document to be faxed and create a job
+ * whose parameters are inherited by the jobs made
+ * after it.  The jobs are to be sent in two hours
+ * so the scheduler only queues them.
+ */
+bool
+hfaxdTestApp::startJob(fxStr& docname, fxStr& emsg)
+{
+    if (file == "") {
+	emsg = "No document to send (use -f)";
+	return (false);
+    }
+    int fd = Sys::open(file, O_RDONLY);
+    if (fd < 0) {
+	emsg = fxStr::format("%s: %s", (const char*) file, strerror(errno));
+	return (false);
+    }
+    bool ok = setType(TYPE_I) && sendData(fd, &FaxClient::storeTemp, docname, emsg);
+    Sys::close(fd);
+    fxStr jobid, groupid;
+    if (!ok || !newJob(jobid, groupid, emsg))
+	return (false);
+    time_t tts = Sys::now() + 2*60*60;
+    return (jobParm("FROMUSER", getUserName())
+	&& jobParm("NOTIFYADDR", getUserName())
+	&& jobParm("NOTIFY", "none")
+	&& jobLastTime(2*24*60*60)
+	&& jobParm("MAXDIALS", (u_int) 3)
+	&& jobParm("VRES", (u_int) 196)
+	&& jobParm("PAGEWIDTH", (u_int) 209)
+	&& jobParm("PAGELENGTH", (u_int) 296)
+	&& jobSendTime(*gmtime(&tts)));
+}
+
+/*
+ * Submit count jobs one at a time, each a copy
+ * of the one before.
+ */
+bool
+hfaxdTestApp::testSubmit(fxStr& emsg)
+{
+    if (!startSession(emsg))
+	return (false);
+    fxStr docname;
+    bool ok = startJob(docname, emsg);
+    u_int i;
+    double start = now();
+    for (i = 0; ok && i < count; i++) {
+	fxStr jobid, groupid;
+	fxStr number = fxStr::format("555%04u", i);
+	ok = (i == 0 || newJob(jobid, groupid, emsg))
+	    && jobParm("DIALSTRING", number)
+	    && jobParm("EXTERNAL", number)
+	    && jobDocument(docname)
+	    && jobSubmit(getCurrentJob());
+    }
+    double secs = now() - start;
+    hangupServer();
+    if (ok)
+	printf("%u %.6f\n", i, secs);
+    return (ok);
+}
+
+/*
+ * Submit count jobs with one JBATCH command.
+ */
+bool
+hfaxdTestApp::testBatch(fxStr& emsg)
+{
+    if (!startSession(emsg))
+	return (false);
+    fxStr docname;
+    bool ok = startJob(docname, emsg) && jobDocument(docname);
+    fxStackBuffer numbers;
+    for (u_int i = 0; i < count; i++)
+	numbers.fput("555%04u\n", i);
+    double start = now();
+    if (ok && initDataConn(emsg)) {
+	ok = (command("JBATCH") == PRELIM && openDataConn(emsg));
+	if (ok) {
+	    int fd = getDataFd();
+	    const char* cp = numbers;
+	    for (u_int cc = numbers.getLength(); ok && cc > 0; ) {
+		int n = Sys::write(fd, cp, cc);
+		if (n <= 0) {
+		    emsg = fxStr::format("Data write: %s", strerror(errno));
+		    ok = false;
+		} else
+		    cp += n, cc -= n;
+	    }
+	}
+	closeDataConn();
+	ok = ok && getReply(false) == COMPLETE;
+    } else
+	ok = false;
+    double secs = now() - start;
+    hangupServer();
+    if (ok)
+	printf("%u %.6f\n", count, secs);
+    return (ok);
+}
+
+/*
+ * Open, log in to, and close count sessions one after
+ * the other.
+ */
+bool
+hfaxdTestApp::testConnect(fxStr& emsg)
+{
+    bool ok = true;
+    u_int i;
+    double start = now();
+    for (i = 0; ok && i < count; i++) {
+	ok = startSession(emsg);
+	if (ok) {
+	    ok = (command("QUIT") == COMPLETE);
+	    hangupServer();
+	}
+    }
+    double secs = now() - start;
+    if (ok)
+	printf("%u %.6f\n", i, secs);
+    return (ok);
+}
+
+/*
+ * Retrieve a file in image mode count times in one session.
+ */
+bool
+hfaxdTestApp::testRetr(fxStr& emsg)
+{
+    if (file == "") {
+	emsg = "No file to retrieve (use -f)";
+	return (false);
+    }
+    if (!startSession(emsg))
+	return (false);
+    bool ok = setType(TYPE_I);
+    u_long bytes = 0;
+    u_int i;
+    double start = now();
+    for (i = 0; ok && i < count; i++)
+	ok = recvData(countBytes, &bytes, emsg, 0,
+	    "RETR %s", (const char*) file);
+    double secs = now() - start;
+    hangupServer();
+    if (ok)
+	printf("%u %.6f %lu\n", i, secs, bytes);
+    return (ok);
+}
+
+/*
+ * List the done queue changes since a generation
+ * of the job status index and return the generation
+ * given in the reply.
+ */
+bool
+hfaxdTestApp::listSince(u_int& gen, fxStr& emsg)
+{
+    u_long lines = 0;
+    if (!recvData(countLines, &lines, emsg, 0,
+      "LIST doneq SINCE %u", gen))
+	return (false);
+    const fxStr& resp = getLastResponse();
+    u_int l = resp.find(0, "generation ");
+    if (l == resp.length()) {
+	emsg = "No generation in reply: " | resp;
+	return (false);
+    }
+    gen = (u_int) atoi(&resp[l + 11]);
+    return (true);
+}
+
+/*
+ * Submit count jobs and kill them so they move to
+ * the done queue, delete them, and check that every
+ * one is reported removed by LIST doneq SINCE.
+ */
+bool
+hfaxdTestApp::testSince(fxStr& emsg)
+{
+    if (!startSession(emsg))
+	return (false);
+    fxStr docname;
+    bool ok = startJob(docname, emsg);
+    fxStrArray jobids;
+    u_int i;
+    for (i = 0; ok && i < count; i++) {
+	fxStr jobid, groupid;
+	fxStr number = fxStr::format("555%04u", i);
+	ok = (i == 0 || newJob(jobid, groupid, emsg))
+	    && jobParm("DIALSTRING", number)
+	    && jobDocument(docname)
+	    && jobSubmit(getCurrentJob());
+	if (ok)
+	    jobids.append(getCurrentJob());
+    }
+    for (i = 0; ok && i < jobids.length(); i++)
+	ok = jobKill(jobids[i]);
+    u_int gen = 0;
+    ok = ok && setType(TYPE_A) && listSince(gen, emsg);
+    /*
+     * NB: not jobDelete; after the first deletion the server's
+     *     current job is the default job, not the client's.
+     */
+    for (i = 0; ok && i < jobids.length(); i++)
+	ok = (command("JDELE %s", (const char*) jobids[i]) == COMPLETE);
+    double start = now();
+    ok = ok && listSince(gen, emsg);
+    double secs = now() - start;
+    u_int removed = 0;
+    if (ok) {
+	/*
+	 * Removed jobs are named, several to a line, in
+	 * "Removed:" lines before the final reply.
+	 */
+	fxStr lines(getLastContinuation());
+	for (i = 0; i < jobids.length(); i++) {
+	    for (u_int l = 0; l < lines.length(); ) {
+		u_int e = lines.next(l, " \n");
+		if (lines.extract(l, e-l) == jobids[i]) {
+		    removed++;
+		    break;
+		}
+		l = lines.skip(e, " \n");
+	    }
+	}
+	if (removed != jobids.length()) {
+	    emsg = fxStr::format("%u of %u deleted jobs reported removed",
+		removed, jobids.length());
+	    ok = false;
+	}
+    }
+    hangupServer();
+    if (ok)
+	printf("%u %.6f %u\n", jobids.length(), secs, removed);
+    return (ok);
+}
+
+/*
+ * List the modem status count times in one session.
+ */
+bool
+hfaxdTestApp::testStatus(fxStr& emsg)
+{
+    if (!startSession(emsg))
+	return (false);
+    bool ok = setType(TYPE_A);
+    u_long lines = 0;
+    u_int i;
+    double start = now();
+    for (i = 0; ok && i < count; i++) {
+	lines = 0;
+	ok = recvData(countLines, &lines, emsg, 0, "LIST status");
+    }
+    double secs = now() - start;
+    hangupServer();
+    if (ok)
+	printf("%u %.6f %lu\n", i, secs, lines);
+    return (ok);
+}
+
+bool
+hfaxdTestApp::run(int argc, char** argv)
+{
+    extern int optind;
+    extern char* optarg;
+    int c;
+
+    appName = argv[0];
+    u_int l = appName.length();
+    appName = appName.tokenR(l, '/');
+
+    resetConfig();
+    readConfig(FAX_SYSCONF);
+    readConfig(FAX_USERCONF);
+
+    count = 100;
+    while ((c = Sys::getopt(argc, argv, "f:h:n:v")) != -1)
+	switch (c) {
+	case 'f':			// file to retrieve
+	    file = optarg;
+	    break;
+	case 'h':			// server's host
+	    setHost(optarg);
+	    break;
+	case 'n':
+	    count = (u_int) atoi(optarg);
+	    break;
+	case 'v':			// protocol tracing
+	    setVerbose(true);
+	    break;
+	case '?':
+	    usage();
+	    /*NOTREACHED*/
+	}
+    if (argc - optind != 1 || count == 0)
+	usage();
+    fxStr test(argv[optind]);
+    fxStr emsg;
+    bool ok = false;
+    if (test == "batch")
+	ok = testBatch(emsg);
+    else if (test == "connect")
+	ok = testConnect(emsg);
+    else if (test == "retr")
+	ok = testRetr(emsg);
+    else if (test == "since")
+	ok = testSince(emsg);
+    else if (test == "status")
+	ok = testStatus(emsg);
+    else if (test == "submit")
+	ok = testSubmit(emsg);
+    else
+	usage();
+    if (!ok) {
+	if (emsg == "")
+	    emsg = getLastResponse();
+	printError("%s: %s", (const char*) test, (const char*) emsg);
+    }
+    return (ok);
+}
+
+void
+hfaxdTestApp::usage()
+{
+    fxFatal(_("usage: %s [-h host] [-n count] [-f file] [-v] batch|connect|retr|since|status|submit"),
+	(const char*) appName);
+}
+
+int
+main(int argc, char** argv)
+{
+    hfaxdTestApp app;
+    return (app.run(argc, argv) ? 0 : -1);
+}